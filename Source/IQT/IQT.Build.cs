@@ -49,6 +49,8 @@ public class IQT : ModuleRules
             {
                 "CoreUObject",
                 "Engine",
+                "Json",
+                "Sockets",
                 "Slate",
                 "SlateCore"
             }
@@ -6,6 +6,15 @@
 
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
+#include "IQT_Log.h"
+#include "IQT_LatencyStats.h"
+#include "Misc/CoreDelegates.h"
+
+// Categorias de log da IQT (declaradas em IQT_Log.h).
+DEFINE_LOG_CATEGORY(LogIQT);
+DEFINE_LOG_CATEGORY(LogIOTQueue);
+DEFINE_LOG_CATEGORY(LogIQTInternal);
+DEFINE_LOG_CATEGORY(LogIQTTasks);
 
 /**
  * FIQTModule: Main module class for the IQT plugin.
@@ -20,15 +29,24 @@ public:
     {
         // This code will execute after your module is loaded into memory;
         // the exact timing is specified in the .uplugin file per-module
-        UE_LOG(LogTemp, Log, TEXT("IQT Module: StartupModule called. IQT Plugin is initializing."));
+        UE_LOG(LogIQT, Log, TEXT("IQT Module: StartupModule called. IQT Plugin is initializing."));
+
+        // Publica os percentis de latência no CSV profiler ao fim de cada frame (apenas durante capturas).
+        EndFrameHandle = FCoreDelegates::OnEndFrame.AddLambda([]() { FIQT_LatencyRegistry::Get().ExportToCsvProfiler(); });
     }
 
     virtual void ShutdownModule() override
     {
         // This function may be called during shutdown to clean up your module.
         // For modules that are dynamically unloaded, we must clean up anything that was loaded.
-        UE_LOG(LogTemp, Log, TEXT("IQT Module: ShutdownModule called. IQT Plugin is shutting down."));
+        UE_LOG(LogIQT, Log, TEXT("IQT Module: ShutdownModule called. IQT Plugin is shutting down."));
+
+        FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+        EndFrameHandle.Reset();
     }
+
+private:
+    FDelegateHandle EndFrameHandle;
 };
 
 // This macro implements the module.
@@ -0,0 +1,116 @@
+﻿// IQT/Source/IQT/Private/IQT_ASCCacheSubsystem.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_ASCCacheSubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "GameFramework/Actor.h"
+
+UIQT_ASCCacheSubsystem* UIQT_ASCCacheSubsystem::Get(const UObject* WorldContextObject)
+{
+    UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+    return World ? World->GetSubsystem<UIQT_ASCCacheSubsystem>() : nullptr;
+}
+
+UAbilitySystemComponent* UIQT_ASCCacheSubsystem::ResolveASC(AActor* Actor)
+{
+    if (!IsValid(Actor))
+    {
+        return nullptr;
+    }
+
+    if (UWorld* World = Actor->GetWorld())
+    {
+        if (UIQT_ASCCacheSubsystem* Cache = World->GetSubsystem<UIQT_ASCCacheSubsystem>())
+        {
+            return Cache->FindOrResolveASC(Actor);
+        }
+    }
+    return UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Actor);
+}
+
+UAbilitySystemComponent* UIQT_ASCCacheSubsystem::FindOrResolveASC(AActor* Actor)
+{
+    if (!IsValid(Actor))
+    {
+        return nullptr;
+    }
+
+    const TObjectKey<AActor> ActorKey(Actor);
+    if (const TWeakObjectPtr<UAbilitySystemComponent>* Cached = CachedASCs.Find(ActorKey))
+    {
+        UAbilitySystemComponent* CachedASC = Cached->Get();
+        if (IsCachedASCValidFor(CachedASC, Actor))
+        {
+            return CachedASC;
+        }
+    }
+
+    // Falta no cache ou entrada obsoleta (ASC destruído ou trocado): resolve novamente.
+    UAbilitySystemComponent* ResolvedASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Actor);
+    if (ResolvedASC)
+    {
+        CachedASCs.Add(ActorKey, ResolvedASC);
+    }
+    else
+    {
+        // Atores sem ASC não são guardados, para que um ASC adicionado depois seja encontrado.
+        CachedASCs.Remove(ActorKey);
+    }
+    return ResolvedASC;
+}
+
+bool UIQT_ASCCacheSubsystem::IsCachedASCValidFor(const UAbilitySystemComponent* ASC, const AActor* Actor)
+{
+    if (!IsValid(ASC))
+    {
+        return false;
+    }
+    // Um ASC pode viver em outro ator (ex.: PlayerState) e apontar para o ator consultado como avatar.
+    return ASC->GetOwner() == Actor || ASC->GetOwnerActor() == Actor || ASC->GetAvatarActor_Direct() == Actor;
+}
+
+void UIQT_ASCCacheSubsystem::InvalidateActor(AActor* Actor)
+{
+    if (Actor)
+    {
+        CachedASCs.Remove(TObjectKey<AActor>(Actor));
+    }
+}
+
+void UIQT_ASCCacheSubsystem::InvalidateAll()
+{
+    CachedASCs.Reset();
+}
+
+void UIQT_ASCCacheSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+    Super::Initialize(Collection);
+
+    if (UWorld* World = GetWorld())
+    {
+        ActorDestroyedHandle = World->AddOnActorDestroyedHandler(FOnActorDestroyed::FDelegate::CreateUObject(this, &UIQT_ASCCacheSubsystem::HandleActorDestroyed));
+    }
+}
+
+void UIQT_ASCCacheSubsystem::Deinitialize()
+{
+    if (UWorld* World = GetWorld())
+    {
+        World->RemoveOnActorDestroyededHandler(ActorDestroyedHandle);
+    }
+    ActorDestroyedHandle.Reset();
+    CachedASCs.Empty();
+
+    Super::Deinitialize();
+}
+
+void UIQT_ASCCacheSubsystem::HandleActorDestroyed(AActor* Actor)
+{
+    InvalidateActor(Actor);
+}
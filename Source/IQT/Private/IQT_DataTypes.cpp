@@ -0,0 +1,71 @@
+﻿// IQT/Source/IQT/Private/IQT_DataTypes.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_DataTypes.h"
+#include "UObject/UObjectGlobals.h"
+
+const FIQT_QueueItemDispatchData& FIQT_SharedDispatchData::Get() const
+{
+    static const FIQT_QueueItemDispatchData Defaults;
+    return Data.IsValid() ? *Data : Defaults;
+}
+
+FIQT_QueueItemDispatchData& FIQT_SharedDispatchData::GetMutable()
+{
+    if (!Data.IsValid())
+    {
+        Data = MakeShared<FIQT_QueueItemDispatchData, ESPMode::ThreadSafe>();
+    }
+    else if (!Data.IsUnique())
+    {
+        // Outra cópia do item ainda lê este bloco: a escrita vai para um bloco só desta cópia.
+        Data = MakeShared<FIQT_QueueItemDispatchData, ESPMode::ThreadSafe>(*Data);
+    }
+    return *Data;
+}
+
+bool FIQT_SharedDispatchData::Serialize(FArchive& Ar)
+{
+    bool bHasData = Data.IsValid();
+    Ar << bHasData;
+    if (Ar.IsLoading())
+    {
+        // Nunca escreve no bloco lido: ele pode estar compartilhado com outras cópias do item.
+        Data = bHasData ? MakeShared<FIQT_QueueItemDispatchData, ESPMode::ThreadSafe>() : nullptr;
+    }
+    if (bHasData)
+    {
+        FIQT_QueueItemDispatchData::StaticStruct()->SerializeItem(Ar, Data.Get(), nullptr);
+    }
+    return true;
+}
+
+bool FIQT_SharedDispatchData::Identical(const FIQT_SharedDispatchData* Other, uint32 PortFlags) const
+{
+    if (!Other)
+    {
+        return false;
+    }
+    return Data == Other->Data || FIQT_QueueItemDispatchData::StaticStruct()->CompareScriptStruct(&Get(), &Other->Get(), PortFlags);
+}
+
+void FIQT_SharedDispatchData::AddStructReferencedObjects(FReferenceCollector& Collector)
+{
+    if (Data.IsValid())
+    {
+        Collector.AddPropertyReferencesWithStructARO(FIQT_QueueItemDispatchData::StaticStruct(), Data.Get());
+    }
+}
+
+FIQT_QueueItemDispatchData UIQT_QueueItemLibrary::GetQueueItemDispatchData(const FIQT_QueueItem& Item)
+{
+    return Item.GetDispatchData();
+}
+
+void UIQT_QueueItemLibrary::SetQueueItemDispatchData(FIQT_QueueItem& Item, const FIQT_QueueItemDispatchData& DispatchData)
+{
+    Item.GetMutableDispatchData() = DispatchData;
+}
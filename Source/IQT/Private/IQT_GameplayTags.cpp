@@ -0,0 +1,15 @@
+﻿// IQT/Source/IQT/Private/IQT_GameplayTags.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_GameplayTags.h"
+
+namespace IQTGameplayTags
+{
+    UE_DEFINE_GAMEPLAY_TAG_COMMENT(Action_Timeout, "IQT.Action.Timeout", "Ação enfileirada na IQT expirou antes de emitir a tag de fim ou de falha.");
+    UE_DEFINE_GAMEPLAY_TAG_COMMENT(Action_DispatchFailed, "IQT.Action.DispatchFailed", "Ação retirada da fila da IQT que não pôde ser disparada (TriggerData inválida, alvo sem ASC ou espera sem tags de fim/falha).");
+    UE_DEFINE_GAMEPLAY_TAG_COMMENT(Item_Duplicate, "IQT.Item.Duplicate", "Item recusado pela fila ao ser reinserido porque já há outro com a mesma chave; não conta como falha da ação.");
+    UE_DEFINE_GAMEPLAY_TAG_COMMENT(Item_Rejected, "IQT.Item.Rejected", "Item recusado pela fila ao ser reinserido (inválido); não conta como falha da ação.");
+}
@@ -0,0 +1,333 @@
+﻿// IQT/Source/IQT/Private/IQT_LatencyStats.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_LatencyStats.h"
+#include "IQT_Queue.h"
+#include "HAL/IConsoleManager.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+// UE 5.5+ separa as estatísticas do CSV profiler em CSV_PROFILER_STATS.
+#if defined(CSV_PROFILER_STATS)
+    #define IQT_WITH_CSV_PROFILER CSV_PROFILER_STATS
+#else
+    #define IQT_WITH_CSV_PROFILER CSV_PROFILER
+#endif
+
+#if IQT_WITH_CSV_PROFILER
+CSV_DEFINE_CATEGORY(IQT, true);
+#endif
+
+static bool GIQTLatencyCsvExport = true;
+static FAutoConsoleVariableRef CVarIQTLatencyCsvExport(
+    TEXT("iqt.Latency.CsvExport"),
+    GIQTLatencyCsvExport,
+    TEXT("Publica os percentis de latência da IQT (espera na fila e execução) no CSV profiler durante uma captura."));
+
+// As séries por tag exigem uma busca no mapa sob o Lock a cada desenfileiramento; fora do caminho quente por padrão.
+static bool GIQTLatencyPerTag = false;
+static FAutoConsoleVariableRef CVarIQTLatencyPerTag(
+    TEXT("iqt.Latency.PerTag"),
+    GIQTLatencyPerTag,
+    TEXT("Registra também os histogramas de latência por AbilityTriggerTag (custa um lock de leitura por amostra)."));
+
+static FAutoConsoleCommand CmdIQTLatencyReset(
+    TEXT("iqt.Latency.Reset"),
+    TEXT("Zera os histogramas de latência da IQT."),
+    FConsoleCommandDelegate::CreateLambda([]() { FIQT_LatencyRegistry::Get().ResetAll(); }));
+
+// ---------------------------------------------------------------------------
+// FIQT_LatencyHistogram
+// ---------------------------------------------------------------------------
+
+FIQT_LatencyHistogram::FIQT_LatencyHistogram()
+{
+    Reset();
+}
+
+int32 FIQT_LatencyHistogram::GetBucketIndex(uint64 Microseconds)
+{
+    if (Microseconds < static_cast<uint64>(SubBucketCount))
+    {
+        return static_cast<int32>(Microseconds);
+    }
+    // Faixa = posição do bit mais alto; sub-faixa = os SubBucketBits seguintes.
+    const int32 HighBit = static_cast<int32>(FPlatformMath::FloorLog2_64(Microseconds));
+    const int32 Major = HighBit - SubBucketBits + 1;
+    if (Major >= MajorBucketCount)
+    {
+        return NumBuckets - 1;
+    }
+    const int32 Sub = static_cast<int32>((Microseconds >> (HighBit - SubBucketBits)) & (SubBucketCount - 1));
+    return Major * SubBucketCount + Sub;
+}
+
+uint64 FIQT_LatencyHistogram::GetBucketLowerBound(int32 BucketIndex)
+{
+    const int32 Major = BucketIndex / SubBucketCount;
+    const uint64 Sub = static_cast<uint64>(BucketIndex % SubBucketCount);
+    return Major == 0 ? Sub : (SubBucketCount + Sub) << (Major - 1);
+}
+
+uint64 FIQT_LatencyHistogram::GetBucketWidth(int32 BucketIndex)
+{
+    const int32 Major = BucketIndex / SubBucketCount;
+    return Major == 0 ? 1 : uint64(1) << (Major - 1);
+}
+
+void FIQT_LatencyHistogram::RecordSeconds(double Seconds)
+{
+    RecordMicroseconds(static_cast<uint64>(FMath::Max(0.0, Seconds) * 1000000.0));
+}
+
+void FIQT_LatencyHistogram::RecordMicroseconds(uint64 Microseconds)
+{
+    Buckets[GetBucketIndex(Microseconds)].fetch_add(1, std::memory_order_relaxed);
+    Count.fetch_add(1, std::memory_order_relaxed);
+    SumMicroseconds.fetch_add(Microseconds, std::memory_order_relaxed);
+
+    uint64 PrevMax = MaxMicroseconds.load(std::memory_order_relaxed);
+    while (Microseconds > PrevMax && !MaxMicroseconds.compare_exchange_weak(PrevMax, Microseconds, std::memory_order_relaxed))
+    {
+    }
+}
+
+void FIQT_LatencyHistogram::Reset()
+{
+    for (std::atomic<uint32>& Bucket : Buckets)
+    {
+        Bucket.store(0, std::memory_order_relaxed);
+    }
+    Count.store(0, std::memory_order_relaxed);
+    SumMicroseconds.store(0, std::memory_order_relaxed);
+    MaxMicroseconds.store(0, std::memory_order_relaxed);
+}
+
+uint64 FIQT_LatencyHistogram::GetValueAtQuantile(double Quantile) const
+{
+    // Soma os baldes (e não Count) para que o resultado seja consistente mesmo com gravações concorrentes.
+    uint64 Total = 0;
+    for (const std::atomic<uint32>& Bucket : Buckets)
+    {
+        Total += Bucket.load(std::memory_order_relaxed);
+    }
+    if (Total == 0)
+    {
+        return 0;
+    }
+
+    const uint64 Target = FMath::Max<uint64>(1, static_cast<uint64>(FMath::CeilToDouble(FMath::Clamp(Quantile, 0.0, 1.0) * static_cast<double>(Total))));
+    uint64 Cumulative = 0;
+    for (int32 Index = 0; Index < NumBuckets; ++Index)
+    {
+        Cumulative += Buckets[Index].load(std::memory_order_relaxed);
+        if (Cumulative >= Target)
+        {
+            // Ponto médio da sub-faixa, limitado ao máximo observado.
+            const uint64 Mid = GetBucketLowerBound(Index) + GetBucketWidth(Index) / 2;
+            return FMath::Min(Mid, MaxMicroseconds.load(std::memory_order_relaxed));
+        }
+    }
+    return MaxMicroseconds.load(std::memory_order_relaxed);
+}
+
+FIQT_LatencyPercentiles FIQT_LatencyHistogram::GetPercentiles() const
+{
+    FIQT_LatencyPercentiles Result;
+    Result.SampleCount = static_cast<int64>(GetCount());
+    if (Result.SampleCount > 0)
+    {
+        Result.P50Ms = GetValueAtQuantile(0.50) / 1000.0f;
+        Result.P95Ms = GetValueAtQuantile(0.95) / 1000.0f;
+        Result.P99Ms = GetValueAtQuantile(0.99) / 1000.0f;
+        Result.MeanMs = static_cast<float>(SumMicroseconds.load(std::memory_order_relaxed) / static_cast<double>(Result.SampleCount) / 1000.0);
+        Result.MaxMs = MaxMicroseconds.load(std::memory_order_relaxed) / 1000.0f;
+    }
+    return Result;
+}
+
+// ---------------------------------------------------------------------------
+// FIQT_LatencySeries / FIQT_LatencyRegistry
+// ---------------------------------------------------------------------------
+
+FIQT_LatencySeries::FIQT_LatencySeries(const FString& InSeriesName)
+    : SeriesName(InSeriesName)
+{
+    static const TCHAR* Suffixes[] = { TEXT("WaitP50"), TEXT("WaitP95"), TEXT("WaitP99"), TEXT("ExecP50"), TEXT("ExecP95"), TEXT("ExecP99") };
+    for (int32 Index = 0; Index < UE_ARRAY_COUNT(Suffixes); ++Index)
+    {
+        CsvStatNames[Index] = FName(*FString::Printf(TEXT("%s/%s"), *SeriesName, Suffixes[Index]));
+    }
+}
+
+FIQT_LatencyRegistry& FIQT_LatencyRegistry::Get()
+{
+    static FIQT_LatencyRegistry Instance;
+    return Instance;
+}
+
+FIQT_LatencySeries* FIQT_LatencyRegistry::AcquireQueueSeries(FName QueueName)
+{
+    if (QueueName.IsNone())
+    {
+        return nullptr;
+    }
+    FWriteScopeLock WriteLock(Lock);
+    FQueueSeriesEntry& Entry = QueueSeries.FindOrAdd(QueueName);
+    if (!Entry.Series.IsValid())
+    {
+        Entry.Series = MakeUnique<FIQT_LatencySeries>(FString::Printf(TEXT("Queue.%s"), *QueueName.ToString()));
+    }
+    ++Entry.NumRefs;
+    return Entry.Series.Get();
+}
+
+void FIQT_LatencyRegistry::ReleaseQueueSeries(FIQT_LatencySeries* Series)
+{
+    if (!Series)
+    {
+        return;
+    }
+    // Busca pelo ponteiro: o QueueName da fila pode ter mudado desde que ela obteve a série.
+    FWriteScopeLock WriteLock(Lock);
+    for (TMap<FName, FQueueSeriesEntry>::TIterator It = QueueSeries.CreateIterator(); It; ++It)
+    {
+        if (It.Value().Series.Get() == Series)
+        {
+            if (--It.Value().NumRefs <= 0)
+            {
+                It.RemoveCurrent();
+            }
+            return;
+        }
+    }
+}
+
+FIQT_LatencySeries& FIQT_LatencyRegistry::FindOrAddTagSeries(FGameplayTag Tag)
+{
+    {
+        FReadScopeLock ReadLock(Lock);
+        if (const TUniquePtr<FIQT_LatencySeries>* Found = TagSeries.Find(Tag))
+        {
+            return **Found;
+        }
+    }
+    FWriteScopeLock WriteLock(Lock);
+    TUniquePtr<FIQT_LatencySeries>& Series = TagSeries.FindOrAdd(Tag);
+    if (!Series.IsValid())
+    {
+        Series = MakeUnique<FIQT_LatencySeries>(FString::Printf(TEXT("Tag.%s"), *Tag.ToString()));
+    }
+    return *Series;
+}
+
+const FIQT_LatencySeries* FIQT_LatencyRegistry::FindQueueSeries(FName QueueName) const
+{
+    FReadScopeLock ReadLock(Lock);
+    const FQueueSeriesEntry* Found = QueueSeries.Find(QueueName);
+    return Found ? Found->Series.Get() : nullptr;
+}
+
+const FIQT_LatencySeries* FIQT_LatencyRegistry::FindTagSeries(FGameplayTag Tag) const
+{
+    FReadScopeLock ReadLock(Lock);
+    const TUniquePtr<FIQT_LatencySeries>* Found = TagSeries.Find(Tag);
+    return Found ? Found->Get() : nullptr;
+}
+
+void FIQT_LatencyRegistry::RecordQueueWait(FIQT_LatencySeries* InQueueSeries, FGameplayTag Tag, double Seconds)
+{
+    if (InQueueSeries)
+    {
+        InQueueSeries->QueueWait.RecordSeconds(Seconds);
+    }
+    if (GIQTLatencyPerTag && Tag.IsValid())
+    {
+        FindOrAddTagSeries(Tag).QueueWait.RecordSeconds(Seconds);
+    }
+}
+
+void FIQT_LatencyRegistry::RecordExecution(FIQT_LatencySeries* InQueueSeries, FGameplayTag Tag, double Seconds)
+{
+    if (InQueueSeries)
+    {
+        InQueueSeries->Execution.RecordSeconds(Seconds);
+    }
+    if (GIQTLatencyPerTag && Tag.IsValid())
+    {
+        FindOrAddTagSeries(Tag).Execution.RecordSeconds(Seconds);
+    }
+}
+
+void FIQT_LatencyRegistry::ResetAll()
+{
+    FReadScopeLock ReadLock(Lock);
+    for (const TPair<FName, FQueueSeriesEntry>& Pair : QueueSeries)
+    {
+        Pair.Value.Series->QueueWait.Reset();
+        Pair.Value.Series->Execution.Reset();
+    }
+    for (const TPair<FGameplayTag, TUniquePtr<FIQT_LatencySeries>>& Pair : TagSeries)
+    {
+        Pair.Value->QueueWait.Reset();
+        Pair.Value->Execution.Reset();
+    }
+}
+
+void FIQT_LatencyRegistry::ExportToCsvProfiler() const
+{
+#if IQT_WITH_CSV_PROFILER
+    if (!GIQTLatencyCsvExport || !FCsvProfiler::Get()->IsCapturing())
+    {
+        return;
+    }
+
+    const auto ExportSeries = [](const FIQT_LatencySeries& Series)
+    {
+        const FIQT_LatencyPercentiles Wait = Series.QueueWait.GetPercentiles();
+        const FIQT_LatencyPercentiles Exec = Series.Execution.GetPercentiles();
+        const float Values[] = { Wait.P50Ms, Wait.P95Ms, Wait.P99Ms, Exec.P50Ms, Exec.P95Ms, Exec.P99Ms };
+        for (int32 Index = 0; Index < UE_ARRAY_COUNT(Values); ++Index)
+        {
+            FCsvProfiler::RecordCustomStat(Series.CsvStatNames[Index], CSV_CATEGORY_INDEX(IQT), Values[Index], ECsvCustomStatOp::Set);
+        }
+    };
+
+    FReadScopeLock ReadLock(Lock);
+    for (const TPair<FName, FQueueSeriesEntry>& Pair : QueueSeries)
+    {
+        ExportSeries(*Pair.Value.Series);
+    }
+    for (const TPair<FGameplayTag, TUniquePtr<FIQT_LatencySeries>>& Pair : TagSeries)
+    {
+        ExportSeries(*Pair.Value);
+    }
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// UIQT_LatencyStatsLibrary
+// ---------------------------------------------------------------------------
+
+bool UIQT_LatencyStatsLibrary::GetQueueLatency(const UIQT_Queue* Queue, FIQT_LatencyPercentiles& OutQueueWait, FIQT_LatencyPercentiles& OutExecution)
+{
+    const FIQT_LatencySeries* Series = Queue ? FIQT_LatencyRegistry::Get().FindQueueSeries(Queue->QueueName) : nullptr;
+    OutQueueWait = Series ? Series->QueueWait.GetPercentiles() : FIQT_LatencyPercentiles();
+    OutExecution = Series ? Series->Execution.GetPercentiles() : FIQT_LatencyPercentiles();
+    return Series != nullptr;
+}
+
+bool UIQT_LatencyStatsLibrary::GetTagLatency(FGameplayTag AbilityTriggerTag, FIQT_LatencyPercentiles& OutQueueWait, FIQT_LatencyPercentiles& OutExecution)
+{
+    const FIQT_LatencySeries* Series = FIQT_LatencyRegistry::Get().FindTagSeries(AbilityTriggerTag);
+    OutQueueWait = Series ? Series->QueueWait.GetPercentiles() : FIQT_LatencyPercentiles();
+    OutExecution = Series ? Series->Execution.GetPercentiles() : FIQT_LatencyPercentiles();
+    return Series != nullptr;
+}
+
+void UIQT_LatencyStatsLibrary::ResetLatencyStats()
+{
+    FIQT_LatencyRegistry::Get().ResetAll();
+}
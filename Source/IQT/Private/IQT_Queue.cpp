@@ -6,10 +6,18 @@
 
 #include "IQT_Queue.h" 
 #include "Internal/IQT_PriorityQueueInternal.h" 
+#include "Internal/IQT_TraceRing.h"
+#include "Internal/IQT_Stats.h"
+#include "Internal/IQT_Broker.h"
+#include "IQT_QueueGroupSubsystem.h"
+#include "IQT_LatencyStats.h"
+#include "IQT_GameplayTags.h"
+#include "GameFramework/Actor.h"
+#include "Engine/World.h"
 // NOTA: "Internal/IQT_PriorityQueueInternal.h" AGORA É INCLUÍDO DIRETAMENTE EM "IQT_Queue.h" para resolver o TUniquePtr
 // A linha abaixo foi comentada pois o include já está no .h do UIQT_Queue.
 // #include "Internal/IQT_PriorityQueueInternal.h" 
-DEFINE_LOG_CATEGORY(LogIOTQueue);
+// NOTA: A categoria LogIOTQueue agora é definida em IQT.cpp junto com as demais categorias da IQT (IQT_Log.h).
 
 
 
@@ -17,49 +25,193 @@ UIQT_Queue::UIQT_Queue()
     : EnqueueMode(EIQT_QueueMode::PriorityOrder) 
     , bIgnoreDuplicatesOnEnqueue(true)          
     , MaxQueueSize(0)                           
+    , ReserveCapacity(0)
+    , OverflowPolicy(EIQT_OverflowPolicy::Reject)
+    , OverflowBlockTimeoutSeconds(0.05f)
+    , AgingRatePerSecond(0.0f)
+    , UtilityCandidateWindow(0)
+    , SpillInMemoryBudget(0)
+    , bStealWhenIdle(true)
+    , StealBatchSize(4)
+    , bEnableDeadLetterQueue(true)
+    , MaxDeadLetterItems(100)
+    , BrokerBatchSize(32)
+    , BrokerPrefetchCount(1)
     , NextFIFOPriorityCounter(0)                
     , NextFILOPriorityCounter(TNumericLimits<int32>::Max()) 
+    , InternalQueue(nullptr)
+    , LatencySeries(nullptr)
+    , PublishedDepth(0)
+    , NumInFlight(0)
+    , AppliedAgingRate(0.0f)
+    , AppliedMaxQueueSize(0)
+    , AppliedOverflowPolicy(EIQT_OverflowPolicy::Reject)
+    , AppliedBlockTimeoutSeconds(0.0f)
+    , AppliedSpillBudget(0)
 {
-    // A alocação da InternalQueue ainda ocorre aqui, mas a definição completa
-    // de UIQT_PriorityQueueInternal já é conhecida devido ao include em IQT_Queue.h
-    InternalQueue = MakeShared<UIQT_PriorityQueueInternal>();
-    InternalQueue->Init(); 
+    // A InternalQueue não é criada aqui: CDO, arquétipos e componentes que nunca passam de
+    // FIQT_SmallQueue::Capacity itens não pagam a alocação. Ver EnsureInternalQueue.
+}
+
+bool UIQT_Queue::CanUseInlineStorage() const
+{
+    // A fila pequena só ordena por Priority e só recusa com a fila cheia: envelhecimento, utilidade, políticas de
+    // estouro, spill e roubo entre filas do grupo dependem dos índices da fila interna.
+    return EnqueueMode != EIQT_QueueMode::UtilityScore
+        && !(EnqueueMode == EIQT_QueueMode::PriorityOrder && AgingRatePerSecond > 0.0f)
+        && OverflowPolicy == EIQT_OverflowPolicy::Reject
+        && SpillInMemoryBudget <= 0
+        && !RegisteredSharingGroup.IsValid();
+}
+
+bool UIQT_Queue::EnsureInternalQueue()
+{
+    if (!SmallQueue.IsActive() && GetInternalQueue())
+    {
+        return true;
+    }
+    // Em destruição: o armazenamento liberado em BeginDestroy não é recriado.
+    if (HasAnyFlags(RF_BeginDestroyed))
+    {
+        return false;
+    }
+    // A trava da fila pequena serializa a criação: quem chega depois encontra a fila interna já com os itens.
+    SmallQueue.Promote([this](TArray<FIQT_QueueItem>&& Items, uint32 NextGeneration)
+    {
+        // Só acontece com IQT_SMALL_QUEUE_CAPACITY = 0, em que Promote não se desativa sozinho.
+        if (GetInternalQueue())
+        {
+            return;
+        }
+        // Configurada e inicializada antes de publicada: outra thread que veja o ponteiro vê uma fila pronta, com
+        // MaxQueueSize, estouro, spill e envelhecimento já valendo qualquer que seja a operação que a promoveu.
+        TSharedPtr<UIQT_PriorityQueueInternal> NewQueue = MakeShared<UIQT_PriorityQueueInternal>();
+        NewQueue->Init();
+        ApplyQueueSettings(*NewQueue);
+        NewQueue->Adopt(MoveTemp(Items), NextGeneration);
+        InternalQueueOwner = NewQueue;
+        InternalQueue.store(NewQueue.Get(), std::memory_order_release);
+    });
+    return GetInternalQueue() != nullptr;
+}
+
+void UIQT_Queue::OnRegister()
+{
+    Super::OnRegister();
+    // OnRegister se repete (ex.: reregistro do componente no editor): os contadores acumulados são mantidos.
+    // Por QueueName, e não pelo nome da instância: stats e contadores de trace criados nunca são liberados.
+    if (!Counters.IsValid())
+    {
+        Counters = QueueName.IsNone() ? MakeShared<FIQT_QueueCounters>(FString()) : TSharedPtr<FIQT_QueueCounters>(FIQT_QueueCounters::FindOrAdd(QueueName));
+        // Itens e ações anteriores ao registro já estão nos agregados; entram também nos contadores do nome.
+        Counters->AddDepth(PublishedDepth.load());
+        Counters->AddInFlight(NumInFlight.load());
+    }
+    PublishCounters(0);
+    SetSharingGroup(SharingGroup);
+}
+
+void UIQT_Queue::OnUnregister()
+{
+    if (RegisteredSharingGroup.IsValid())
+    {
+        if (UIQT_QueueGroupSubsystem* Groups = UIQT_QueueGroupSubsystem::Get(this))
+        {
+            Groups->UnregisterQueue(RegisteredSharingGroup, this);
+        }
+        RegisteredSharingGroup = FGameplayTag();
+    }
+    ReleaseLatencySeries();
+    Super::OnUnregister();
 }
 
 void UIQT_Queue::BeginDestroy()
 {
-    InternalQueue.Reset(); 
+    // Só a parte desta fila sai dos contadores: outras filas de mesmo QueueName continuam somando neles.
+    const int32 RemainingDepth = PublishedDepth.exchange(0);
+    const int32 RemainingInFlight = NumInFlight.exchange(0);
+    DEC_DWORD_STAT_BY(STAT_IQT_QueuedItems, RemainingDepth);
+    DEC_DWORD_STAT_BY(STAT_IQT_InFlightActions, RemainingInFlight);
+    if (Counters.IsValid())
+    {
+        Counters->AddDepth(-RemainingDepth);
+        Counters->AddInFlight(-RemainingInFlight);
+        Counters.Reset();
+    }
+    ReleaseLatencySeries();
+    DisconnectFromBroker();
+    StopBroker();
+    // Desativa a fila pequena (descartando os itens): nada volta a ser guardado inline durante a destruição.
+    SmallQueue.Promote([](TArray<FIQT_QueueItem>&&, uint32) {});
+    InternalQueue.store(nullptr, std::memory_order_release);
+    InternalQueueOwner.Reset();
     Super::BeginDestroy();
 }
 
-void UIQT_Queue::InitializeQueue()
+void UIQT_Queue::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
 {
-    if (InternalQueue.IsValid())
+    UIQT_Queue* This = CastChecked<UIQT_Queue>(InThis);
+    This->SmallQueue.AddReferencedObjects(Collector);
+    if (UIQT_PriorityQueueInternal* Internal = This->GetInternalQueue())
+    {
+        Internal->AddReferencedObjects(Collector);
+    }
     {
-        InternalQueue->Init(); 
-        NextFIFOPriorityCounter = 0;
-        NextFILOPriorityCounter = TNumericLimits<int32>::Max();
-        UE_LOG(LogIOTQueue, Log, TEXT("UIQT_Queue: Fila inicializada e contadores resetados."));
+        FScopeLock Lock(&This->DelayedItemsMutex);
+        for (FDelayedItem& Delayed : This->DelayedItems)
+        {
+            Collector.AddReferencedObject(Delayed.Item.UserPayload, This);
+            Delayed.Item.DispatchData.AddStructReferencedObjects(Collector);
+        }
     }
+    Super::AddReferencedObjects(InThis, Collector);
 }
 
-bool UIQT_Queue::EnqueueItem(FIQT_QueueItem& ItemToEnqueue)
+void UIQT_Queue::InitializeQueue()
 {
-    if (!InternalQueue.IsValid())
+    // Reservas que cabem inline não criam a fila interna: ela só é criada quando a fila pequena enche.
+    SmallQueue.Empty();
+    if (ReserveCapacity > FIQT_SmallQueue::Capacity)
     {
-        UE_LOG(LogIOTQueue, Error, TEXT("UIQT_Queue: Fila não inicializada! Chame InitializeQueue primeiro."));
-        return false;
+        EnsureInternalQueue();
     }
-
-    if (MaxQueueSize > 0 && InternalQueue->GetCount() >= MaxQueueSize)
+    if (UIQT_PriorityQueueInternal* Internal = GetInternalQueue())
     {
-        UE_LOG(LogIOTQueue, Warning, TEXT("UIQT_Queue: Fila cheia (Max: %d). Item '%s' não enfileirado."), MaxQueueSize, *ItemToEnqueue.Name.ToString());
-        return false;
+        Internal->Init(); 
+        // Antes da reserva: o modo spill e os heaps sob demanda determinam o que é pré-alocado.
+        SyncQueueSettings();
+        if (ReserveCapacity > 0)
+        {
+            Internal->Reserve(ReserveCapacity);
+        }
+    }
+    NextFIFOPriorityCounter = 0;
+    NextFILOPriorityCounter = TNumericLimits<int32>::Max();
+    {
+        FScopeLock Lock(&DelayedItemsMutex);
+        DelayedItems.Reset();
     }
+    PublishCounters(0);
+    UE_LOG(LogIOTQueue, Log, TEXT("UIQT_Queue: Fila inicializada e contadores resetados."));
+}
+
+bool UIQT_Queue::EnqueueItem(FIQT_QueueItem& ItemToEnqueue)
+{
+    return EnqueueItemInternal(ItemToEnqueue, FPlatformTime::Seconds());
+}
 
-    if (bIgnoreDuplicatesOnEnqueue && ContainsItem(ItemToEnqueue))
+bool UIQT_Queue::EnqueueItemInternal(FIQT_QueueItem& ItemToEnqueue, double ArrivalTimeSeconds)
+{
+    IQT_SCOPE_CYCLE_COUNTER(Enqueue);
+
+    // Um item reenfileirado (ex.: nova tentativa) não pode carregar o handle da passagem anterior.
+    ItemToEnqueue.Handle.Invalidate();
+
+    // No modo proxy a checagem de duplicidade é feita pelo broker, contra a fila compartilhada.
+    if (bIgnoreDuplicatesOnEnqueue && !BrokerClient.IsValid() && ContainsItem(ItemToEnqueue))
     {
-        UE_LOG(LogIOTQueue, Log, TEXT("UIQT_Queue: Item '%s' já existe na fila e duplicatas são ignoradas."), *ItemToEnqueue.Name.ToString());
+        UE_LOG(LogIOTQueue, Verbose, TEXT("UIQT_Queue: Item '%s' já existe na fila e duplicatas são ignoradas."), *ItemToEnqueue.Name.ToString());
+        IQT_TRACE_EVENT(EIQT_TraceOp::EnqueueRejected, GetUniqueID(), ItemToEnqueue.Handle.Value, ItemToEnqueue.Priority);
         return false;
     }
 
@@ -72,161 +224,1257 @@ bool UIQT_Queue::EnqueueItem(FIQT_QueueItem& ItemToEnqueue)
             ItemToEnqueue.Priority = NextFILOPriorityCounter--;
             break;
         case EIQT_QueueMode::PriorityOrder:
+        case EIQT_QueueMode::UtilityScore:
         default:
             break;
     }
 
-    TSharedPtr<FIQT_QueueItem> ItemPtr = MakeShared<FIQT_QueueItem>(ItemToEnqueue);
-    ItemPtr->bIsEnqueued = true; 
-    
-    bool bSuccess = InternalQueue->Enqueue(ItemPtr);
+    ItemToEnqueue.EnqueueTimeSeconds = ArrivalTimeSeconds;
+    ItemToEnqueue.DequeueOffsetSeconds = 0.0f;
+    ItemToEnqueue.DispatchOffsetSeconds = 0.0f;
+    ItemToEnqueue.CompletionOffsetSeconds = 0.0f;
+
+    if (BrokerClient.IsValid())
+    {
+        return EnqueueToBroker(ItemToEnqueue);
+    }
+
+    // A fila guarda a sua própria cópia; o item do chamador permanece como está (bIsEnqueued = false).
+    FIQT_QueueItem StoredItem(ItemToEnqueue);
+    StoredItem.bIsEnqueued = true; 
+
+    // Poucos itens ficam inline; a fila pequena cheia (ou uma configuração que ela não atende) passa tudo para a
+    // fila interna. O limite é aplicado sob a trava de cada armazenamento, sem corrida entre produtores.
+    TOptional<bool> bStoredInline;
+    if (CanUseInlineStorage())
+    {
+        bStoredInline = SmallQueue.Enqueue(StoredItem, MaxQueueSize, ItemToEnqueue.Handle);
+    }
+    TOptional<FIQT_QueueItem> EvictedItem;
+    bool bSuccess = false;
+    if (bStoredInline.IsSet())
+    {
+        bSuccess = bStoredInline.GetValue();
+    }
+    else if (EnsureInternalQueue())
+    {
+        SyncQueueSettings();
+        bSuccess = GetInternalQueue()->Enqueue(MoveTemp(StoredItem), &ItemToEnqueue.Handle, &EvictedItem);
+    }
+    else
+    {
+        UE_LOG(LogIOTQueue, Error, TEXT("UIQT_Queue: Fila em destruição, item '%s' descartado."), *ItemToEnqueue.Name.ToString());
+        return false;
+    }
     if (bSuccess)
     {
-        UE_LOG(LogIOTQueue, Log , TEXT("UIQT_Queue: Enfileirado item '%s' com prioridade %d. Modo: %s."),
+        IQT_TRACE_EVENT(EIQT_TraceOp::Enqueue, GetUniqueID(), ItemToEnqueue.Handle.Value, ItemToEnqueue.Priority);
+        PublishCounters(EvictedItem.IsSet() ? 2 : 1);
+        UE_LOG(LogIOTQueue, VeryVerbose, TEXT("UIQT_Queue: Enfileirado item '%s' com prioridade %d. Modo: %s."),
             *ItemToEnqueue.Name.ToString(), ItemToEnqueue.Priority,
             *UEnum::GetValueAsString(EnqueueMode));
+
+        if (EvictedItem.IsSet())
+        {
+            ReportEvictedItem(EvictedItem.GetValue(), ItemToEnqueue);
+        }
+    }
+    else
+    {
+        UE_LOG(LogIOTQueue, Warning, TEXT("UIQT_Queue: Item '%s' não enfileirado (fila cheia ou item inválido; Max: %d)."), *ItemToEnqueue.Name.ToString(), MaxQueueSize);
+        IQT_TRACE_EVENT(EIQT_TraceOp::EnqueueRejected, GetUniqueID(), ItemToEnqueue.Handle.Value, ItemToEnqueue.Priority);
     }
     return bSuccess;
 }
 
 bool UIQT_Queue::DequeueItem(FIQT_QueueItem& OutItem)
 {
-    if (!InternalQueue.IsValid())
+    IQT_SCOPE_CYCLE_COUNTER(Dequeue);
+
+    // Itens atrasados cujo tempo já passou entram na fila antes de escolher o próximo.
+    PromoteReadyDelayedItems();
+
+    if (BrokerClient.IsValid())
     {
-        UE_LOG(LogIOTQueue, Error, TEXT("UIQT_Queue: Fila não inicializada!"));
-        return false;
+        // Fora do game thread (ex.: consumidores em worker threads) a espera curta pela resposta é aceitável.
+        FIQT_BrokerLease Lease;
+        if (BrokerClient->Dequeue(Lease, IsInGameThread() ? 0.0 : 0.1))
+        {
+            OutItem = MoveTemp(Lease.Item);
+            OutItem.Handle.Invalidate();
+            OutItem.BrokerLeaseId = Lease.LeaseId;
+            FinishDequeue(OutItem);
+            return true;
+        }
+    }
+    else if (DequeueFromInternal(OutItem))
+    {
+        FinishDequeue(OutItem);
+        return true;
+    }
+    else if (bStealWhenIdle && RegisteredSharingGroup.IsValid() && StealWork(StealBatchSize) > 0 && DequeueFromInternal(OutItem))
+    {
+        // Fila vazia: o agente pega trabalho de um colega do grupo em vez de ficar ocioso.
+        FinishDequeue(OutItem);
+        return true;
     }
 
-    TSharedPtr<FIQT_QueueItem> DequeuedPtr = InternalQueue->Dequeue();
-    if (DequeuedPtr.IsValid())
+    // Fila vazia é um caso normal para consumidores que fazem polling: não deve poluir o log.
+    IQT_TRACE_EVENT(EIQT_TraceOp::DequeueEmpty, GetUniqueID(), 0, 0);
+    UE_LOG(LogIOTQueue, Verbose, TEXT("UIQT_Queue: Dequeued Pointer Invalido ou Lista Vazia, Item Vazio Retornado!"));
+    OutItem = FIQT_QueueItem();
+    return false;
+}
+
+bool UIQT_Queue::DequeueMatching(const FGameplayTagQuery& Query, FIQT_QueueItem& OutItem)
+{
+    IQT_SCOPE_CYCLE_COUNTER(Dequeue);
+
+    PromoteReadyDelayedItems();
+
+    const TOptional<bool> bInline = SmallQueue.DequeueMatching(Query, OutItem);
+    if (bInline.IsSet() ? bInline.GetValue() : GetInternalQueue() && GetInternalQueue()->DequeueMatching(Query, OutItem))
     {
-        OutItem = *DequeuedPtr; 
-        OutItem.bIsEnqueued = false; 
-        UE_LOG(LogIOTQueue, Log , TEXT("UIQT_Queue: Desenfileirado item '%s' com prioridade %d."),
-            *OutItem.Name.ToString(), OutItem.Priority);
+        FinishDequeue(OutItem);
         return true;
     }
 
-    UE_LOG(LogIOTQueue, Warning , TEXT("UIQT_Queue: Dequeued Pointer Invalido ou Lista Vazia, Item Vazio Retornado!"));
-    OutItem = FIQT_QueueItem(); 
+    // Nenhum item satisfaz a consulta: caso normal para consumidores especializados que fazem polling.
+    IQT_TRACE_EVENT(EIQT_TraceOp::DequeueEmpty, GetUniqueID(), 0, 0);
+    OutItem = FIQT_QueueItem();
     return false;
 }
 
-bool UIQT_Queue::RemoveSpecificItem(FIQT_QueueItem& ItemToRemove)
+bool UIQT_Queue::PeekMatching(const FGameplayTagQuery& Query, FIQT_QueueItem& OutItem) const
+{
+    IQT_SCOPE_CYCLE_COUNTER(Lookup);
+
+    const TOptional<bool> bInline = SmallQueue.PeekMatching(Query, OutItem);
+    if (bInline.IsSet() ? bInline.GetValue() : GetInternalQueue() && GetInternalQueue()->PeekMatching(Query, OutItem))
+    {
+        return true;
+    }
+    OutItem = FIQT_QueueItem();
+    return false;
+}
+
+bool UIQT_Queue::PeekTopItem(FIQT_QueueItem& OutItem) const
+{
+    IQT_SCOPE_CYCLE_COUNTER(Lookup);
+
+    if (PeekTop([&OutItem](const FIQT_QueueItem& Item) { OutItem = Item; }))
+    {
+        return true;
+    }
+    OutItem = FIQT_QueueItem();
+    return false;
+}
+
+int32 UIQT_Queue::GetTopK(int32 K, TArray<FIQT_QueueItem>& OutItems) const
+{
+    IQT_SCOPE_CYCLE_COUNTER(Lookup);
+
+    OutItems.Reset(FMath::Clamp(K, 0, GetQueueCount()));
+    return ForEachTopK(K, [&OutItems](const FIQT_QueueItem& Item) { OutItems.Add(Item); });
+}
+
+namespace IQTQueueSnapshot
+{
+    // Copia apenas os grupos de campos pedidos; o restante de OutItem mantém o valor padrão.
+    static void CopyFields(const FIQT_QueueItem& Source, EIQT_SnapshotFields Fields, FIQT_QueueItem& OutItem)
+    {
+        if (EnumHasAnyFlags(Fields, EIQT_SnapshotFields::Identity))
+        {
+            OutItem.Name = Source.Name;
+            OutItem.Handle = Source.Handle;
+            OutItem.TaskID = Source.TaskID;
+        }
+        if (EnumHasAnyFlags(Fields, EIQT_SnapshotFields::Tags))
+        {
+            OutItem.AbilityTriggerTag = Source.AbilityTriggerTag;
+            OutItem.AbilityEndTag = Source.AbilityEndTag;
+            OutItem.AbilityFailTag = Source.AbilityFailTag;
+        }
+        if (EnumHasAnyFlags(Fields, EIQT_SnapshotFields::Priority))
+        {
+            OutItem.Priority = Source.Priority;
+            OutItem.UtilityFeatures = Source.UtilityFeatures;
+        }
+        if (EnumHasAnyFlags(Fields, EIQT_SnapshotFields::State))
+        {
+            OutItem.bIsOpen = Source.bIsOpen;
+            OutItem.bIsEnqueued = Source.bIsEnqueued;
+            OutItem.bIsStacked = Source.bIsStacked;
+            OutItem.bTransferable = Source.bTransferable;
+            OutItem.AttemptCount = Source.AttemptCount;
+        }
+        if (EnumHasAnyFlags(Fields, EIQT_SnapshotFields::Payload))
+        {
+            OutItem.UserPayload = Source.UserPayload;
+        }
+        // TaskPayload, TimeoutSeconds e RetryPolicy moram no mesmo bloco: pedindo os dois grupos, o bloco é
+        // compartilhado sem cópia; pedindo um só, apenas os campos dele são copiados.
+        const bool bCopyPayload = EnumHasAnyFlags(Fields, EIQT_SnapshotFields::Payload);
+        const bool bCopyPolicy = EnumHasAnyFlags(Fields, EIQT_SnapshotFields::Policy);
+        if (bCopyPayload && bCopyPolicy)
+        {
+            OutItem.DispatchData = Source.DispatchData;
+        }
+        else if (Source.DispatchData.HasData() && (bCopyPayload || bCopyPolicy))
+        {
+            const FIQT_QueueItemDispatchData& SourceData = Source.GetDispatchData();
+            FIQT_QueueItemDispatchData& OutData = OutItem.GetMutableDispatchData();
+            if (bCopyPayload)
+            {
+                OutData.TaskPayload = SourceData.TaskPayload;
+            }
+            else
+            {
+                OutData.TimeoutSeconds = SourceData.TimeoutSeconds;
+                OutData.RetryPolicy = SourceData.RetryPolicy;
+            }
+        }
+        if (EnumHasAnyFlags(Fields, EIQT_SnapshotFields::Timing))
+        {
+            OutItem.EnqueueTimeSeconds = Source.EnqueueTimeSeconds;
+            OutItem.DequeueOffsetSeconds = Source.DequeueOffsetSeconds;
+            OutItem.DispatchOffsetSeconds = Source.DispatchOffsetSeconds;
+            OutItem.CompletionOffsetSeconds = Source.CompletionOffsetSeconds;
+        }
+    }
+}
+
+int32 UIQT_Queue::GetQueueSnapshot(int32 Fields, int32 MaxItems, TArray<FIQT_QueueItem>& OutItems) const
+{
+    IQT_SCOPE_CYCLE_COUNTER(Lookup);
+
+    const int32 Limit = MaxItems > 0 ? MaxItems : MAX_int32;
+    const EIQT_SnapshotFields FieldMask = static_cast<EIQT_SnapshotFields>(Fields);
+    OutItems.Reset(FMath::Min(Limit, GetQueueCount()));
+    return ForEachTopK(Limit, [&OutItems, FieldMask](const FIQT_QueueItem& Item)
+    {
+        IQTQueueSnapshot::CopyFields(Item, FieldMask, OutItems.AddDefaulted_GetRef());
+    });
+}
+
+bool UIQT_Queue::PeekTop(TFunctionRef<void(const FIQT_QueueItem&)> Visitor) const
+{
+    const TOptional<int32> NumInline = SmallQueue.ForEachTopK(1, Visitor);
+    if (NumInline.IsSet())
+    {
+        return NumInline.GetValue() > 0;
+    }
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    return Internal && Internal->PeekTop(Visitor);
+}
+
+int32 UIQT_Queue::ForEachTopK(int32 K, TFunctionRef<void(const FIQT_QueueItem&)> Visitor) const
+{
+    const TOptional<int32> NumInline = SmallQueue.ForEachTopK(K, Visitor);
+    if (NumInline.IsSet())
+    {
+        return NumInline.GetValue();
+    }
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    return Internal ? Internal->ForEachTopK(K, Visitor) : 0;
+}
+
+void UIQT_Queue::ForEachItem(TFunctionRef<bool(const FIQT_QueueItem&)> Visitor) const
+{
+    if (!SmallQueue.ForEachItem(Visitor) && GetInternalQueue())
+    {
+        GetInternalQueue()->ForEachItem(Visitor);
+    }
+}
+
+void UIQT_Queue::ReportEvictedItem(FIQT_QueueItem& Evicted, const FIQT_QueueItem& Incoming)
+{
+    Evicted.bIsEnqueued = false;
+    IQT_TRACE_EVENT(EIQT_TraceOp::Evict, GetUniqueID(), Evicted.Handle.Value, Evicted.Priority);
+    UE_LOG(LogIOTQueue, Log, TEXT("UIQT_Queue: Fila cheia (Max: %d). Item '%s' (prioridade %d) removido para dar lugar a '%s' (prioridade %d)."),
+        MaxQueueSize, *Evicted.Name.ToString(), Evicted.Priority, *Incoming.Name.ToString(), Incoming.Priority);
+    if (OnItemEvicted.IsBound())
+    {
+        OnItemEvicted.Broadcast(Evicted);
+    }
+}
+
+void UIQT_Queue::SyncQueueSettings()
+{
+    // Uma configuração que a fila pequena não atende passa os itens já guardados inline para a fila interna.
+    if (SmallQueue.GetCount().Get(0) > 0 && !CanUseInlineStorage())
+    {
+        EnsureInternalQueue();
+    }
+    if (UIQT_PriorityQueueInternal* Internal = GetInternalQueue())
+    {
+        ApplyQueueSettings(*Internal);
+    }
+}
+
+void UIQT_Queue::ApplyQueueSettings(UIQT_PriorityQueueInternal& Internal)
+{
+    // Produtores de várias threads chegam aqui a cada inserção: o cache Applied* só é lido e escrito sob a trava,
+    // e cada mudança chega à fila interna uma única vez. Sem mudança, o custo é o de uma trava sem disputa.
+    FScopeLock Lock(&AppliedSettingsMutex);
+    if (MaxQueueSize != AppliedMaxQueueSize)
+    {
+        Internal.SetMaxSize(MaxQueueSize);
+        AppliedMaxQueueSize = MaxQueueSize;
+    }
+    if (OverflowPolicy != AppliedOverflowPolicy || OverflowBlockTimeoutSeconds != AppliedBlockTimeoutSeconds)
+    {
+        Internal.SetOverflowPolicy(OverflowPolicy, OverflowBlockTimeoutSeconds);
+        AppliedOverflowPolicy = OverflowPolicy;
+        AppliedBlockTimeoutSeconds = OverflowBlockTimeoutSeconds;
+    }
+    if (SpillInMemoryBudget != AppliedSpillBudget || SpillDirectory != AppliedSpillDirectory)
+    {
+        Internal.SetSpill(SpillInMemoryBudget, SpillDirectory);
+        AppliedSpillBudget = SpillInMemoryBudget;
+        AppliedSpillDirectory = SpillDirectory;
+    }
+    const float DesiredRate = EnqueueMode == EIQT_QueueMode::PriorityOrder ? FMath::Max(0.0f, AgingRatePerSecond) : 0.0f;
+    if (DesiredRate != AppliedAgingRate)
+    {
+        Internal.SetAgingRate(DesiredRate);
+        AppliedAgingRate = DesiredRate;
+    }
+    // Fora do modo UtilityScore as colunas de características não são mantidas.
+    static const TArray<float> NoWeights;
+    const TArray<float>& DesiredWeights = EnqueueMode == EIQT_QueueMode::UtilityScore ? UtilityWeights : NoWeights;
+    if (DesiredWeights != AppliedUtilityWeights)
+    {
+        Internal.SetUtilityWeights(DesiredWeights);
+        AppliedUtilityWeights = DesiredWeights;
+    }
+}
+
+bool UIQT_Queue::DequeueFromInternal(FIQT_QueueItem& OutItem)
+{
+    // Propriedades alteradas diretamente desde a última inserção (ex.: modo UtilityScore) valem já nesta retirada.
+    if (SmallQueue.IsActive() && !CanUseInlineStorage())
+    {
+        SyncQueueSettings();
+    }
+    const TOptional<bool> bInline = SmallQueue.Dequeue(OutItem);
+    if (bInline.IsSet())
+    {
+        return bInline.GetValue();
+    }
+    // Sem armazenamento a fila nunca passou da capacidade inline.
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    if (!Internal)
+    {
+        return false;
+    }
+    if (EnqueueMode == EIQT_QueueMode::UtilityScore)
+    {
+        // Pesos trocados diretamente (ou modo trocado) desde a última sincronização valem já nesta retirada.
+        SyncQueueSettings();
+        return Internal->DequeueBestScored(UtilityCandidateWindow, OutItem);
+    }
+    return Internal->Dequeue(OutItem);
+}
+
+void UIQT_Queue::SetUtilityWeights(const TArray<float>& NewWeights)
+{
+    if (NewWeights.Num() > FIQT_QueueItem::MaxUtilityFeatures)
+    {
+        UE_LOG(LogIOTQueue, Warning, TEXT("UIQT_Queue: %d pesos de utilidade informados; apenas os %d primeiros são usados."), NewWeights.Num(), FIQT_QueueItem::MaxUtilityFeatures);
+    }
+    UtilityWeights = NewWeights;
+    SyncQueueSettings();
+}
+
+bool UIQT_Queue::UpdateItemUtilityFeatures(FIQT_ItemHandle Handle, const TArray<float>& Features)
 {
-    if (!InternalQueue.IsValid())
+    // As colunas de características só existem na fila interna.
+    if (SmallQueue.GetCount().Get(0) > 0)
+    {
+        EnsureInternalQueue();
+    }
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    if (!Internal)
     {
-        UE_LOG(LogIOTQueue, Error, TEXT("UIQT_Queue: Fila não inicializada!"));
         return false;
     }
-    TSharedPtr<FIQT_QueueItem> TempItemPtr = MakeShared<FIQT_QueueItem>(ItemToRemove);
-    bool bSuccess = InternalQueue->RemoveItem(TempItemPtr);
+    return Internal->UpdateUtilityFeatures(Handle, Features);
+}
+
+void UIQT_Queue::FinishDequeue(FIQT_QueueItem& OutItem)
+{
+    OutItem.bIsEnqueued = false; 
+    if (OutItem.EnqueueTimeSeconds > 0.0)
+    {
+        OutItem.DequeueOffsetSeconds = OutItem.MakeStageOffset(FPlatformTime::Seconds());
+        FIQT_LatencyRegistry::Get().RecordQueueWait(GetLatencySeries(), OutItem.AbilityTriggerTag, OutItem.DequeueOffsetSeconds);
+    }
+    IQT_TRACE_EVENT(EIQT_TraceOp::Dequeue, GetUniqueID(), OutItem.Handle.Value, OutItem.Priority);
+    PublishCounters(1);
+    UE_LOG(LogIOTQueue, VeryVerbose, TEXT("UIQT_Queue: Desenfileirado item '%s' com prioridade %d."),
+        *OutItem.Name.ToString(), OutItem.Priority);
+}
+
+bool UIQT_Queue::RemoveSpecificItem(FIQT_QueueItem& ItemToRemove)
+{
+    IQT_SCOPE_CYCLE_COUNTER(Remove);
+
+    const TOptional<bool> bInline = SmallQueue.RemoveItem(ItemToRemove);
+    const bool bSuccess = bInline.IsSet() ? bInline.GetValue() : GetInternalQueue() && GetInternalQueue()->RemoveItem(ItemToRemove);
     if (bSuccess)
     {
-        UE_LOG(LogIOTQueue, Log, TEXT("UIQT_Queue: Item '%s' removido especificamente da fila."), *ItemToRemove.Name.ToString());
+        IQT_TRACE_EVENT(EIQT_TraceOp::Remove, GetUniqueID(), ItemToRemove.Handle.Value, ItemToRemove.Priority);
+        PublishCounters(1);
+        UE_LOG(LogIOTQueue, Verbose, TEXT("UIQT_Queue: Item '%s' removido especificamente da fila."), *ItemToRemove.Name.ToString());
     }
     return bSuccess;
 }
 
+int32 UIQT_Queue::RemoveItemsWithPayload(const UObject* Payload)
+{
+    if (!Payload)
+    {
+        return 0;
+    }
+    // Compara apenas ponteiros: seguro nas threads de trabalho.
+    return RemoveAllMatching([Payload](const FIQT_QueueItem& Item) { return Item.UserPayload == Payload; });
+}
+
+int32 UIQT_Queue::CountItemsMatchingQuery(const FGameplayTagQuery& Query) const
+{
+    IQT_SCOPE_CYCLE_COUNTER(Lookup);
+    const TOptional<int32> NumInline = SmallQueue.CountMatching(Query);
+    if (NumInline.IsSet())
+    {
+        return NumInline.GetValue();
+    }
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    return Internal ? Internal->CountMatching(Query) : 0;
+}
+
+int32 UIQT_Queue::RemoveAllMatching(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate, TArray<FIQT_QueueItem>* OutRemoved)
+{
+    IQT_SCOPE_CYCLE_COUNTER(Bulk);
+
+    // As operações em lote rodam sobre o heap da fila interna: itens inline passam para ela antes.
+    if (SmallQueue.GetCount().Get(0) > 0)
+    {
+        EnsureInternalQueue();
+    }
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    if (!Internal)
+    {
+        return 0;
+    }
+
+    // Os itens removidos são necessários para o trace mesmo quando o chamador não os pede.
+    TArray<FIQT_QueueItem> LocalRemoved;
+    TArray<FIQT_QueueItem>& Removed = OutRemoved ? *OutRemoved : LocalRemoved;
+    const int32 FirstRemoved = Removed.Num();
+    const int32 NumRemoved = Internal->RemoveAllMatching(Predicate, &Removed);
+    if (NumRemoved == 0)
+    {
+        return 0;
+    }
+
+    for (int32 Index = FirstRemoved; Index < Removed.Num(); ++Index)
+    {
+        IQT_TRACE_EVENT(EIQT_TraceOp::Remove, GetUniqueID(), Removed[Index].Handle.Value, Removed[Index].Priority);
+    }
+    PublishCounters(NumRemoved);
+    UE_LOG(LogIOTQueue, Verbose, TEXT("UIQT_Queue: %d itens removidos em lote."), NumRemoved);
+    return NumRemoved;
+}
+
+int32 UIQT_Queue::RescoreAll(TFunctionRef<int32(const FIQT_QueueItem&)> Scorer)
+{
+    IQT_SCOPE_CYCLE_COUNTER(Bulk);
+
+    if (SmallQueue.GetCount().Get(0) > 0)
+    {
+        EnsureInternalQueue();
+    }
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    if (!Internal)
+    {
+        return 0;
+    }
+    if (!UsesItemPriority())
+    {
+        UE_LOG(LogIOTQueue, Warning, TEXT("UIQT_Queue: RescoreAll só se aplica aos modos PriorityOrder e UtilityScore (modo atual: %s)."), *UEnum::GetValueAsString(EnqueueMode));
+        return 0;
+    }
+
+    const int32 NumChanged = Internal->RescoreAll(Scorer);
+    if (NumChanged > 0)
+    {
+        PublishCounters(NumChanged);
+        UE_LOG(LogIOTQueue, Verbose, TEXT("UIQT_Queue: %d itens mudaram de prioridade em lote."), NumChanged);
+    }
+    return NumChanged;
+}
+
+int32 UIQT_Queue::CountMatching(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate) const
+{
+    IQT_SCOPE_CYCLE_COUNTER(Bulk);
+    const TOptional<int32> NumInline = SmallQueue.CountMatching(Predicate);
+    if (NumInline.IsSet())
+    {
+        return NumInline.GetValue();
+    }
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    return Internal ? Internal->CountMatching(Predicate) : 0;
+}
+
 bool UIQT_Queue::ContainsItem(FIQT_QueueItem& ItemToCheck) const
 {
-    if (!InternalQueue.IsValid())
+    IQT_SCOPE_CYCLE_COUNTER(Lookup);
+
+    const TOptional<bool> bInline = SmallQueue.Contains(ItemToCheck);
+    if (bInline.IsSet())
     {
-        UE_LOG(LogIOTQueue, Error, TEXT("UIQT_Queue: Fila não inicializada!"));
-        return false;
+        return bInline.GetValue();
     }
-    TSharedPtr<FIQT_QueueItem> TempItemPtr = MakeShared<FIQT_QueueItem>(ItemToCheck); 
-    return InternalQueue->Contains(TempItemPtr);
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    return Internal && Internal->Contains(ItemToCheck);
 }
 
 int32 UIQT_Queue::GetQueueCount() const
 {
-    if (InternalQueue.IsValid())
+    if (BrokerClient.IsValid())
+    {
+        return BrokerClient->GetApproximateCount();
+    }
+    const TOptional<int32> NumInline = SmallQueue.GetCount();
+    if (NumInline.IsSet())
+    {
+        return NumInline.GetValue();
+    }
+    if (UIQT_PriorityQueueInternal* Internal = GetInternalQueue())
     {
-        return InternalQueue->GetCount();
+        return Internal->GetCount();
     }
     return 0;
 }
 
 bool UIQT_Queue::IsQueueEmpty() const
 {
-    if (InternalQueue.IsValid())
+    if (BrokerClient.IsValid())
+    {
+        return BrokerClient->GetApproximateCount() == 0;
+    }
+    const TOptional<int32> NumInline = SmallQueue.GetCount();
+    if (NumInline.IsSet())
+    {
+        return NumInline.GetValue() == 0;
+    }
+    if (UIQT_PriorityQueueInternal* Internal = GetInternalQueue())
     {
-        return InternalQueue->IsEmpty();
+        return Internal->IsEmpty();
     }
     return true;
 }
 
+bool UIQT_Queue::GetHeadPriority(int32& OutPriority) const
+{
+    OutPriority = 0;
+    const TOptional<bool> bInline = SmallQueue.GetHeadPriority(OutPriority);
+    if (bInline.IsSet())
+    {
+        return bInline.GetValue();
+    }
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    return Internal && Internal->GetHeadPriority(OutPriority);
+}
+
 void UIQT_Queue::EmptyQueue()
 {
-    if (InternalQueue.IsValid())
+    SmallQueue.Empty();
+    if (UIQT_PriorityQueueInternal* Internal = GetInternalQueue())
     {
-        InternalQueue->Empty();
-        NextFIFOPriorityCounter = 0;
-        NextFILOPriorityCounter = TNumericLimits<int32>::Max();
-        UE_LOG(LogIOTQueue, Log, TEXT("UIQT_Queue: Fila esvaziada."));
+        Internal->Empty();
     }
+    NextFIFOPriorityCounter = 0;
+    NextFILOPriorityCounter = TNumericLimits<int32>::Max();
+    {
+        FScopeLock Lock(&DelayedItemsMutex);
+        DelayedItems.Reset();
+    }
+    PublishCounters(0);
+    UE_LOG(LogIOTQueue, Log, TEXT("UIQT_Queue: Fila esvaziada."));
 }
 
 int32 UIQT_Queue::GetNumOpenItems() const
 {
-    if (InternalQueue.IsValid())
+    const TOptional<int32> NumInline = SmallQueue.GetNumOpen();
+    if (NumInline.IsSet())
+    {
+        return NumInline.GetValue();
+    }
+    if (UIQT_PriorityQueueInternal* Internal = GetInternalQueue())
     {
-        return InternalQueue->GetNumOpen();
+        return Internal->GetNumOpen();
     }
     return 0;
 }
 
 int32 UIQT_Queue::GetNumClosedItems() const
 {
-    if (InternalQueue.IsValid())
+    const TOptional<int32> NumInline = SmallQueue.GetCount();
+    if (NumInline.IsSet())
     {
-        return InternalQueue->GetNumClose();
+        return NumInline.GetValue() - SmallQueue.GetNumOpen().Get(0);
+    }
+    if (UIQT_PriorityQueueInternal* Internal = GetInternalQueue())
+    {
+        return Internal->GetNumClose();
     }
     return 0;
 }
 
-bool UIQT_Queue::ValidateQueueItemData(const FIQT_QueueItem& ItemToValidate) const
+bool UIQT_Queue::ValidateQueueIntegrity() const
 {
-    if (InternalQueue.IsValid())
+    const TOptional<bool> bInline = SmallQueue.ValidateInvariants();
+    if (bInline.IsSet())
     {
-        return InternalQueue->ValidateData(ItemToValidate);
+        return bInline.GetValue();
     }
-    return false; 
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    return !Internal || Internal->ValidateInvariants();
+}
+
+bool UIQT_Queue::ValidateQueueItemData(const FIQT_QueueItem& ItemToValidate) const
+{
+    return UIQT_PriorityQueueInternal::ValidateData(ItemToValidate);
 }
 
 bool UIQT_Queue::FindItemByTaskID(const FGuid& TaskID, FIQT_QueueItem& OutItem) const
 {
-    if (!InternalQueue.IsValid())
+    IQT_SCOPE_CYCLE_COUNTER(Lookup);
+
+    const TOptional<bool> bInline = SmallQueue.FindByTaskID(TaskID, OutItem);
+    if (bInline.IsSet() ? bInline.GetValue() : GetInternalQueue() && GetInternalQueue()->FindByTaskID(TaskID, OutItem))
     {
-        UE_LOG(LogIOTQueue, Error, TEXT("UIQT_Queue: Fila não inicializada!"));
-        OutItem = FIQT_QueueItem(); 
-        return false;
+        return true;
     }
-    TSharedPtr<FIQT_QueueItem> FoundItemPtr = InternalQueue->FindByTaskID(TaskID);
-    if (FoundItemPtr.IsValid())
+    OutItem = FIQT_QueueItem();
+    return false;
+}
+
+bool UIQT_Queue::FindItemByHashKey(FName InName, FGameplayTag InTag, bool bInIsOpen, FIQT_QueueItem& OutItem) const
+{
+    IQT_SCOPE_CYCLE_COUNTER(Lookup);
+
+    const TOptional<bool> bInline = SmallQueue.FindByHashKey(InName, InTag, bInIsOpen, OutItem);
+    if (bInline.IsSet() ? bInline.GetValue() : GetInternalQueue() && GetInternalQueue()->FindByHashKey(InName, InTag, bInIsOpen, OutItem))
     {
-        OutItem = *FoundItemPtr;
         return true;
     }
-    OutItem = FIQT_QueueItem(); 
+    OutItem = FIQT_QueueItem();
     return false;
 }
 
-bool UIQT_Queue::FindItemByHashKey(FName InName, FGameplayTag InTag, bool bInIsOpen, FIQT_QueueItem& OutItem) const
+bool UIQT_Queue::FindItemByHandle(FIQT_ItemHandle Handle, FIQT_QueueItem& OutItem) const
 {
-    if (!InternalQueue.IsValid())
+    IQT_SCOPE_CYCLE_COUNTER(Lookup);
+
+    const TOptional<bool> bInline = SmallQueue.FindByHandle(Handle, OutItem);
+    if (bInline.IsSet() ? bInline.GetValue() : GetInternalQueue() && GetInternalQueue()->FindByHandle(Handle, OutItem))
     {
-        UE_LOG(LogIOTQueue, Error, TEXT("UIQT_Queue: Fila não inicializada!"));
-        OutItem = FIQT_QueueItem(); 
+        return true;
+    }
+    OutItem = FIQT_QueueItem();
+    return false;
+}
+
+bool UIQT_Queue::IsItemHandleValid(FIQT_ItemHandle Handle) const
+{
+    const TOptional<bool> bInline = SmallQueue.IsHandleValid(Handle);
+    if (bInline.IsSet())
+    {
+        return bInline.GetValue();
+    }
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    return Internal && Internal->IsHandleValid(Handle);
+}
+
+bool UIQT_Queue::CancelItem(FIQT_ItemHandle Handle)
+{
+    IQT_SCOPE_CYCLE_COUNTER(Remove);
+
+    FIQT_QueueItem Cancelled;
+    const TOptional<bool> bInline = SmallQueue.RemoveByHandle(Handle, &Cancelled);
+    if (!(bInline.IsSet() ? bInline.GetValue() : GetInternalQueue() && GetInternalQueue()->RemoveByHandle(Handle, &Cancelled)))
+    {
+        UE_LOG(LogIOTQueue, Verbose, TEXT("UIQT_Queue: Handle %s não aponta para um item da fila; nada cancelado."), *Handle.ToString());
+        return false;
+    }
+
+    IQT_TRACE_EVENT(EIQT_TraceOp::Remove, GetUniqueID(), Handle.Value, Cancelled.Priority);
+    PublishCounters(1);
+    UE_LOG(LogIOTQueue, Verbose, TEXT("UIQT_Queue: Item '%s' cancelado pelo handle %s."), *Cancelled.Name.ToString(), *Handle.ToString());
+    return true;
+}
+
+bool UIQT_Queue::UpdateItem(FIQT_ItemHandle Handle, const FIQT_QueueItem& NewData)
+{
+    // A troca de chave com checagem de duplicidade usa os índices da fila interna.
+    if (SmallQueue.GetCount().Get(0) > 0)
+    {
+        EnsureInternalQueue();
+    }
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    if (!Internal)
+    {
+        return false;
+    }
+
+    const bool bKeepPriority = !UsesItemPriority();
+    if (!Internal->Update(Handle, NewData, bKeepPriority, bIgnoreDuplicatesOnEnqueue))
+    {
+        UE_LOG(LogIOTQueue, Verbose, TEXT("UIQT_Queue: Item do handle %s não atualizado (handle obsoleto, dados inválidos ou chave duplicada)."), *Handle.ToString());
+        return false;
+    }
+    PublishCounters(1);
+    return true;
+}
+
+bool UIQT_Queue::UpdateItemPriority(FIQT_ItemHandle Handle, int32 NewPriority)
+{
+    if (!UsesItemPriority())
+    {
+        UE_LOG(LogIOTQueue, Warning, TEXT("UIQT_Queue: UpdateItemPriority só se aplica aos modos PriorityOrder e UtilityScore (modo atual: %s)."), *UEnum::GetValueAsString(EnqueueMode));
         return false;
     }
-    TSharedPtr<FIQT_QueueItem> FoundItemPtr = InternalQueue->FindByHashKey(InName, InTag, bInIsOpen);
-    if (FoundItemPtr.IsValid())
+    const TOptional<bool> bInline = SmallQueue.UpdatePriority(Handle, NewPriority);
+    if (!(bInline.IsSet() ? bInline.GetValue() : GetInternalQueue() && GetInternalQueue()->UpdatePriority(Handle, NewPriority)))
+    {
+        return false;
+    }
+    PublishCounters(1);
+    return true;
+}
+
+bool UIQT_Queue::GetItemTaskID(FIQT_ItemHandle Handle, FGuid& OutTaskID)
+{
+    const TOptional<bool> bInline = SmallQueue.EnsureTaskID(Handle, OutTaskID);
+    if (bInline.IsSet() ? bInline.GetValue() : GetInternalQueue() && GetInternalQueue()->EnsureTaskID(Handle, OutTaskID))
     {
-        OutItem = *FoundItemPtr;
         return true;
     }
-    OutItem = FIQT_QueueItem(); 
+    OutTaskID.Invalidate();
     return false;
 }
+
+FGuid UIQT_Queue::GetQueueItemTaskID(FIQT_QueueItem& Item)
+{
+    return Item.GetTaskID();
+}
+
+SIZE_T UIQT_Queue::GetInternalAllocatedSize() const
+{
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    return Internal ? Internal->GetAllocatedSize() : 0;
+}
+
+void UIQT_Queue::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+    Super::GetResourceSizeEx(CumulativeResourceSize);
+    CumulativeResourceSize.AddDedicatedSystemMemoryBytes(GetInternalAllocatedSize());
+}
+
+FString UIQT_Queue::GetStatsName() const
+{
+    if (!QueueName.IsNone())
+    {
+        return QueueName.ToString();
+    }
+    const AActor* OwnerActor = GetOwner();
+    return OwnerActor ? FString::Printf(TEXT("%s.%s"), *OwnerActor->GetName(), *GetName()) : GetName();
+}
+
+void UIQT_Queue::PublishCounters(int32 NumOperations)
+{
+    const int32 Depth = GetQueueCount();
+    INC_DWORD_STAT_BY(STAT_IQT_Operations, NumOperations);
+    const int32 PreviousDepth = PublishedDepth.exchange(Depth);
+    if (Depth > PreviousDepth)
+    {
+        INC_DWORD_STAT_BY(STAT_IQT_QueuedItems, Depth - PreviousDepth);
+    }
+    else if (Depth < PreviousDepth)
+    {
+        DEC_DWORD_STAT_BY(STAT_IQT_QueuedItems, PreviousDepth - Depth);
+    }
+
+    if (Counters.IsValid())
+    {
+        if (Depth != PreviousDepth)
+        {
+            Counters->AddDepth(Depth - PreviousDepth);
+        }
+        Counters->AddOperations(NumOperations);
+    }
+}
+
+void UIQT_Queue::NotifyActionDispatched(FIQT_QueueItem& Item)
+{
+    const double NowSeconds = FPlatformTime::Seconds();
+    if (Item.EnqueueTimeSeconds <= 0.0)
+    {
+        // Item que não passou pela fila: o disparo vira a base dos deslocamentos.
+        Item.EnqueueTimeSeconds = NowSeconds;
+    }
+    Item.DispatchOffsetSeconds = Item.MakeStageOffset(NowSeconds);
+    INC_DWORD_STAT(STAT_IQT_InFlightActions);
+    NumInFlight.fetch_add(1, std::memory_order_relaxed);
+    if (Counters.IsValid())
+    {
+        Counters->AddInFlight(1);
+    }
+}
+
+void UIQT_Queue::NotifyActionCompleted(FIQT_QueueItem& Item, bool bRecordLatency)
+{
+    Item.CompletionOffsetSeconds = Item.MakeStageOffset(FPlatformTime::Seconds());
+    if (bRecordLatency && Item.DispatchOffsetSeconds > 0.0f)
+    {
+        FIQT_LatencyRegistry::Get().RecordExecution(GetLatencySeries(), Item.AbilityTriggerTag, Item.CompletionOffsetSeconds - Item.DispatchOffsetSeconds);
+    }
+    DEC_DWORD_STAT(STAT_IQT_InFlightActions);
+    NumInFlight.fetch_sub(1, std::memory_order_relaxed);
+    if (Counters.IsValid())
+    {
+        Counters->AddInFlight(-1);
+    }
+    // Sucesso ou falha, o empréstimo termina aqui: uma nova tentativa volta ao broker como item novo.
+    AcknowledgeItem(Item);
+}
+
+FIQT_LatencySeries* UIQT_Queue::GetLatencySeries()
+{
+    FIQT_LatencySeries* Series = LatencySeries.load(std::memory_order_acquire);
+    if (!Series && !QueueName.IsNone())
+    {
+        // Duas threads podem chegar aqui ao mesmo tempo: só uma referência fica com a fila, a outra é devolvida.
+        FIQT_LatencyRegistry& Registry = FIQT_LatencyRegistry::Get();
+        FIQT_LatencySeries* Acquired = Registry.AcquireQueueSeries(QueueName);
+        if (LatencySeries.compare_exchange_strong(Series, Acquired, std::memory_order_acq_rel))
+        {
+            Series = Acquired;
+        }
+        else
+        {
+            Registry.ReleaseQueueSeries(Acquired);
+        }
+    }
+    return Series;
+}
+
+void UIQT_Queue::ReleaseLatencySeries()
+{
+    FIQT_LatencyRegistry::Get().ReleaseQueueSeries(LatencySeries.exchange(nullptr, std::memory_order_acq_rel));
+}
+
+int32 UIQT_Queue::GetNumInFlightActions() const
+{
+    return FMath::Max(0, NumInFlight.load(std::memory_order_relaxed));
+}
+
+float UIQT_Queue::GetOperationsPerSecond() const
+{
+    return Counters.IsValid() ? Counters->GetOperationsPerSecond() : 0.0f;
+}
+
+double UIQT_Queue::GetQueueTimeSeconds() const
+{
+    if (const UWorld* World = GetWorld())
+    {
+        return World->GetTimeSeconds();
+    }
+    return FPlatformTime::Seconds();
+}
+
+bool UIQT_Queue::EnqueueDelayedItem(FIQT_QueueItem& ItemToEnqueue, float DelaySeconds)
+{
+    FIQT_QueueItem ItemCopy = ItemToEnqueue;
+    return RequeueDelayedItem(MoveTemp(ItemCopy), DelaySeconds);
+}
+
+bool UIQT_Queue::RequeueDelayedItem(FIQT_QueueItem&& ItemToRequeue, float DelaySeconds)
+{
+    if (!UIQT_PriorityQueueInternal::ValidateData(ItemToRequeue))
+    {
+        UE_LOG(LogIOTQueue, Warning, TEXT("UIQT_Queue: Item atrasado '%s' inválido."), *ItemToRequeue.Name.ToString());
+        return false;
+    }
+
+    const double ReadyTime = GetQueueTimeSeconds() + FMath::Max(0.0f, DelaySeconds);
+    const FName ItemName = ItemToRequeue.Name;
+    IQT_TRACE_EVENT(EIQT_TraceOp::RequeueDelayed, GetUniqueID(), ItemToRequeue.Handle.Value, ItemToRequeue.Priority);
+
+    {
+        FScopeLock Lock(&DelayedItemsMutex);
+        DelayedItems.HeapPush(FDelayedItem{ ReadyTime, MoveTemp(ItemToRequeue) },
+            [](const FDelayedItem& A, const FDelayedItem& B) { return A.ReadyTime < B.ReadyTime; });
+    }
+
+    UE_LOG(LogIOTQueue, Verbose, TEXT("UIQT_Queue: Item '%s' agendado para entrar na fila em %.3fs."), *ItemName.ToString(), DelaySeconds);
+    return true;
+}
+
+int32 UIQT_Queue::GetNumDelayedItems() const
+{
+    FScopeLock Lock(&DelayedItemsMutex);
+    return DelayedItems.Num();
+}
+
+bool UIQT_Queue::HasDelayedItems() const
+{
+    FScopeLock Lock(&DelayedItemsMutex);
+    return DelayedItems.Num() > 0;
+}
+
+float UIQT_Queue::GetSecondsUntilNextDelayedItem() const
+{
+    FScopeLock Lock(&DelayedItemsMutex);
+    if (DelayedItems.Num() == 0)
+    {
+        return -1.0f;
+    }
+    return FMath::Max(0.0f, static_cast<float>(DelayedItems.HeapTop().ReadyTime - GetQueueTimeSeconds()));
+}
+
+int32 UIQT_Queue::PromoteReadyDelayedItems()
+{
+    const auto ReadyTimeLess = [](const FDelayedItem& A, const FDelayedItem& B) { return A.ReadyTime < B.ReadyTime; };
+
+    // Só retira os itens prontos sob a trava: EnqueueItem pode despejar, esperar (Block) e disparar delegates.
+    TArray<FDelayedItem, TInlineAllocator<8>> ReadyItems;
+    {
+        FScopeLock Lock(&DelayedItemsMutex);
+        if (DelayedItems.Num() == 0)
+        {
+            return 0;
+        }
+
+        // A fila pode estar cheia: o excedente continua atrasado e será tentado no próximo Dequeue.
+        const int32 FreeSpace = MaxQueueSize > 0 ? MaxQueueSize - GetQueueCount() : MAX_int32;
+        const double Now = GetQueueTimeSeconds();
+        while (ReadyItems.Num() < FreeSpace && DelayedItems.Num() > 0 && DelayedItems.HeapTop().ReadyTime <= Now)
+        {
+            DelayedItems.HeapPop(ReadyItems.AddDefaulted_GetRef(), ReadyTimeLess, EAllowShrinking::No);
+        }
+    }
+
+    int32 NumPromoted = 0;
+    for (FDelayedItem& Ready : ReadyItems)
+    {
+        if (EnqueueItem(Ready.Item))
+        {
+            NumPromoted++;
+        }
+        else if (MaxQueueSize > 0 && GetQueueCount() >= MaxQueueSize)
+        {
+            // Outro produtor ocupou o espaço entre a retirada e a inserção: volta para o heap com o mesmo ReadyTime.
+            FScopeLock Lock(&DelayedItemsMutex);
+            DelayedItems.HeapPush(MoveTemp(Ready), ReadyTimeLess);
+        }
+        else
+        {
+            // Rejeitado (duplicado ou inválido): não há como repetir, registra como falha definitiva com o motivo.
+            AddDeadLetterItem(Ready.Item, bIgnoreDuplicatesOnEnqueue && ContainsItem(Ready.Item) ? IQTGameplayTags::Item_Duplicate : IQTGameplayTags::Item_Rejected);
+        }
+    }
+    return NumPromoted;
+}
+
+void UIQT_Queue::AddDeadLetterItem(const FIQT_QueueItem& Item, FGameplayTag LastFailTag)
+{
+    IQT_TRACE_EVENT(EIQT_TraceOp::DeadLetter, GetUniqueID(), Item.Handle.Value, Item.Priority);
+    // Itens recusados ao voltar para a fila não esgotaram tentativas: o log diz o motivo real.
+    if (LastFailTag.MatchesTagExact(IQTGameplayTags::Item_Duplicate))
+    {
+        UE_LOG(LogIOTQueue, Warning, TEXT("UIQT_Queue: Item '%s' recusado como duplicado ao voltar para a fila e enviado para a fila de mensagens mortas."),
+            *Item.Name.ToString());
+    }
+    else if (LastFailTag.MatchesTagExact(IQTGameplayTags::Item_Rejected))
+    {
+        UE_LOG(LogIOTQueue, Warning, TEXT("UIQT_Queue: Item '%s' recusado ao voltar para a fila e enviado para a fila de mensagens mortas."),
+            *Item.Name.ToString());
+    }
+    else
+    {
+        UE_LOG(LogIOTQueue, Warning, TEXT("UIQT_Queue: Item '%s' esgotou as tentativas (%d) e foi para a fila de mensagens mortas. Última falha: %s."),
+            *Item.Name.ToString(), Item.AttemptCount, *LastFailTag.ToString());
+    }
+
+    if (bEnableDeadLetterQueue)
+    {
+        FScopeLock Lock(&DeadLetterMutex);
+        if (MaxDeadLetterItems > 0 && DeadLetterItems.Num() >= MaxDeadLetterItems)
+        {
+            DeadLetterItems.RemoveAt(0, DeadLetterItems.Num() - MaxDeadLetterItems + 1, EAllowShrinking::No);
+        }
+        FIQT_QueueItem& DeadItem = DeadLetterItems.Add_GetRef(Item);
+        DeadItem.bIsEnqueued = false;
+    }
+
+    OnItemDeadLettered.Broadcast(Item, LastFailTag);
+}
+
+void UIQT_Queue::GetDeadLetterItems(TArray<FIQT_QueueItem>& OutItems) const
+{
+    FScopeLock Lock(&DeadLetterMutex);
+    OutItems = DeadLetterItems;
+}
+
+int32 UIQT_Queue::GetNumEvictedItems() const
+{
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    return Internal ? Internal->GetNumEvicted() : 0;
+}
+
+int32 UIQT_Queue::GetNumSpilledItems() const
+{
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    return Internal ? Internal->GetNumSpilled() : 0;
+}
+
+bool UIQT_Queue::HostBroker(int32 Port)
+{
+    if (BrokerClient.IsValid() || !EnsureInternalQueue())
+    {
+        UE_LOG(LogIOTQueue, Error, TEXT("UIQT_Queue: HostBroker requer uma fila local (e não pode ser usado no modo proxy)."));
+        return false;
+    }
+    StopBroker();
+    Broker = MakeShared<FIQT_Broker>(InternalQueueOwner);
+    if (!Broker->Start(Port))
+    {
+        Broker.Reset();
+        return false;
+    }
+    return true;
+}
+
+void UIQT_Queue::StopBroker()
+{
+    if (Broker.IsValid())
+    {
+        Broker->Shutdown();
+        Broker.Reset();
+    }
+}
+
+bool UIQT_Queue::ConnectToBroker(int32 Port, const FString& Host)
+{
+    if (Broker.IsValid())
+    {
+        UE_LOG(LogIOTQueue, Error, TEXT("UIQT_Queue: Esta fila hospeda um broker e não pode ser proxy de outro."));
+        return false;
+    }
+    DisconnectFromBroker();
+    BrokerClient = FIQT_BrokerClient::Connect(Host, Port);
+    if (!BrokerClient.IsValid())
+    {
+        return false;
+    }
+    BrokerClient->SetBatchSize(BrokerBatchSize);
+    BrokerClient->SetPrefetchCount(BrokerPrefetchCount);
+
+    // Lotes incompletos seguem uma vez por frame: a latência extra de um Enqueue fica limitada a um frame.
+    TWeakObjectPtr<UIQT_Queue> WeakThis(this);
+    BrokerFlushTicker = FTSTicker::GetCoreTicker().AddTicker(TEXT("IQT Broker Flush"), 0.0f, [WeakThis](float)
+    {
+        if (UIQT_Queue* This = WeakThis.Get())
+        {
+            This->FlushBrokerRequests();
+        }
+        return true;
+    });
+    UE_LOG(LogIOTQueue, Log, TEXT("UIQT_Queue: '%s' conectada ao broker %s:%d."), *GetStatsName(), *Host, Port);
+    return true;
+}
+
+void UIQT_Queue::DisconnectFromBroker()
+{
+    if (BrokerFlushTicker.IsValid())
+    {
+        FTSTicker::GetCoreTicker().RemoveTicker(BrokerFlushTicker);
+        BrokerFlushTicker.Reset();
+    }
+    BrokerClient.Reset();
+}
+
+bool UIQT_Queue::IsBrokerProxy() const
+{
+    return BrokerClient.IsValid();
+}
+
+bool UIQT_Queue::IsBrokerDequeuePending() const
+{
+    return BrokerClient.IsValid() && BrokerClient->IsDequeuePending();
+}
+
+bool UIQT_Queue::AcknowledgeItem(const FIQT_QueueItem& Item)
+{
+    if (!BrokerClient.IsValid() || Item.BrokerLeaseId == 0)
+    {
+        return false;
+    }
+    BrokerClient->Ack(Item.BrokerLeaseId);
+    return true;
+}
+
+bool UIQT_Queue::FlushBrokerRequests()
+{
+    if (!BrokerClient.IsValid())
+    {
+        return false;
+    }
+    BrokerClient->SetBatchSize(BrokerBatchSize);
+    BrokerClient->SetPrefetchCount(BrokerPrefetchCount);
+    if (!BrokerClient->Flush())
+    {
+        UE_LOG(LogIOTQueue, Error, TEXT("UIQT_Queue: Conexão com o broker perdida; '%s' volta a usar a fila local."), *GetStatsName());
+        DisconnectFromBroker();
+        return false;
+    }
+    return true;
+}
+
+bool UIQT_Queue::EnqueueToBroker(FIQT_QueueItem& ItemToEnqueue)
+{
+    // Enviado em lote: recusas do broker (duplicado ou fila cheia) só aparecem nas estatísticas do broker.
+    FIQT_QueueItem StoredItem(ItemToEnqueue);
+    StoredItem.bIsEnqueued = true;
+    BrokerClient->Enqueue(StoredItem, bIgnoreDuplicatesOnEnqueue);
+    if (!BrokerClient->IsConnected())
+    {
+        UE_LOG(LogIOTQueue, Warning, TEXT("UIQT_Queue: Item '%s' não enviado: conexão com o broker perdida."), *ItemToEnqueue.Name.ToString());
+        IQT_TRACE_EVENT(EIQT_TraceOp::EnqueueRejected, GetUniqueID(), 0, ItemToEnqueue.Priority);
+        return false;
+    }
+    IQT_TRACE_EVENT(EIQT_TraceOp::Enqueue, GetUniqueID(), 0, ItemToEnqueue.Priority);
+    PublishCounters(1);
+    return true;
+}
+
+void UIQT_Queue::SetSharingGroup(FGameplayTag NewGroup)
+{
+    SharingGroup = NewGroup;
+    UIQT_QueueGroupSubsystem* Groups = UIQT_QueueGroupSubsystem::Get(this);
+    if (!Groups || NewGroup == RegisteredSharingGroup)
+    {
+        return;
+    }
+    if (RegisteredSharingGroup.IsValid())
+    {
+        Groups->UnregisterQueue(RegisteredSharingGroup, this);
+    }
+    RegisteredSharingGroup = NewGroup;
+    if (NewGroup.IsValid())
+    {
+        Groups->RegisterQueue(NewGroup, this);
+        // Os colegas roubam da fila interna: itens já guardados inline passam para ela.
+        if (SmallQueue.GetCount().Get(0) > 0)
+        {
+            EnsureInternalQueue();
+        }
+    }
+}
+
+int32 UIQT_Queue::StealWork(int32 MaxItems)
+{
+    IQT_SCOPE_CYCLE_COUNTER(Dequeue);
+
+    UIQT_QueueGroupSubsystem* Groups = RegisteredSharingGroup.IsValid() ? UIQT_QueueGroupSubsystem::Get(this) : nullptr;
+    if (!Groups || BrokerClient.IsValid() || MaxItems <= 0)
+    {
+        return 0;
+    }
+    UIQT_Queue* Victim = Groups->FindBusiestPeer(RegisteredSharingGroup, this);
+    UIQT_PriorityQueueInternal* VictimQueue = Victim ? Victim->GetInternalQueue() : nullptr;
+    if (!VictimQueue)
+    {
+        return 0;
+    }
+
+    // Contagens publicadas (sem trava): podem estar um pouco atrasadas, o que só muda quantos itens vêm.
+    const int32 Surplus = (Victim->GetQueueCount() - GetQueueCount()) / 2;
+    const int32 FreeSpace = MaxQueueSize > 0 ? MaxQueueSize - GetQueueCount() : MAX_int32;
+    const int32 NumToSteal = FMath::Min(FMath::Min(MaxItems, Surplus), FMath::Min(FreeSpace, Victim->GetNumTransferableItems()));
+    if (NumToSteal <= 0)
+    {
+        return 0;
+    }
+
+    // Uma trava por vez: a da vítima durante a retirada, depois a desta fila durante a inserção.
+    TArray<FIQT_QueueItem> StolenItems;
+    VictimQueue->StealTransferable(NumToSteal, StolenItems);
+    Victim->PublishCounters(StolenItems.Num());
+
+    int32 NumAccepted = 0;
+    int32 NumReturned = 0;
+    for (FIQT_QueueItem& Item : StolenItems)
+    {
+        const FIQT_ItemHandle OldHandle = Item.Handle;
+        const int32 VictimPriority = Item.Priority;
+        Item.bIsEnqueued = false;
+        // Mesmo caminho de EnqueueItem (duplicidade, FIFO/FILO desta fila, despejo reportado), mantendo a hora de chegada.
+        if (EnqueueItemInternal(Item, Item.EnqueueTimeSeconds))
+        {
+            NumAccepted++;
+            IQT_TRACE_EVENT(EIQT_TraceOp::Steal, GetUniqueID(), OldHandle.Value, Item.Priority);
+            continue;
+        }
+
+        // Recusado aqui: volta para a vítima com a prioridade que tinha nela; se nem ela aceitar, vai para a dead-letter.
+        Item.Priority = VictimPriority;
+        Item.bIsEnqueued = true;
+        TOptional<FIQT_QueueItem> Evicted;
+        if (VictimQueue->Enqueue(Item, nullptr, &Evicted))
+        {
+            NumReturned++;
+            if (Evicted.IsSet())
+            {
+                Victim->ReportEvictedItem(Evicted.GetValue(), Item);
+            }
+        }
+        else
+        {
+            Item.bIsEnqueued = false;
+            AddDeadLetterItem(Item, VictimQueue->Contains(Item) ? IQTGameplayTags::Item_Duplicate : IQTGameplayTags::Item_Rejected);
+        }
+    }
+    if (NumReturned > 0)
+    {
+        Victim->PublishCounters(NumReturned);
+    }
+    if (NumAccepted > 0)
+    {
+        Groups->RecordSteal(RegisteredSharingGroup, NumAccepted);
+        UE_LOG(LogIOTQueue, Verbose, TEXT("UIQT_Queue: '%s' roubou %d itens de '%s'."), *GetStatsName(), NumAccepted, *Victim->GetStatsName());
+    }
+    return NumAccepted;
+}
+
+int32 UIQT_Queue::GetNumTransferableItems() const
+{
+    UIQT_PriorityQueueInternal* Internal = GetInternalQueue();
+    return Internal ? Internal->GetNumTransferable() : 0;
+}
+
+int32 UIQT_Queue::GetNumDeadLetterItems() const
+{
+    FScopeLock Lock(&DeadLetterMutex);
+    return DeadLetterItems.Num();
+}
+
+void UIQT_Queue::ClearDeadLetterQueue()
+{
+    FScopeLock Lock(&DeadLetterMutex);
+    DeadLetterItems.Reset();
+}
@@ -0,0 +1,123 @@
+﻿// IQT/Source/IQT/Private/IQT_QueueGroupSubsystem.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_QueueGroupSubsystem.h"
+#include "IQT_Queue.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+
+UIQT_QueueGroupSubsystem* UIQT_QueueGroupSubsystem::Get(const UObject* WorldContextObject)
+{
+    UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+    return World ? World->GetSubsystem<UIQT_QueueGroupSubsystem>() : nullptr;
+}
+
+bool UIQT_QueueGroupSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UIQT_QueueGroupSubsystem::Deinitialize()
+{
+    {
+        FWriteScopeLock WriteLock(GroupsLock);
+        Groups.Empty();
+    }
+    Super::Deinitialize();
+}
+
+void UIQT_QueueGroupSubsystem::RegisterQueue(FGameplayTag Group, UIQT_Queue* Queue)
+{
+    if (!Group.IsValid() || !Queue)
+    {
+        return;
+    }
+    FWriteScopeLock WriteLock(GroupsLock);
+    Groups.FindOrAdd(Group).Members.AddUnique(Queue);
+}
+
+void UIQT_QueueGroupSubsystem::UnregisterQueue(FGameplayTag Group, UIQT_Queue* Queue)
+{
+    FWriteScopeLock WriteLock(GroupsLock);
+    if (FGroup* Found = Groups.Find(Group))
+    {
+        // Também descarta membros já destruídos.
+        Found->Members.RemoveAllSwap([Queue](const TWeakObjectPtr<UIQT_Queue>& Member) { return !Member.IsValid() || Member.Get() == Queue; });
+    }
+}
+
+UIQT_Queue* UIQT_QueueGroupSubsystem::FindBusiestPeer(FGameplayTag Group, const UIQT_Queue* Thief) const
+{
+    FReadScopeLock ReadLock(GroupsLock);
+    const FGroup* Found = Groups.Find(Group);
+    if (!Found)
+    {
+        return nullptr;
+    }
+
+    // Só contadores publicados: nenhuma fila é travada para escolher a vítima.
+    UIQT_Queue* Busiest = nullptr;
+    int32 BusiestTransferable = 0;
+    for (const TWeakObjectPtr<UIQT_Queue>& Member : Found->Members)
+    {
+        UIQT_Queue* Queue = Member.Get();
+        if (!Queue || Queue == Thief)
+        {
+            continue;
+        }
+        const int32 NumTransferable = Queue->GetNumTransferableItems();
+        if (NumTransferable > BusiestTransferable)
+        {
+            Busiest = Queue;
+            BusiestTransferable = NumTransferable;
+        }
+    }
+    return Busiest;
+}
+
+void UIQT_QueueGroupSubsystem::RecordSteal(FGameplayTag Group, int32 NumItems)
+{
+    FWriteScopeLock WriteLock(GroupsLock);
+    if (FGroup* Found = Groups.Find(Group))
+    {
+        Found->NumSteals++;
+        Found->NumItemsStolen += NumItems;
+    }
+}
+
+FIQT_QueueGroupStats UIQT_QueueGroupSubsystem::GetGroupStats(FGameplayTag Group) const
+{
+    FIQT_QueueGroupStats Stats;
+    FReadScopeLock ReadLock(GroupsLock);
+    const FGroup* Found = Groups.Find(Group);
+    if (!Found)
+    {
+        return Stats;
+    }
+
+    Stats.NumSteals = Found->NumSteals;
+    Stats.NumItemsStolen = Found->NumItemsStolen;
+    Stats.MinDepth = MAX_int32;
+    for (const TWeakObjectPtr<UIQT_Queue>& Member : Found->Members)
+    {
+        if (const UIQT_Queue* Queue = Member.Get())
+        {
+            const int32 Depth = Queue->GetQueueCount();
+            Stats.NumQueues++;
+            Stats.TotalItems += Depth;
+            Stats.TotalTransferable += Queue->GetNumTransferableItems();
+            Stats.MinDepth = FMath::Min(Stats.MinDepth, Depth);
+            Stats.MaxDepth = FMath::Max(Stats.MaxDepth, Depth);
+        }
+    }
+    if (Stats.NumQueues == 0)
+    {
+        Stats.MinDepth = 0;
+        return Stats;
+    }
+    Stats.Imbalance = Stats.TotalItems > 0 ? Stats.MaxDepth / (float(Stats.TotalItems) / Stats.NumQueues) : 0.0f;
+    return Stats;
+}
@@ -11,22 +11,29 @@
 #include "Engine/World.h" 
 #include "TimerManager.h" 
 #include "AbilitySystemGlobals.h" // Para usar GetAbilitySystemComponentFromActor
+#include "IQT_GameplayTags.h"
+#include "IQT_ASCCacheSubsystem.h"
+#include "IQT_Log.h"
+#include "Internal/IQT_TraceRing.h"
+#include "Internal/IQT_Stats.h"
 
 UIQT_RunQueuedActions::UIQT_RunQueuedActions(const FObjectInitializer& ObjectInitializer)
     : Super(ObjectInitializer)
     , bOverallSuccess(true) 
+    , DefaultActionTimeoutSeconds(0.0f)
+    , bActionInFlight(false)
 {
     // Construtor: Inicializa o status de sucesso geral.
     // Tarefas de habilidade podem ser instanciadas por execu��o ou por ator.
     // 'Instanced Per Actor' � geralmente prefer�vel para gerenciadores de longo prazo.
 }
 
-UIQT_RunQueuedActions* UIQT_RunQueuedActions::IQT_RunQueuedActions(UGameplayAbility* OwningAbility, UIQT_Queue* InQueue)
+UIQT_RunQueuedActions* UIQT_RunQueuedActions::IQT_RunQueuedActions(UGameplayAbility* OwningAbility, UIQT_Queue* InQueue, float DefaultActionTimeout)
 {
     // Verifica se a habilidade propriet�ria e a fila s�o v�lidas.
     if (!OwningAbility || !InQueue)
     {
-        UE_LOG(LogTemp, Error, TEXT("UIQT_RunQueuedActions: OwningAbility ou InQueue � nulo. N�o foi poss�vel criar a tarefa."));
+        UE_LOG(LogIQTTasks, Error, TEXT("UIQT_RunQueuedActions: OwningAbility ou InQueue � nulo. N�o foi poss�vel criar a tarefa."));
         return nullptr;
     }
 
@@ -34,6 +41,7 @@ UIQT_RunQueuedActions* UIQT_RunQueuedActions::IQT_RunQueuedActions(UGameplayAbil
     UIQT_RunQueuedActions* MyObj = NewAbilityTask<UIQT_RunQueuedActions>(OwningAbility);
     MyObj->Queue = InQueue;
     MyObj->bOverallSuccess = true; // Reinicia o status de sucesso geral para esta execu��o.
+    MyObj->DefaultActionTimeoutSeconds = FMath::Max(0.0f, DefaultActionTimeout);
     return MyObj;
 }
 
@@ -46,146 +54,249 @@ void UIQT_RunQueuedActions::Activate()
 
 void UIQT_RunQueuedActions::ProcessNextQueueItem()
 {
+    IQT_SCOPE_CYCLE_COUNTER(RunnerStep);
+
     // Limpa qualquer timer pendente para ProcessNextQueueItem, evitando chamadas duplicadas.
     if (GetWorld())
     {
         GetWorld()->GetTimerManager().ClearTimer(NextItemTimerHandle);
     }
     
-    // Verifica se a fila � v�lida ou est� vazia.
-    if (!Queue || Queue->IsQueueEmpty())
+    // Verifica se a fila � v�lida ou est� vazia (itens aguardando nova tentativa mantêm o executor vivo).
+    if (!Queue || (Queue->IsQueueEmpty() && !Queue->HasDelayedItems()))
     {
-        UE_LOG(LogTemp, Log, TEXT("UIQT_RunQueuedActions: Fila de a��es conclu�da. Sucesso geral: %s"), bOverallSuccess ? TEXT("TRUE") : TEXT("FALSE"));
+        UE_LOG(LogIQTTasks, Log, TEXT("UIQT_RunQueuedActions: Fila de a��es conclu�da. Sucesso geral: %s"), bOverallSuccess ? TEXT("TRUE") : TEXT("FALSE"));
         // Se a tarefa ainda deve enviar delegates (ou seja, n�o foi cancelada externamente), envia o status final.
         if (ShouldBroadcastAbilityTaskDelegates())
         {
-            OnFinished.Broadcast(bOverallSuccess); 
+            BroadcastFinished();
         }
         EndTask(); // Encerra a tarefa da habilidade.
         return;
     }
 
-    FIQT_QueueItem CurrentItem;
+    FIQT_QueueItem& CurrentItem = InFlightItem;
     // Tenta desenfileirar um item.
     if (Queue->DequeueItem(CurrentItem))
     {
+        // Conta a tentativa no próprio item, para que a política de retry saiba quantas já ocorreram.
+        CurrentItem.AttemptCount++;
+
         // LOG 1: Confirma que o item foi desenfileirado e a a��o ser� disparada.
-        UE_LOG(LogTemp, Log, TEXT("UIQT_RunQueuedActions: Desenfileirado item '%s'. Disparando a��o..."), *CurrentItem.Name.ToString());
+        UE_LOG(LogIQTTasks, Verbose, TEXT("UIQT_RunQueuedActions: Desenfileirado item '%s'. Disparando a��o..."), *CurrentItem.Name.ToString());
 
-        // Cria a tarefa de espera para a a��o atual.
+        // A espera é um único objeto reutilizável: criada no primeiro item e apenas re-armada nos seguintes.
         // O ator que ir� receber o evento de trigger � o OwnerActor da habilidade.
-        CurrentWaitTask = UIQT_WaitForAction::IQT_WaitActionEvent(
-            Ability, 
-            CurrentItem, 
-            Ability->GetActorInfo().OwnerActor.Get(), // O ator que ser� o alvo do evento de trigger
-            true,  // OnlyTriggerOnce: A tarefa de espera termina ap�s o primeiro sucesso/falha.
-            true  // OnlyMatchExact: Permite que tags filhas tamb�m acionem o evento.
-        );
+        if (GetOrCreateWaitTask())
+        {
+            WaitTask->ReArm(
+                CurrentItem, 
+                Ability->GetActorInfo().OwnerActor.Get(), // O ator que ser� o alvo do evento de trigger
+                true,  // OnlyTriggerOnce: A espera � desarmada ap�s o primeiro sucesso/falha.
+                true,  // OnlyMatchExact: Permite que tags filhas tamb�m acionem o evento.
+                DefaultActionTimeoutSeconds // Timeout padrão para itens sem TimeoutSeconds próprio.
+            );
+        }
         
         // --- IN�CIO DE NOVOS LOGS E VERIFICA��ES DETALHADAS ---
-        if (CurrentWaitTask)
+        if (WaitTask)
         {
-            // LOG 2: Confirma que a task UIQT_WaitForAction foi criada com sucesso.
-            UE_LOG(LogTemp, Log, TEXT("UIQT_RunQueuedActions: UIQT_WaitForAction para item '%s' criada com sucesso. Validando TriggerData..."), *CurrentItem.Name.ToString());
+            // LOG 2: Confirma que a task UIQT_WaitForAction foi configurada para o item.
+            UE_LOG(LogIQTTasks, VeryVerbose, TEXT("UIQT_RunQueuedActions: UIQT_WaitForAction re-armada para item '%s'. Validando TriggerData..."), *CurrentItem.Name.ToString());
             
-            const FIQT_TriggerData& TriggerData = CurrentWaitTask->GetEventTriggerData();
+            const FIQT_TriggerData& TriggerData = WaitTask->GetEventTriggerData();
 
             // Verifica��o 1: Garante que a TriggerData b�sica � v�lida.
             // Isso inclui verificar se a TriggerTag � v�lida e se o EventTargetActor existe e � v�lido.
             if (!TriggerData.TriggerTag.IsValid() || !IsValid(TriggerData.EventTargetActor))
             {
                 // LOG 3: Indica que a TriggerData � inv�lida.
-                UE_LOG(LogTemp, Warning, TEXT("UIQT_RunQueuedActions: TriggerData inv�lida para item '%s'. TriggerTag V�lida: %d, EventTargetActor V�lido: %d"),
+                UE_LOG(LogIQTTasks, Warning, TEXT("UIQT_RunQueuedActions: TriggerData inv�lida para item '%s'. TriggerTag V�lida: %d, EventTargetActor V�lido: %d"),
                     *CurrentItem.Name.ToString(), TriggerData.TriggerTag.IsValid(), IsValid(TriggerData.EventTargetActor));
                 
-                bOverallSuccess = false; // Marca o resultado geral como falha.
-                // Tenta agendar o processamento do pr�ximo item, j� que este n�o pode ser disparado.
-                if (IsValid(Ability) && GetWorld()) 
-                {
-                    GetWorld()->GetTimerManager().SetTimer(NextItemTimerHandle, this, &UIQT_RunQueuedActions::ProcessNextQueueItem, 0.001f, false);
-                }
-                else
-                {
-                    EndTask(); // Se a Ability ou o mundo n�o s�o v�lidos, encerra a tarefa.
-                }
+                // Conta como falha do item (nova tentativa ou mensagens mortas) e segue para o próximo.
+                FailUndispatchedItem();
                 return; // Importante para sair da fun��o e evitar processamento adicional com dados inv�lidos.
             }
 
             // Verifica��o 2: Garante que o ator alvo possui um AbilitySystemComponent, pois � necess�rio para SendGameplayEventToActor.
-            UAbilitySystemComponent* TargetASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(TriggerData.EventTargetActor);
+            UAbilitySystemComponent* TargetASC = UIQT_ASCCacheSubsystem::ResolveASC(TriggerData.EventTargetActor);
             if (!TargetASC)
             {
                 // LOG 4: Indica que o EventTargetActor n�o possui ASC.
-                UE_LOG(LogTemp, Error, TEXT("UIQT_RunQueuedActions: EventTargetActor '%s' para item '%s' n�o possui AbilitySystemComponent. Evento de gameplay N�O SER� ENVIADO."),
+                UE_LOG(LogIQTTasks, Error, TEXT("UIQT_RunQueuedActions: EventTargetActor '%s' para item '%s' n�o possui AbilitySystemComponent. Evento de gameplay N�O SER� ENVIADO."),
                     *TriggerData.EventTargetActor->GetName(), *CurrentItem.Name.ToString());
-                bOverallSuccess = false; // Marca o resultado geral como falha.
-                // Tenta agendar o processamento do pr�ximo item, j� que este n�o pode ser disparado.
-                if (IsValid(Ability) && GetWorld()) 
-                {
-                    GetWorld()->GetTimerManager().SetTimer(NextItemTimerHandle, this, &UIQT_RunQueuedActions::ProcessNextQueueItem, 0.001f, false);
-                }
-                else
-                {
-                    EndTask(); // Se a Ability ou o mundo n�o s�o v�lidos, encerra a tarefa.
-                }
+                // Conta como falha do item (nova tentativa ou mensagens mortas) e segue para o próximo.
+                FailUndispatchedItem();
                 return; // Importante para sair da fun��o e evitar tentar enviar evento para ASC nulo.
             }
 
+            // Passa a ouvir as tags de fim/falha ANTES de enviar o evento: uma habilidade que responde
+            // de forma síncrona (dentro do próprio SendGameplayEventToActor) não tem seu resultado perdido.
+            UE_LOG(LogIQTTasks, VeryVerbose, TEXT("UIQT_RunQueuedActions: Armando UIQT_WaitForAction para item '%s'."), *CurrentItem.Name.ToString());
+            if (!WaitTask->StartWaiting())
+            {
+                // Sem ASC ou sem tags de fim/falha nenhum delegate seria disparado e a fila ficaria parada
+                // para sempre. Trata como falha e segue para o próximo item; o evento não é enviado.
+                UE_LOG(LogIQTTasks, Warning, TEXT("UIQT_RunQueuedActions: UIQT_WaitForAction do item '%s' abortou na ativação. Processando próximo item."), *CurrentItem.Name.ToString());
+                FailUndispatchedItem();
+                return;
+            }
+
             // Neste ponto, TriggerData (incluindo TriggerTag e EventTargetActor) e TargetASC devem ser v�lidos.
             // LOG 5: Confirma que o evento de gameplay ser� enviado.
-            UE_LOG(LogTemp, Log, TEXT("UIQT_RunQueuedActions: Enviando evento '%s' para ator '%s' (ASC: %s)."), 
+            UE_LOG(LogIQTTasks, VeryVerbose, TEXT("UIQT_RunQueuedActions: Enviando evento '%s' para ator '%s' (ASC: %s)."), 
                 *TriggerData.TriggerTag.ToString(), *TriggerData.EventTargetActor->GetName(), *TargetASC->GetName());
             
             // Dispara o evento de gameplay para o ator alvo especificado na TriggerData.
+            IQT_TRACE_EVENT(EIQT_TraceOp::ActionStart, Queue->GetUniqueID(), CurrentItem.Handle.Value, CurrentItem.Priority);
+            Queue->NotifyActionDispatched(CurrentItem);
+            bActionInFlight = true;
             UAbilitySystemBlueprintLibrary::SendGameplayEventToActor(TriggerData.EventTargetActor, TriggerData.TriggerTag, TriggerData.Payload);
-            
-            // LOG 6: Confirma a vincula��o dos delegates da task de espera.
-            UE_LOG(LogTemp, Log, TEXT("UIQT_RunQueuedActions: Vinculando delegates para UIQT_WaitForAction de item '%s'."), *CurrentItem.Name.ToString());
-            CurrentWaitTask->SucessesfullAction.AddDynamic(this, &UIQT_RunQueuedActions::OnActionSucceeded);
-            CurrentWaitTask->FailedAction.AddDynamic(this, &UIQT_RunQueuedActions::OnActionFailed);
-            
-            // LOG 7: Confirma a ativa��o da task de espera.
-            UE_LOG(LogTemp, Log, TEXT("UIQT_RunQueuedActions: Ativando UIQT_WaitForAction para item '%s'."), *CurrentItem.Name.ToString());
-            CurrentWaitTask->Activate(); 
         }
-        else // A cria��o da UIQT_WaitForAction falhou (j� logado internamente por IQT_WaitActionEvent se a falha for l�)
+        else // A cria��o da UIQT_WaitForAction falhou (j� logado internamente por CreateReusableWaitTask)
         {
             // LOG 8: Indica falha na cria��o da task UIQT_WaitForAction.
-            UE_LOG(LogTemp, Error, TEXT("UIQT_RunQueuedActions: Falha ao criar UIQT_WaitForAction para item '%s'. Processando pr�ximo item."), *CurrentItem.Name.ToString());
-            bOverallSuccess = false; 
-            if (IsValid(Ability) && GetWorld()) 
-            {
-                GetWorld()->GetTimerManager().SetTimer(NextItemTimerHandle, this, &UIQT_RunQueuedActions::ProcessNextQueueItem, 0.001f, false);
-            }
-            else
-            {
-                EndTask();
-            }
+            UE_LOG(LogIQTTasks, Error, TEXT("UIQT_RunQueuedActions: Falha ao criar UIQT_WaitForAction para item '%s'. Processando pr�ximo item."), *CurrentItem.Name.ToString());
+            FailUndispatchedItem();
+        }
+    }
+    else if (Queue->HasDelayedItems())
+    {
+        // Só há itens aguardando o backoff: espera até o próximo ficar pronto.
+        const float WaitSeconds = FMath::Max(0.001f, Queue->GetSecondsUntilNextDelayedItem());
+        UE_LOG(LogIQTTasks, Verbose, TEXT("UIQT_RunQueuedActions: Aguardando %.3fs pelo próximo item atrasado."), WaitSeconds);
+        if (IsValid(Ability) && GetWorld())
+        {
+            GetWorld()->GetTimerManager().SetTimer(NextItemTimerHandle, this, &UIQT_RunQueuedActions::ProcessNextQueueItem, WaitSeconds, false);
+        }
+        else
+        {
+            EndTask();
+        }
+    }
+    else if (Queue->IsBrokerDequeuePending())
+    {
+        // Fila compartilhada pelo broker: o pedido do item ainda está a caminho. Tenta de novo no próximo tick.
+        UE_LOG(LogIQTTasks, VeryVerbose, TEXT("UIQT_RunQueuedActions: Aguardando a resposta do broker para o próximo item."));
+        if (IsValid(Ability) && GetWorld())
+        {
+            NextItemTimerHandle = GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UIQT_RunQueuedActions::ProcessNextQueueItem);
+        }
+        else
+        {
+            EndTask();
         }
     }
     else // DequeueItem falhou inesperadamente (a fila n�o estava vazia, mas DequeueItem retornou false)
     {
-        UE_LOG(LogTemp, Error, TEXT("UIQT_RunQueuedActions: DequeueItem falhou inesperadamente. Encerrando tarefa com falha."));
+        UE_LOG(LogIQTTasks, Error, TEXT("UIQT_RunQueuedActions: DequeueItem falhou inesperadamente. Encerrando tarefa com falha."));
         bOverallSuccess = false; 
         if (ShouldBroadcastAbilityTaskDelegates())
         {
-            OnFinished.Broadcast(bOverallSuccess);
+            BroadcastFinished();
         }
         EndTask();
     }
 }
 
+UIQT_WaitForAction* UIQT_RunQueuedActions::GetOrCreateWaitTask()
+{
+    // Uma espera encerrada externamente (ex.: EndTask via habilidade) é substituída uma única vez.
+    if (!WaitTask || WaitTask->IsFinished())
+    {
+        WaitTask = UIQT_WaitForAction::CreateReusableWaitTask(Ability);
+        if (WaitTask)
+        {
+            // LOG 6: Os delegates são vinculados uma vez por objeto, não mais a cada item.
+            // Usa os delegates nativos: os dinâmicos ficam sem ligações e a espera nem chega a dispará-los.
+            UE_LOG(LogIQTTasks, VeryVerbose, TEXT("UIQT_RunQueuedActions: Vinculando delegates da UIQT_WaitForAction reutilizável."));
+            WaitTask->OnSucceededNative.AddUObject(this, &UIQT_RunQueuedActions::OnActionSucceeded);
+            WaitTask->OnFailedNative.AddUObject(this, &UIQT_RunQueuedActions::OnActionFailed);
+        }
+    }
+    return WaitTask;
+}
+
+void UIQT_RunQueuedActions::RetryOrDeadLetterInFlightItem(FGameplayTag FailTag)
+{
+    // Decide entre nova tentativa (item volta para a fila como atrasado) e falha definitiva (fila de mensagens mortas).
+    const FIQT_RetryPolicy& RetryPolicy = InFlightItem.GetDispatchData().RetryPolicy;
+    if (Queue && RetryPolicy.CanRetry(InFlightItem.AttemptCount, FailTag))
+    {
+        const float RetryDelay = RetryPolicy.ComputeBackoffDelay(InFlightItem.AttemptCount);
+        UE_LOG(LogIQTTasks, Log, TEXT("UIQT_RunQueuedActions: Nova tentativa %d/%d da ação '%s' em %.3fs."),
+            InFlightItem.AttemptCount + 1, RetryPolicy.MaxAttempts, *InFlightItem.Name.ToString(), RetryDelay);
+        if (!Queue->RequeueDelayedItem(MoveTemp(InFlightItem), RetryDelay))
+        {
+            bOverallSuccess = false;
+        }
+    }
+    else
+    {
+        bOverallSuccess = false; // Uma ação individual falhou, então o sucesso geral é falso.
+        if (Queue)
+        {
+            Queue->AddDeadLetterItem(InFlightItem, FailTag);
+        }
+    }
+}
+
+void UIQT_RunQueuedActions::FailUndispatchedItem()
+{
+    // Sem disparo não há NotifyActionCompleted: o empréstimo do broker termina aqui, e uma nova tentativa volta
+    // ao broker como item novo, como nas falhas da própria ação.
+    if (Queue)
+    {
+        Queue->AcknowledgeItem(InFlightItem);
+    }
+    RetryOrDeadLetterInFlightItem(IQTGameplayTags::Action_DispatchFailed);
+
+    if (IsValid(Ability) && GetWorld())
+    {
+        GetWorld()->GetTimerManager().SetTimer(NextItemTimerHandle, this, &UIQT_RunQueuedActions::ProcessNextQueueItem, 0.001f, false);
+    }
+    else
+    {
+        EndTask(); // Se a Ability ou o mundo não são válidos, encerra a tarefa.
+    }
+}
+
+void UIQT_RunQueuedActions::ReleaseInFlightAction(bool bRecordLatency)
+{
+    if (bActionInFlight)
+    {
+        bActionInFlight = false;
+        if (Queue)
+        {
+            Queue->NotifyActionCompleted(InFlightItem, bRecordLatency);
+        }
+    }
+}
+
+void UIQT_RunQueuedActions::BroadcastFinished()
+{
+    if (OnFinished.IsBound())
+    {
+        OnFinished.Broadcast(bOverallSuccess);
+    }
+    OnFinishedNative.Broadcast(bOverallSuccess);
+}
+
 // Callback para quando uma a��o individual � conclu�da com sucesso.
-void UIQT_RunQueuedActions::OnActionSucceeded(FGameplayEventData Payload, const FIQT_QueueItem& QueueItemData, FGameplayTag EventTag, AActor* EventTargetActor, FGameplayTag TriggerTag)
+void UIQT_RunQueuedActions::OnActionSucceeded(const FGameplayEventData& Payload, const FIQT_QueueItem& QueueItemData, FGameplayTag EventTag, AActor* EventTargetActor, FGameplayTag TriggerTag)
 {
-    UE_LOG(LogTemp, Log, TEXT("UIQT_RunQueuedActions: A��o '%s' conclu�da com SUCESSO (Tag: %s | TriggerTag: %s)."), *QueueItemData.Name.ToString(), *EventTag.ToString(), *TriggerTag.ToString());
+    UE_LOG(LogIQTTasks, Verbose, TEXT("UIQT_RunQueuedActions: A��o '%s' conclu�da com SUCESSO (Tag: %s | TriggerTag: %s)."), *QueueItemData.Name.ToString(), *EventTag.ToString(), *TriggerTag.ToString());
     
-    // Finaliza a CurrentWaitTask antes de agendar a pr�xima itera��o.
-    // Isso � crucial para liberar recursos e desvincular delegates.
-    if (CurrentWaitTask)
+    IQT_SCOPE_CYCLE_COUNTER(RunnerCallback);
+    IQT_TRACE_EVENT(EIQT_TraceOp::ActionSuccess, Queue ? Queue->GetUniqueID() : 0, QueueItemData.Handle.Value, QueueItemData.Priority);
+    ReleaseInFlightAction();
+
+    // Desarma a espera antes de agendar a pr�xima itera��o: ela ignora eventos at� ser re-armada
+    // com o pr�ximo item, mantendo objeto e liga��es com o ASC.
+    if (WaitTask)
     {
-        CurrentWaitTask->EndTask();
-        CurrentWaitTask = nullptr; 
+        WaitTask->Disarm();
     }
 
     // Se a Ability que possui esta task ainda � v�lida e o mundo existe, agende o processamento do pr�ximo item.
@@ -200,17 +311,31 @@ void UIQT_RunQueuedActions::OnActionSucceeded(FGameplayEventData Payload, const
 }
 
 // Callback para quando uma a��o individual falha.
-void UIQT_RunQueuedActions::OnActionFailed(FGameplayEventData Payload, const FIQT_QueueItem& QueueItemData, FGameplayTag EventTag, AActor* EventTargetActor, FGameplayTag TriggerTag)
+void UIQT_RunQueuedActions::OnActionFailed(const FGameplayEventData& Payload, const FIQT_QueueItem& QueueItemData, FGameplayTag EventTag, AActor* EventTargetActor, FGameplayTag TriggerTag)
 {
-    UE_LOG(LogTemp, Warning, TEXT("UIQT_RunQueuedActions: A��o '%s' falhou (Tag: %s | TriggerTag: %s)."), *QueueItemData.Name.ToString(), *EventTag.ToString(), *TriggerTag.ToString());
-    bOverallSuccess = false; // Uma ao individual falhou, ent�o o sucesso geral � falso.
+    UE_LOG(LogIQTTasks, Warning, TEXT("UIQT_RunQueuedActions: A��o '%s' falhou (Tag: %s | TriggerTag: %s)."), *QueueItemData.Name.ToString(), *EventTag.ToString(), *TriggerTag.ToString());
+
+    IQT_SCOPE_CYCLE_COUNTER(RunnerCallback);
+    IQT_TRACE_EVENT(EventTag.MatchesTagExact(IQTGameplayTags::Action_Timeout) ? EIQT_TraceOp::ActionTimeout : EIQT_TraceOp::ActionFail,
+        Queue ? Queue->GetUniqueID() : 0, QueueItemData.Handle.Value, QueueItemData.Priority);
+    ReleaseInFlightAction();
+
+    // A decisão usa InFlightItem, que é o mesmo item entregue à task de espera.
+    RetryOrDeadLetterInFlightItem(EventTag);
     
-    // Finaliza a CurrentWaitTask antes de agendar a pr�xima itera��o.
-    // Isso � crucial para liberar recursos e desvincular delegates.
-    if (CurrentWaitTask)
+    // Desarma a espera antes de agendar a pr�xima itera��o: ela ignora eventos at� ser re-armada
+    // com o pr�ximo item, mantendo objeto e liga��es com o ASC.
+    if (WaitTask)
     {
-        CurrentWaitTask->EndTask();
-        CurrentWaitTask = nullptr; 
+        WaitTask->Disarm();
+    }
+
+    // Timeout: a ação já consumiu todo o seu prazo, então o próximo item vai no próximo tick, sem o atraso do timer.
+    // Nunca aqui dentro: estamos no broadcast de falha da própria espera, que não pode ser re-armada durante ele.
+    if (EventTag.MatchesTagExact(IQTGameplayTags::Action_Timeout) && IsValid(Ability) && GetWorld())
+    {
+        NextItemTimerHandle = GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UIQT_RunQueuedActions::ProcessNextQueueItem);
+        return;
     }
 
     // Se a Ability que possui esta task ainda � v�lida e o mundo existe, agende o processamento do pr�ximo item.
@@ -232,12 +357,13 @@ void UIQT_RunQueuedActions::OnDestroy(bool AbilityEnding)
     {
         GetWorld()->GetTimerManager().ClearTimer(NextItemTimerHandle);
     }
-    // Garante que a tarefa de espera atual (CurrentWaitTask) seja limpa, se ainda ativa.
-    if (CurrentWaitTask)
+    // A espera reutilizável s� termina junto com o executor.
+    if (WaitTask)
     {
-        CurrentWaitTask->EndTask();
-        CurrentWaitTask = nullptr;
+        WaitTask->EndTask();
+        WaitTask = nullptr;
     }
+    ReleaseInFlightAction(false);
     // Chama a implementa��o base.
     Super::OnDestroy(AbilityEnding);
 }
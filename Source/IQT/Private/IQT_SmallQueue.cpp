@@ -0,0 +1,661 @@
+﻿// IQT/Source/IQT/Private/IQT_SmallQueue.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_SmallQueue.h"
+#include "Internal/IQT_PriorityQueueInternal.h"
+#include "IQT_Log.h"
+#include "Algo/Sort.h"
+#include "Math/VectorRegister.h"
+
+namespace IQTSmallQueue
+{
+    // Avalia a consulta uma vez por tag distinta: montar o FGameplayTagContainer de cada item aloca.
+    struct FQueryMatcher
+    {
+        const FGameplayTagQuery& Query;
+        FGameplayTag LastTag;
+        bool bLastMatch = false;
+        bool bHasLast = false;
+
+        explicit FQueryMatcher(const FGameplayTagQuery& InQuery)
+            : Query(InQuery)
+        {}
+
+        bool operator()(const FIQT_QueueItem& Item)
+        {
+            if (!bHasLast || Item.AbilityTriggerTag != LastTag)
+            {
+                LastTag = Item.AbilityTriggerTag;
+                bLastMatch = Query.Matches(FGameplayTagContainer(LastTag));
+                bHasLast = true;
+            }
+            return bLastMatch;
+        }
+    };
+
+    // Diferença com sinal para tolerar o estouro do contador (como na fila interna).
+    static bool IsNewer(uint32 A, uint32 B)
+    {
+        return static_cast<int32>(A - B) > 0;
+    }
+}
+
+FIQT_SmallQueue::FIQT_SmallQueue()
+    : UsedSlots(0)
+    , Num(0)
+    , NumOpen(0)
+    , NextSequence(0)
+    , NextGeneration(1)
+    , bActive(Capacity > 0)
+    , PublishedNum(0)
+    , PublishedNumOpen(0)
+    , PublishedHeadPriority(NoHeadPriority)
+{
+    for (int32& Key : Keys)
+    {
+        Key = MAX_int32;
+    }
+}
+
+FIQT_SmallQueue::~FIQT_SmallQueue()
+{
+    // Nenhuma outra thread pode usar a fila durante a destruição: não há o que travar.
+    EmptyLocked();
+}
+
+int32 FIQT_SmallQueue::FindInsertPositionLocked(int32 Key, uint32 Sequence) const
+{
+    // Conta, 4 chaves por instrução, os itens que saem antes (chave menor); as posições livres valem MAX_int32.
+    const VectorRegister4Int KeyLanes = VectorIntSet1(Key);
+    int32 NumBefore = 0;
+    for (int32 Lane = 0; Lane < NumKeyLanes; Lane += 4)
+    {
+        const VectorRegister4Int Before = VectorIntCompareGT(KeyLanes, VectorIntLoadAligned(&Keys[Lane]));
+        NumBefore += FMath::CountBits(static_cast<uint64>(VectorMaskBits(VectorCastIntToFloat(Before))));
+    }
+
+    // Chaves iguais ficam em ordem de chegada: os mais novos que o item saem antes e ficam acima dele.
+    int32 Position = Num - NumBefore;
+    while (Position > 0 && Keys[Position - 1] == Key && IQTSmallQueue::IsNewer(Sequences[PositionSlots[Position - 1]], Sequence))
+    {
+        Position--;
+    }
+    return Position;
+}
+
+void FIQT_SmallQueue::InsertAtLocked(int32 Position, int32 Slot)
+{
+    for (int32 Index = Num; Index > Position; --Index)
+    {
+        Keys[Index] = Keys[Index - 1];
+        PositionSlots[Index] = PositionSlots[Index - 1];
+    }
+    Keys[Position] = GetItem(Slot).Priority;
+    PositionSlots[Position] = static_cast<uint8>(Slot);
+    Num++;
+}
+
+void FIQT_SmallQueue::UnlinkAtLocked(int32 Position)
+{
+    for (int32 Index = Position; Index < Num - 1; ++Index)
+    {
+        Keys[Index] = Keys[Index + 1];
+        PositionSlots[Index] = PositionSlots[Index + 1];
+    }
+    Num--;
+    Keys[Num] = MAX_int32;
+}
+
+void FIQT_SmallQueue::RemoveAtLocked(int32 Position, FIQT_QueueItem* OutItem)
+{
+    const int32 Slot = PositionSlots[Position];
+    UnlinkAtLocked(Position);
+
+    FIQT_QueueItem& Item = GetItem(Slot);
+    NumOpen -= Item.bIsOpen ? 1 : 0;
+    if (OutItem)
+    {
+        *OutItem = MoveTemp(Item);
+    }
+    DestructItem(&Item);
+    UsedSlots &= ~(1u << Slot);
+}
+
+int32 FIQT_SmallQueue::FindFirstPositionLocked(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate) const
+{
+    for (int32 Position = Num - 1; Position >= 0; --Position)
+    {
+        if (Predicate(GetItem(PositionSlots[Position])))
+        {
+            return Position;
+        }
+    }
+    return INDEX_NONE;
+}
+
+int32 FIQT_SmallQueue::ResolveHandleLocked(FIQT_ItemHandle Handle) const
+{
+    const uint32 Slot = Handle.GetSlot();
+    if (!Handle.IsValid() || Slot >= static_cast<uint32>(NumSlots) || (UsedSlots & (1u << Slot)) == 0 || Generations[Slot] != Handle.GetGeneration())
+    {
+        return INDEX_NONE;
+    }
+    for (int32 Position = 0; Position < Num; ++Position)
+    {
+        if (PositionSlots[Position] == Slot)
+        {
+            return Position;
+        }
+    }
+    return INDEX_NONE;
+}
+
+void FIQT_SmallQueue::EmptyLocked()
+{
+    for (int32 Slot = 0; Slot < NumSlots; ++Slot)
+    {
+        if (UsedSlots & (1u << Slot))
+        {
+            DestructItem(&GetItem(Slot));
+        }
+    }
+    for (int32& Key : Keys)
+    {
+        Key = MAX_int32;
+    }
+    UsedSlots = 0;
+    Num = 0;
+    NumOpen = 0;
+}
+
+void FIQT_SmallQueue::PublishLocked()
+{
+    PublishedNum.store(Num, std::memory_order_relaxed);
+    PublishedNumOpen.store(NumOpen, std::memory_order_relaxed);
+    PublishedHeadPriority.store(Num > 0 ? int64(Keys[Num - 1]) : NoHeadPriority, std::memory_order_relaxed);
+}
+
+TOptional<bool> FIQT_SmallQueue::Enqueue(FIQT_QueueItem& InOutItem, int32 MaxSize, FIQT_ItemHandle& OutHandle)
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    if (!UIQT_PriorityQueueInternal::ValidateData(InOutItem) || (MaxSize > 0 && Num >= MaxSize))
+    {
+        return false;
+    }
+    if (Num >= Capacity)
+    {
+        return {};
+    }
+
+    // Geração 0 é reservada para o handle inválido.
+    const int32 Slot = static_cast<int32>(FMath::CountTrailingZeros(~UsedSlots));
+    const uint32 Generation = NextGeneration;
+    NextGeneration = NextGeneration == MAX_uint32 ? 1 : NextGeneration + 1;
+
+    FIQT_QueueItem& Stored = *new (Storage[Slot].GetTypedPtr()) FIQT_QueueItem(MoveTemp(InOutItem));
+    Stored.Handle = FIQT_ItemHandle(static_cast<uint32>(Slot), Generation);
+    OutHandle = Stored.Handle;
+    UsedSlots |= 1u << Slot;
+    Generations[Slot] = Generation;
+    Sequences[Slot] = NextSequence++;
+    NumOpen += Stored.bIsOpen ? 1 : 0;
+    InsertAtLocked(FindInsertPositionLocked(Stored.Priority, Sequences[Slot]), Slot);
+    PublishLocked();
+    return true;
+}
+
+TOptional<bool> FIQT_SmallQueue::Dequeue(FIQT_QueueItem& OutItem)
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    if (Num == 0)
+    {
+        return false;
+    }
+    RemoveAtLocked(Num - 1, &OutItem);
+    PublishLocked();
+    return true;
+}
+
+TOptional<bool> FIQT_SmallQueue::DequeueMatching(const FGameplayTagQuery& Query, FIQT_QueueItem& OutItem)
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    IQTSmallQueue::FQueryMatcher Matcher(Query);
+    const int32 Position = Query.IsEmpty() ? INDEX_NONE : FindFirstPositionLocked(Matcher);
+    if (Position == INDEX_NONE)
+    {
+        return false;
+    }
+    RemoveAtLocked(Position, &OutItem);
+    PublishLocked();
+    return true;
+}
+
+TOptional<bool> FIQT_SmallQueue::PeekMatching(const FGameplayTagQuery& Query, FIQT_QueueItem& OutItem) const
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    IQTSmallQueue::FQueryMatcher Matcher(Query);
+    const int32 Position = Query.IsEmpty() ? INDEX_NONE : FindFirstPositionLocked(Matcher);
+    if (Position == INDEX_NONE)
+    {
+        return false;
+    }
+    OutItem = GetItem(PositionSlots[Position]);
+    return true;
+}
+
+TOptional<int32> FIQT_SmallQueue::ForEachTopK(int32 K, TFunctionRef<void(const FIQT_QueueItem&)> Visitor) const
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    const int32 NumVisited = FMath::Clamp(K, 0, Num);
+    for (int32 Position = Num - 1; Position >= Num - NumVisited; --Position)
+    {
+        Visitor(GetItem(PositionSlots[Position]));
+    }
+    return NumVisited;
+}
+
+bool FIQT_SmallQueue::ForEachItem(TFunctionRef<bool(const FIQT_QueueItem&)> Visitor) const
+{
+    if (!IsActive())
+    {
+        return false;
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+    for (int32 Position = Num - 1; Position >= 0 && Visitor(GetItem(PositionSlots[Position])); --Position)
+    {
+    }
+    return true;
+}
+
+TOptional<int32> FIQT_SmallQueue::CountMatching(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate) const
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    int32 NumMatches = 0;
+    for (int32 Position = 0; Position < Num; ++Position)
+    {
+        NumMatches += Predicate(GetItem(PositionSlots[Position])) ? 1 : 0;
+    }
+    return NumMatches;
+}
+
+TOptional<int32> FIQT_SmallQueue::CountMatching(const FGameplayTagQuery& Query) const
+{
+    if (Query.IsEmpty())
+    {
+        return IsActive() ? TOptional<int32>(0) : TOptional<int32>();
+    }
+    IQTSmallQueue::FQueryMatcher Matcher(Query);
+    return CountMatching([&Matcher](const FIQT_QueueItem& Item) { return Matcher(Item); });
+}
+
+TOptional<bool> FIQT_SmallQueue::Contains(const FIQT_QueueItem& InData) const
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    return FindFirstPositionLocked([&InData](const FIQT_QueueItem& Item) { return Item == InData; }) != INDEX_NONE;
+}
+
+TOptional<bool> FIQT_SmallQueue::RemoveItem(const FIQT_QueueItem& ItemToRemove)
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    const int32 Position = FindFirstPositionLocked([&ItemToRemove](const FIQT_QueueItem& Item) { return Item == ItemToRemove; });
+    if (Position == INDEX_NONE)
+    {
+        return false;
+    }
+    RemoveAtLocked(Position, nullptr);
+    PublishLocked();
+    return true;
+}
+
+TOptional<bool> FIQT_SmallQueue::FindByTaskID(const FGuid& TaskID, FIQT_QueueItem& OutItem) const
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    const int32 Position = TaskID.IsValid() ? FindFirstPositionLocked([&TaskID](const FIQT_QueueItem& Item) { return Item.TaskID == TaskID; }) : INDEX_NONE;
+    if (Position == INDEX_NONE)
+    {
+        return false;
+    }
+    OutItem = GetItem(PositionSlots[Position]);
+    return true;
+}
+
+TOptional<bool> FIQT_SmallQueue::FindByHashKey(FName InName, FGameplayTag InTag, bool bInIsOpen, FIQT_QueueItem& OutItem) const
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    const int32 Position = FindFirstPositionLocked([InName, InTag, bInIsOpen](const FIQT_QueueItem& Item)
+    {
+        return Item.Name == InName && Item.AbilityTriggerTag == InTag && Item.bIsOpen == bInIsOpen;
+    });
+    if (Position == INDEX_NONE)
+    {
+        return false;
+    }
+    OutItem = GetItem(PositionSlots[Position]);
+    return true;
+}
+
+TOptional<bool> FIQT_SmallQueue::IsHandleValid(FIQT_ItemHandle Handle) const
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    return ResolveHandleLocked(Handle) != INDEX_NONE;
+}
+
+TOptional<bool> FIQT_SmallQueue::FindByHandle(FIQT_ItemHandle Handle, FIQT_QueueItem& OutItem) const
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    const int32 Position = ResolveHandleLocked(Handle);
+    if (Position == INDEX_NONE)
+    {
+        return false;
+    }
+    OutItem = GetItem(PositionSlots[Position]);
+    return true;
+}
+
+TOptional<bool> FIQT_SmallQueue::RemoveByHandle(FIQT_ItemHandle Handle, FIQT_QueueItem* OutItem)
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    const int32 Position = ResolveHandleLocked(Handle);
+    if (Position == INDEX_NONE)
+    {
+        return false;
+    }
+    RemoveAtLocked(Position, OutItem);
+    PublishLocked();
+    return true;
+}
+
+TOptional<bool> FIQT_SmallQueue::UpdatePriority(FIQT_ItemHandle Handle, int32 NewPriority)
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    const int32 Position = ResolveHandleLocked(Handle);
+    if (Position == INDEX_NONE)
+    {
+        return false;
+    }
+    // Volta na posição da nova chave mantendo a ordem de chegada, como UpdatePriority da fila interna.
+    const int32 Slot = PositionSlots[Position];
+    UnlinkAtLocked(Position);
+    GetItem(Slot).Priority = NewPriority;
+    InsertAtLocked(FindInsertPositionLocked(NewPriority, Sequences[Slot]), Slot);
+    PublishLocked();
+    return true;
+}
+
+TOptional<bool> FIQT_SmallQueue::EnsureTaskID(FIQT_ItemHandle Handle, FGuid& OutTaskID)
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+    const int32 Position = ResolveHandleLocked(Handle);
+    if (Position == INDEX_NONE)
+    {
+        return false;
+    }
+    OutTaskID = GetItem(PositionSlots[Position]).GetTaskID();
+    return true;
+}
+
+TOptional<int32> FIQT_SmallQueue::GetCount() const
+{
+    return IsActive() ? TOptional<int32>(PublishedNum.load(std::memory_order_relaxed)) : TOptional<int32>();
+}
+
+TOptional<int32> FIQT_SmallQueue::GetNumOpen() const
+{
+    return IsActive() ? TOptional<int32>(PublishedNumOpen.load(std::memory_order_relaxed)) : TOptional<int32>();
+}
+
+TOptional<bool> FIQT_SmallQueue::GetHeadPriority(int32& OutPriority) const
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    const int64 HeadPriority = PublishedHeadPriority.load(std::memory_order_relaxed);
+    if (HeadPriority == NoHeadPriority)
+    {
+        return false;
+    }
+    OutPriority = static_cast<int32>(HeadPriority);
+    return true;
+}
+
+bool FIQT_SmallQueue::Empty()
+{
+    if (!IsActive())
+    {
+        return false;
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+    EmptyLocked();
+    PublishLocked();
+    return true;
+}
+
+bool FIQT_SmallQueue::Promote(TFunctionRef<void(TArray<FIQT_QueueItem>&& Items, uint32 NextGeneration)> Adopt)
+{
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed) && Capacity > 0)
+    {
+        return false;
+    }
+
+    // Ordem de chegada: a fila interna numera os itens na ordem recebida, e essa numeração desempata prioridades
+    // iguais também em atualizações futuras.
+    uint8 ArrivalSlots[NumSlots];
+    for (int32 Position = 0; Position < Num; ++Position)
+    {
+        ArrivalSlots[Position] = PositionSlots[Position];
+    }
+    Algo::Sort(TArrayView<uint8>(ArrivalSlots, Num), [this](uint8 A, uint8 B) { return IQTSmallQueue::IsNewer(Sequences[B], Sequences[A]); });
+
+    TArray<FIQT_QueueItem> Items;
+    Items.Reserve(Num);
+    for (int32 Index = 0; Index < Num; ++Index)
+    {
+        Items.Add(MoveTemp(GetItem(ArrivalSlots[Index])));
+    }
+    EmptyLocked();
+    Adopt(MoveTemp(Items), NextGeneration);
+
+    // Sem publicar a contagem zerada: leitores sem trava que ainda vejam bActive leriam uma fila vazia antes de
+    // passar para a interna. Os valores publicados ficam com a contagem de antes (a mesma que a interna acabou de
+    // receber) e deixam de ser lidos assim que bActive cai.
+    bActive.store(false, std::memory_order_release);
+    return true;
+}
+
+void FIQT_SmallQueue::AddReferencedObjects(FReferenceCollector& Collector)
+{
+    FScopeLock Lock(&Mutex);
+    for (int32 Position = 0; Position < Num; ++Position)
+    {
+        FIQT_QueueItem& Item = GetItem(PositionSlots[Position]);
+        Collector.AddReferencedObject(Item.UserPayload);
+        Item.DispatchData.AddStructReferencedObjects(Collector);
+    }
+}
+
+TOptional<bool> FIQT_SmallQueue::ValidateInvariants() const
+{
+    if (!IsActive())
+    {
+        return {};
+    }
+    FScopeLock Lock(&Mutex);
+    if (!bActive.load(std::memory_order_relaxed))
+    {
+        return {};
+    }
+
+    uint32 SeenSlots = 0;
+    int32 CountedOpen = 0;
+    for (int32 Position = 0; Position < Num; ++Position)
+    {
+        const int32 Slot = PositionSlots[Position];
+        if ((UsedSlots & (1u << Slot)) == 0 || (SeenSlots & (1u << Slot)) != 0)
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SmallQueue: Erro de validação: Slot %d da posição %d livre ou repetido."), Slot, Position);
+            return false;
+        }
+        SeenSlots |= 1u << Slot;
+
+        const FIQT_QueueItem& Item = GetItem(Slot);
+        if (Keys[Position] != Item.Priority || Item.Handle != FIQT_ItemHandle(static_cast<uint32>(Slot), Generations[Slot]))
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SmallQueue: Erro de validação: Chave ou handle da posição %d diverge do item."), Position);
+            return false;
+        }
+        // Cada posição sai antes da anterior: chave menor, ou igual e mais nova.
+        if (Position > 0 && !(Keys[Position] < Keys[Position - 1] || (Keys[Position] == Keys[Position - 1] && IQTSmallQueue::IsNewer(Sequences[Slot], Sequences[PositionSlots[Position - 1]]))))
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SmallQueue: Erro de validação: Ordem de saída violada na posição %d."), Position);
+            return false;
+        }
+        CountedOpen += Item.bIsOpen ? 1 : 0;
+    }
+    if (SeenSlots != UsedSlots || CountedOpen != NumOpen)
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SmallQueue: Erro de validação: Slots ocupados ou contagem de abertos (%d, esperado %d) divergem."), NumOpen, CountedOpen);
+        return false;
+    }
+    for (int32 Position = Num; Position < NumKeyLanes; ++Position)
+    {
+        if (Keys[Position] != MAX_int32)
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SmallQueue: Erro de validação: Posição livre %d sem a chave de preenchimento."), Position);
+            return false;
+        }
+    }
+    return true;
+}
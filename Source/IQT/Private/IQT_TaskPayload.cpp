@@ -0,0 +1,274 @@
+﻿// IQT/Source/IQT/Private/IQT_TaskPayload.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_TaskPayload.h"
+#include "Abilities/GameplayAbilityTypes.h"
+#include "UObject/UObjectGlobals.h"
+
+FIQT_TaskPayload::FIQT_TaskPayload()
+    : ScriptStruct(nullptr)
+    , HeapMemory(nullptr)
+    , bHasObjectReferences(false)
+{
+}
+
+FIQT_TaskPayload::FIQT_TaskPayload(const FIQT_TaskPayload& Other)
+    : FIQT_TaskPayload()
+{
+    InitializeAs(Other.ScriptStruct, Other.IsValid() ? Other.GetMemory() : nullptr);
+}
+
+FIQT_TaskPayload::FIQT_TaskPayload(FIQT_TaskPayload&& Other)
+    : FIQT_TaskPayload()
+{
+    MoveFrom(Other);
+}
+
+FIQT_TaskPayload::~FIQT_TaskPayload()
+{
+    Reset();
+}
+
+FIQT_TaskPayload& FIQT_TaskPayload::operator=(const FIQT_TaskPayload& Other)
+{
+    if (this != &Other)
+    {
+        if (Other.IsValid())
+        {
+            InitializeAs(Other.ScriptStruct, Other.GetMemory());
+        }
+        else
+        {
+            Reset();
+        }
+    }
+    return *this;
+}
+
+FIQT_TaskPayload& FIQT_TaskPayload::operator=(FIQT_TaskPayload&& Other)
+{
+    if (this != &Other)
+    {
+        Reset();
+        MoveFrom(Other);
+    }
+    return *this;
+}
+
+bool FIQT_TaskPayload::FitsInline(const UScriptStruct* InStruct)
+{
+    return InStruct->GetStructureSize() <= InlineSize && InStruct->GetMinAlignment() <= InlineAlignment;
+}
+
+void FIQT_TaskPayload::InitializeAs(const UScriptStruct* InStruct, const uint8* Source)
+{
+    // Mesmo tipo: reaproveita a memória e só copia (ou limpa) os dados.
+    if (InStruct && InStruct == ScriptStruct)
+    {
+        if (Source)
+        {
+            InStruct->CopyScriptStruct(GetMutableMemory(), Source);
+        }
+        else
+        {
+            InStruct->ClearScriptStruct(GetMutableMemory());
+        }
+        return;
+    }
+
+    Reset();
+    if (!InStruct)
+    {
+        return;
+    }
+
+    ScriptStruct = InStruct;
+    bHasObjectReferences = InStruct->RefLink != nullptr || (InStruct->StructFlags & STRUCT_AddStructReferencedObjects) != 0;
+    if (!FitsInline(InStruct))
+    {
+        HeapMemory = static_cast<uint8*>(FMemory::Malloc(FMath::Max(1, InStruct->GetStructureSize()), InStruct->GetMinAlignment()));
+    }
+
+    uint8* Memory = GetMutableMemory();
+    InStruct->InitializeStruct(Memory);
+    if (Source)
+    {
+        InStruct->CopyScriptStruct(Memory, Source);
+    }
+}
+
+void FIQT_TaskPayload::Reset()
+{
+    if (ScriptStruct)
+    {
+        ScriptStruct->DestroyStruct(GetMutableMemory());
+    }
+    if (HeapMemory)
+    {
+        FMemory::Free(HeapMemory);
+        HeapMemory = nullptr;
+    }
+    ScriptStruct = nullptr;
+    bHasObjectReferences = false;
+}
+
+void FIQT_TaskPayload::MoveFrom(FIQT_TaskPayload& Other)
+{
+    if (!Other.IsValid())
+    {
+        return;
+    }
+
+    if (Other.HeapMemory)
+    {
+        ScriptStruct = Other.ScriptStruct;
+        HeapMemory = Other.HeapMemory;
+        bHasObjectReferences = Other.bHasObjectReferences;
+        Other.HeapMemory = nullptr;
+        Other.ScriptStruct = nullptr;
+        Other.bHasObjectReferences = false;
+        return;
+    }
+
+    // UScriptStruct não expõe construção por movimento: dados inline são copiados (são pequenos por definição).
+    InitializeAs(Other.ScriptStruct, Other.GetMemory());
+    Other.Reset();
+}
+
+FInstancedStruct FIQT_TaskPayload::ToInstancedStruct() const
+{
+    FInstancedStruct Result;
+    if (ScriptStruct)
+    {
+        Result.InitializeAs(ScriptStruct, GetMemory());
+    }
+    return Result;
+}
+
+void FIQT_TaskPayload::FromInstancedStruct(const FInstancedStruct& InStruct)
+{
+    if (InStruct.IsValid())
+    {
+        InitializeAs(InStruct.GetScriptStruct(), InStruct.GetMemory());
+    }
+    else
+    {
+        Reset();
+    }
+}
+
+bool FIQT_TaskPayload::Serialize(FArchive& Ar)
+{
+    // O formato em disco é o do FInstancedStruct, que já trata versões e structs definidas pelo usuário.
+    FInstancedStruct Instanced;
+    if (Ar.IsSaving())
+    {
+        Instanced = ToInstancedStruct();
+    }
+    Instanced.Serialize(Ar);
+    if (Ar.IsLoading())
+    {
+        FromInstancedStruct(Instanced);
+    }
+    return true;
+}
+
+bool FIQT_TaskPayload::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+    FInstancedStruct Instanced;
+    if (Ar.IsSaving())
+    {
+        Instanced = ToInstancedStruct();
+    }
+    Instanced.NetSerialize(Ar, Map, bOutSuccess);
+    if (Ar.IsLoading())
+    {
+        FromInstancedStruct(Instanced);
+    }
+    return true;
+}
+
+bool FIQT_TaskPayload::Identical(const FIQT_TaskPayload* Other, uint32 PortFlags) const
+{
+    if (!Other || ScriptStruct != Other->ScriptStruct)
+    {
+        return false;
+    }
+    return !ScriptStruct || ScriptStruct->CompareScriptStruct(GetMemory(), Other->GetMemory(), PortFlags);
+}
+
+void FIQT_TaskPayload::AddStructReferencedObjects(FReferenceCollector& Collector)
+{
+    if (!ScriptStruct)
+    {
+        return;
+    }
+    Collector.AddReferencedObject(ScriptStruct);
+    if (bHasObjectReferences)
+    {
+        Collector.AddPropertyReferencesWithStructARO(ScriptStruct, GetMutableMemory());
+    }
+}
+
+FString FIQT_PayloadTargetData::ToString() const
+{
+    return FString::Printf(TEXT("FIQT_PayloadTargetData(%s)"), TaskPayload.IsValid() ? *TaskPayload.GetScriptStruct()->GetName() : TEXT("None"));
+}
+
+bool FIQT_PayloadTargetData::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+    return TaskPayload.NetSerialize(Ar, Map, bOutSuccess);
+}
+
+const FIQT_TaskPayload* FIQT_PayloadTargetData::FindInEventData(const FGameplayEventData& EventData)
+{
+    for (int32 Index = 0; Index < EventData.TargetData.Num(); ++Index)
+    {
+        const FGameplayAbilityTargetData* TargetData = EventData.TargetData.Get(Index);
+        if (TargetData && TargetData->GetScriptStruct()->IsChildOf(FIQT_PayloadTargetData::StaticStruct()))
+        {
+            return &static_cast<const FIQT_PayloadTargetData*>(TargetData)->TaskPayload;
+        }
+    }
+    return nullptr;
+}
+
+void FIQT_PayloadTargetData::AddToEventData(FGameplayEventData& EventData, const FIQT_TaskPayload& InTaskPayload)
+{
+    if (InTaskPayload.IsValid())
+    {
+        // O handle de TargetData assume a posse do ponteiro.
+        EventData.TargetData.Add(new FIQT_PayloadTargetData(InTaskPayload));
+    }
+}
+
+FIQT_TaskPayload UIQT_TaskPayloadLibrary::MakeTaskPayload(const FInstancedStruct& Value)
+{
+    FIQT_TaskPayload Payload;
+    Payload.FromInstancedStruct(Value);
+    return Payload;
+}
+
+FInstancedStruct UIQT_TaskPayloadLibrary::GetTaskPayloadStruct(const FIQT_TaskPayload& TaskPayload)
+{
+    return TaskPayload.ToInstancedStruct();
+}
+
+bool UIQT_TaskPayloadLibrary::IsTaskPayloadValid(const FIQT_TaskPayload& TaskPayload)
+{
+    return TaskPayload.IsValid();
+}
+
+bool UIQT_TaskPayloadLibrary::GetTaskPayloadFromEventData(const FGameplayEventData& EventData, FInstancedStruct& OutPayload)
+{
+    if (const FIQT_TaskPayload* TaskPayload = FIQT_PayloadTargetData::FindInEventData(EventData))
+    {
+        OutPayload = TaskPayload->ToInstancedStruct();
+        return OutPayload.IsValid();
+    }
+    OutPayload.Reset();
+    return false;
+}
@@ -0,0 +1,141 @@
+﻿// IQT/Source/IQT/Private/IQT_TimeoutSubsystem.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_TimeoutSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+
+UIQT_TimeoutSubsystem::UIQT_TimeoutSubsystem()
+    : CurrentSlot(0)
+    , SlotAccumulator(0.0f)
+    , NumWheelEntries(0)
+    , NextTimeoutId(1)
+{
+}
+
+UIQT_TimeoutSubsystem* UIQT_TimeoutSubsystem::Get(const UObject* WorldContextObject)
+{
+    UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+    return World ? World->GetSubsystem<UIQT_TimeoutSubsystem>() : nullptr;
+}
+
+bool UIQT_TimeoutSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    // Apenas mundos de jogo executam habilidades.
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UIQT_TimeoutSubsystem::Deinitialize()
+{
+    for (TArray<FWheelEntry>& Slot : Slots)
+    {
+        Slot.Empty();
+    }
+    ActiveTimeoutIds.Empty();
+    NumWheelEntries = 0;
+    Super::Deinitialize();
+}
+
+uint64 UIQT_TimeoutSubsystem::ScheduleTimeout(float DelaySeconds, FSimpleDelegate&& Callback)
+{
+    if (!Callback.IsBound() || DelaySeconds <= 0.0f)
+    {
+        return 0;
+    }
+
+    // Quantos slots à frente (pelo menos 1, para nunca disparar no mesmo frame do agendamento). O slot K à frente
+    // é visitado K * SlotResolution - SlotAccumulator segundos depois, então o tempo já decorrido no slot atual
+    // entra somando: com ele subtraído, o timeout dispararia antes do prazo.
+    const int32 Ticks = FMath::Max(1, FMath::CeilToInt((DelaySeconds + SlotAccumulator) / SlotResolution));
+    const int32 TargetSlot = (CurrentSlot + Ticks) % NumSlots;
+
+    FWheelEntry& Entry = Slots[TargetSlot].AddDefaulted_GetRef();
+    Entry.TimeoutId = NextTimeoutId++;
+    Entry.RemainingRounds = (Ticks - 1) / NumSlots;
+    Entry.Callback = MoveTemp(Callback);
+    ++NumWheelEntries;
+
+    ActiveTimeoutIds.Add(Entry.TimeoutId);
+    return Entry.TimeoutId;
+}
+
+void UIQT_TimeoutSubsystem::CancelTimeout(uint64& InOutTimeoutId)
+{
+    if (InOutTimeoutId != 0)
+    {
+        // A entrada fica na roda até o slot ser visitado, mas não dispara mais.
+        ActiveTimeoutIds.Remove(InOutTimeoutId);
+        InOutTimeoutId = 0;
+    }
+}
+
+void UIQT_TimeoutSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    if (ActiveTimeoutIds.Num() == 0)
+    {
+        // Nada pendente: mantém a roda parada e descarta as entradas canceladas que ainda restarem, que de outro
+        // modo ficariam nos slots até a roda voltar a girar.
+        SlotAccumulator = 0.0f;
+        if (NumWheelEntries > 0)
+        {
+            for (TArray<FWheelEntry>& Slot : Slots)
+            {
+                Slot.Reset();
+            }
+            NumWheelEntries = 0;
+        }
+        return;
+    }
+
+    TArray<FSimpleDelegate> Expired;
+    SlotAccumulator += DeltaTime;
+    while (SlotAccumulator >= SlotResolution)
+    {
+        SlotAccumulator -= SlotResolution;
+        CurrentSlot = (CurrentSlot + 1) % NumSlots;
+        ProcessSlot(CurrentSlot, Expired);
+    }
+
+    // Os callbacks são executados fora da iteração dos slots, pois normalmente agendam um novo timeout
+    // (o executor passa imediatamente para o próximo item da fila).
+    for (FSimpleDelegate& Callback : Expired)
+    {
+        Callback.ExecuteIfBound();
+    }
+}
+
+void UIQT_TimeoutSubsystem::ProcessSlot(int32 SlotIndex, TArray<FSimpleDelegate>& OutExpired)
+{
+    TArray<FWheelEntry>& Slot = Slots[SlotIndex];
+    for (int32 Index = Slot.Num() - 1; Index >= 0; --Index)
+    {
+        FWheelEntry& Entry = Slot[Index];
+        if (!ActiveTimeoutIds.Contains(Entry.TimeoutId))
+        {
+            // Cancelado anteriormente.
+            Slot.RemoveAtSwap(Index, EAllowShrinking::No);
+            --NumWheelEntries;
+        }
+        else if (Entry.RemainingRounds > 0)
+        {
+            Entry.RemainingRounds--;
+        }
+        else
+        {
+            ActiveTimeoutIds.Remove(Entry.TimeoutId);
+            OutExpired.Add(MoveTemp(Entry.Callback));
+            Slot.RemoveAtSwap(Index, EAllowShrinking::No);
+            --NumWheelEntries;
+        }
+    }
+}
+
+TStatId UIQT_TimeoutSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UIQT_TimeoutSubsystem, STATGROUP_Tickables);
+}
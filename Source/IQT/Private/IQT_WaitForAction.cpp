@@ -9,12 +9,21 @@
 #include "AbilitySystemGlobals.h" // Para UAbilitySystemGlobals::GetAbilitySystemComponentFromActor
 #include "Abilities/GameplayAbility.h" // Necessário para UGameplayAbility::GetActorInfo()
 #include "GameFramework/Actor.h" // Para AActor
+#include "IQT_GameplayTags.h"
+#include "IQT_TimeoutSubsystem.h"
+#include "IQT_ASCCacheSubsystem.h"
+#include "IQT_Log.h"
 
 UIQT_WaitForAction::UIQT_WaitForAction(const FObjectInitializer& ObjectInitializer) 
     : Super(ObjectInitializer)
     , bUseExternalTarget(false)
     , bOnlyTriggerOnce(false)
     , bOnlyMatchExact(true)
+    , bReusable(false)
+    , bArmed(false)
+    , TimeoutSeconds(0.0f)
+    , TimeoutId(0)
+    , bBoundMatchExact(true)
 {
     // Construtor, inicializa variáveis membro.
 }
@@ -23,60 +32,105 @@ UIQT_WaitForAction* UIQT_WaitForAction::IQT_WaitActionEvent(UGameplayAbility* Ow
     const FIQT_QueueItem& InQueueItem,
     AActor* InOptionalExternalTarget,
     bool InOnlyTriggerOnce,
-    bool InOnlyMatchExact)
+    bool InOnlyMatchExact,
+    float InDefaultTimeoutSeconds)
 {
     // Verifica se a Ability de origem é válida.
     if (!OwningAbility)
     {
-        UE_LOG(LogTemp, Error, TEXT("UIQT_WaitForAction: OwningAbility é nulo. Não foi possível criar a tarefa."));
+        UE_LOG(LogIQTTasks, Error, TEXT("UIQT_WaitForAction: OwningAbility é nulo. Não foi possível criar a tarefa."));
         return nullptr;
     }
 
     // Cria uma nova instância da Ability Task.
     UIQT_WaitForAction* MyObj = NewAbilityTask<UIQT_WaitForAction>(OwningAbility); 
-    
+
+    // Configura tags, alvo, timeout e TriggerData a partir do item da fila.
+    MyObj->ReArm(InQueueItem, InOptionalExternalTarget, InOnlyTriggerOnce, InOnlyMatchExact, InDefaultTimeoutSeconds);
+
+    // Retorna a tarefa recém-criada.
+    return MyObj;
+}
+
+UIQT_WaitForAction* UIQT_WaitForAction::CreateReusableWaitTask(UGameplayAbility* OwningAbility)
+{
+    if (!OwningAbility)
+    {
+        UE_LOG(LogIQTTasks, Error, TEXT("UIQT_WaitForAction: OwningAbility é nulo. Não foi possível criar a tarefa reutilizável."));
+        return nullptr;
+    }
+
+    UIQT_WaitForAction* MyObj = NewAbilityTask<UIQT_WaitForAction>(OwningAbility);
+    MyObj->bReusable = true;
+    return MyObj;
+}
+
+void UIQT_WaitForAction::ReArm(const FIQT_QueueItem& InQueueItem, AActor* InOptionalExternalTarget, bool InOnlyTriggerOnce, bool InOnlyMatchExact, float InDefaultTimeoutSeconds)
+{
+    // Um item anterior ainda pendente deixa de ser aceito a partir daqui.
+    Disarm();
+
     // Armazena os dados do item da fila.
-    MyObj->QueueItemData = InQueueItem;
+    QueueItemData = InQueueItem;
 
     // Configura as tags de sucesso e falha A PARTIR DO ITEM DA FILA.
-    MyObj->SuccessTag = InQueueItem.AbilityEndTag;
-    MyObj->FailTag = InQueueItem.AbilityFailTag;
+    SuccessTag = InQueueItem.AbilityEndTag;
+    FailTag = InQueueItem.AbilityFailTag;
 
     // Configura os comportamentos da tarefa.
-    MyObj->bOnlyTriggerOnce = InOnlyTriggerOnce;
-    MyObj->bOnlyMatchExact = InOnlyMatchExact;
+    bOnlyTriggerOnce = InOnlyTriggerOnce;
+    bOnlyMatchExact = InOnlyMatchExact;
+
+    // O timeout do próprio item tem precedência sobre o padrão do chamador.
+    const float ItemTimeoutSeconds = InQueueItem.GetDispatchData().TimeoutSeconds;
+    TimeoutSeconds = ItemTimeoutSeconds > 0.0f ? ItemTimeoutSeconds : FMath::Max(0.0f, InDefaultTimeoutSeconds);
+
+    if (!Ability)
+    {
+        UE_LOG(LogIQTTasks, Warning, TEXT("UIQT_WaitForAction: ReArm sem habilidade dona; alvo e TriggerData do item '%s' não foram configurados."), *InQueueItem.Name.ToString());
+        return;
+    }
 
     // *** TRATAMENTO DO OptionalExternalTarget ***
     // Se um ator externo foi fornecido, tenta obter o ASC dele.
-    AActor* CurrentOwnerActor = OwningAbility->GetActorInfo().OwnerActor.Get();
+    AActor* CurrentOwnerActor = Ability->GetActorInfo().OwnerActor.Get();
+
+    // O ASC do dono já está resolvido no ActorInfo da habilidade; atores externos passam pelo cache compartilhado.
+    UAbilitySystemComponent* OwnerASC = Ability->GetAbilitySystemComponentFromActorInfo();
+    if (!OwnerASC)
+    {
+        OwnerASC = UIQT_ASCCacheSubsystem::ResolveASC(CurrentOwnerActor);
+    }
 
-    if (InOptionalExternalTarget)
+    if (InOptionalExternalTarget && InOptionalExternalTarget != CurrentOwnerActor)
     {
-        MyObj->bUseExternalTarget = true;
-        MyObj->OptionalExternalTargetASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(InOptionalExternalTarget);
-        if (!MyObj->OptionalExternalTargetASC)
+        bUseExternalTarget = true;
+        OptionalExternalTargetASC = UIQT_ASCCacheSubsystem::ResolveASC(InOptionalExternalTarget);
+        if (!OptionalExternalTargetASC)
         {
-            UE_LOG(LogTemp, Warning, TEXT("UIQT_WaitForAction: InOptionalExternalTarget (%s) não possui um AbilitySystemComponent válido. Usando OwningAbility's ASC como fallback."), *InOptionalExternalTarget->GetName());
-            MyObj->bUseExternalTarget = false;
-            MyObj->OptionalExternalTargetASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(CurrentOwnerActor);
+            UE_LOG(LogIQTTasks, Warning, TEXT("UIQT_WaitForAction: InOptionalExternalTarget (%s) não possui um AbilitySystemComponent válido. Usando OwningAbility's ASC como fallback."), *InOptionalExternalTarget->GetName());
+            bUseExternalTarget = false;
+            OptionalExternalTargetASC = OwnerASC;
         }
     }
     else
     {
-        MyObj->OptionalExternalTargetASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(CurrentOwnerActor);
+        // O alvo é o próprio dono: evita uma segunda resolução.
+        bUseExternalTarget = InOptionalExternalTarget != nullptr && OwnerASC != nullptr;
+        OptionalExternalTargetASC = OwnerASC;
     }
 
     // *** PREENCHE A NOVA ESTRUTURA FIQT_TriggerData ***
-    MyObj->TriggerDataToUse.TriggerTag = InQueueItem.AbilityTriggerTag;
-    MyObj->TriggerDataToUse.Payload.EventTag = InQueueItem.AbilityTriggerTag;
-    MyObj->TriggerDataToUse.Payload.Instigator = CurrentOwnerActor;
-    MyObj->TriggerDataToUse.Payload.Target = CurrentOwnerActor;
-    MyObj->TriggerDataToUse.Payload.OptionalObject = InQueueItem.UserPayload;
-    MyObj->TriggerDataToUse.EventTargetActor = CurrentOwnerActor;
-
-
-    // Retorna a tarefa recém-criada.
-    return MyObj;
+    // Reatribuída por inteiro para que nenhum campo do item anterior (ex.: TargetData) sobreviva ao ReArm.
+    TriggerDataToUse = FIQT_TriggerData();
+    TriggerDataToUse.TriggerTag = InQueueItem.AbilityTriggerTag;
+    TriggerDataToUse.Payload.EventTag = InQueueItem.AbilityTriggerTag;
+    TriggerDataToUse.Payload.Instigator = CurrentOwnerActor;
+    TriggerDataToUse.Payload.Target = CurrentOwnerActor;
+    TriggerDataToUse.Payload.OptionalObject = InQueueItem.UserPayload;
+    TriggerDataToUse.EventTargetActor = CurrentOwnerActor;
+    TriggerDataToUse.TaskPayload = InQueueItem.GetDispatchData().TaskPayload;
+    FIQT_PayloadTargetData::AddToEventData(TriggerDataToUse.Payload, TriggerDataToUse.TaskPayload);
 }
 
 // Retorna TObjectPtr<UAbilitySystemComponent> para consistência
@@ -92,25 +146,56 @@ TObjectPtr<UAbilitySystemComponent> UIQT_WaitForAction::GetTargetASC() const
 }
 
 void UIQT_WaitForAction::Activate() 
+{
+    // Uma espera reutilizável sobrevive a uma ativação sem alvo: o próximo ReArm pode corrigir a configuração.
+    if (!StartWaiting() && !bReusable)
+    {
+        EndTask();
+    }
+}
+
+bool UIQT_WaitForAction::StartWaiting()
 {
     TObjectPtr<UAbilitySystemComponent> TargetASC = GetTargetASC(); 
-    // Se o ASC alvo não for válido, loga um aviso e encerra a tarefa.
+    // Se o ASC alvo não for válido, loga um aviso e não arma a espera.
     if (!TargetASC)
     {
-        UE_LOG(LogTemp, Warning, TEXT("UIQT_WaitForAction: TargetASC é nulo, abortando tarefa.")); 
-        EndTask();
-        return;
+        UE_LOG(LogIQTTasks, Warning, TEXT("UIQT_WaitForAction: TargetASC é nulo, abortando tarefa.")); 
+        return false;
     }
 
     // Se nenhuma tag de sucesso ou falha for fornecida, a tarefa não terá como disparar.
-    // Loga um aviso e encerra a tarefa.
     if (!SuccessTag.IsValid() && !FailTag.IsValid())
     {
-        UE_LOG(LogTemp, Warning, TEXT("UIQT_WaitForAction: Nenhuma SuccessTag ou FailTag válida fornecida (do QueueItem), a tarefa nunca será disparada. Encerrando tarefa.")); 
-        EndTask();
+        UE_LOG(LogIQTTasks, Warning, TEXT("UIQT_WaitForAction: Nenhuma SuccessTag ou FailTag válida fornecida (do QueueItem), a tarefa nunca será disparada. Encerrando tarefa.")); 
+        return false;
+    }
+
+    BindEventListeners(TargetASC);
+    bArmed = true;
+
+    // Inicia a contagem do tempo limite, se houver.
+    StartTimeout();
+    return true;
+}
+
+void UIQT_WaitForAction::Disarm()
+{
+    ClearTimeout();
+    bArmed = false;
+}
+
+void UIQT_WaitForAction::BindEventListeners(UAbilitySystemComponent* TargetASC)
+{
+    // Itens consecutivos costumam usar as mesmas tags: nesse caso as ligações atuais continuam válidas.
+    const bool bHasBindings = SuccessHandle.IsValid() || FailHandle.IsValid();
+    if (bHasBindings && BoundASC.Get() == TargetASC && BoundSuccessTag == SuccessTag && BoundFailTag == FailTag && bBoundMatchExact == bOnlyMatchExact)
+    {
         return;
     }
 
+    UnbindEventListeners();
+
     // Liga os delegates para a tag de sucesso.
     if (SuccessTag.IsValid())
     {
@@ -140,103 +225,206 @@ void UIQT_WaitForAction::Activate()
             FailHandle = TargetASC->AddGameplayEventTagContainerDelegate(FGameplayTagContainer(FailTag), FGameplayEventTagMulticastDelegate::FDelegate::CreateUObject(this, &UIQT_WaitForAction::OnContainerFailEvent));
         }
     }
+
+    BoundASC = TargetASC;
+    BoundSuccessTag = SuccessTag;
+    BoundFailTag = FailTag;
+    bBoundMatchExact = bOnlyMatchExact;
+}
+
+void UIQT_WaitForAction::UnbindEventListeners()
+{
+    // Remove os delegates usando as tags com que foram ligados (as atuais podem ter mudado num ReArm).
+    if (UAbilitySystemComponent* TargetASC = BoundASC.Get())
+    {
+        if (SuccessHandle.IsValid())
+        {
+            if (bBoundMatchExact)
+            {
+                TargetASC->GenericGameplayEventCallbacks.FindOrAdd(BoundSuccessTag).Remove(SuccessHandle);
+            }
+            else
+            {
+                TargetASC->RemoveGameplayEventTagContainerDelegate(FGameplayTagContainer(BoundSuccessTag), SuccessHandle);
+            }
+        }
+
+        if (FailHandle.IsValid())
+        {
+            if (bBoundMatchExact)
+            {
+                TargetASC->GenericGameplayEventCallbacks.FindOrAdd(BoundFailTag).Remove(FailHandle);
+            }
+            else
+            {
+                TargetASC->RemoveGameplayEventTagContainerDelegate(FGameplayTagContainer(BoundFailTag), FailHandle);
+            }
+        }
+    }
+
+    SuccessHandle.Reset();
+    FailHandle.Reset();
+    BoundASC.Reset();
+    BoundSuccessTag = FGameplayTag();
+    BoundFailTag = FGameplayTag();
+}
+
+void UIQT_WaitForAction::PrepareResultBroadcast()
+{
+    // O evento chegou a tempo: o prazo desta espera não é mais necessário.
+    ClearTimeout();
+    if (bOnlyTriggerOnce)
+    {
+        bArmed = false;
+    }
+}
+
+void UIQT_WaitForAction::FinishResultBroadcast()
+{
+    // Se a tarefa deve disparar apenas uma vez, a encerra (a reutilizável apenas fica desarmada).
+    if (bOnlyTriggerOnce && !bReusable)
+    {
+        EndTask();
+    }
+}
+
+void UIQT_WaitForAction::BroadcastResult(bool bSucceeded, const FGameplayEventData& Payload, const FGameplayTag& EventTag, AActor* EventTargetActor)
+{
+    // O delegate dinâmico copia o payload e passa pelo ProcessEvent mesmo sem ouvintes: só é usado quando ligado.
+    FWaitActionEventDelegate& DynamicDelegate = bSucceeded ? SucessesfullAction : FailedAction;
+    if (DynamicDelegate.IsBound())
+    {
+        DynamicDelegate.Broadcast(Payload, QueueItemData, EventTag, EventTargetActor, QueueItemData.AbilityTriggerTag);
+    }
+
+    // Por último, pois um ouvinte nativo (ex.: UIQT_RunQueuedActions) pode re-armar esta espera no próprio callback.
+    FIQT_WaitActionNativeDelegate& NativeDelegate = bSucceeded ? OnSucceededNative : OnFailedNative;
+    NativeDelegate.Broadcast(Payload, QueueItemData, EventTag, EventTargetActor, QueueItemData.AbilityTriggerTag);
+}
+
+void UIQT_WaitForAction::StartTimeout()
+{
+    ClearTimeout();
+    if (TimeoutSeconds <= 0.0f)
+    {
+        return;
+    }
+
+    if (UIQT_TimeoutSubsystem* TimeoutSubsystem = UIQT_TimeoutSubsystem::Get(this))
+    {
+        // Delegates de UObject são fracos: se a task for coletada antes do prazo, o callback é ignorado.
+        TimeoutId = TimeoutSubsystem->ScheduleTimeout(TimeoutSeconds, FSimpleDelegate::CreateUObject(this, &UIQT_WaitForAction::OnTimeoutExpired));
+    }
+    else
+    {
+        UE_LOG(LogIQTTasks, Warning, TEXT("UIQT_WaitForAction: UIQT_TimeoutSubsystem indisponível, timeout de %.2fs do item '%s' será ignorado."), TimeoutSeconds, *QueueItemData.Name.ToString());
+    }
+}
+
+void UIQT_WaitForAction::ClearTimeout()
+{
+    if (TimeoutId != 0)
+    {
+        if (UIQT_TimeoutSubsystem* TimeoutSubsystem = UIQT_TimeoutSubsystem::Get(this))
+        {
+            TimeoutSubsystem->CancelTimeout(TimeoutId);
+        }
+        TimeoutId = 0;
+    }
+}
+
+void UIQT_WaitForAction::OnTimeoutExpired()
+{
+    TimeoutId = 0;
+    if (!bArmed)
+    {
+        return;
+    }
+
+    // Um timeout é sempre terminal, independentemente de bOnlyTriggerOnce.
+    bArmed = false;
+    UE_LOG(LogIQTTasks, Warning, TEXT("UIQT_WaitForAction: Ação '%s' expirou após %.2fs sem emitir tag de fim ou falha."), *QueueItemData.Name.ToString(), TimeoutSeconds);
+
+    if (ShouldBroadcastAbilityTaskDelegates())
+    {
+        TObjectPtr<UAbilitySystemComponent> TargetASC = GetTargetASC();
+        AActor* TargetActor = TargetASC ? TargetASC->GetOwner() : nullptr;
+
+        // Payload sintético: não houve evento real, então a tag do evento é a própria tag de timeout.
+        FGameplayEventData TimeoutPayload;
+        TimeoutPayload.EventTag = IQTGameplayTags::Action_Timeout;
+        TimeoutPayload.Instigator = TargetActor;
+        TimeoutPayload.Target = TargetActor;
+        TimeoutPayload.OptionalObject = QueueItemData.UserPayload;
+        FIQT_PayloadTargetData::AddToEventData(TimeoutPayload, QueueItemData.GetDispatchData().TaskPayload);
+
+        BroadcastResult(false, TimeoutPayload, IQTGameplayTags::Action_Timeout, TargetActor);
+    }
+
+    if (!bReusable)
+    {
+        EndTask();
+    }
 }
 
 // Callback para correspondência exata de sucesso.
 void UIQT_WaitForAction::OnExactSuccessEvent(const FGameplayEventData* Payload) 
 {
-    // Verifica se os delegates devem ser broadcastados e se o payload é válido.
-    if (ShouldBroadcastAbilityTaskDelegates() && Payload)
+    // Verifica se a espera está armada, se os delegates devem ser broadcastados e se o payload é válido.
+    if (bArmed && ShouldBroadcastAbilityTaskDelegates() && Payload)
     {
+        PrepareResultBroadcast();
         // Broadcasta o evento de sucesso, incluindo a TriggerTag original.
-        SucessesfullAction.Broadcast(*Payload, QueueItemData, SuccessTag, GetTargetASC()->GetOwner(), QueueItemData.AbilityTriggerTag); 
-        // Se a tarefa deve disparar apenas uma vez, a encerra.
-        if (bOnlyTriggerOnce)
-        {
-            EndTask();
-        }
+        BroadcastResult(true, *Payload, SuccessTag, GetTargetASC()->GetOwner());
+        FinishResultBroadcast();
     }
 }
 
 // Callback para correspondência de container de sucesso.
 void UIQT_WaitForAction::OnContainerSuccessEvent(FGameplayTag MatchedTag, const FGameplayEventData* Payload) 
 {
-    // Verifica se os delegates devem ser broadcastados e se o payload é válido.
-    if (ShouldBroadcastAbilityTaskDelegates() && Payload)
+    // Verifica se a espera está armada, se os delegates devem ser broadcastados e se o payload é válido.
+    if (bArmed && ShouldBroadcastAbilityTaskDelegates() && Payload)
     {
+        PrepareResultBroadcast();
         // Broadcasta o evento de sucesso, incluindo a TriggerTag original.
-        SucessesfullAction.Broadcast(*Payload, QueueItemData, MatchedTag, GetTargetASC()->GetOwner(), QueueItemData.AbilityTriggerTag); 
-        // Se a tarefa deve disparar apenas uma vez, a encerra.
-        if (bOnlyTriggerOnce)
-        {
-            EndTask();
-        }
+        BroadcastResult(true, *Payload, MatchedTag, GetTargetASC()->GetOwner());
+        FinishResultBroadcast();
     }
 }
 
 // Callback para correspondência exata de falha.
 void UIQT_WaitForAction::OnExactFailEvent(const FGameplayEventData* Payload) 
 {
-    // Verifica se os delegates devem ser broadcastados e se o payload é válido.
-    if (ShouldBroadcastAbilityTaskDelegates() && Payload)
+    // Verifica se a espera está armada, se os delegates devem ser broadcastados e se o payload é válido.
+    if (bArmed && ShouldBroadcastAbilityTaskDelegates() && Payload)
     {
+        PrepareResultBroadcast();
         // Broadcasta o evento de falha, incluindo a TriggerTag original.
-        FailedAction.Broadcast(*Payload, QueueItemData, FailTag, GetTargetASC()->GetOwner(), QueueItemData.AbilityTriggerTag);
-        // Se a tarefa deve disparar apenas uma vez, a encerra.
-        if (bOnlyTriggerOnce)
-        {
-            EndTask();
-        }
+        BroadcastResult(false, *Payload, FailTag, GetTargetASC()->GetOwner());
+        FinishResultBroadcast();
     }
 }
 
 // Callback para correspondência de container de falha.
 void UIQT_WaitForAction::OnContainerFailEvent(FGameplayTag MatchedTag, const FGameplayEventData* Payload) 
 {
-    // Verifica se os delegates devem ser broadcastados e se o payload é válido.
-    if (ShouldBroadcastAbilityTaskDelegates() && Payload)
+    // Verifica se a espera está armada, se os delegates devem ser broadcastados e se o payload é válido.
+    if (bArmed && ShouldBroadcastAbilityTaskDelegates() && Payload)
     {
+        PrepareResultBroadcast();
         // Broadcasta o evento de falha, incluindo a TriggerTag original.
-        FailedAction.Broadcast(*Payload, QueueItemData, MatchedTag, GetTargetASC()->GetOwner(), QueueItemData.AbilityTriggerTag);
-        // Se a tarefa deve disparar apenas uma vez, a encerra.
-        if (bOnlyTriggerOnce)
-        {
-            EndTask();
-        }
+        BroadcastResult(false, *Payload, MatchedTag, GetTargetASC()->GetOwner());
+        FinishResultBroadcast();
     }
 }
 
 void UIQT_WaitForAction::OnDestroy(bool AbilityEnding) 
 {
-    TObjectPtr<UAbilitySystemComponent> TargetASC = GetTargetASC(); 
-    
-    // Remove os delegates para evitar vazamentos de memória e chamadas indesejadas.
-    if (TargetASC)
-    {
-        if (SuccessHandle.IsValid())
-        {
-            if (bOnlyMatchExact)
-            {
-                TargetASC->GenericGameplayEventCallbacks.FindOrAdd(SuccessTag).Remove(SuccessHandle);
-            }
-            else
-            {
-                TargetASC->RemoveGameplayEventTagContainerDelegate(FGameplayTagContainer(SuccessTag), SuccessHandle);
-            }
-        }
+    Disarm();
 
-        if (FailHandle.IsValid())
-        {
-            if (bOnlyMatchExact)
-            {
-                TargetASC->GenericGameplayEventCallbacks.FindOrAdd(FailTag).Remove(FailHandle);
-            }
-            else
-            {
-                TargetASC->RemoveGameplayEventTagContainerDelegate(FGameplayTagContainer(FailTag), FailHandle);
-            }
-        }
-    }
+    // Remove os delegates para evitar vazamentos de memória e chamadas indesejadas.
+    UnbindEventListeners();
 
     // Chama a implementação base.
     Super::OnDestroy(AbilityEnding);
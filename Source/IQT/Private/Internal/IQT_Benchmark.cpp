@@ -0,0 +1,841 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_Benchmark.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+//
+// Benchmark headless das operações da fila IQT (comando de console "iqt.Bench.Run").
+//
+// Uso típico em Linux (CI):
+//   UnrealEditor-Cmd <Projeto>.uproject -nullrhi -unattended -nosplash -log
+//       -ExecCmds="iqt.Bench.Run Baseline=Bench/IQT-Baseline.json Exit=1"
+//
+// Argumentos (todos opcionais):
+//   Sizes=10,100,...     Tamanhos da fila pré-preenchida (padrão 10..1000000).
+//   Threads=1,2,4        Pares produtor/consumidor dos casos concorrentes.
+//   Ops=1000             Operações medidas por caso single-thread.
+//   Budget=10            Tempo máximo (s) para preencher a fila de um caso; casos acima do orçamento são pulados.
+//   Duration=1           Duração (s) de cada caso concorrente.
+//   Out=<arquivo>        JSON de saída (padrão Saved/Profiling/IQT/Bench-<data>.json).
+//   Baseline=<arquivo>   JSON anterior para comparação; regressões acima de Threshold são reportadas.
+//   Threshold=0.10       Regressão tolerada (fração).
+//   Exit=1               Encerra o processo ao final (código 1 se houver regressão).
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "IQT_Queue.h"
+#include "IQT_GameplayTags.h"
+#include "IQT_Log.h"
+#include "IQT_PriorityQueueInternal.h"
+#include "Algo/Unique.h"
+#include "Async/Async.h"
+#include "Dom/JsonObject.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/Package.h"
+#include <atomic>
+
+namespace IQTBenchmark
+{
+    // Nome do backend medido; novos backends da fila interna entram como novas linhas no JSON.
+    static const TCHAR* BackendName = TEXT("HotColdHeap");
+
+    struct FBenchConfig
+    {
+        TArray<int32> Sizes = { 10, 100, 1000, 10000, 100000, 1000000 };
+        TArray<int32> ThreadCounts = { 1, 2, 4 };
+        int32 OpsPerCase = 1000;
+        double CaseBudgetSeconds = 10.0;
+        double ConcurrentDurationSeconds = 1.0;
+        double RegressionThreshold = 0.10;
+        FString OutputPath;
+        FString BaselinePath;
+        bool bExitWhenDone = false;
+    };
+
+    struct FBenchResult
+    {
+        FString Backend = BackendName;
+        FString Op;
+        FString Mode;
+        bool bDedup = false;
+        int32 Size = 0;
+        int32 Producers = 1;
+        int32 Consumers = 0;
+        int32 NumOps = 0;
+        double MeanNs = 0.0;
+        double P50Ns = 0.0;
+        double P99Ns = 0.0;
+        double OpsPerSecond = 0.0;
+        double BytesPerItem = 0.0;
+        double BytesPerQueue = 0.0;
+        bool bSkipped = false;
+
+        FString GetKey() const
+        {
+            return FString::Printf(TEXT("%s|%s|%s|%s|%d|%dP%dC"), *Backend, *Op, *Mode, bDedup ? TEXT("Dedup") : TEXT("NoDedup"), Size, Producers, Consumers);
+        }
+    };
+
+    static TArray<int32> ParseIntList(const FString& InList)
+    {
+        TArray<FString> Parts;
+        InList.ParseIntoArray(Parts, TEXT(","));
+        TArray<int32> Values;
+        for (const FString& Part : Parts)
+        {
+            const int32 Value = FCString::Atoi(*Part);
+            if (Value > 0)
+            {
+                Values.Add(Value);
+            }
+        }
+        return Values;
+    }
+
+    static FBenchConfig ParseConfig(const TArray<FString>& Args)
+    {
+        FBenchConfig Config;
+        const FString Line = FString::Join(Args, TEXT(" "));
+        FString Value;
+        if (FParse::Value(*Line, TEXT("Sizes="), Value, false) && ParseIntList(Value).Num() > 0)
+        {
+            Config.Sizes = ParseIntList(Value);
+        }
+        if (FParse::Value(*Line, TEXT("Threads="), Value, false) && ParseIntList(Value).Num() > 0)
+        {
+            Config.ThreadCounts = ParseIntList(Value);
+        }
+        FParse::Value(*Line, TEXT("Ops="), Config.OpsPerCase);
+        FParse::Value(*Line, TEXT("Budget="), Config.CaseBudgetSeconds);
+        FParse::Value(*Line, TEXT("Duration="), Config.ConcurrentDurationSeconds);
+        FParse::Value(*Line, TEXT("Threshold="), Config.RegressionThreshold);
+        FParse::Value(*Line, TEXT("Out="), Config.OutputPath, false);
+        FParse::Value(*Line, TEXT("Baseline="), Config.BaselinePath, false);
+        int32 ExitFlag = 0;
+        FParse::Value(*Line, TEXT("Exit="), ExitFlag);
+        Config.bExitWhenDone = ExitFlag != 0;
+
+        Config.OpsPerCase = FMath::Max(1, Config.OpsPerCase);
+        if (Config.OutputPath.IsEmpty())
+        {
+            Config.OutputPath = FPaths::Combine(FPaths::ProfilingDir(), TEXT("IQT"), FString::Printf(TEXT("Bench-%s.json"), *FDateTime::Now().ToString()));
+        }
+        return Config;
+    }
+
+    static FIQT_QueueItem MakeItem(int32 Index, FRandomStream& Random)
+    {
+        FIQT_QueueItem Item;
+        Item.Name = FName(TEXT("IQTBenchItem"), Index + 1);
+        Item.AbilityTriggerTag = IQTGameplayTags::Action_Timeout;
+        Item.bIsOpen = true;
+        Item.Priority = Random.RandRange(0, 1 << 20);
+        return Item;
+    }
+
+    // Converte amostras (ciclos por operação) em média/p50/p99 em nanossegundos.
+    static void FillTiming(TArray<uint64>& SampleCycles, FBenchResult& Result)
+    {
+        Result.NumOps = SampleCycles.Num();
+        if (SampleCycles.Num() == 0)
+        {
+            return;
+        }
+        SampleCycles.Sort();
+        const double NsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1e9;
+        uint64 Total = 0;
+        for (const uint64 Cycles : SampleCycles)
+        {
+            Total += Cycles;
+        }
+        Result.MeanNs = static_cast<double>(Total) / SampleCycles.Num() * NsPerCycle;
+        Result.P50Ns = SampleCycles[SampleCycles.Num() / 2] * NsPerCycle;
+        Result.P99Ns = SampleCycles[FMath::Min(SampleCycles.Num() - 1, (SampleCycles.Num() * 99) / 100)] * NsPerCycle;
+        Result.OpsPerSecond = Result.MeanNs > 0.0 ? 1e9 / Result.MeanNs : 0.0;
+    }
+
+    template <typename OpType>
+    static void TimeOps(int32 NumOps, TArray<uint64>& OutSamples, OpType&& Op)
+    {
+        OutSamples.Reset(NumOps);
+        for (int32 Index = 0; Index < NumOps; ++Index)
+        {
+            const uint64 Start = FPlatformTime::Cycles64();
+            Op(Index);
+            OutSamples.Add(FPlatformTime::Cycles64() - Start);
+        }
+    }
+
+    // Mede a API pública (UIQT_Queue) em uma fila pré-preenchida com Size itens.
+    // Com AgingRate > 0 o caso é reportado como "<Modo>Aged" (envelhecimento só vale em PriorityOrder).
+    static void RunSingleThreadedCase(EIQT_QueueMode Mode, bool bDedup, int32 Size, float AgingRate, const FBenchConfig& Config, TArray<FBenchResult>& OutResults)
+    {
+        const FString ModeName = UEnum::GetValueAsString(Mode).RightChop(FString(TEXT("EIQT_QueueMode::")).Len()) + (AgingRate > 0.0f ? TEXT("Aged") : TEXT(""));
+        const int32 NumOps = Config.OpsPerCase;
+
+        FBenchResult Template;
+        Template.Mode = ModeName;
+        Template.bDedup = bDedup;
+        Template.Size = Size;
+
+        UIQT_Queue* Queue = NewObject<UIQT_Queue>(GetTransientPackage(), NAME_None, RF_Transient);
+        Queue->QueueName = TEXT("IQTBench");
+        Queue->EnqueueMode = Mode;
+        Queue->bIgnoreDuplicatesOnEnqueue = bDedup;
+        Queue->MaxQueueSize = Size + NumOps;
+        Queue->AgingRatePerSecond = AgingRate;
+        Queue->InitializeQueue();
+
+        FRandomStream Random(Size * 31 + static_cast<int32>(Mode) * 7 + (bDedup ? 1 : 0));
+        TArray<FIQT_QueueItem> Items;
+        Items.Reserve(Size + NumOps);
+
+        const double FillStart = FPlatformTime::Seconds();
+        bool bOverBudget = false;
+        for (int32 Index = 0; Index < Size; ++Index)
+        {
+            FIQT_QueueItem& Item = Items.Add_GetRef(MakeItem(Index, Random));
+            Item.GetTaskID(); // Os itens pré-carregados são alvo do FindItemByTaskID.
+            Queue->EnqueueItem(Item);
+            if ((Index & 1023) == 0 && FPlatformTime::Seconds() - FillStart > Config.CaseBudgetSeconds)
+            {
+                bOverBudget = true;
+                break;
+            }
+        }
+
+        static const TCHAR* OpNames[] = { TEXT("ContainsItem"), TEXT("FindItemByTaskID"), TEXT("FindItemByHashKey"), TEXT("RemoveSpecificItem"), TEXT("EnqueueItem"), TEXT("DequeueItem"), TEXT("FindItemByHandle"), TEXT("DequeueMatching"),
+            TEXT("CountMatching"), TEXT("RemoveAllMatching"), TEXT("RescoreAll") };
+        if (bOverBudget)
+        {
+            UE_LOG(LogIQT, Display, TEXT("IQT.Bench: %s Dedup=%d Size=%d pulado (preenchimento excedeu %.1fs)."), *ModeName, bDedup, Size, Config.CaseBudgetSeconds);
+            for (const TCHAR* OpName : OpNames)
+            {
+                FBenchResult& Result = OutResults.Add_GetRef(Template);
+                Result.Op = OpName;
+                Result.bSkipped = true;
+            }
+            Queue->EmptyQueue();
+            Queue->MarkAsGarbage();
+            return;
+        }
+
+        // Memória da estrutura interna por item, medida com a fila cheia.
+        Template.BytesPerItem = Size > 0 ? static_cast<double>(Queue->GetInternalAllocatedSize()) / Size : 0.0;
+
+        // Índices aleatórios de itens presentes, iguais para todas as buscas.
+        TArray<int32> Probe;
+        Probe.Reserve(NumOps);
+        for (int32 Index = 0; Index < NumOps; ++Index)
+        {
+            Probe.Add(Random.RandRange(0, Size - 1));
+        }
+
+        TArray<uint64> Samples;
+        const auto AddResult = [&OutResults, &Template, &Samples](const TCHAR* OpName)
+        {
+            FBenchResult& Result = OutResults.Add_GetRef(Template);
+            Result.Op = OpName;
+            FillTiming(Samples, Result);
+        };
+
+        TimeOps(NumOps, Samples, [&](int32 Index) { Queue->ContainsItem(Items[Probe[Index]]); });
+        AddResult(OpNames[0]);
+
+        FIQT_QueueItem Found;
+        TimeOps(NumOps, Samples, [&](int32 Index) { Queue->FindItemByTaskID(Items[Probe[Index]].TaskID, Found); });
+        AddResult(OpNames[1]);
+
+        TimeOps(NumOps, Samples, [&](int32 Index)
+        {
+            const FIQT_QueueItem& Item = Items[Probe[Index]];
+            Queue->FindItemByHashKey(Item.Name, Item.AbilityTriggerTag, Item.bIsOpen, Found);
+        });
+        AddResult(OpNames[2]);
+
+        TimeOps(NumOps, Samples, [&](int32 Index) { Queue->FindItemByHandle(Items[Probe[Index]].Handle, Found); });
+        AddResult(OpNames[6]);
+
+        // Operações em lote: cada amostra percorre a fila inteira, então são poucas.
+        const int32 NumBulkOps = FMath::Clamp(NumOps / 100, 1, 16);
+        TimeOps(NumBulkOps, Samples, [&](int32 Index) { Queue->CountMatching([Index](const FIQT_QueueItem& Item) { return (Item.Priority & 15) == (Index & 15); }); });
+        AddResult(OpNames[8]);
+
+        // Remove cerca de 1/16 dos itens e os re-enfileira fora da medição.
+        Samples.Reset(NumBulkOps);
+        TArray<FIQT_QueueItem> Removed;
+        for (int32 Index = 0; Index < NumBulkOps; ++Index)
+        {
+            Removed.Reset();
+            const uint64 Start = FPlatformTime::Cycles64();
+            Queue->RemoveAllMatching([Index](const FIQT_QueueItem& Item) { return (Item.Priority & 15) == (Index & 15); }, &Removed);
+            Samples.Add(FPlatformTime::Cycles64() - Start);
+            for (FIQT_QueueItem& Item : Removed)
+            {
+                Queue->EnqueueItem(Item);
+            }
+        }
+        AddResult(OpNames[9]);
+
+        if (Mode == EIQT_QueueMode::PriorityOrder)
+        {
+            TimeOps(NumBulkOps, Samples, [&](int32) { Queue->RescoreAll([](const FIQT_QueueItem& Item) { return (Item.Priority + 1) & ((1 << 20) - 1); }); });
+            AddResult(OpNames[10]);
+        }
+        else
+        {
+            FBenchResult& Result = OutResults.Add_GetRef(Template);
+            Result.Op = OpNames[10];
+            Result.bSkipped = true;
+        }
+
+        // Remove e re-enfileira (fora da medição) para manter o tamanho da fila constante.
+        Samples.Reset(NumOps);
+        for (int32 Index = 0; Index < NumOps; ++Index)
+        {
+            FIQT_QueueItem& Item = Items[Probe[Index]];
+            const uint64 Start = FPlatformTime::Cycles64();
+            const bool bRemoved = Queue->RemoveSpecificItem(Item);
+            Samples.Add(FPlatformTime::Cycles64() - Start);
+            if (bRemoved)
+            {
+                Queue->EnqueueItem(Item);
+            }
+        }
+        AddResult(OpNames[3]);
+
+        TimeOps(NumOps, Samples, [&](int32 Index)
+        {
+            FIQT_QueueItem& Item = Items.Add_GetRef(MakeItem(Size + Index, Random));
+            Queue->EnqueueItem(Item);
+        });
+        AddResult(OpNames[4]);
+
+        FIQT_QueueItem Dequeued;
+        TimeOps(NumOps, Samples, [&](int32) { Queue->DequeueItem(Dequeued); });
+        AddResult(OpNames[5]);
+
+        // Consulta pela tag dos itens: mede a resolução da consulta (cacheada) e o topo do bucket.
+        const FGameplayTagQuery MatchQuery = FGameplayTagQuery::MakeQuery_MatchAnyTags(FGameplayTagContainer(IQTGameplayTags::Action_Timeout));
+        TimeOps(NumOps, Samples, [&](int32) { Queue->DequeueMatching(MatchQuery, Dequeued); });
+        AddResult(OpNames[7]);
+
+        Queue->EmptyQueue();
+        Queue->MarkAsGarbage();
+    }
+
+    // Utilidade dinâmica: a cada decisão o contexto muda (pesos novos) e o melhor item é retirado.
+    // - UtilityDequeue / UtilityDequeueWindow64: modo UtilityScore, pontuação vetorizada no momento da retirada.
+    // - RescoreAllDequeue: PriorityOrder, prioridades recalculadas com RescoreAll (cópia pontuada fora da trava + heapify) antes da retirada.
+    // - RequeueFreshDequeue: PriorityOrder sem operações em lote, cada item é cancelado e re-enfileirado com a prioridade nova.
+    // O item retirado volta à fila fora da medição. Cada variante para ao esgotar o orçamento do caso.
+    static void RunUtilityCase(int32 Size, const FBenchConfig& Config, TArray<FBenchResult>& OutResults)
+    {
+        constexpr int32 NumFeatures = 4;
+        const int32 NumOps = FMath::Clamp(Config.OpsPerCase / 10, 1, 100);
+        FRandomStream Random(Size * 17 + 5);
+
+        TArray<TArray<float>> WeightSets;
+        for (int32 Op = 0; Op < NumOps; ++Op)
+        {
+            TArray<float>& Weights = WeightSets.AddDefaulted_GetRef();
+            for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+            {
+                Weights.Add(Random.FRandRange(-1.0f, 1.0f));
+            }
+        }
+
+        TArray<FIQT_QueueItem> Items;
+        Items.Reserve(Size);
+        for (int32 Index = 0; Index < Size; ++Index)
+        {
+            FIQT_QueueItem& Item = Items.Add_GetRef(MakeItem(Index, Random));
+            for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+            {
+                Item.UtilityFeatures.Add(Random.FRand());
+            }
+        }
+
+        // Prioridade equivalente à pontuação (menor sai primeiro), para as variantes sem o modo UtilityScore.
+        const auto FreshPriority = [](const FIQT_QueueItem& Item, const TArray<float>& Weights)
+        {
+            float Score = 0.0f;
+            for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+            {
+                Score += Weights[Feature] * Item.UtilityFeatures[Feature];
+            }
+            return -FMath::RoundToInt(Score * 1000000.0f);
+        };
+
+        struct FVariant
+        {
+            const TCHAR* Op;
+            EIQT_QueueMode Mode;
+            int32 Window;
+        };
+        const FVariant Variants[] =
+        {
+            { TEXT("UtilityDequeue"), EIQT_QueueMode::UtilityScore, 0 },
+            { TEXT("UtilityDequeueWindow64"), EIQT_QueueMode::UtilityScore, 64 },
+            { TEXT("RescoreAllDequeue"), EIQT_QueueMode::PriorityOrder, 0 },
+            { TEXT("RequeueFreshDequeue"), EIQT_QueueMode::PriorityOrder, 0 },
+        };
+        for (int32 VariantIndex = 0; VariantIndex < UE_ARRAY_COUNT(Variants); ++VariantIndex)
+        {
+            const FVariant& Variant = Variants[VariantIndex];
+            FBenchResult Result;
+            Result.Op = Variant.Op;
+            Result.Mode = UEnum::GetValueAsString(Variant.Mode).RightChop(FString(TEXT("EIQT_QueueMode::")).Len());
+            Result.Size = Size;
+
+            UIQT_Queue* Queue = NewObject<UIQT_Queue>(GetTransientPackage(), NAME_None, RF_Transient);
+            Queue->QueueName = TEXT("IQTBench");
+            Queue->EnqueueMode = Variant.Mode;
+            Queue->bIgnoreDuplicatesOnEnqueue = false;
+            Queue->UtilityWeights = WeightSets[0];
+            Queue->UtilityCandidateWindow = Variant.Window;
+            Queue->InitializeQueue();
+
+            const double FillStart = FPlatformTime::Seconds();
+            for (int32 Index = 0; Index < Items.Num() && !Result.bSkipped; ++Index)
+            {
+                Queue->EnqueueItem(Items[Index]);
+                Result.bSkipped = (Index & 1023) == 0 && FPlatformTime::Seconds() - FillStart > Config.CaseBudgetSeconds;
+            }
+
+            TArray<uint64> Samples;
+            FIQT_QueueItem Dequeued;
+            const double CaseStart = FPlatformTime::Seconds();
+            for (int32 Op = 0; Op < NumOps && !Result.bSkipped; ++Op)
+            {
+                const TArray<float>& Weights = WeightSets[Op];
+                const uint64 Start = FPlatformTime::Cycles64();
+                if (Variant.Mode == EIQT_QueueMode::UtilityScore)
+                {
+                    Queue->SetUtilityWeights(Weights);
+                }
+                else if (VariantIndex == 2)
+                {
+                    Queue->RescoreAll([&FreshPriority, &Weights](const FIQT_QueueItem& Item) { return FreshPriority(Item, Weights); });
+                }
+                else
+                {
+                    for (FIQT_QueueItem& Item : Items)
+                    {
+                        if (Queue->CancelItem(Item.Handle))
+                        {
+                            Item.Priority = FreshPriority(Item, Weights);
+                            Queue->EnqueueItem(Item);
+                        }
+                    }
+                }
+                Queue->DequeueItem(Dequeued);
+                Samples.Add(FPlatformTime::Cycles64() - Start);
+
+                // O item retirado volta com a prioridade que tinha na fila (o handle novo fica em Items).
+                FIQT_QueueItem& Original = Items[Dequeued.Name.GetNumber() - 1];
+                Original.Priority = Dequeued.Priority;
+                Queue->EnqueueItem(Original);
+                if (FPlatformTime::Seconds() - CaseStart > Config.CaseBudgetSeconds)
+                {
+                    break;
+                }
+            }
+
+            if (Result.bSkipped)
+            {
+                UE_LOG(LogIQT, Display, TEXT("IQT.Bench: %s Size=%d pulado (preenchimento excedeu %.1fs)."), Variant.Op, Size, Config.CaseBudgetSeconds);
+            }
+            else
+            {
+                Result.BytesPerItem = Size > 0 ? static_cast<double>(Queue->GetInternalAllocatedSize()) / Size : 0.0;
+                FillTiming(Samples, Result);
+            }
+            OutResults.Add(MoveTemp(Result));
+            Queue->EmptyQueue();
+            Queue->MarkAsGarbage();
+        }
+    }
+
+    // Custo de cada EnqueueItem ao preencher uma fila vazia com Size itens, com armazenamento criado no primeiro uso e
+    // crescendo sob demanda (EnqueueGrowing) ou pré-alocado por ReserveCapacity em InitializeQueue (EnqueueReserved).
+    static void RunCapacityCase(int32 Size, const FBenchConfig& Config, TArray<FBenchResult>& OutResults)
+    {
+        FRandomStream Random(Size * 13 + 3);
+        TArray<FIQT_QueueItem> Items;
+        Items.Reserve(Size);
+        for (int32 Index = 0; Index < Size; ++Index)
+        {
+            Items.Add(MakeItem(Index, Random));
+        }
+
+        for (const bool bReserved : { false, true })
+        {
+            FBenchResult Result;
+            Result.Op = bReserved ? TEXT("EnqueueReserved") : TEXT("EnqueueGrowing");
+            Result.Mode = TEXT("PriorityOrder");
+            Result.Size = Size;
+
+            UIQT_Queue* Queue = NewObject<UIQT_Queue>(GetTransientPackage(), NAME_None, RF_Transient);
+            Queue->QueueName = TEXT("IQTBench");
+            Queue->bIgnoreDuplicatesOnEnqueue = false;
+            Queue->ReserveCapacity = bReserved ? Size : 0;
+            Queue->InitializeQueue();
+
+            TArray<uint64> Samples;
+            Samples.Reserve(Size);
+            const double FillStart = FPlatformTime::Seconds();
+            for (int32 Index = 0; Index < Items.Num() && !Result.bSkipped; ++Index)
+            {
+                const uint64 Start = FPlatformTime::Cycles64();
+                Queue->EnqueueItem(Items[Index]);
+                Samples.Add(FPlatformTime::Cycles64() - Start);
+                Result.bSkipped = (Index & 1023) == 0 && FPlatformTime::Seconds() - FillStart > Config.CaseBudgetSeconds;
+            }
+
+            if (Result.bSkipped)
+            {
+                UE_LOG(LogIQT, Display, TEXT("IQT.Bench: %s Size=%d pulado (preenchimento excedeu %.1fs)."), *Result.Op, Size, Config.CaseBudgetSeconds);
+            }
+            else
+            {
+                Result.BytesPerItem = Size > 0 ? static_cast<double>(Queue->GetInternalAllocatedSize()) / Size : 0.0;
+                FillTiming(Samples, Result);
+            }
+            OutResults.Add(MoveTemp(Result));
+            Queue->EmptyQueue();
+            Queue->MarkAsGarbage();
+        }
+    }
+
+    // Filas com poucos itens (o caso comum de um agente): armazenamento inline (FIQT_SmallQueue) contra a fila interna,
+    // forçada com ReserveCapacity acima da capacidade inline. EnqueueDequeue mede o par sobre uma fila com Size - 1
+    // itens; BytesPerQueue soma o componente e o que ele aloca no heap.
+    static void RunSmallQueueCase(const FBenchConfig& Config, TArray<FBenchResult>& OutResults)
+    {
+        if (FIQT_SmallQueue::Capacity <= 0)
+        {
+            return;
+        }
+        TArray<int32> Sizes = { 1, 4, FIQT_SmallQueue::Capacity };
+        Sizes.Sort();
+        Sizes.SetNum(Algo::Unique(Sizes));
+
+        const int32 NumOps = Config.OpsPerCase;
+        for (const int32 Size : Sizes)
+        {
+            for (const bool bInline : { true, false })
+            {
+                UIQT_Queue* Queue = NewObject<UIQT_Queue>(GetTransientPackage(), NAME_None, RF_Transient);
+                Queue->QueueName = TEXT("IQTBench");
+                Queue->bIgnoreDuplicatesOnEnqueue = false;
+                Queue->ReserveCapacity = bInline ? 0 : FIQT_SmallQueue::Capacity + 1;
+                Queue->InitializeQueue();
+
+                FRandomStream Random(Size * 17 + (bInline ? 1 : 0));
+                TArray<FIQT_QueueItem> Items;
+                for (int32 Index = 0; Index < Size; ++Index)
+                {
+                    Items.Add(MakeItem(Index, Random));
+                    Queue->EnqueueItem(Items.Last());
+                }
+                const double BytesPerQueue = static_cast<double>(sizeof(UIQT_Queue) + Queue->GetInternalAllocatedSize());
+
+                FBenchResult Template;
+                Template.Backend = bInline ? TEXT("SmallQueue") : BackendName;
+                Template.Mode = TEXT("PriorityOrder");
+                Template.Size = Size;
+                Template.BytesPerQueue = BytesPerQueue;
+                Template.BytesPerItem = BytesPerQueue / Size;
+
+                TArray<uint64> Samples;
+                {
+                    FBenchResult& Result = OutResults.Add_GetRef(Template);
+                    Result.Op = TEXT("ContainsItem");
+                    TimeOps(NumOps, Samples, [Queue, &Items](int32 Index) { Queue->ContainsItem(Items[Index % Items.Num()]); });
+                    FillTiming(Samples, Result);
+                }
+                {
+                    FBenchResult& Result = OutResults.Add_GetRef(Template);
+                    Result.Op = TEXT("EnqueueDequeue");
+                    FIQT_QueueItem Dequeued;
+                    Queue->DequeueItem(Dequeued);
+                    TimeOps(NumOps, Samples, [Queue, &Items, &Dequeued](int32 Index)
+                    {
+                        Queue->EnqueueItem(Items[Index % Items.Num()]);
+                        Queue->DequeueItem(Dequeued);
+                    });
+                    FillTiming(Samples, Result);
+                }
+                Queue->EmptyQueue();
+                Queue->MarkAsGarbage();
+            }
+        }
+    }
+
+    // Produtores e consumidores concorrentes na fila interna (a camada thread-safe).
+    // Com NumPollers > 0 mede apenas as consultas das threads de leitura (contagem, topo e Contains),
+    // feitas enquanto produtores e consumidores mantêm a fila em movimento.
+    static void RunConcurrentCase(int32 Size, int32 NumProducers, int32 NumConsumers, int32 NumPollers, const FBenchConfig& Config, TArray<FBenchResult>& OutResults)
+    {
+        FBenchResult& Result = OutResults.Add_GetRef(FBenchResult());
+        Result.Op = NumPollers > 0 ? TEXT("ConcurrentPoll") : TEXT("ConcurrentEnqueueDequeue");
+        Result.Mode = NumPollers > 0 ? FString::Printf(TEXT("%dPollers"), NumPollers) : FString(TEXT("PriorityOrder"));
+        Result.Size = Size;
+        Result.Producers = NumProducers;
+        Result.Consumers = NumConsumers;
+
+        UIQT_PriorityQueueInternal Queue;
+        Queue.SetMaxSize(Size * 2 + 1024);
+
+        FRandomStream Random(Size);
+        const double FillStart = FPlatformTime::Seconds();
+        for (int32 Index = 0; Index < Size; ++Index)
+        {
+            Queue.Enqueue(MakeItem(Index, Random));
+            if ((Index & 1023) == 0 && FPlatformTime::Seconds() - FillStart > Config.CaseBudgetSeconds)
+            {
+                UE_LOG(LogIQT, Display, TEXT("IQT.Bench: concorrente Size=%d %dP%dC pulado (preenchimento excedeu %.1fs)."), Size, NumProducers, NumConsumers, Config.CaseBudgetSeconds);
+                Result.bSkipped = true;
+                return;
+            }
+        }
+
+        std::atomic<bool> bStop(false);
+        TArray<TFuture<int64>> Workers;
+        for (int32 ThreadIndex = 0; ThreadIndex < NumProducers + NumConsumers + NumPollers; ++ThreadIndex)
+        {
+            const bool bProducer = ThreadIndex < NumProducers;
+            const bool bPoller = ThreadIndex >= NumProducers + NumConsumers;
+            const bool bCountOps = NumPollers > 0 ? bPoller : true;
+            Workers.Add(Async(EAsyncExecution::Thread, [&Queue, &bStop, bProducer, bPoller, bCountOps, ThreadIndex, Size]() -> int64
+            {
+                FRandomStream ThreadRandom(ThreadIndex * 7919 + 1);
+                int64 NumOps = 0;
+                int32 NextIndex = Size + ThreadIndex * (1 << 24);
+                const FIQT_QueueItem Probe = MakeItem(ThreadRandom.RandHelper(FMath::Max(Size, 1)), ThreadRandom);
+                while (!bStop.load(std::memory_order_relaxed))
+                {
+                    if (bPoller)
+                    {
+                        // Padrão de um agente de IA por tick: tamanho e prioridade do topo sem trava, depois uma busca.
+                        int32 HeadPriority = 0;
+                        if (!Queue.IsEmpty() && Queue.GetHeadPriority(HeadPriority) && Queue.GetNumOpen() >= 0)
+                        {
+                            Queue.Contains(Probe);
+                        }
+                    }
+                    else if (bProducer)
+                    {
+                        Queue.Enqueue(MakeItem(NextIndex++, ThreadRandom));
+                    }
+                    else
+                    {
+                        FIQT_QueueItem Dequeued;
+                        Queue.Dequeue(Dequeued);
+                    }
+                    NumOps += bCountOps ? 1 : 0;
+                }
+                return NumOps;
+            }));
+        }
+
+        const double Start = FPlatformTime::Seconds();
+        FPlatformProcess::Sleep(static_cast<float>(Config.ConcurrentDurationSeconds));
+        bStop.store(true);
+        int64 TotalOps = 0;
+        for (TFuture<int64>& Worker : Workers)
+        {
+            TotalOps += Worker.Get();
+        }
+        const double Elapsed = FPlatformTime::Seconds() - Start;
+
+        Result.NumOps = static_cast<int32>(FMath::Min<int64>(TotalOps, MAX_int32));
+        Result.OpsPerSecond = Elapsed > 0.0 ? TotalOps / Elapsed : 0.0;
+        Result.MeanNs = TotalOps > 0 ? Elapsed * 1e9 / TotalOps : 0.0;
+        Queue.Empty();
+    }
+
+    static TSharedRef<FJsonObject> ResultToJson(const FBenchResult& Result)
+    {
+        TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+        Json->SetStringField(TEXT("key"), Result.GetKey());
+        Json->SetStringField(TEXT("backend"), Result.Backend);
+        Json->SetStringField(TEXT("op"), Result.Op);
+        Json->SetStringField(TEXT("mode"), Result.Mode);
+        Json->SetBoolField(TEXT("dedup"), Result.bDedup);
+        Json->SetNumberField(TEXT("size"), Result.Size);
+        Json->SetNumberField(TEXT("producers"), Result.Producers);
+        Json->SetNumberField(TEXT("consumers"), Result.Consumers);
+        Json->SetBoolField(TEXT("skipped"), Result.bSkipped);
+        Json->SetNumberField(TEXT("ops"), Result.NumOps);
+        Json->SetNumberField(TEXT("mean_ns"), Result.MeanNs);
+        Json->SetNumberField(TEXT("p50_ns"), Result.P50Ns);
+        Json->SetNumberField(TEXT("p99_ns"), Result.P99Ns);
+        Json->SetNumberField(TEXT("ops_per_sec"), Result.OpsPerSecond);
+        Json->SetNumberField(TEXT("bytes_per_item"), Result.BytesPerItem);
+        Json->SetNumberField(TEXT("bytes_per_queue"), Result.BytesPerQueue);
+        return Json;
+    }
+
+    // Compara com o baseline pela média por operação; retorna as descrições das regressões.
+    static TArray<FString> CompareWithBaseline(const TArray<FBenchResult>& Results, const FBenchConfig& Config)
+    {
+        TArray<FString> Regressions;
+        FString BaselineText;
+        if (!FFileHelper::LoadFileToString(BaselineText, *Config.BaselinePath))
+        {
+            UE_LOG(LogIQT, Warning, TEXT("IQT.Bench: Baseline '%s' não encontrado; comparação ignorada."), *Config.BaselinePath);
+            return Regressions;
+        }
+
+        TSharedPtr<FJsonObject> Baseline;
+        if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineText), Baseline) || !Baseline.IsValid())
+        {
+            UE_LOG(LogIQT, Warning, TEXT("IQT.Bench: Baseline '%s' inválido; comparação ignorada."), *Config.BaselinePath);
+            return Regressions;
+        }
+
+        TMap<FString, double> BaselineMeanNs;
+        const TArray<TSharedPtr<FJsonValue>>* BaselineResults = nullptr;
+        if (Baseline->TryGetArrayField(TEXT("results"), BaselineResults))
+        {
+            for (const TSharedPtr<FJsonValue>& Value : *BaselineResults)
+            {
+                const TSharedPtr<FJsonObject> Entry = Value->AsObject();
+                if (Entry.IsValid() && !Entry->GetBoolField(TEXT("skipped")))
+                {
+                    BaselineMeanNs.Add(Entry->GetStringField(TEXT("key")), Entry->GetNumberField(TEXT("mean_ns")));
+                }
+            }
+        }
+
+        for (const FBenchResult& Result : Results)
+        {
+            const double* Previous = BaselineMeanNs.Find(Result.GetKey());
+            if (Result.bSkipped || !Previous || *Previous <= 0.0)
+            {
+                continue;
+            }
+            const double Ratio = Result.MeanNs / *Previous;
+            if (Ratio > 1.0 + Config.RegressionThreshold)
+            {
+                Regressions.Add(FString::Printf(TEXT("%s: %.1f ns -> %.1f ns (+%.1f%%)"), *Result.GetKey(), *Previous, Result.MeanNs, (Ratio - 1.0) * 100.0));
+            }
+        }
+        return Regressions;
+    }
+
+    static void Run(const TArray<FString>& Args)
+    {
+        const FBenchConfig Config = ParseConfig(Args);
+        UE_LOG(LogIQT, Display, TEXT("IQT.Bench: Iniciando (%d tamanhos, %d operações por caso)."), Config.Sizes.Num(), Config.OpsPerCase);
+
+        // Logs por operação distorcem a medição: silencia as categorias da fila durante o benchmark.
+        const ELogVerbosity::Type PrevQueueVerbosity = LogIOTQueue.GetVerbosity();
+        const ELogVerbosity::Type PrevInternalVerbosity = LogIQTInternal.GetVerbosity();
+        LogIOTQueue.SetVerbosity(ELogVerbosity::Error);
+        LogIQTInternal.SetVerbosity(ELogVerbosity::Error);
+
+        TArray<FBenchResult> Results;
+        const EIQT_QueueMode Modes[] = { EIQT_QueueMode::PriorityOrder, EIQT_QueueMode::FIFO, EIQT_QueueMode::FILO };
+        for (const EIQT_QueueMode Mode : Modes)
+        {
+            for (const bool bDedup : { false, true })
+            {
+                for (const int32 Size : Config.Sizes)
+                {
+                    RunSingleThreadedCase(Mode, bDedup, Size, 0.0f, Config, Results);
+                }
+            }
+        }
+        for (const int32 Size : Config.Sizes)
+        {
+            RunSingleThreadedCase(EIQT_QueueMode::PriorityOrder, false, Size, 1.0f, Config, Results);
+        }
+        for (const int32 Size : Config.Sizes)
+        {
+            RunUtilityCase(Size, Config, Results);
+            RunCapacityCase(Size, Config, Results);
+        }
+        RunSmallQueueCase(Config, Results);
+        for (const int32 NumThreads : Config.ThreadCounts)
+        {
+            for (const int32 Size : Config.Sizes)
+            {
+                RunConcurrentCase(Size, NumThreads, NumThreads, 0, Config, Results);
+                RunConcurrentCase(Size, 1, 1, NumThreads * 4, Config, Results);
+            }
+        }
+
+        LogIOTQueue.SetVerbosity(PrevQueueVerbosity);
+        LogIQTInternal.SetVerbosity(PrevInternalVerbosity);
+
+        const TArray<FString> Regressions = Config.BaselinePath.IsEmpty() ? TArray<FString>() : CompareWithBaseline(Results, Config);
+
+        TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+        Root->SetStringField(TEXT("engine"), FEngineVersion::Current().ToString());
+        Root->SetStringField(TEXT("platform"), FPlatformProperties::IniPlatformName());
+        Root->SetStringField(TEXT("cpu"), FPlatformMisc::GetCPUBrand());
+        Root->SetNumberField(TEXT("cores"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+        Root->SetStringField(TEXT("build_config"), LexToString(FApp::GetBuildConfiguration()));
+        Root->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+        Root->SetStringField(TEXT("baseline"), Config.BaselinePath);
+        Root->SetNumberField(TEXT("threshold"), Config.RegressionThreshold);
+        TArray<TSharedPtr<FJsonValue>> ResultValues;
+        for (const FBenchResult& Result : Results)
+        {
+            ResultValues.Add(MakeShared<FJsonValueObject>(ResultToJson(Result)));
+        }
+        Root->SetArrayField(TEXT("results"), ResultValues);
+        TArray<TSharedPtr<FJsonValue>> RegressionValues;
+        for (const FString& Regression : Regressions)
+        {
+            RegressionValues.Add(MakeShared<FJsonValueString>(Regression));
+        }
+        Root->SetArrayField(TEXT("regressions"), RegressionValues);
+
+        FString Output;
+        FJsonSerializer::Serialize(Root, TJsonWriterFactory<>::Create(&Output));
+        if (FFileHelper::SaveStringToFile(Output, *Config.OutputPath))
+        {
+            UE_LOG(LogIQT, Display, TEXT("IQT.Bench: %d resultados gravados em '%s'."), Results.Num(), *Config.OutputPath);
+        }
+        else
+        {
+            UE_LOG(LogIQT, Error, TEXT("IQT.Bench: Falha ao gravar '%s'."), *Config.OutputPath);
+        }
+
+        for (const FString& Regression : Regressions)
+        {
+            UE_LOG(LogIQT, Error, TEXT("IQT.Bench: REGRESSÃO %s"), *Regression);
+        }
+        UE_LOG(LogIQT, Display, TEXT("IQT.Bench: %s (%d regressões)."), Regressions.Num() > 0 ? TEXT("FAIL") : TEXT("PASS"), Regressions.Num());
+
+        if (Config.bExitWhenDone)
+        {
+            FPlatformMisc::RequestExitWithStatus(false, Regressions.Num() > 0 ? 1 : 0);
+        }
+    }
+}
+
+static FAutoConsoleCommand CmdIQTBenchRun(
+    TEXT("iqt.Bench.Run"),
+    TEXT("Executa o benchmark das operações da fila IQT e grava o resultado em JSON. Ver IQT_Benchmark.cpp para os argumentos."),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&IQTBenchmark::Run));
+
+#endif // !UE_BUILD_SHIPPING
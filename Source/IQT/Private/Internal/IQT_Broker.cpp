@@ -0,0 +1,655 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_Broker.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_Broker.h"
+#include "IQT_Log.h"
+#include "IQT_PriorityQueueInternal.h"
+#include "Algo/Reverse.h"
+#include "HAL/RunnableThread.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+#include "UObject/GarbageCollection.h"
+
+namespace IQTBroker
+{
+    static ISocketSubsystem* GetSockets()
+    {
+        return ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+    }
+
+    static void WriteHello(TArray<uint8>& OutPayload)
+    {
+        FMemoryWriter Writer(OutPayload);
+        uint32 HelloMagic = Magic;
+        uint32 HelloVersion = Version;
+        Writer << HelloMagic << HelloVersion;
+    }
+
+    static bool ReadHello(const TArray<uint8>& Payload)
+    {
+        FMemoryReader Reader(Payload);
+        uint32 HelloMagic = 0;
+        uint32 HelloVersion = 0;
+        Reader << HelloMagic << HelloVersion;
+        return !Reader.IsError() && HelloMagic == Magic && HelloVersion == Version;
+    }
+}
+
+// --- FIQT_Broker ---
+
+FIQT_Broker::FIQT_Broker(TSharedPtr<UIQT_PriorityQueueInternal> InQueue)
+    : Queue(MoveTemp(InQueue))
+    , ListenSocket(nullptr)
+    , Thread(nullptr)
+    , BoundPort(0)
+    , bStopRequested(false)
+    , NextLeaseId(1)
+{
+}
+
+FIQT_Broker::~FIQT_Broker()
+{
+    Shutdown();
+}
+
+bool FIQT_Broker::Start(int32 Port)
+{
+    check(Queue.IsValid());
+    if (IsRunning())
+    {
+        return true;
+    }
+
+    ISocketSubsystem* Sockets = IQTBroker::GetSockets();
+    TSharedRef<FInternetAddr> Address = Sockets->CreateInternetAddr();
+    Address->SetLoopbackAddress();
+    Address->SetPort(Port);
+
+    ListenSocket = Sockets->CreateSocket(NAME_Stream, TEXT("IQT Broker"), Address->GetProtocolType());
+    if (!ListenSocket || !ListenSocket->SetReuseAddr(true) || !ListenSocket->SetNonBlocking(true)
+        || !ListenSocket->Bind(*Address) || !ListenSocket->Listen(16))
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("FIQT_Broker: Não foi possível escutar em %s (porta em uso?)."), *Address->ToString(true));
+        if (ListenSocket)
+        {
+            Sockets->DestroySocket(ListenSocket);
+            ListenSocket = nullptr;
+        }
+        return false;
+    }
+    BoundPort = ListenSocket->GetPortNo();
+
+    bStopRequested = false;
+    Thread = FRunnableThread::Create(this, TEXT("IQT Broker"), 0, TPri_AboveNormal);
+    UE_LOG(LogIQTInternal, Log, TEXT("FIQT_Broker: Escutando em 127.0.0.1:%d."), BoundPort);
+    return Thread != nullptr;
+}
+
+void FIQT_Broker::Shutdown()
+{
+    if (Thread)
+    {
+        Thread->Kill(/*bShouldWait*/ true);
+        delete Thread;
+        Thread = nullptr;
+    }
+    {
+        FScopeLock Lock(&ClientsMutex);
+        for (int32 ClientIndex = Clients.Num() - 1; ClientIndex >= 0; --ClientIndex)
+        {
+            DropClient(ClientIndex, TEXT("broker encerrado"));
+        }
+    }
+    if (ListenSocket)
+    {
+        ListenSocket->Close();
+        IQTBroker::GetSockets()->DestroySocket(ListenSocket);
+        ListenSocket = nullptr;
+    }
+}
+
+FIQT_Broker::FStats FIQT_Broker::GetStats() const
+{
+    FScopeLock Lock(&ClientsMutex);
+    return Stats;
+}
+
+uint32 FIQT_Broker::Run()
+{
+    TArray<uint8> Payload;
+    while (!bStopRequested)
+    {
+        bool bHasItemWork = false;
+        {
+            FScopeLock Lock(&ClientsMutex);
+            bHasItemWork = ReceiveFromClients();
+        }
+        if (!bHasItemWork)
+        {
+            WaitForTraffic(IdleWaitSeconds);
+            continue;
+        }
+
+        // A ordem das travas (guarda do GC antes de ClientsMutex) evita o impasse com AddReferencedObjects.
+        // Com a guarda, o GC não roda enquanto itens são (des)serializados pelo caminho dos seus UObjects.
+        FGCScopeGuard GCGuard;
+        FScopeLock Lock(&ClientsMutex);
+        ProcessClients(Payload);
+    }
+    return 0;
+}
+
+bool FIQT_Broker::ReceiveFromClients()
+{
+    bool bHasItemWork = false;
+    AcceptPending();
+    for (const TUniquePtr<FClient>& Client : Clients)
+    {
+        if (Client->bClosed)
+        {
+            bHasItemWork = true;
+            continue;
+        }
+        // Um envio que não coube no socket na volta anterior é retomado aqui.
+        Client->bClosed = !Client->Connection->ReceiveAvailable()
+            || (Client->Connection->HasPendingSend() && !Client->Connection->SendPending(/*bBlock*/ false));
+        bHasItemWork |= Client->bClosed || Client->Connection->HasFrame();
+    }
+    return bHasItemWork;
+}
+
+void FIQT_Broker::ProcessClients(TArray<uint8>& Payload)
+{
+    for (int32 ClientIndex = Clients.Num() - 1; ClientIndex >= 0; --ClientIndex)
+    {
+        FClient& Client = *Clients[ClientIndex];
+        if (Client.bClosed)
+        {
+            DropClient(ClientIndex, TEXT("conexão encerrada"));
+            continue;
+        }
+
+        // Todos os quadros já recebidos são processados e respondidos juntos (um único Send por volta).
+        FIQT_BrokerFrameHeader Header;
+        bool bClientOk = true;
+        while (bClientOk && Client.Connection->PopFrame(Header, Payload))
+        {
+            bClientOk = HandleFrame(Client, Header, Payload);
+        }
+        if (!bClientOk || Client.Connection->HasProtocolError())
+        {
+            DropClient(ClientIndex, TEXT("erro de protocolo"));
+            continue;
+        }
+        if (Client.Connection->HasPendingSend() && !Client.Connection->SendPending(/*bBlock*/ false))
+        {
+            DropClient(ClientIndex, TEXT("falha de envio"));
+        }
+    }
+}
+
+void FIQT_Broker::WaitForTraffic(double TimeoutSeconds)
+{
+    // Clients só muda nesta thread, então a lista pode ser lida sem ClientsMutex (o GC só a lê).
+    // FSocket não oferece select sobre vários sockets: cada um recebe uma fatia do tempo, e a espera termina no
+    // primeiro que tiver dados. A thread fica bloqueada no sistema operacional, sem girar.
+    const FTimespan Slice = FTimespan::FromSeconds(TimeoutSeconds / (Clients.Num() + 1));
+    if (ListenSocket->Wait(ESocketWaitConditions::WaitForRead, Slice))
+    {
+        return;
+    }
+    for (const TUniquePtr<FClient>& Client : Clients)
+    {
+        if (bStopRequested || Client->Connection->WaitForData(Slice.GetTotalSeconds()))
+        {
+            return;
+        }
+    }
+}
+
+void FIQT_Broker::AcceptPending()
+{
+    bool bHasPending = false;
+    while (ListenSocket->HasPendingConnection(bHasPending) && bHasPending)
+    {
+        FSocket* Socket = ListenSocket->Accept(TEXT("IQT Broker Client"));
+        if (!Socket)
+        {
+            break;
+        }
+        TUniquePtr<FClient> Client = MakeUnique<FClient>();
+        Client->Connection = MakeUnique<FIQT_BrokerConnection>(Socket);
+        UE_LOG(LogIQTInternal, Log, TEXT("FIQT_Broker: Cliente conectado (%s)."), *Client->Connection->GetDescription());
+        Clients.Add(MoveTemp(Client));
+        Stats.NumConnections = Clients.Num();
+    }
+}
+
+bool FIQT_Broker::HandleFrame(FClient& Client, const FIQT_BrokerFrameHeader& Header, TArray<uint8>& Payload)
+{
+    if (!Client.bHandshakeDone && Header.Op != IQTBroker::EOp::Hello)
+    {
+        return false;
+    }
+
+    FMemoryReader Reader(Payload);
+    TArray<uint8> Response;
+    FMemoryWriter Writer(Response);
+    switch (Header.Op)
+    {
+        case IQTBroker::EOp::Hello:
+        {
+            if (!IQTBroker::ReadHello(Payload))
+            {
+                UE_LOG(LogIQTInternal, Warning, TEXT("FIQT_Broker: Handshake recusado (%s): versão do protocolo ou build diferente."), *Client.Connection->GetDescription());
+                return false;
+            }
+            Client.bHandshakeDone = true;
+            IQTBroker::WriteHello(Response);
+            break;
+        }
+        case IQTBroker::EOp::Enqueue:
+        {
+            int32 Num = 0;
+            Reader << Num;
+            int32 NumAccepted = 0;
+            for (int32 Index = 0; Index < Num && !Reader.IsError(); ++Index)
+            {
+                FIQT_QueueItem Item;
+                if (!IQTBroker::ReadItem(Reader, Item))
+                {
+                    return false;
+                }
+                const bool bDuplicate = (Header.Flags & IQTBroker::FrameFlag_IgnoreDuplicates) != 0 && Queue->Contains(Item);
+                if (!bDuplicate && Queue->Enqueue(MoveTemp(Item)))
+                {
+                    NumAccepted++;
+                }
+            }
+            if (Reader.IsError())
+            {
+                return false;
+            }
+            Stats.NumEnqueued += NumAccepted;
+            Stats.NumRejected += Num - NumAccepted;
+            int32 QueueCount = Queue->GetCount();
+            Writer << NumAccepted << QueueCount;
+            break;
+        }
+        case IQTBroker::EOp::Dequeue:
+        {
+            int32 MaxItems = 0;
+            Reader << MaxItems;
+            if (Reader.IsError())
+            {
+                return false;
+            }
+            TArray<FIQT_BrokerLease, TInlineAllocator<32>> Leased;
+            FIQT_QueueItem Item;
+            while (Leased.Num() < MaxItems && Queue->Dequeue(Item))
+            {
+                Leased.Add({ NextLeaseId++, MoveTemp(Item) });
+            }
+            int32 QueueCount = Queue->GetCount();
+            int32 Num = Leased.Num();
+            Writer << QueueCount << Num;
+            for (FIQT_BrokerLease& Lease : Leased)
+            {
+                Writer << Lease.LeaseId;
+                IQTBroker::WriteItem(Writer, Lease.Item);
+                Client.Leases.Add(Lease.LeaseId, MoveTemp(Lease.Item));
+            }
+            Stats.NumDequeued += Num;
+            Stats.NumLeased += Num;
+            break;
+        }
+        case IQTBroker::EOp::Ack:
+        {
+            int32 Num = 0;
+            Reader << Num;
+            int32 NumAcked = 0;
+            for (int32 Index = 0; Index < Num && !Reader.IsError(); ++Index)
+            {
+                uint64 LeaseId = 0;
+                Reader << LeaseId;
+                NumAcked += Client.Leases.Remove(LeaseId);
+            }
+            if (Reader.IsError())
+            {
+                return false;
+            }
+            Stats.NumAcked += NumAcked;
+            Stats.NumLeased -= NumAcked;
+            int32 QueueCount = Queue->GetCount();
+            Writer << NumAcked << QueueCount;
+            break;
+        }
+        default:
+            return false;
+    }
+
+    Client.Connection->QueueFrame(Header.Op, Header.RequestId, 0, Response);
+    return true;
+}
+
+void FIQT_Broker::DropClient(int32 ClientIndex, const TCHAR* Reason)
+{
+    FClient& Client = *Clients[ClientIndex];
+    const int32 NumLeases = Client.Leases.Num();
+    for (TPair<uint64, FIQT_QueueItem>& Lease : Client.Leases)
+    {
+        if (!Queue->Enqueue(MoveTemp(Lease.Value)))
+        {
+            UE_LOG(LogIQTInternal, Warning, TEXT("FIQT_Broker: Item emprestado não pôde voltar para a fila (fila cheia) e foi descartado."));
+        }
+    }
+    UE_LOG(LogIQTInternal, Log, TEXT("FIQT_Broker: Cliente %s desconectado (%s); %d itens sem Ack voltaram para a fila."),
+        *Client.Connection->GetDescription(), Reason, NumLeases);
+    Stats.NumRequeued += NumLeases;
+    Stats.NumLeased -= NumLeases;
+    Clients.RemoveAtSwap(ClientIndex);
+    Stats.NumConnections = Clients.Num();
+}
+
+void FIQT_Broker::AddReferencedObjects(FReferenceCollector& Collector)
+{
+    // A fila pode não ter outro dono no GC (ex.: broker do commandlet).
+    if (Queue.IsValid())
+    {
+        Queue->AddReferencedObjects(Collector);
+    }
+    FScopeLock Lock(&ClientsMutex);
+    for (const TUniquePtr<FClient>& Client : Clients)
+    {
+        for (TPair<uint64, FIQT_QueueItem>& Lease : Client->Leases)
+        {
+            Collector.AddReferencedObject(Lease.Value.UserPayload);
+            Lease.Value.DispatchData.AddStructReferencedObjects(Collector);
+        }
+    }
+}
+
+// --- FIQT_BrokerClient ---
+
+FIQT_BrokerClient::~FIQT_BrokerClient()
+{
+    if (bConnected)
+    {
+        // Lotes pendentes ainda são entregues; itens buscados e não entregues voltam para a fila no broker.
+        Flush();
+    }
+}
+
+TSharedPtr<FIQT_BrokerClient> FIQT_BrokerClient::Connect(const FString& Host, int32 Port, double TimeoutSeconds)
+{
+    ISocketSubsystem* Sockets = IQTBroker::GetSockets();
+    TSharedRef<FInternetAddr> Address = Sockets->CreateInternetAddr();
+    bool bIsValid = false;
+    Address->SetIp(*Host, bIsValid);
+    Address->SetPort(Port);
+    if (!bIsValid)
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("FIQT_BrokerClient: Endereço inválido '%s'."), *Host);
+        return nullptr;
+    }
+
+    FSocket* Socket = Sockets->CreateSocket(NAME_Stream, TEXT("IQT Broker Proxy"), Address->GetProtocolType());
+    if (!Socket || !Socket->Connect(*Address))
+    {
+        UE_LOG(LogIQTInternal, Warning, TEXT("FIQT_BrokerClient: Não foi possível conectar a %s."), *Address->ToString(true));
+        if (Socket)
+        {
+            Sockets->DestroySocket(Socket);
+        }
+        return nullptr;
+    }
+
+    TSharedPtr<FIQT_BrokerClient> Client(new FIQT_BrokerClient());
+    Client->Connection = MakeUnique<FIQT_BrokerConnection>(Socket);
+    Client->bConnected = true;
+
+    TArray<uint8> Hello;
+    IQTBroker::WriteHello(Hello);
+    const uint32 HelloId = Client->PostFrame(IQTBroker::EOp::Hello, 0, Hello);
+    if (!Client->Flush() || !Client->ReadResponses(HelloId, TimeoutSeconds))
+    {
+        UE_LOG(LogIQTInternal, Warning, TEXT("FIQT_BrokerClient: %s não respondeu ao handshake."), *Address->ToString(true));
+        return nullptr;
+    }
+    return Client;
+}
+
+uint32 FIQT_BrokerClient::PostFrame(IQTBroker::EOp Op, uint8 Flags, TConstArrayView<uint8> Payload)
+{
+    const uint32 RequestId = NextRequestId++;
+    Connection->QueueFrame(Op, RequestId, Flags, Payload);
+    LastSentRequestId = RequestId;
+    return RequestId;
+}
+
+void FIQT_BrokerClient::Enqueue(const FIQT_QueueItem& Item, bool bIgnoreDuplicates)
+{
+    if (PendingEnqueue.Num() > 0 && bIgnoreDuplicates != bPendingIgnoreDuplicates)
+    {
+        FlushEnqueueBatch();
+    }
+    bPendingIgnoreDuplicates = bIgnoreDuplicates;
+    PendingEnqueue.Add(Item);
+    if (PendingEnqueue.Num() >= BatchSize)
+    {
+        Flush();
+    }
+}
+
+void FIQT_BrokerClient::Ack(uint64 LeaseId)
+{
+    PendingAcks.Add(LeaseId);
+    if (PendingAcks.Num() >= BatchSize)
+    {
+        Flush();
+    }
+}
+
+void FIQT_BrokerClient::FlushEnqueueBatch()
+{
+    if (PendingEnqueue.Num() == 0)
+    {
+        return;
+    }
+    TArray<uint8> Payload;
+    FMemoryWriter Writer(Payload);
+    int32 Num = PendingEnqueue.Num();
+    Writer << Num;
+    for (const FIQT_QueueItem& Item : PendingEnqueue)
+    {
+        IQTBroker::WriteItem(Writer, Item);
+    }
+    const uint32 RequestId = PostFrame(IQTBroker::EOp::Enqueue, bPendingIgnoreDuplicates ? IQTBroker::FrameFlag_IgnoreDuplicates : IQTBroker::FrameFlag_None, Payload);
+    InFlightEnqueues.Add(RequestId, Num);
+    PendingEnqueue.Reset();
+}
+
+void FIQT_BrokerClient::FlushAckBatch()
+{
+    if (PendingAcks.Num() == 0)
+    {
+        return;
+    }
+    TArray<uint8> Payload;
+    FMemoryWriter Writer(Payload);
+    int32 Num = PendingAcks.Num();
+    Writer << Num;
+    for (uint64 LeaseId : PendingAcks)
+    {
+        Writer << LeaseId;
+    }
+    PostFrame(IQTBroker::EOp::Ack, IQTBroker::FrameFlag_None, Payload);
+    PendingAcks.Reset();
+}
+
+bool FIQT_BrokerClient::Flush()
+{
+    if (!bConnected)
+    {
+        return false;
+    }
+    FlushEnqueueBatch();
+    FlushAckBatch();
+    if (!Connection->SendPending(/*bBlock*/ true))
+    {
+        bConnected = false;
+        UE_LOG(LogIQTInternal, Warning, TEXT("FIQT_BrokerClient: Conexão com o broker perdida."));
+        return false;
+    }
+    // Consome as respostas que já chegaram, sem esperar: mantém contagens atualizadas e o buffer do broker livre.
+    return ReadResponses(0, 0.0);
+}
+
+bool FIQT_BrokerClient::Sync(double TimeoutSeconds)
+{
+    return Flush() && ReadResponses(LastSentRequestId, TimeoutSeconds);
+}
+
+bool FIQT_BrokerClient::Dequeue(FIQT_BrokerLease& OutLease, double TimeoutSeconds)
+{
+    if (Prefetched.Num() == 0)
+    {
+        if (!bConnected)
+        {
+            return false;
+        }
+        // Um pedido por vez: outro pedido antes da resposta emprestaria itens a mais para este cliente.
+        if (PendingDequeueRequestId == 0)
+        {
+            // Enqueues e Acks pendentes seguem no mesmo envio, antes do pedido: o broker os processa em ordem.
+            FlushEnqueueBatch();
+            FlushAckBatch();
+            TArray<uint8> Payload;
+            FMemoryWriter Writer(Payload);
+            int32 MaxItems = PrefetchCount;
+            Writer << MaxItems;
+            PendingDequeueRequestId = PostFrame(IQTBroker::EOp::Dequeue, IQTBroker::FrameFlag_None, Payload);
+            if (!Flush())
+            {
+                return false;
+            }
+        }
+        if (PendingDequeueRequestId != 0 && !ReadResponses(PendingDequeueRequestId, TimeoutSeconds))
+        {
+            return false;
+        }
+    }
+    if (Prefetched.Num() == 0)
+    {
+        return false;
+    }
+    OutLease = Prefetched.Pop(EAllowShrinking::No);
+    return true;
+}
+
+bool FIQT_BrokerClient::ReadResponses(uint32 UntilRequestId, double TimeoutSeconds)
+{
+    const double Deadline = FPlatformTime::Seconds() + TimeoutSeconds;
+    TArray<uint8> Payload;
+    while (bConnected)
+    {
+        if (!Connection->ReceiveAvailable())
+        {
+            bConnected = false;
+            break;
+        }
+        FIQT_BrokerFrameHeader Header;
+        while (Connection->PopFrame(Header, Payload))
+        {
+            if (!HandleResponse(Header, Payload))
+            {
+                bConnected = false;
+                break;
+            }
+        }
+        if (Connection->HasProtocolError())
+        {
+            bConnected = false;
+            break;
+        }
+
+        // Respostas chegam na ordem dos pedidos: basta comparar com o último id respondido.
+        if (UntilRequestId == 0 || static_cast<int32>(LastAnsweredRequestId - UntilRequestId) >= 0)
+        {
+            return true;
+        }
+        const double Remaining = Deadline - FPlatformTime::Seconds();
+        if (Remaining <= 0.0)
+        {
+            // Sem espera (TimeoutSeconds 0) a resposta ainda não ter chegado é o caso normal.
+            UE_CLOG(TimeoutSeconds > 0.0, LogIQTInternal, Warning, TEXT("FIQT_BrokerClient: Sem resposta do broker para o pedido %u em %.1fs."), UntilRequestId, TimeoutSeconds);
+            return false;
+        }
+        Connection->WaitForData(FMath::Min(Remaining, 0.05));
+    }
+    UE_LOG(LogIQTInternal, Warning, TEXT("FIQT_BrokerClient: Conexão com o broker perdida."));
+    return false;
+}
+
+bool FIQT_BrokerClient::HandleResponse(const FIQT_BrokerFrameHeader& Header, TArray<uint8>& Payload)
+{
+    FMemoryReader Reader(Payload);
+    switch (Header.Op)
+    {
+        case IQTBroker::EOp::Hello:
+        {
+            if (!IQTBroker::ReadHello(Payload))
+            {
+                return false;
+            }
+            break;
+        }
+        case IQTBroker::EOp::Enqueue:
+        {
+            int32 NumAccepted = 0;
+            Reader << NumAccepted << RemoteCount;
+            int32 NumSent = 0;
+            InFlightEnqueues.RemoveAndCopyValue(Header.RequestId, NumSent);
+            NumRejected += FMath::Max(0, NumSent - NumAccepted);
+            break;
+        }
+        case IQTBroker::EOp::Dequeue:
+        {
+            int32 Num = 0;
+            Reader << RemoteCount << Num;
+            const int32 FirstNew = Prefetched.Num();
+            for (int32 Index = 0; Index < Num && !Reader.IsError(); ++Index)
+            {
+                FIQT_BrokerLease& Lease = Prefetched.AddDefaulted_GetRef();
+                Reader << Lease.LeaseId;
+                if (!IQTBroker::ReadItem(Reader, Lease.Item))
+                {
+                    return false;
+                }
+            }
+            // O broker envia do mais prioritário ao menos; Prefetched entrega pelo fim.
+            TArrayView<FIQT_BrokerLease> NewLeases = MakeArrayView(Prefetched).RightChop(FirstNew);
+            Algo::Reverse(NewLeases);
+            if (Header.RequestId == PendingDequeueRequestId)
+            {
+                PendingDequeueRequestId = 0;
+            }
+            break;
+        }
+        case IQTBroker::EOp::Ack:
+        {
+            int32 NumAcked = 0;
+            Reader << NumAcked << RemoteCount;
+            break;
+        }
+        default:
+            return false;
+    }
+    LastAnsweredRequestId = Header.RequestId;
+    return !Reader.IsError();
+}
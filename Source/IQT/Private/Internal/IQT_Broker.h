@@ -0,0 +1,181 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_Broker.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "UObject/GCObject.h"
+#include "IQT_BrokerProtocol.h"
+#include <atomic>
+
+class FRunnableThread;
+class FSocket;
+class UIQT_PriorityQueueInternal;
+
+// Item entregue por um Dequeue do broker. O LeaseId deve ser confirmado (Ack) quando o item termina.
+struct FIQT_BrokerLease
+{
+    uint64 LeaseId = 0;
+    FIQT_QueueItem Item;
+};
+
+/**
+ * FIQT_Broker: Compartilha uma UIQT_PriorityQueueInternal com outros processos do mesmo host, por TCP em loopback.
+ * - Uma thread própria atende todas as conexões (sockets não bloqueantes), processando os quadros de cada conexão
+ *   em ordem e respondendo em lote a cada volta. Sem tráfego ela fica bloqueada esperando os sockets, e a guarda
+ *   do GC só é tomada quando há quadros para (des)serializar.
+ * - Itens entregues por Dequeue ficam "emprestados" à conexão até o Ack. Se a conexão cair antes, voltam para a
+ *   fila (entrega ao menos uma vez).
+ * - A fila pode ser usada localmente ao mesmo tempo (ex.: UIQT_Queue::HostBroker): ela já é thread-safe.
+ */
+class FIQT_Broker : public FRunnable, public FGCObject
+{
+public:
+    struct FStats
+    {
+        int32 NumConnections = 0;
+        int64 NumEnqueued = 0;
+        int64 NumRejected = 0;
+        int64 NumDequeued = 0;
+        int64 NumAcked = 0;
+        int64 NumRequeued = 0;      // Empréstimos devolvidos à fila por conexões encerradas sem Ack.
+        int32 NumLeased = 0;        // Empréstimos em aberto.
+    };
+
+    explicit FIQT_Broker(TSharedPtr<UIQT_PriorityQueueInternal> InQueue);
+    virtual ~FIQT_Broker() override;
+
+    // Abre o socket de escuta em 127.0.0.1:Port e inicia a thread. Port 0 escolhe uma porta livre (ver GetPort).
+    bool Start(int32 Port);
+
+    // Encerra a thread e as conexões. Empréstimos em aberto voltam para a fila.
+    void Shutdown();
+
+    bool IsRunning() const { return Thread != nullptr; }
+    int32 GetPort() const { return BoundPort; }
+    FStats GetStats() const;
+
+    // FRunnable
+    virtual uint32 Run() override;
+    virtual void Stop() override { bStopRequested = true; }
+
+    // FGCObject
+    virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+    virtual FString GetReferencerName() const override { return TEXT("FIQT_Broker"); }
+
+private:
+    struct FClient
+    {
+        TUniquePtr<FIQT_BrokerConnection> Connection;
+        TMap<uint64, FIQT_QueueItem> Leases;
+        bool bHandshakeDone = false;
+        bool bClosed = false;       // A conexão caiu; os empréstimos voltam para a fila em ProcessClients.
+    };
+
+    // Tempo máximo de uma espera sem tráfego (também é o atraso máximo para notar Stop).
+    static constexpr double IdleWaitSeconds = 0.002;
+
+    // Sem a guarda do GC: aceita conexões, lê os sockets e envia respostas pendentes.
+    // Retorna se algum cliente tem quadros a processar ou caiu (ambos mexem em itens e exigem a guarda).
+    bool ReceiveFromClients();
+    // Com a guarda do GC: processa os quadros recebidos, responde e descarta os clientes encerrados.
+    void ProcessClients(TArray<uint8>& Payload);
+    // Bloqueia até chegar algo em algum socket ou o tempo esgotar.
+    void WaitForTraffic(double TimeoutSeconds);
+    void AcceptPending();
+    bool HandleFrame(FClient& Client, const FIQT_BrokerFrameHeader& Header, TArray<uint8>& Payload);
+    void DropClient(int32 ClientIndex, const TCHAR* Reason);
+
+    TSharedPtr<UIQT_PriorityQueueInternal> Queue;
+    FSocket* ListenSocket;
+    FRunnableThread* Thread;
+    int32 BoundPort;
+    std::atomic<bool> bStopRequested;
+
+    // Clientes e empréstimos: acessados pela thread do broker e pelo GC (AddReferencedObjects).
+    mutable FCriticalSection ClientsMutex;
+    TArray<TUniquePtr<FClient>> Clients;
+    uint64 NextLeaseId;
+    FStats Stats;
+};
+
+/**
+ * FIQT_BrokerClient: Conexão de um processo com um FIQT_Broker.
+ * - Enqueue/Ack são acumulados em lotes e enviados por Flush (automático ao completar BatchSize itens).
+ *   As respostas não são esperadas: chegam em ordem e são contabilizadas na próxima leitura (NumRejected, contagem).
+ * - Dequeue empresta um item por pedido, para não tirar dos outros consumidores os itens mais prioritários.
+ *   SetPrefetchCount busca vários de uma vez (menos viagens, mas os buscados ficam presos a este cliente).
+ *   Com TimeoutSeconds 0 o Dequeue não bloqueia: o pedido fica pendente e a resposta é lida numa próxima chamada.
+ * Não é thread-safe: use a partir de uma única thread.
+ */
+class FIQT_BrokerClient
+{
+public:
+    ~FIQT_BrokerClient();
+
+    // Conecta e faz o handshake. Retorna nullptr se o broker não responder em TimeoutSeconds.
+    static TSharedPtr<FIQT_BrokerClient> Connect(const FString& Host, int32 Port, double TimeoutSeconds = 2.0);
+
+    // Itens por lote de Enqueue/Ack.
+    void SetBatchSize(int32 InBatchSize) { BatchSize = FMath::Max(1, InBatchSize); }
+
+    // Itens emprestados por pedido de Dequeue (padrão 1).
+    void SetPrefetchCount(int32 InPrefetchCount) { PrefetchCount = FMath::Max(1, InPrefetchCount); }
+
+    void Enqueue(const FIQT_QueueItem& Item, bool bIgnoreDuplicates);
+    void Ack(uint64 LeaseId);
+
+    // Entrega o próximo item emprestado, pedindo mais ao broker quando os buscados acabam.
+    // Espera a resposta por até TimeoutSeconds; um pedido sem resposta continua valendo para a próxima chamada.
+    bool Dequeue(FIQT_BrokerLease& OutLease, double TimeoutSeconds = 2.0);
+
+    // Envia os lotes pendentes. Retorna false se a conexão caiu.
+    bool Flush();
+
+    // Espera todas as respostas das requisições já enviadas (ex.: antes de ler NumRejected).
+    bool Sync(double TimeoutSeconds = 2.0);
+
+    bool IsConnected() const { return bConnected; }
+
+    // Há um pedido de Dequeue enviado e ainda sem resposta (um Dequeue sem espera retornou false por causa dele).
+    bool IsDequeuePending() const { return bConnected && PendingDequeueRequestId != 0; }
+
+    // Último tamanho da fila informado pelo broker, mais o que ainda está neste cliente (lotes e itens buscados).
+    int32 GetApproximateCount() const { return RemoteCount + PendingEnqueue.Num() + Prefetched.Num(); }
+    int64 GetNumRejected() const { return NumRejected; }
+
+private:
+    FIQT_BrokerClient() = default;
+
+    uint32 PostFrame(IQTBroker::EOp Op, uint8 Flags, TConstArrayView<uint8> Payload);
+    void FlushEnqueueBatch();
+    void FlushAckBatch();
+
+    // Lê respostas até a de RequestId (0 = apenas as que já chegaram).
+    bool ReadResponses(uint32 UntilRequestId, double TimeoutSeconds);
+    bool HandleResponse(const FIQT_BrokerFrameHeader& Header, TArray<uint8>& Payload);
+
+    TUniquePtr<FIQT_BrokerConnection> Connection;
+    bool bConnected = false;
+    int32 BatchSize = 32;
+    int32 PrefetchCount = 1;
+    uint32 PendingDequeueRequestId = 0;     // Pedido de Dequeue enviado e ainda sem resposta (0 = nenhum).
+    uint32 NextRequestId = 1;
+    uint32 LastSentRequestId = 0;
+    uint32 LastAnsweredRequestId = 0;
+
+    TArray<FIQT_QueueItem> PendingEnqueue;
+    bool bPendingIgnoreDuplicates = false;
+    TArray<uint64> PendingAcks;
+    TMap<uint32, int32> InFlightEnqueues;   // RequestId -> itens enviados, para contar as recusas na resposta.
+
+    // Itens buscados e ainda não entregues, em ordem inversa (o próximo fica no fim).
+    TArray<FIQT_BrokerLease> Prefetched;
+
+    int32 RemoteCount = 0;
+    int64 NumRejected = 0;
+};
@@ -0,0 +1,187 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_BrokerProtocol.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_BrokerProtocol.h"
+#include "IQT_Log.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+
+void IQTBroker::SerializeItem(FArchive& InnerAr, FIQT_QueueItem& Item)
+{
+    FObjectAndNameAsStringProxyArchive Ar(InnerAr, /*bInLoadIfFindFails*/ false);
+    Ar.SetUseUnversionedPropertySerialization(true);
+    FIQT_QueueItem::StaticStruct()->SerializeItem(Ar, &Item, nullptr);
+}
+
+void IQTBroker::WriteItem(FArchive& Ar, const FIQT_QueueItem& Item)
+{
+    // O tamanho vem antes para que o leitor possa validar (e pular) o item sem depender do serializador.
+    TArray<uint8> Bytes;
+    FMemoryWriter ItemWriter(Bytes);
+    SerializeItem(ItemWriter, const_cast<FIQT_QueueItem&>(Item));
+    uint32 NumBytes = static_cast<uint32>(Bytes.Num());
+    Ar << NumBytes;
+    Ar.Serialize(Bytes.GetData(), Bytes.Num());
+}
+
+bool IQTBroker::ReadItem(FArchive& Ar, FIQT_QueueItem& OutItem)
+{
+    uint32 NumBytes = 0;
+    Ar << NumBytes;
+    if (Ar.IsError() || int64(NumBytes) > Ar.TotalSize() - Ar.Tell())
+    {
+        Ar.SetError();
+        return false;
+    }
+    TArray<uint8> Bytes;
+    Bytes.SetNumUninitialized(static_cast<int32>(NumBytes));
+    Ar.Serialize(Bytes.GetData(), Bytes.Num());
+
+    FMemoryReader ItemReader(Bytes);
+    OutItem = FIQT_QueueItem();
+    SerializeItem(ItemReader, OutItem);
+    return !Ar.IsError() && !ItemReader.IsError();
+}
+
+FIQT_BrokerConnection::FIQT_BrokerConnection(FSocket* InSocket)
+    : Socket(InSocket)
+    , RecvOffset(0)
+    , bProtocolError(false)
+{
+    Socket->SetNonBlocking(true);
+    Socket->SetNoDelay(true);
+}
+
+FIQT_BrokerConnection::~FIQT_BrokerConnection()
+{
+    Socket->Close();
+    ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+}
+
+void FIQT_BrokerConnection::QueueFrame(IQTBroker::EOp Op, uint32 RequestId, uint8 Flags, TConstArrayView<uint8> Payload)
+{
+    FIQT_BrokerFrameHeader Header;
+    Header.PayloadBytes = static_cast<uint32>(Payload.Num());
+    Header.RequestId = RequestId;
+    Header.Op = Op;
+    Header.Flags = Flags;
+    Header.Reserved = 0;
+    SendBuffer.Append(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+    SendBuffer.Append(Payload.GetData(), Payload.Num());
+}
+
+bool FIQT_BrokerConnection::SendPending(bool bBlock)
+{
+    int32 NumSent = 0;
+    while (NumSent < SendBuffer.Num())
+    {
+        int32 BytesSent = 0;
+        if (!Socket->Send(SendBuffer.GetData() + NumSent, SendBuffer.Num() - NumSent, BytesSent))
+        {
+            if (ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetLastErrorCode() != SE_EWOULDBLOCK)
+            {
+                return false;
+            }
+            BytesSent = 0;
+        }
+        NumSent += BytesSent;
+        if (BytesSent == 0)
+        {
+            if (!bBlock)
+            {
+                break;
+            }
+            // Buffer do socket cheio: espera o outro lado consumir.
+            Socket->Wait(ESocketWaitConditions::WaitForWrite, FTimespan::FromMilliseconds(10));
+        }
+    }
+    SendBuffer.RemoveAt(0, NumSent, EAllowShrinking::No);
+    return true;
+}
+
+bool FIQT_BrokerConnection::ReceiveAvailable()
+{
+    // Compacta o buffer quando a parte já consumida domina (quadros são retirados do início).
+    if (RecvOffset > 0 && RecvOffset * 2 >= RecvBuffer.Num())
+    {
+        RecvBuffer.RemoveAt(0, RecvOffset, EAllowShrinking::No);
+        RecvOffset = 0;
+    }
+
+    static constexpr int32 ChunkBytes = 64 * 1024;
+    while (true)
+    {
+        const int32 OldNum = RecvBuffer.Num();
+        RecvBuffer.AddUninitialized(ChunkBytes);
+        int32 BytesRead = 0;
+        const bool bOk = Socket->Recv(RecvBuffer.GetData() + OldNum, ChunkBytes, BytesRead);
+        RecvBuffer.SetNum(OldNum + FMath::Max(0, BytesRead), EAllowShrinking::No);
+        if (!bOk)
+        {
+            return ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetLastErrorCode() == SE_EWOULDBLOCK;
+        }
+        if (BytesRead == 0)
+        {
+            // Leitura bem-sucedida de 0 bytes em um socket não bloqueante: o outro lado fechou a conexão.
+            return false;
+        }
+        if (BytesRead < ChunkBytes)
+        {
+            return true;
+        }
+    }
+}
+
+bool FIQT_BrokerConnection::WaitForData(double TimeoutSeconds)
+{
+    return Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(TimeoutSeconds));
+}
+
+bool FIQT_BrokerConnection::HasFrame() const
+{
+    const int32 Available = RecvBuffer.Num() - RecvOffset;
+    if (bProtocolError || Available < int32(sizeof(FIQT_BrokerFrameHeader)))
+    {
+        return false;
+    }
+    FIQT_BrokerFrameHeader Header;
+    FMemory::Memcpy(&Header, RecvBuffer.GetData() + RecvOffset, sizeof(Header));
+    return Header.PayloadBytes > IQTBroker::MaxPayloadBytes || Available >= int32(sizeof(FIQT_BrokerFrameHeader)) + int32(Header.PayloadBytes);
+}
+
+bool FIQT_BrokerConnection::PopFrame(FIQT_BrokerFrameHeader& OutHeader, TArray<uint8>& OutPayload)
+{
+    const int32 Available = RecvBuffer.Num() - RecvOffset;
+    if (bProtocolError || Available < int32(sizeof(FIQT_BrokerFrameHeader)))
+    {
+        return false;
+    }
+    FMemory::Memcpy(&OutHeader, RecvBuffer.GetData() + RecvOffset, sizeof(OutHeader));
+    if (OutHeader.PayloadBytes > IQTBroker::MaxPayloadBytes || OutHeader.Op >= IQTBroker::EOp::Count)
+    {
+        bProtocolError = true;
+        return false;
+    }
+    const int32 FrameBytes = int32(sizeof(FIQT_BrokerFrameHeader)) + int32(OutHeader.PayloadBytes);
+    if (Available < FrameBytes)
+    {
+        return false;
+    }
+    OutPayload.Reset();
+    OutPayload.Append(RecvBuffer.GetData() + RecvOffset + sizeof(FIQT_BrokerFrameHeader), OutHeader.PayloadBytes);
+    RecvOffset += FrameBytes;
+    return true;
+}
+
+FString FIQT_BrokerConnection::GetDescription() const
+{
+    TSharedRef<FInternetAddr> PeerAddress = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+    Socket->GetPeerAddress(*PeerAddress);
+    return PeerAddress->ToString(/*bAppendPort*/ true);
+}
@@ -0,0 +1,111 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_BrokerProtocol.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IQT_DataTypes.h"
+
+class FSocket;
+
+/**
+ * Protocolo binário do broker da IQT (ver FIQT_Broker / FIQT_BrokerClient).
+ * Cada quadro é um FIQT_BrokerFrameHeader seguido de PayloadBytes bytes. Requisições carregam lotes (N itens ou N
+ * leases por quadro) e podem ser enviadas em sequência sem esperar respostas; o broker responde na mesma ordem,
+ * ecoando o RequestId.
+ *
+ * Payloads (inteiros little-endian, itens como uint32 Bytes + FIQT_QueueItem serializado):
+ * - Hello:   Magic, Version (nos dois sentidos).
+ * - Enqueue: int32 Num, Num itens.                 Resposta: int32 NumAccepted, int32 QueueCount.
+ * - Dequeue: int32 MaxItems.                       Resposta: int32 QueueCount, int32 Num, Num x (uint64 LeaseId, item).
+ * - Ack:     int32 Num, Num x uint64 LeaseId.      Resposta: int32 NumAcked, int32 QueueCount.
+ */
+namespace IQTBroker
+{
+    static constexpr uint32 Magic = 0x42545149; // "IQTB"
+    static constexpr uint32 Version = 1;
+
+    // Limite de um quadro: protege o broker de um cliente com defeito (ou de uma conexão que não é da IQT).
+    static constexpr uint32 MaxPayloadBytes = 16 * 1024 * 1024;
+
+    enum class EOp : uint8
+    {
+        Hello,
+        Enqueue,
+        Dequeue,
+        Ack,
+
+        Count
+    };
+
+    enum EFrameFlags : uint8
+    {
+        FrameFlag_None = 0,
+        FrameFlag_IgnoreDuplicates = 1 << 0,   // Enqueue: recusa itens já presentes na fila do broker.
+    };
+
+    // Serializa as propriedades do item sem tags de versão: broker e clientes precisam ser o mesmo build.
+    // UObjects viajam pelo caminho e só são resolvidos se já estiverem carregados no processo que lê.
+    void SerializeItem(FArchive& InnerAr, FIQT_QueueItem& Item);
+    void WriteItem(FArchive& Ar, const FIQT_QueueItem& Item);
+    bool ReadItem(FArchive& Ar, FIQT_QueueItem& OutItem);
+}
+
+// Cabeçalho de quadro, gravado byte a byte.
+struct FIQT_BrokerFrameHeader
+{
+    uint32 PayloadBytes;
+    uint32 RequestId;
+    IQTBroker::EOp Op;
+    uint8 Flags;
+    uint16 Reserved;
+};
+static_assert(sizeof(FIQT_BrokerFrameHeader) == 12, "FIQT_BrokerFrameHeader é gravado byte a byte no socket.");
+
+/**
+ * FIQT_BrokerConnection: Um socket TCP com buffers de envio e recepção e o enquadramento do protocolo.
+ * O socket é não bloqueante; quadros são acumulados em QueueFrame e enviados juntos em SendPending.
+ * Não é thread-safe: cada conexão pertence a uma única thread.
+ */
+class FIQT_BrokerConnection
+{
+public:
+    // Assume a posse do socket (fechado e destruído no destrutor).
+    explicit FIQT_BrokerConnection(FSocket* InSocket);
+    ~FIQT_BrokerConnection();
+
+    FIQT_BrokerConnection(const FIQT_BrokerConnection&) = delete;
+    FIQT_BrokerConnection& operator=(const FIQT_BrokerConnection&) = delete;
+
+    // Acrescenta um quadro ao buffer de envio.
+    void QueueFrame(IQTBroker::EOp Op, uint32 RequestId, uint8 Flags, TConstArrayView<uint8> Payload);
+
+    // Envia o que couber no socket. Com bBlock, espera até enviar tudo. Retorna false se a conexão caiu.
+    bool SendPending(bool bBlock);
+    bool HasPendingSend() const { return SendBuffer.Num() > 0; }
+
+    // Lê tudo o que já chegou. Retorna false se a conexão foi fechada ou deu erro.
+    bool ReceiveAvailable();
+
+    // Espera até haver dados para ler (ou o tempo esgotar).
+    bool WaitForData(double TimeoutSeconds);
+
+    // Há um quadro completo (ou um cabeçalho inválido, que PopFrame rejeita) esperando no buffer de recepção.
+    bool HasFrame() const;
+
+    // Retira o próximo quadro completo do buffer de recepção. bProtocolError indica um quadro inválido.
+    bool PopFrame(FIQT_BrokerFrameHeader& OutHeader, TArray<uint8>& OutPayload);
+
+    bool HasProtocolError() const { return bProtocolError; }
+    FString GetDescription() const;
+
+private:
+    FSocket* Socket;
+    TArray<uint8> SendBuffer;
+    TArray<uint8> RecvBuffer;
+    int32 RecvOffset;           // Início dos dados ainda não consumidos em RecvBuffer.
+    bool bProtocolError;
+};
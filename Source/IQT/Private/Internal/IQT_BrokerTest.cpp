@@ -0,0 +1,311 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_BrokerTest.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+//
+// Teste multiprocesso do broker da IQT (comandos de console "iqt.Broker.*"). Nenhum serviço externo é usado:
+// o broker e os clientes são processos locais do mesmo executável, ligados por TCP em loopback.
+//
+//  - iqt.Broker.Test: hospeda um broker (porta livre), lança Producers processos produtores e Consumers
+//    processos consumidores (-ExecCmds="iqt.Broker.Client ..."), espera todos terminarem e verifica pelo
+//    broker que todo item enfileirado foi entregue e confirmado (Ack) exatamente uma vez.
+//  - iqt.Broker.Client: um produtor (enfileira Items itens em lotes) ou consumidor (desenfileira e confirma até
+//    a fila ficar vazia por IdleSeconds).
+//  - iqt.Broker.Host / iqt.Broker.Stop: hospeda uma fila vazia para testes manuais.
+//
+// Argumentos (todos opcionais):
+//   Producers=2 Consumers=2   Processos lançados por iqt.Broker.Test.
+//   Items=20000               Itens por produtor.
+//   Batch=32                  Itens por lote (Enqueue/Ack).
+//   Prefetch=1                Itens emprestados por pedido de Dequeue (acima de 1 troca ordem global por vazão).
+//   Timeout=120               Tempo máximo (s) de iqt.Broker.Test.
+//   Mode=Producer|Consumer    Papel de iqt.Broker.Client.
+//   Port=7787 Id=0            Porta do broker e índice do produtor (prefixo dos nomes dos itens).
+//   IdleSeconds=3             Consumidor: encerra após a fila ficar vazia por esse tempo (depois do primeiro item).
+//   Exit=1                    Encerra o processo ao final (código 1 em caso de falha).
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "IQT_Broker.h"
+#include "IQT_PriorityQueueInternal.h"
+#include "IQT_GameplayTags.h"
+#include "IQT_Log.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/Paths.h"
+
+namespace IQTBrokerTest
+{
+    struct FBrokerTestConfig
+    {
+        int32 NumProducers = 2;
+        int32 NumConsumers = 2;
+        int32 ItemsPerProducer = 20000;
+        int32 BatchSize = 32;
+        int32 PrefetchCount = 1;
+        double TimeoutSeconds = 120.0;
+        FString Mode;
+        int32 Port = 7787;
+        int32 ProducerId = 0;
+        double IdleSeconds = 3.0;
+        bool bExitWhenDone = false;
+    };
+
+    static FBrokerTestConfig ParseConfig(const TArray<FString>& Args)
+    {
+        FBrokerTestConfig Config;
+        const FString Line = FString::Join(Args, TEXT(" "));
+        FParse::Value(*Line, TEXT("Producers="), Config.NumProducers);
+        FParse::Value(*Line, TEXT("Consumers="), Config.NumConsumers);
+        FParse::Value(*Line, TEXT("Items="), Config.ItemsPerProducer);
+        FParse::Value(*Line, TEXT("Batch="), Config.BatchSize);
+        FParse::Value(*Line, TEXT("Prefetch="), Config.PrefetchCount);
+        FParse::Value(*Line, TEXT("Timeout="), Config.TimeoutSeconds);
+        FParse::Value(*Line, TEXT("Mode="), Config.Mode);
+        FParse::Value(*Line, TEXT("Port="), Config.Port);
+        FParse::Value(*Line, TEXT("Id="), Config.ProducerId);
+        FParse::Value(*Line, TEXT("IdleSeconds="), Config.IdleSeconds);
+        int32 ExitFlag = 0;
+        FParse::Value(*Line, TEXT("Exit="), ExitFlag);
+        Config.bExitWhenDone = ExitFlag != 0;
+        Config.NumProducers = FMath::Clamp(Config.NumProducers, 1, 32);
+        Config.NumConsumers = FMath::Clamp(Config.NumConsumers, 1, 32);
+        Config.ItemsPerProducer = FMath::Max(1, Config.ItemsPerProducer);
+        Config.BatchSize = FMath::Max(1, Config.BatchSize);
+        Config.PrefetchCount = FMath::Max(1, Config.PrefetchCount);
+        return Config;
+    }
+
+    static void Finish(const FBrokerTestConfig& Config, bool bPassed)
+    {
+        if (Config.bExitWhenDone)
+        {
+            FPlatformMisc::RequestExitWithStatus(false, bPassed ? 0 : 1);
+        }
+    }
+
+    static int32 RunProducer(FIQT_BrokerClient& Client, const FBrokerTestConfig& Config)
+    {
+        FRandomStream Random(Config.ProducerId + 1);
+        for (int32 Index = 0; Index < Config.ItemsPerProducer; ++Index)
+        {
+            // O nome identifica o produtor e o item; duplicatas não são ignoradas, então nenhum envio é recusado.
+            FIQT_QueueItem Item;
+            Item.Name = FName(*FString::Printf(TEXT("IQTBrokerItem_%d"), Config.ProducerId), Index + 1);
+            Item.AbilityTriggerTag = IQTGameplayTags::Action_Timeout;
+            Item.Priority = Random.RandRange(0, 1000);
+            Item.bIsOpen = true;
+            Item.EnqueueTimeSeconds = FPlatformTime::Seconds();
+            Client.Enqueue(Item, /*bIgnoreDuplicates*/ false);
+            if (!Client.IsConnected())
+            {
+                return Index;
+            }
+        }
+        return Client.Sync(10.0) ? Config.ItemsPerProducer : 0;
+    }
+
+    static int32 RunConsumer(FIQT_BrokerClient& Client, const FBrokerTestConfig& Config)
+    {
+        int32 NumConsumed = 0;
+        double IdleSince = FPlatformTime::Seconds();
+        // Antes do primeiro item os produtores ainda podem estar iniciando: a espera é mais longa.
+        while (Client.IsConnected())
+        {
+            FIQT_BrokerLease Lease;
+            if (Client.Dequeue(Lease))
+            {
+                Client.Ack(Lease.LeaseId);
+                NumConsumed++;
+                IdleSince = FPlatformTime::Seconds();
+                continue;
+            }
+            const double IdleLimit = NumConsumed > 0 ? Config.IdleSeconds : Config.TimeoutSeconds;
+            if (FPlatformTime::Seconds() - IdleSince > IdleLimit)
+            {
+                break;
+            }
+            FPlatformProcess::SleepNoStats(0.005f);
+        }
+        Client.Sync(10.0);
+        return NumConsumed;
+    }
+
+    static void RunClient(const TArray<FString>& Args)
+    {
+        const FBrokerTestConfig Config = ParseConfig(Args);
+        const bool bProducer = Config.Mode.Equals(TEXT("Producer"), ESearchCase::IgnoreCase);
+        TSharedPtr<FIQT_BrokerClient> Client = FIQT_BrokerClient::Connect(TEXT("127.0.0.1"), Config.Port, 30.0);
+        if (!Client.IsValid())
+        {
+            UE_LOG(LogIQT, Error, TEXT("IQT.Broker: Cliente sem broker em 127.0.0.1:%d."), Config.Port);
+            Finish(Config, false);
+            return;
+        }
+        Client->SetBatchSize(Config.BatchSize);
+        Client->SetPrefetchCount(Config.PrefetchCount);
+
+        const double Start = FPlatformTime::Seconds();
+        const int32 NumItems = bProducer ? RunProducer(*Client, Config) : RunConsumer(*Client, Config);
+        const double Elapsed = FPlatformTime::Seconds() - Start;
+        const bool bPassed = Client->IsConnected() && (!bProducer || NumItems == Config.ItemsPerProducer);
+        UE_LOG(LogIQT, Display, TEXT("IQT.Broker: %s %s: %d itens em %.2fs (%.0f itens/s)."),
+            bPassed ? TEXT("PASS") : TEXT("FAIL"), bProducer ? TEXT("produtor") : TEXT("consumidor"),
+            NumItems, Elapsed, Elapsed > 0.0 ? NumItems / Elapsed : 0.0);
+        Client.Reset();
+        Finish(Config, bPassed);
+    }
+
+    static FProcHandle LaunchClient(const FString& ClientArgs)
+    {
+        // Mesmo executável e projeto, sem renderização: o cliente roda o comando e encerra o processo.
+        const FString ProjectFile = FPaths::GetProjectFilePath();
+        const FString CommandLine = FString::Printf(TEXT("%s -nullrhi -unattended -nosplash -nosound -log -ExecCmds=\"iqt.Broker.Client %s Exit=1\""),
+            ProjectFile.IsEmpty() ? TEXT("") : *FString::Printf(TEXT("\"%s\""), *FPaths::ConvertRelativePathToFull(ProjectFile)), *ClientArgs);
+        return FPlatformProcess::CreateProc(FPlatformProcess::ExecutablePath(), *CommandLine,
+            /*bLaunchDetached*/ true, /*bLaunchHidden*/ true, /*bLaunchReallyHidden*/ true, nullptr, 0, nullptr, nullptr);
+    }
+
+    static void RunTest(const TArray<FString>& Args)
+    {
+        const FBrokerTestConfig Config = ParseConfig(Args);
+        TSharedPtr<UIQT_PriorityQueueInternal> Queue = MakeShared<UIQT_PriorityQueueInternal>();
+        Queue->Init();
+        FIQT_Broker Broker(Queue);
+        if (!Broker.Start(0))
+        {
+            Finish(Config, false);
+            return;
+        }
+        UE_LOG(LogIQT, Display, TEXT("IQT.Broker: Iniciando (%d produtores x %d itens, %d consumidores, lotes de %d, porta %d)."),
+            Config.NumProducers, Config.ItemsPerProducer, Config.NumConsumers, Config.BatchSize, Broker.GetPort());
+
+        TArray<FProcHandle> Processes;
+        for (int32 Index = 0; Index < Config.NumProducers; ++Index)
+        {
+            Processes.Add(LaunchClient(FString::Printf(TEXT("Mode=Producer Port=%d Id=%d Items=%d Batch=%d"),
+                Broker.GetPort(), Index, Config.ItemsPerProducer, Config.BatchSize)));
+        }
+        for (int32 Index = 0; Index < Config.NumConsumers; ++Index)
+        {
+            Processes.Add(LaunchClient(FString::Printf(TEXT("Mode=Consumer Port=%d Batch=%d Prefetch=%d IdleSeconds=%f Timeout=%f"),
+                Broker.GetPort(), Config.BatchSize, Config.PrefetchCount, Config.IdleSeconds, Config.TimeoutSeconds)));
+        }
+
+        // O laço do jogo fica parado durante o teste: é um comando para processos sem renderização.
+        TArray<FString> Failures;
+        const double Start = FPlatformTime::Seconds();
+        for (int32 Index = 0; Index < Processes.Num(); ++Index)
+        {
+            FProcHandle& Process = Processes[Index];
+            if (!Process.IsValid())
+            {
+                Failures.Add(FString::Printf(TEXT("processo %d não foi lançado"), Index));
+                continue;
+            }
+            while (FPlatformProcess::IsProcRunning(Process) && FPlatformTime::Seconds() - Start < Config.TimeoutSeconds)
+            {
+                FPlatformProcess::SleepNoStats(0.05f);
+            }
+            int32 ReturnCode = -1;
+            if (FPlatformProcess::IsProcRunning(Process))
+            {
+                FPlatformProcess::TerminateProc(Process, /*KillTree*/ true);
+                Failures.Add(FString::Printf(TEXT("processo %d excedeu %.0fs"), Index, Config.TimeoutSeconds));
+            }
+            else if (!FPlatformProcess::GetProcReturnCode(Process, &ReturnCode) || ReturnCode != 0)
+            {
+                Failures.Add(FString::Printf(TEXT("processo %d terminou com código %d"), Index, ReturnCode));
+            }
+            FPlatformProcess::CloseProc(Process);
+        }
+
+        // Desconexões e Acks finais são processados pela thread do broker logo após a saída dos clientes.
+        FIQT_Broker::FStats Stats = Broker.GetStats();
+        for (int32 Attempt = 0; Attempt < 100 && (Stats.NumConnections > 0 || Stats.NumLeased > 0); ++Attempt)
+        {
+            FPlatformProcess::SleepNoStats(0.02f);
+            Stats = Broker.GetStats();
+        }
+        const double Elapsed = FPlatformTime::Seconds() - Start;
+        Broker.Shutdown();
+
+        const int64 Expected = int64(Config.NumProducers) * Config.ItemsPerProducer;
+        if (Stats.NumEnqueued != Expected || Stats.NumRejected != 0)
+        {
+            Failures.Add(FString::Printf(TEXT("%lld itens enfileirados (%lld recusados), esperado %lld"), Stats.NumEnqueued, Stats.NumRejected, Expected));
+        }
+        if (Stats.NumAcked != Expected || Stats.NumDequeued != Expected || Stats.NumRequeued != 0)
+        {
+            Failures.Add(FString::Printf(TEXT("%lld entregues, %lld confirmados, %lld devolvidos; esperado %lld entregues e confirmados"),
+                Stats.NumDequeued, Stats.NumAcked, Stats.NumRequeued, Expected));
+        }
+        if (Queue->GetCount() != 0)
+        {
+            Failures.Add(FString::Printf(TEXT("%d itens restantes na fila"), Queue->GetCount()));
+        }
+
+        for (const FString& Failure : Failures)
+        {
+            UE_LOG(LogIQT, Error, TEXT("IQT.Broker: FALHA %s"), *Failure);
+        }
+        UE_LOG(LogIQT, Display, TEXT("IQT.Broker: %s. %lld itens por %d processos em %.2fs (%.0f itens/s)."),
+            Failures.Num() > 0 ? TEXT("FAIL") : TEXT("PASS"), Expected, Processes.Num(), Elapsed, Elapsed > 0.0 ? Expected / Elapsed : 0.0);
+        Finish(Config, Failures.Num() == 0);
+    }
+
+    // Broker manual (iqt.Broker.Host / iqt.Broker.Stop).
+    static TSharedPtr<FIQT_Broker> ManualBroker;
+
+    static void RunHost(const TArray<FString>& Args)
+    {
+        const FBrokerTestConfig Config = ParseConfig(Args);
+        TSharedPtr<UIQT_PriorityQueueInternal> Queue = MakeShared<UIQT_PriorityQueueInternal>();
+        Queue->Init();
+        ManualBroker.Reset();
+        ManualBroker = MakeShared<FIQT_Broker>(Queue);
+        if (!ManualBroker->Start(Config.Port))
+        {
+            ManualBroker.Reset();
+        }
+    }
+
+    static void RunStop(const TArray<FString>& Args)
+    {
+        if (ManualBroker.IsValid())
+        {
+            const FIQT_Broker::FStats Stats = ManualBroker->GetStats();
+            UE_LOG(LogIQT, Display, TEXT("IQT.Broker: Encerrado. %lld enfileirados, %lld recusados, %lld entregues, %lld confirmados, %lld devolvidos."),
+                Stats.NumEnqueued, Stats.NumRejected, Stats.NumDequeued, Stats.NumAcked, Stats.NumRequeued);
+            ManualBroker.Reset();
+        }
+    }
+}
+
+static FAutoConsoleCommand CmdIQTBrokerTest(
+    TEXT("iqt.Broker.Test"),
+    TEXT("Executa o teste multiprocesso do broker da IQT (broker local + processos clientes). Ver IQT_BrokerTest.cpp para os argumentos."),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&IQTBrokerTest::RunTest));
+
+static FAutoConsoleCommand CmdIQTBrokerClient(
+    TEXT("iqt.Broker.Client"),
+    TEXT("Executa um cliente de teste do broker da IQT. Argumentos: Mode=Producer|Consumer Port=7787 [Items=] [Batch=] [Prefetch=] [Id=] [Exit=1]."),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&IQTBrokerTest::RunClient));
+
+static FAutoConsoleCommand CmdIQTBrokerHost(
+    TEXT("iqt.Broker.Host"),
+    TEXT("Hospeda uma fila vazia da IQT em 127.0.0.1:Port (padrão 7787) para testes manuais."),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&IQTBrokerTest::RunHost));
+
+static FAutoConsoleCommand CmdIQTBrokerStop(
+    TEXT("iqt.Broker.Stop"),
+    TEXT("Encerra o broker de iqt.Broker.Host e mostra as estatísticas."),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&IQTBrokerTest::RunStop));
+
+#endif // !UE_BUILD_SHIPPING
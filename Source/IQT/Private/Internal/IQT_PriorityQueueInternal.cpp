@@ -4,355 +4,2295 @@
 // This code is property of William Wolff and protected by copyright law.
 // -------------------------------------------------------------------------------
 
-#include "IQT_PriorityQueueInternal.h" 
-#include "IQT_DynAINode.h" 
-#include "Kismet/GameplayStatics.h" 
+#include "IQT_PriorityQueueInternal.h"
+#include "IQT_Log.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "Math/VectorRegister.h"
+#include "Misc/Paths.h"
+
+namespace IQTUtilityKernel
+{
+    // As posições viajam em lanes de float, exatas até 2^24: filas maiores são avaliadas em blocos.
+    static constexpr int32 MaxBlockItems = 1 << 24;
+
+    /**
+     * Produto escalar Soma(Weights[f] * Columns[f][i]) para i em [Begin, End), 4 posições por instrução, guardando por
+     * lane o melhor valor e a sua posição; as lanes são reduzidas só no fim. Retorna a posição do maior valor acima
+     * de InOutBestScore (atualizado), ou INDEX_NONE se nenhum o superar.
+     */
+    static int32 ArgMaxWeightedSum(const float* const* Columns, const float* Weights, int32 NumFeatures, int32 Begin, int32 End, float& InOutBestScore)
+    {
+        VectorRegister4Float WeightLanes[FIQT_QueueItem::MaxUtilityFeatures];
+        for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+        {
+            WeightLanes[Feature] = VectorSetFloat1(Weights[Feature]);
+        }
+
+        VectorRegister4Float BestScores = VectorSetFloat1(TNumericLimits<float>::Lowest());
+        VectorRegister4Float BestOffsets = VectorSetFloat1(-1.0f);
+        VectorRegister4Float Offsets = MakeVectorRegisterFloat(0.0f, 1.0f, 2.0f, 3.0f);
+        const VectorRegister4Float OffsetStep = VectorSetFloat1(4.0f);
+
+        int32 Index = Begin;
+        for (; Index + 4 <= End; Index += 4)
+        {
+            VectorRegister4Float Scores = VectorZeroFloat();
+            for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+            {
+                Scores = VectorMultiplyAdd(VectorLoad(Columns[Feature] + Index), WeightLanes[Feature], Scores);
+            }
+            const VectorRegister4Float Better = VectorCompareGT(Scores, BestScores);
+            BestScores = VectorSelect(Better, Scores, BestScores);
+            BestOffsets = VectorSelect(Better, Offsets, BestOffsets);
+            Offsets = VectorAdd(Offsets, OffsetStep);
+        }
+
+        float LaneScores[4];
+        float LaneOffsets[4];
+        VectorStore(BestScores, LaneScores);
+        VectorStore(BestOffsets, LaneOffsets);
+        int32 BestIndex = INDEX_NONE;
+        for (int32 Lane = 0; Lane < 4; ++Lane)
+        {
+            if (LaneOffsets[Lane] >= 0.0f && LaneScores[Lane] > InOutBestScore)
+            {
+                InOutBestScore = LaneScores[Lane];
+                BestIndex = Begin + static_cast<int32>(LaneOffsets[Lane]);
+            }
+        }
+
+        // Cauda (menos de 4 posições).
+        for (; Index < End; ++Index)
+        {
+            float Score = 0.0f;
+            for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+            {
+                Score += Weights[Feature] * Columns[Feature][Index];
+            }
+            if (Score > InOutBestScore)
+            {
+                InOutBestScore = Score;
+                BestIndex = Index;
+            }
+        }
+        return BestIndex;
+    }
+}
 
 // Construtor
 UIQT_PriorityQueueInternal::UIQT_PriorityQueueInternal()
-    : iQueueSize(0)
-    , iQueueMaxSize(300) 
+    : iQueueMaxSize(MAX_int32)
+    , OverflowPolicy(EIQT_OverflowPolicy::Reject)
+    , BlockTimeoutSeconds(0.0f)
+    , AgingRate(0.0f)
+    , AgingEpochSeconds(FPlatformTime::Seconds())
+    , NextSequence(0)
+    , NextGeneration(1)
+    , NumOpen(0)
+    , PublishedCount(0)
+    , PublishedNumOpen(0)
+    , PublishedHeadPriority(NoHeadPriority)
+    , NumEvicted(0)
+    , PublishedNumSpilled(0)
+    , PublishedNumTransferable(0)
+    , NumBlockedProducers(0)
+    , SpaceAvailableEvent(EEventMode::AutoReset)
+    , BucketsVersion(0)
+    , NumUtilityWeights(0)
+    , NextQueryCacheEntry(0)
+    , SpillThreshold(0)
+    , bSpillFailed(false)
+    , NumSpilled(0)
+    , NumSpilledOpen(0)
 {
-    pHead = new UIQT_DynAINode();
-    pTail = new UIQT_DynAINode();
-
-    pHead->pNextNode = pTail;
-    pTail->pPriorNode = pHead;
+    FMemory::Memzero(UtilityWeights);
 }
 
 // Destrutor
 UIQT_PriorityQueueInternal::~UIQT_PriorityQueueInternal()
 {
-    FScopeLock Lock(&Mutex); 
-    Empty();                 
-    delete pHead;            
-    delete pTail;
-    pHead = nullptr;
-    pTail = nullptr;
+    // Nenhuma outra thread pode usar a fila durante a destruição: não há o que travar.
+    EmptyLocked();
 }
 
 void UIQT_PriorityQueueInternal::Init()
 {
-    FScopeLock Lock(&Mutex); 
-    Empty(); 
+    FPublishingWriteScope WriteScope(*this);
+    EmptyLocked();
+    NextSequence = 0;
+    AgingEpochSeconds = FPlatformTime::Seconds();
+}
+
+void UIQT_PriorityQueueInternal::Empty()
+{
+    FPublishingWriteScope WriteScope(*this);
+    EmptyLocked();
+}
+
+void UIQT_PriorityQueueInternal::Reserve(int32 NumItems)
+{
+    FWriteScopeLock WriteLock(QueueLock);
+    // Acima do limite do spill os itens excedentes vão para disco: o heap nunca passa de SpillThreshold + 1.
+    const int32 NumInMemory = SpillThreshold > 0 ? FMath::Min(NumItems, SpillThreshold + 1) : NumItems;
+    if (NumInMemory <= 0)
+    {
+        return;
+    }
+    Heap.Reserve(NumInMemory);
+    Slots.Reserve(NumInMemory);
+    SlotHeapIndex.Reserve(NumInMemory);
+    FreeSlots.Reserve(NumInMemory);
+    KeyIndex.Reserve(NumInMemory);
+    SlotBucketIndex.Reserve(NumInMemory);
+    SlotWorstIndex.Reserve(NumInMemory);
+    TransferHeap.Reserve(NumInMemory);
+    SlotTransferIndex.Reserve(NumInMemory);
+    SlotUtilityIndex.Reserve(NumInMemory);
+    if (IsTrackingWorst())
+    {
+        WorstHeap.Reserve(NumInMemory);
+    }
+    if (IsTrackingUtility())
+    {
+        UtilitySlots.Reserve(NumInMemory);
+        for (int32 Feature = 0; Feature < NumUtilityWeights; Feature++)
+        {
+            UtilityColumns[Feature].Reserve(NumInMemory);
+        }
+    }
+}
 
-    if (!pHead) pHead = new UIQT_DynAINode();
-    if (!pTail) pTail = new UIQT_DynAINode();
+void UIQT_PriorityQueueInternal::Adopt(TArray<FIQT_QueueItem>&& Items, uint32 InNextGeneration)
+{
+    FPublishingWriteScope WriteScope(*this);
+    checkf(Slots.Num() == 0, TEXT("UIQT_PriorityQueueInternal::Adopt exige uma fila sem slots (recém-criada ou após Init)."));
 
-    pHead->pNextNode = pTail;
-    pTail->pPriorNode = pHead;
-    iQueueSize = 0;
-    // VerificationList.Empty(); // Removido
+    // Cada item volta ao slot do seu handle; os slots intermediários ficam livres.
+    int32 NumSlotsNeeded = 0;
+    for (const FIQT_QueueItem& Item : Items)
+    {
+        NumSlotsNeeded = FMath::Max(NumSlotsNeeded, static_cast<int32>(Item.Handle.GetSlot()) + 1);
+    }
+    Slots.Reserve(NumSlotsNeeded);
+    for (int32 Slot = 0; Slot < NumSlotsNeeded; ++Slot)
+    {
+        AddSlotLocked(FIQT_QueueItem(), 0);
+    }
+    for (FIQT_QueueItem& Item : Items)
+    {
+        const uint32 Slot = Item.Handle.GetSlot();
+        checkf(Item.Handle.IsValid() && SlotHeapIndex[Slot] == INDEX_NONE, TEXT("UIQT_PriorityQueueInternal::Adopt: handle %s inválido ou repetido."), *Item.Handle.ToString());
+        Slots[Slot].Generation = Item.Handle.GetGeneration();
+        Slots[Slot].Item = MoveTemp(Item);
+        IndexSlotLocked(Slot, NextSequence++);
+    }
+    // Do maior para o menor: FreeSlots.Pop reutiliza primeiro os slots mais baixos.
+    for (int32 Slot = NumSlotsNeeded - 1; Slot >= 0; --Slot)
+    {
+        if (SlotHeapIndex[Slot] == INDEX_NONE)
+        {
+            FreeSlots.Add(static_cast<uint32>(Slot));
+        }
+    }
+    NextGeneration = InNextGeneration;
 }
 
-void UIQT_PriorityQueueInternal::Empty()
+void UIQT_PriorityQueueInternal::EmptyLocked()
 {
-    FScopeLock Lock(&Mutex); 
-    UIQT_DynAINode* Current = pHead->pNextNode;
-    while (Current != pTail)
+    // Mantém a capacidade alocada: filas costumam ser reabastecidas logo após serem esvaziadas.
+    Heap.Reset();
+    Slots.Reset();
+    SlotHeapIndex.Reset();
+    FreeSlots.Reset();
+    RelocatedHandles.Reset();
+    KeyIndex.Reset();
+    TaskIDIndex.Reset();
+    SlotBucketIndex.Reset();
+    WorstHeap.Reset();
+    SlotWorstIndex.Reset();
+    TransferHeap.Reset();
+    SlotTransferIndex.Reset();
+    for (TArray<float>& Column : UtilityColumns)
+    {
+        Column.Reset();
+    }
+    UtilitySlots.Reset();
+    SlotUtilityIndex.Reset();
+    NumOpen = 0;
+    // Destruir as runs apaga seus arquivos.
+    SpillRuns.Reset();
+    NumSpilled = 0;
+    NumSpilledOpen = 0;
+    // Os buckets (e o cache de consultas) continuam válidos: apenas os sub-heaps são esvaziados.
+    for (FTagBucket& Bucket : TagBuckets)
     {
-        UIQT_DynAINode* Next = Current->pNextNode;
-        delete Current; 
-        Current = Next;
+        Bucket.Heap.Reset();
     }
+}
 
-    pHead->pNextNode = pTail;
-    pTail->pPriorNode = pHead;
-    iQueueSize = 0;
-    // VerificationList.Empty(); // Removido
+bool UIQT_PriorityQueueInternal::HotLess(const FIQT_HotRecord& A, const FIQT_HotRecord& B)
+{
+    if (A.SortKey != B.SortKey)
+    {
+        return A.SortKey < B.SortKey;
+    }
+    // Empate: o mais novo sai primeiro. Diferença com sinal para tolerar o estouro do contador.
+    return static_cast<int32>(A.Sequence - B.Sequence) > 0;
 }
 
-bool UIQT_PriorityQueueInternal::Enqueue(TSharedPtr<FIQT_QueueItem>& InData)
+void UIQT_PriorityQueueInternal::PublishLocked()
 {
-    FScopeLock Lock(&Mutex); 
+    // Cada valor é consistente por si só; leitores que combinam vários (ex.: GetNumClose) podem ver mutações diferentes.
+    // Com runs em disco, RefillFromSpillLocked já garantiu que o topo em memória é o topo da fila inteira.
+    PublishedCount.store(GetTotalCountLocked(), std::memory_order_relaxed);
+    PublishedNumOpen.store(NumOpen + NumSpilledOpen, std::memory_order_relaxed);
+    PublishedNumSpilled.store(NumSpilled, std::memory_order_relaxed);
+    PublishedNumTransferable.store(TransferHeap.Num(), std::memory_order_relaxed);
+    PublishedHeadPriority.store(Heap.Num() > 0 ? int64(Slots[Heap[0].Slot].Item.Priority) : NoHeadPriority, std::memory_order_relaxed);
 
-    if (!InData.IsValid() || !ValidateData(*InData))
+    if (NumBlockedProducers.load(std::memory_order_relaxed) > 0 && GetTotalCountLocked() < iQueueMaxSize)
     {
-        UE_LOG(LogTemp, Warning, TEXT("UIQT_PriorityQueueInternal: Tentativa de enfileirar dados inválidos ou nulos."));
-        return false;
+        SpaceAvailableEvent->Trigger();
     }
+}
+
+bool UIQT_PriorityQueueInternal::Enqueue(const FIQT_QueueItem& InData, FIQT_ItemHandle* OutHandle, TOptional<FIQT_QueueItem>* OutEvicted)
+{
+    return Enqueue(FIQT_QueueItem(InData), OutHandle, OutEvicted);
+}
+
+bool UIQT_PriorityQueueInternal::Enqueue(FIQT_QueueItem&& InData, FIQT_ItemHandle* OutHandle, TOptional<FIQT_QueueItem>* OutEvicted)
+{
+    double Deadline = 0.0;
+    while (true)
+    {
+        {
+            FPublishingWriteScope WriteScope(*this);
+            const bool bMustWait = OverflowPolicy == EIQT_OverflowPolicy::Block && GetTotalCountLocked() >= iQueueMaxSize && ValidateData(InData);
+            if (!bMustWait)
+            {
+                return EnqueueLocked(MoveTemp(InData), OutHandle, OutEvicted);
+            }
+            if (Deadline == 0.0)
+            {
+                Deadline = FPlatformTime::Seconds() + BlockTimeoutSeconds;
+            }
+        }
 
-    // REMOVIDO: A checagem de duplicidade agora é responsabilidade exclusiva do UIQT_Queue.
-    // if (Contains(InData))
-    // {
-    //     return false; 
-    // }
+        // Espera sem a trava. Fatias curtas: um sinal perdido (ou consumido por outro produtor) custa no máximo uma fatia.
+        const double Remaining = Deadline - FPlatformTime::Seconds();
+        if (Remaining <= 0.0)
+        {
+            UE_LOG(LogIQTInternal, Warning, TEXT("UIQT_PriorityQueueInternal: Fila cheia (%d) após esperar %.3fs. Item '%s' não enfileirado."), iQueueMaxSize, BlockTimeoutSeconds, *InData.Name.ToString());
+            return false;
+        }
+        NumBlockedProducers.fetch_add(1, std::memory_order_relaxed);
+        SpaceAvailableEvent->Wait(FTimespan::FromSeconds(FMath::Min(Remaining, 0.01)));
+        NumBlockedProducers.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
 
-    if (iQueueSize >= iQueueMaxSize)
+bool UIQT_PriorityQueueInternal::EnqueueLocked(FIQT_QueueItem&& InData, FIQT_ItemHandle* OutHandle, TOptional<FIQT_QueueItem>* OutEvicted)
+{
+    if (!ValidateData(InData))
     {
-        UE_LOG(LogTemp, Warning, TEXT("UIQT_PriorityQueueInternal: Fila atingiu o tamanho máximo (%d). Item '%s' não enfileirado."), iQueueMaxSize, *InData->Name.ToString());
-        return false; 
+        UE_LOG(LogIQTInternal, Warning, TEXT("UIQT_PriorityQueueInternal: Tentativa de enfileirar dados inválidos ou nulos."));
+        return false;
     }
 
-    UIQT_DynAINode* NewNode = new UIQT_DynAINode();
-    NewNode->Init(InData); 
+    // A checagem de duplicidade é responsabilidade exclusiva do UIQT_Queue.
 
-    InsertNode(NewNode); 
+    if (AgingRate > 0.0f && InData.EnqueueTimeSeconds <= 0.0)
+    {
+        // O envelhecimento depende da hora de chegada; UIQT_Queue já a preenche.
+        InData.EnqueueTimeSeconds = FPlatformTime::Seconds();
+    }
+    if (AgingRate > 0.0f && double(AgingRate) * (InData.EnqueueTimeSeconds - AgingEpochSeconds) > AgingRebaseKeyThreshold)
+    {
+        RebaseAgingEpochLocked(InData.EnqueueTimeSeconds);
+    }
 
-    // REMOVIDO: Não há mais VerificationList.
-    // VerificationList.AddUnique(*InData); 
+    // Itens em disco contam para o limite, mas EvictLowest só remove itens em memória.
+    if (GetTotalCountLocked() >= iQueueMaxSize && !EvictForLocked(MakeSortKey(InData), OutEvicted))
+    {
+        UE_LOG(LogIQTInternal, Warning, TEXT("UIQT_PriorityQueueInternal: Fila atingiu o tamanho máximo (%d). Item '%s' não enfileirado."), iQueueMaxSize, *InData.Name.ToString());
+        return false;
+    }
 
-    iQueueSize++;
+    // O excedente de memória vai para o disco ao liberar a trava (FPublishingWriteScope).
+    const uint32 Slot = InsertLocked(MoveTemp(InData), NextSequence++);
+    if (OutHandle)
+    {
+        *OutHandle = Slots[Slot].Item.Handle;
+    }
     return true;
 }
 
-TSharedPtr<FIQT_QueueItem> UIQT_PriorityQueueInternal::Dequeue()
+uint32 UIQT_PriorityQueueInternal::InsertLocked(FIQT_QueueItem&& InData, uint32 Sequence)
 {
-    FScopeLock Lock(&Mutex); 
-    if (iQueueSize == 0)
+    // Geração 0 é reservada para o handle inválido.
+    const uint32 Generation = NextGeneration;
+    NextGeneration = NextGeneration == MAX_uint32 ? 1 : NextGeneration + 1;
+
+    uint32 Slot;
+    if (FreeSlots.Num() > 0)
     {
-        return nullptr; 
+        Slot = FreeSlots.Pop(EAllowShrinking::No);
+        Slots[Slot].Generation = Generation;
+        Slots[Slot].Item = MoveTemp(InData);
     }
+    else
+    {
+        Slot = AddSlotLocked(MoveTemp(InData), Generation);
+    }
+    IndexSlotLocked(Slot, Sequence);
+    return Slot;
+}
 
-    UIQT_DynAINode* NodeToRemove = pHead->pNextNode; 
-    TSharedPtr<FIQT_QueueItem> DequeuedData = NodeToRemove->AgentData; 
-
-    NodeToRemove->pPriorNode->pNextNode = NodeToRemove->pNextNode;
-    NodeToRemove->pNextNode->pPriorNode = NodeToRemove->pPriorNode;
-
-    delete NodeToRemove; 
-    NodeToRemove = nullptr; 
+uint32 UIQT_PriorityQueueInternal::AddSlotLocked(FIQT_QueueItem&& InData, uint32 Generation)
+{
+    const uint32 Slot = static_cast<uint32>(Slots.Add(FColdSlot{ MoveTemp(InData), Generation }));
+    SlotHeapIndex.Add(INDEX_NONE);
+    SlotBucketIndex.Add(INDEX_NONE);
+    SlotWorstIndex.Add(INDEX_NONE);
+    SlotTransferIndex.Add(INDEX_NONE);
+    SlotUtilityIndex.Add(INDEX_NONE);
+    return Slot;
+}
 
-    iQueueSize--;
+void UIQT_PriorityQueueInternal::IndexSlotLocked(uint32 Slot, uint32 Sequence)
+{
+    FIQT_QueueItem& Stored = Slots[Slot].Item;
+    Stored.Handle = FIQT_ItemHandle(Slot, Slots[Slot].Generation);
+    KeyIndex.Add(FItemKey(Stored), Slot);
+    if (Stored.TaskID.IsValid())
+    {
+        TaskIDIndex.Add(Stored.TaskID, Slot);
+    }
+    PlaceSlotLocked(Slot, Sequence);
+}
 
-    // REMOVIDO: Não há mais VerificationList para atualizar.
-    // if (DequeuedData.IsValid())
-    // {
-    //     VerificationList.RemoveAll([&](const FIQT_QueueItem& Item) {
-    //         return Item == *DequeuedData; 
-    //     });
-    // }
+void UIQT_PriorityQueueInternal::PlaceSlotLocked(uint32 Slot, uint32 Sequence)
+{
+    const FIQT_QueueItem& Stored = Slots[Slot].Item;
+    FIQT_HotRecord Record;
+    Record.SortKey = MakeSortKey(Stored);
+    Record.Sequence = Sequence;
+    Record.Slot = Slot;
+    Record.TagIndex = GetOrAddTagIndex(Stored.AbilityTriggerTag);
+    Record.Flags = MakeHotFlags(Stored);
+    Record.Pad = 0;
 
-    return DequeuedData;
+    NumOpen += Stored.bIsOpen ? 1 : 0;
+    const int32 HeapIndex = Heap.AddUninitialized();
+    PlaceRecord(HeapIndex, Record);
+    SiftUp(HeapIndex);
+    SecondaryInsert(Record);
 }
 
-void UIQT_PriorityQueueInternal::InsertNode(UIQT_DynAINode* InNode)
+uint32 UIQT_PriorityQueueInternal::RestoreLocked(FIQT_QueueItem&& Item, uint32 Sequence)
 {
-    UIQT_DynAINode* Current = pHead;
-    while (Current->pNextNode != pTail && InNode->GetPriority() > Current->pNextNode->GetPriority())
+    const FIQT_ItemHandle Handle = Item.Handle;
+    const uint32 Slot = InsertLocked(MoveTemp(Item), Sequence);
+    // De volta ao slot original, basta restaurar a geração; em outro slot, o handle passa a ser redirecionado.
+    Slots[Slot].Item.Handle = Handle;
+    if (Handle.GetSlot() == Slot)
     {
-        Current = Current->pNextNode;
+        Slots[Slot].Generation = Handle.GetGeneration();
     }
+    else
+    {
+        RelocatedHandles.Add(Handle, Slot);
+    }
+    return Slot;
+}
 
-    InNode->pNextNode = Current->pNextNode;
-    InNode->pPriorNode = Current;
-    Current->pNextNode->pPriorNode = InNode;
-    Current->pNextNode = InNode;
+void UIQT_PriorityQueueInternal::SpillIfOverBudgetLocked()
+{
+    if (SpillThreshold > 0 && !bSpillFailed && Heap.Num() > SpillThreshold)
+    {
+        SpillLocked();
+    }
 }
 
-bool UIQT_PriorityQueueInternal::Contains(TSharedPtr<FIQT_QueueItem>& InData)
+void UIQT_PriorityQueueInternal::SpillLocked()
 {
-    FScopeLock Lock(&Mutex); 
-    if (!InData.IsValid()) return false;
+    // Mantém a metade mais prioritária em memória; o resto vira uma run em ordem de saída.
+    const int32 NumToKeep = FMath::Max(1, SpillThreshold / 2);
+    TArray<FIQT_HotRecord> Ordered = Heap;
+    Algo::Sort(Ordered, &UIQT_PriorityQueueInternal::HotLess);
 
-    // NOVO: Itera a lista encadeada diretamente para verificar a existência.
-    UIQT_DynAINode* Current = pHead->pNextNode;
-    while (Current != pTail)
+    TArray<FIQT_SpillRun::FEntry> Entries;
+    Entries.Reserve(Ordered.Num() - NumToKeep);
+    for (int32 Index = NumToKeep; Index < Ordered.Num(); ++Index)
     {
-        if (Current->AgentData.IsValid() && (*Current->AgentData) == (*InData))
-        {
-            return true;
-        }
-        Current = Current->pNextNode;
+        const FIQT_HotRecord& Record = Ordered[Index];
+        const FIQT_QueueItem& Item = Slots[Record.Slot].Item;
+        Entries.Add({ Record.SortKey, Record.Sequence, GetTypeHash(FItemKey(Item)), &Item });
+    }
+
+    TUniquePtr<FIQT_SpillRun> Run = FIQT_SpillRun::Write(SpillDirectory, Entries);
+    if (!Run)
+    {
+        // Os itens continuam em memória. Sem suspender, cada Enqueue tentaria (e ordenaria a fila) de novo.
+        bSpillFailed = true;
+        UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Falha ao gravar run de spill em '%s'. Spill suspenso; %d itens continuam em memória."), *SpillDirectory, Heap.Num());
+        return;
     }
-    return false;
+
+    // Os itens saem da memória por completo: heaps, índices e slot. O handle continua resolvendo pela run.
+    for (int32 Index = NumToKeep; Index < Ordered.Num(); ++Index)
+    {
+        RemoveAtHeapIndex(SlotHeapIndex[Ordered[Index].Slot], nullptr);
+    }
+    NumSpilled += Run->GetNumRemaining();
+    NumSpilledOpen += Run->GetNumOpenRemaining();
+    UE_LOG(LogIQTInternal, Verbose, TEXT("UIQT_PriorityQueueInternal: %d itens gravados em '%s' (%lld bytes). Em disco: %d em %d runs."),
+        Run->GetNumRemaining(), *Run->GetPath(), Run->GetFileSize(), NumSpilled, SpillRuns.Num() + 1);
+    SpillRuns.Add(MoveTemp(Run));
 }
 
-bool UIQT_PriorityQueueInternal::RemoveItem(TSharedPtr<FIQT_QueueItem>& ItemToRemove)
+void UIQT_PriorityQueueInternal::RefillFromSpillLocked()
 {
-    FScopeLock Lock(&Mutex); 
-    if (!ItemToRemove.IsValid()) return false;
+    // Runs esvaziadas por remoções fora de ordem (ou por erro de leitura) saem antes de comparar as cabeças.
+    SpillRuns.RemoveAll([](const TUniquePtr<FIQT_SpillRun>& Run) { return Run->IsExhausted(); });
 
-    UIQT_DynAINode* Current = pHead->pNextNode;
-    while (Current != pTail)
+    while (SpillRuns.Num() > 0)
     {
-        if (Current->AgentData.IsValid() && (*Current->AgentData) == (*ItemToRemove))
+        int32 BestRun = 0;
+        for (int32 RunIndex = 1; RunIndex < SpillRuns.Num(); ++RunIndex)
         {
-            RemoveNode(Current);
-            iQueueSize--;
+            const FIQT_SpillRun& Candidate = *SpillRuns[RunIndex];
+            const FIQT_SpillRun& Best = *SpillRuns[BestRun];
+            if (HotLess(FIQT_HotRecord{ Candidate.GetHeadSortKey(), Candidate.GetHead().Sequence }, FIQT_HotRecord{ Best.GetHeadSortKey(), Best.GetHead().Sequence }))
+            {
+                BestRun = RunIndex;
+            }
+        }
 
-            // REMOVIDO: Não há mais VerificationList para atualizar.
-            // VerificationList.RemoveAll([&](const FIQT_QueueItem& Item) {
-            //     return Item == *ItemToRemove;
-            // });
+        FIQT_SpillRun& Run = *SpillRuns[BestRun];
+        if (Heap.Num() > 0 && !HotLess(FIQT_HotRecord{ Run.GetHeadSortKey(), Run.GetHead().Sequence }, Heap[0]))
+        {
+            break;
+        }
 
-            return true;
+        // Lote sequencial: amortiza a busca pela melhor run e mantém a leitura do arquivo contínua.
+        // As contagens são descontadas pela diferença: cobre também os itens perdidos num erro de leitura.
+        const int32 NumBefore = Run.GetNumRemaining();
+        const int32 NumOpenBefore = Run.GetNumOpenRemaining();
+        for (int32 Loaded = 0; Loaded < SpillRefillBatch && !Run.IsExhausted(); ++Loaded)
+        {
+            FIQT_QueueItem Item;
+            FIQT_SpillRecordHeader Header;
+            if (!Run.ReadNext(Item, Header))
+            {
+                break;
+            }
+            RestoreLocked(MoveTemp(Item), Header.Sequence);
         }
-        Current = Current->pNextNode;
+        NumSpilled -= NumBefore - Run.GetNumRemaining();
+        NumSpilledOpen -= NumOpenBefore - Run.GetNumOpenRemaining();
+
+        if (Run.IsExhausted())
+        {
+            SpillRuns.RemoveAt(BestRun, EAllowShrinking::No);
+        }
+    }
+}
+
+bool UIQT_PriorityQueueInternal::EvictForLocked(int32 NewSortKey, TOptional<FIQT_QueueItem>* OutEvicted)
+{
+    // Empates não removem: o item novo só entra se for estritamente mais prioritário que o pior.
+    if (!IsTrackingWorst() || WorstHeap.Num() == 0 || NewSortKey >= WorstHeap[0].SortKey)
+    {
+        return false;
     }
-    return false; 
+    const uint32 WorstSlot = WorstHeap[0].Slot;
+    UE_LOG(LogIQTInternal, Verbose, TEXT("UIQT_PriorityQueueInternal: Fila cheia (%d). Item '%s' removido para dar lugar a um item mais prioritário."),
+        iQueueMaxSize, *Slots[WorstSlot].Item.Name.ToString());
+    FIQT_QueueItem* EvictedItem = OutEvicted ? &OutEvicted->Emplace() : nullptr;
+    RemoveAtHeapIndex(SlotHeapIndex[WorstSlot], EvictedItem);
+    NumEvicted.fetch_add(1, std::memory_order_relaxed);
+    return true;
 }
 
-void UIQT_PriorityQueueInternal::RemoveNode(UIQT_DynAINode* InNode)
+bool UIQT_PriorityQueueInternal::Dequeue(FIQT_QueueItem& OutData)
 {
-    if (!InNode || InNode == pHead || InNode == pTail)
+    FPublishingWriteScope WriteScope(*this);
+    if (Heap.Num() == 0)
     {
-        return; 
+        return false;
     }
+    RemoveAtHeapIndex(0, &OutData);
+    return true;
+}
 
-    InNode->pPriorNode->pNextNode = InNode->pNextNode;
-    InNode->pNextNode->pPriorNode = InNode->pPriorNode;
+bool UIQT_PriorityQueueInternal::DequeueMatching(const FGameplayTagQuery& Query, FIQT_QueueItem& OutData)
+{
+    FPublishingWriteScope WriteScope(*this);
+    const int32 Slot = FindFirstMatchingSlot(Query);
+    if (Slot == INDEX_NONE)
+    {
+        return false;
+    }
+    RemoveAtHeapIndex(SlotHeapIndex[Slot], &OutData);
+    return true;
+}
 
-    delete InNode;
+bool UIQT_PriorityQueueInternal::PeekMatching(const FGameplayTagQuery& Query, FIQT_QueueItem& OutData) const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    const int32 Slot = FindFirstMatchingSlot(Query);
+    if (Slot == INDEX_NONE)
+    {
+        return false;
+    }
+    OutData = Slots[Slot].Item;
+    return true;
 }
 
-bool UIQT_PriorityQueueInternal::ValidateData(const FIQT_QueueItem& InData) const
+bool UIQT_PriorityQueueInternal::PeekTop(TFunctionRef<void(const FIQT_QueueItem&)> Visitor) const
 {
-    if (InData.Name.IsNone()) return false;
-    if (!InData.AbilityTriggerTag.IsValid()) return false;
-    
+    FReadScopeLock ReadLock(QueueLock);
+    if (Heap.Num() == 0)
+    {
+        return false;
+    }
+    Visitor(Slots[Heap[0].Slot].Item);
     return true;
 }
 
-TSharedPtr<FIQT_QueueItem> UIQT_PriorityQueueInternal::FindByTaskID(const FGuid& TaskID)
+int32 UIQT_PriorityQueueInternal::ForEachTopK(int32 K, TFunctionRef<void(const FIQT_QueueItem&)> Visitor) const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    const int32 Count = FMath::Min(K, Heap.Num());
+    if (Count <= 0)
+    {
+        return 0;
+    }
+    ForEachTopKIndexLocked(Count, [this, &Visitor](int32 HeapIndex) { Visitor(Slots[Heap[HeapIndex].Slot].Item); });
+    return Count;
+}
+
+void UIQT_PriorityQueueInternal::ForEachTopKIndexLocked(int32 Count, TFunctionRef<void(int32)> Visitor) const
 {
-    FScopeLock Lock(&Mutex); 
-    UIQT_DynAINode* Current = pHead->pNextNode;
-    while (Current != pTail)
+    // Fronteira de índices do heap: o próximo item na ordem de saída é sempre filho de um já visitado,
+    // então basta expandir os filhos do último escolhido (no máximo K + 1 candidatos abertos).
+    const auto FrontierLess = [this](int32 A, int32 B) { return HotLess(Heap[A], Heap[B]); };
+    TArray<int32, TInlineAllocator<64>> Frontier;
+    Frontier.Reserve(Count + 1);
+    Frontier.HeapPush(0, FrontierLess);
+    for (int32 Visited = 0; Visited < Count; ++Visited)
     {
-        if (Current->AgentData.IsValid() && Current->AgentData->TaskID == TaskID)
+        int32 HeapIndex;
+        Frontier.HeapPop(HeapIndex, FrontierLess, EAllowShrinking::No);
+        Visitor(HeapIndex);
+
+        const int32 Child = HeapIndex * 2 + 1;
+        if (Child < Heap.Num())
         {
-            return Current->AgentData;
+            Frontier.HeapPush(Child, FrontierLess);
+        }
+        if (Child + 1 < Heap.Num())
+        {
+            Frontier.HeapPush(Child + 1, FrontierLess);
         }
-        Current = Current->pNextNode;
     }
-    return nullptr;
 }
 
-TSharedPtr<FIQT_QueueItem> UIQT_PriorityQueueInternal::FindByHashKey(FName InName, FGameplayTag InTag, bool bInIsOpen)
+void UIQT_PriorityQueueInternal::ForEachItem(TFunctionRef<bool(const FIQT_QueueItem&)> Visitor) const
 {
-    FScopeLock Lock(&Mutex); 
-    UIQT_DynAINode* Current = pHead->pNextNode;
-    while (Current != pTail)
+    FReadScopeLock ReadLock(QueueLock);
+    for (const FIQT_HotRecord& Record : Heap)
     {
-        if (Current->AgentData.IsValid() && 
-            Current->AgentData->Name == InName &&
-            Current->AgentData->AbilityTriggerTag.MatchesTagExact(InTag) &&
-            Current->AgentData->bIsOpen == bInIsOpen)
+        if (!Visitor(Slots[Record.Slot].Item))
         {
-            return Current->AgentData;
+            break;
         }
-        Current = Current->pNextNode;
     }
-    return nullptr;
 }
 
-void UIQT_PriorityQueueInternal::SetMaxSize(int32 NewSize)
+void UIQT_PriorityQueueInternal::ResolveQueryBuckets(const FGameplayTagQuery& Query, FQueryBucketList& OutBuckets) const
 {
-    FScopeLock Lock(&Mutex); 
-    if (NewSize > 0)
+    FScopeLock CacheLock(&QueryCacheMutex);
+    for (FQueryBuckets& Entry : QueryCache)
+    {
+        if (Entry.Query == Query)
+        {
+            if (Entry.BucketsVersion != BucketsVersion)
+            {
+                break;
+            }
+            OutBuckets = Entry.Buckets;
+            return;
+        }
+    }
+
+    // Reaproveita a entrada da mesma consulta (desatualizada) ou a próxima da substituição circular.
+    FQueryBuckets* Entry = QueryCache.FindByPredicate([&Query](const FQueryBuckets& Candidate) { return Candidate.Query == Query; });
+    if (!Entry)
+    {
+        if (QueryCache.Num() < MaxCachedQueries)
+        {
+            Entry = &QueryCache.AddDefaulted_GetRef();
+        }
+        else
+        {
+            Entry = &QueryCache[NextQueryCacheEntry];
+            NextQueryCacheEntry = (NextQueryCacheEntry + 1) % MaxCachedQueries;
+        }
+        Entry->Query = Query;
+    }
+
+    // A consulta é avaliada uma vez por tag: FGameplayTagContainer::HasTag já considera as tags pai.
+    Entry->Buckets.Reset();
+    for (int32 BucketIndex = 0; BucketIndex < TagBuckets.Num(); ++BucketIndex)
     {
-        iQueueMaxSize = NewSize;
+        const FTagBucket& Bucket = TagBuckets[BucketIndex];
+        if (Bucket.bSharedTags || Query.Matches(FGameplayTagContainer(Bucket.Tag)))
+        {
+            Entry->Buckets.Add(static_cast<uint16>(BucketIndex));
+        }
     }
+    Entry->BucketsVersion = BucketsVersion;
+    OutBuckets = Entry->Buckets;
 }
 
-int32 UIQT_PriorityQueueInternal::GetMaxSize() const
+int32 UIQT_PriorityQueueInternal::FindFirstMatchingSlot(const FGameplayTagQuery& Query) const
 {
-    FScopeLock Lock(&Mutex); 
-    return iQueueMaxSize;
+    if (Heap.Num() == 0 || Query.IsEmpty())
+    {
+        return INDEX_NONE;
+    }
+
+    FQueryBucketList MatchingBuckets;
+    ResolveQueryBuckets(Query, MatchingBuckets);
+
+    const FIQT_HotRecord* Best = nullptr;
+    for (const uint16 BucketIndex : MatchingBuckets)
+    {
+        const FTagBucket& Bucket = TagBuckets[BucketIndex];
+        if (Bucket.Heap.Num() == 0)
+        {
+            continue;
+        }
+        if (!Bucket.bSharedTags)
+        {
+            if (!Best || HotLess(Bucket.Heap[0], *Best))
+            {
+                Best = &Bucket.Heap[0];
+            }
+            continue;
+        }
+        // Bucket de estouro: só existe com mais de 65535 tags distintas; percorre seus itens.
+        for (const FIQT_HotRecord& Record : Bucket.Heap)
+        {
+            if ((!Best || HotLess(Record, *Best)) && Query.Matches(FGameplayTagContainer(Slots[Record.Slot].Item.AbilityTriggerTag)))
+            {
+                Best = &Record;
+            }
+        }
+    }
+    return Best ? static_cast<int32>(Best->Slot) : INDEX_NONE;
 }
 
-int32 UIQT_PriorityQueueInternal::GetCount() const
+uint16 UIQT_PriorityQueueInternal::GetOrAddTagIndex(FGameplayTag Tag)
 {
-    FScopeLock Lock(&Mutex); 
-    return iQueueSize;
+    if (const uint16* Found = TagToIndex.Find(Tag))
+    {
+        return *Found;
+    }
+    // Tags além do limite compartilham o último índice e o mesmo bucket (filtrado item a item).
+    const uint16 NewIndex = static_cast<uint16>(FMath::Min(TagToIndex.Num(), int32(MAX_uint16)));
+    TagToIndex.Add(Tag, NewIndex);
+    if (NewIndex == TagBuckets.Num())
+    {
+        TagBuckets.AddDefaulted_GetRef().Tag = Tag;
+    }
+    else
+    {
+        TagBuckets[NewIndex].bSharedTags = true;
+    }
+    ++BucketsVersion;
+    return NewIndex;
 }
 
-int32 UIQT_PriorityQueueInternal::GetNumOpen() const
+void UIQT_PriorityQueueInternal::PlaceRecord(int32 HeapIndex, const FIQT_HotRecord& Record)
+{
+    Heap[HeapIndex] = Record;
+    SlotHeapIndex[Record.Slot] = HeapIndex;
+}
+
+template <typename LessType, typename PlaceType>
+void UIQT_PriorityQueueInternal::HeapSiftUp(TArray<FIQT_HotRecord>& InHeap, int32 HeapIndex, LessType&& Less, PlaceType&& Place)
 {
-    FScopeLock Lock(&Mutex); 
-    int32 Count = 0;
-    // NOVO: Itera a lista encadeada diretamente para contar itens abertos.
-    UIQT_DynAINode* Current = pHead->pNextNode;
-    while (Current != pTail)
+    const FIQT_HotRecord Record = InHeap[HeapIndex];
+    while (HeapIndex > 0)
     {
-        if (Current->AgentData.IsValid() && Current->AgentData->bIsOpen)
+        const int32 Parent = (HeapIndex - 1) / 2;
+        if (!Less(Record, InHeap[Parent]))
         {
-            Count++;
+            break;
         }
-        Current = Current->pNextNode;
+        Place(HeapIndex, InHeap[Parent]);
+        HeapIndex = Parent;
     }
-    return Count;
+    Place(HeapIndex, Record);
 }
 
-int32 UIQT_PriorityQueueInternal::GetNumClose() const
+template <typename LessType, typename PlaceType>
+void UIQT_PriorityQueueInternal::HeapSiftDown(TArray<FIQT_HotRecord>& InHeap, int32 HeapIndex, LessType&& Less, PlaceType&& Place)
 {
-    FScopeLock Lock(&Mutex); 
-    int32 Count = 0;
-    // NOVO: Itera a lista encadeada diretamente para contar itens fechados.
-    UIQT_DynAINode* Current = pHead->pNextNode;
-    while (Current != pTail)
+    const FIQT_HotRecord Record = InHeap[HeapIndex];
+    const int32 Count = InHeap.Num();
+    while (true)
     {
-        if (Current->AgentData.IsValid() && !Current->AgentData->bIsOpen)
+        int32 Child = HeapIndex * 2 + 1;
+        if (Child >= Count)
+        {
+            break;
+        }
+        if (Child + 1 < Count && Less(InHeap[Child + 1], InHeap[Child]))
+        {
+            Child++;
+        }
+        if (!Less(InHeap[Child], Record))
         {
-            Count++;
+            break;
         }
-        Current = Current->pNextNode;
+        Place(HeapIndex, InHeap[Child]);
+        HeapIndex = Child;
     }
-    return Count;
+    Place(HeapIndex, Record);
 }
 
-bool UIQT_PriorityQueueInternal::IsEmpty() const
+void UIQT_PriorityQueueInternal::SiftUp(int32 HeapIndex)
 {
-    FScopeLock Lock(&Mutex); 
-    return iQueueSize == 0;
+    HeapSiftUp(Heap, HeapIndex, &HotLess, [this](int32 Index, const FIQT_HotRecord& Record) { PlaceRecord(Index, Record); });
 }
 
-// RENOMEADO e MODIFICADO para despejar o conteúdo real da fila, não uma lista de verificação separada.
-void UIQT_PriorityQueueInternal::DumpQueueContents() const
+void UIQT_PriorityQueueInternal::SiftDown(int32 HeapIndex)
 {
-    FScopeLock Lock(&Mutex); 
-    UE_LOG(LogTemp, Warning, TEXT("UIQT_PriorityQueueInternal - Conteúdo Atual da Fila"));
-    UE_LOG(LogTemp, Warning, TEXT("UIQT_PriorityQueueInternal - ============================================================="));
+    HeapSiftDown(Heap, HeapIndex, &HotLess, [this](int32 Index, const FIQT_HotRecord& Record) { PlaceRecord(Index, Record); });
+}
 
-    UIQT_DynAINode* Current = pHead->pNextNode;
-    int32 Index = 0;
-    while (Current != pTail)
+template <typename LessType>
+void UIQT_PriorityQueueInternal::IndexedHeapInsert(TArray<FIQT_HotRecord>& InHeap, TArray<int32>& SlotIndex, const FIQT_HotRecord& Record, LessType&& Less)
+{
+    const int32 Index = InHeap.Add(Record);
+    SlotIndex[Record.Slot] = Index;
+    HeapSiftUp(InHeap, Index, Less, [&InHeap, &SlotIndex](int32 PlaceIndex, const FIQT_HotRecord& Placed)
     {
-        if (Current->AgentData.IsValid() && ValidateData(*Current->AgentData))
-        {
-            UE_LOG(LogTemp, Warning, TEXT("UIQT_PriorityQueueInternal - Item %d: Name=%s | Tag=%s | IsOpen=%s | Priority=%d | TaskID=%s"),
-                Index, *Current->AgentData->Name.ToString(), *Current->AgentData->AbilityTriggerTag.ToString(), 
-                Current->AgentData->bIsOpen ? TEXT("true") : TEXT("false"), Current->AgentData->Priority, 
-                *Current->AgentData->TaskID.ToString());
-        }
-        else
-        {
-            UE_LOG(LogTemp, Warning, TEXT("UIQT_PriorityQueueInternal - Item %d: Dados inválidos no nó."), Index);
-        }
-        Current = Current->pNextNode;
-        Index++;
+        InHeap[PlaceIndex] = Placed;
+        SlotIndex[Placed.Slot] = PlaceIndex;
+    });
+}
+
+template <typename LessType>
+void UIQT_PriorityQueueInternal::IndexedHeapRemove(TArray<FIQT_HotRecord>& InHeap, TArray<int32>& SlotIndex, uint32 Slot, LessType&& Less)
+{
+    const int32 Index = SlotIndex[Slot];
+    SlotIndex[Slot] = INDEX_NONE;
+
+    const FIQT_HotRecord Last = InHeap.Pop(EAllowShrinking::No);
+    if (Index < InHeap.Num())
+    {
+        SlotIndex[Last.Slot] = Index;
+        IndexedHeapUpdate(InHeap, SlotIndex, Last, Less);
     }
-    UE_LOG(LogTemp, Warning, TEXT("UIQT_PriorityQueueInternal - ============================================================="));
 }
 
-bool UIQT_PriorityQueueInternal::ValidateList() const
+template <typename LessType>
+void UIQT_PriorityQueueInternal::IndexedHeapUpdate(TArray<FIQT_HotRecord>& InHeap, TArray<int32>& SlotIndex, const FIQT_HotRecord& Record, LessType&& Less)
 {
-    FScopeLock Lock(&Mutex); 
-    UIQT_DynAINode* Current = pHead;
-    int32 Count = 0;
-    while (Current != nullptr)
+    auto Place = [&InHeap, &SlotIndex](int32 PlaceIndex, const FIQT_HotRecord& Placed)
     {
-        if (Current->pNextNode == nullptr && Current != pTail)
-        {
-            UE_LOG(LogTemp, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação da lista: Nó '%p' sem pNextNode antes do pTail."), Current);
-            return false;
-        }
-        if (Current->pNextNode && Current->pNextNode->pPriorNode != Current)
+        InHeap[PlaceIndex] = Placed;
+        SlotIndex[Placed.Slot] = PlaceIndex;
+    };
+    const int32 Index = SlotIndex[Record.Slot];
+    InHeap[Index] = Record;
+    HeapSiftDown(InHeap, Index, Less, Place);
+    HeapSiftUp(InHeap, SlotIndex[Record.Slot], Less, Place);
+}
+
+template <typename LessType>
+void UIQT_PriorityQueueInternal::IndexedHeapify(TArray<FIQT_HotRecord>& InHeap, TArray<int32>& SlotIndex, LessType&& Less)
+{
+    auto Place = [&InHeap, &SlotIndex](int32 PlaceIndex, const FIQT_HotRecord& Placed)
+    {
+        InHeap[PlaceIndex] = Placed;
+        SlotIndex[Placed.Slot] = PlaceIndex;
+    };
+    for (int32 Index = 0; Index < InHeap.Num(); ++Index)
+    {
+        SlotIndex[InHeap[Index].Slot] = Index;
+    }
+    // Heapify de baixo para cima: O(n), contra O(n log n) de reinserir tudo.
+    for (int32 Index = InHeap.Num() / 2 - 1; Index >= 0; --Index)
+    {
+        HeapSiftDown(InHeap, Index, Less, Place);
+    }
+}
+
+void UIQT_PriorityQueueInternal::SecondaryInsert(const FIQT_HotRecord& Record)
+{
+    IndexedHeapInsert(TagBuckets[Record.TagIndex].Heap, SlotBucketIndex, Record, &HotLess);
+    if (IsTrackingWorst())
+    {
+        IndexedHeapInsert(WorstHeap, SlotWorstIndex, Record, &WorstLess);
+    }
+    if (Record.Flags & HotFlag_Transferable)
+    {
+        IndexedHeapInsert(TransferHeap, SlotTransferIndex, Record, &WorstLess);
+    }
+    if (IsTrackingUtility())
+    {
+        UtilityInsert(Record.Slot);
+    }
+}
+
+void UIQT_PriorityQueueInternal::SecondaryRemove(const FIQT_HotRecord& Record)
+{
+    IndexedHeapRemove(TagBuckets[Record.TagIndex].Heap, SlotBucketIndex, Record.Slot, &HotLess);
+    if (IsTrackingWorst())
+    {
+        IndexedHeapRemove(WorstHeap, SlotWorstIndex, Record.Slot, &WorstLess);
+    }
+    // Pelo índice, e não pela flag: em UpdateItem o registro pode chegar já com a flag nova.
+    if (SlotTransferIndex[Record.Slot] != INDEX_NONE)
+    {
+        IndexedHeapRemove(TransferHeap, SlotTransferIndex, Record.Slot, &WorstLess);
+    }
+    if (SlotUtilityIndex[Record.Slot] != INDEX_NONE)
+    {
+        UtilityRemove(Record.Slot);
+    }
+}
+
+void UIQT_PriorityQueueInternal::SecondaryUpdate(const FIQT_HotRecord& Record)
+{
+    IndexedHeapUpdate(TagBuckets[Record.TagIndex].Heap, SlotBucketIndex, Record, &HotLess);
+    if (IsTrackingWorst())
+    {
+        IndexedHeapUpdate(WorstHeap, SlotWorstIndex, Record, &WorstLess);
+    }
+    // bTransferable pode ter mudado (UpdateItem): entra, sai ou é reposicionado no heap de transferíveis.
+    const bool bTransferable = (Record.Flags & HotFlag_Transferable) != 0;
+    if (SlotTransferIndex[Record.Slot] != INDEX_NONE)
+    {
+        if (bTransferable)
         {
-            UE_LOG(LogTemp, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação da lista: Inconsistência de ponteiro duplo. Current->pNextNode->pPriorNode != Current."));
-            return false;
+            IndexedHeapUpdate(TransferHeap, SlotTransferIndex, Record, &WorstLess);
         }
-        if (Current != pHead && Current != pTail)
+        else
         {
-            Count++; 
+            IndexedHeapRemove(TransferHeap, SlotTransferIndex, Record.Slot, &WorstLess);
         }
-        Current = Current->pNextNode;
     }
-    if (Count != iQueueSize)
+    else if (bTransferable)
     {
-        UE_LOG(LogTemp, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação da lista: Contagem de nós difere do iQueueSize. Contado: %d, Esperado: %d"), Count, iQueueSize);
-        return false;
+        IndexedHeapInsert(TransferHeap, SlotTransferIndex, Record, &WorstLess);
     }
-    return true;
-}
\ No newline at end of file
+    // As características podem ter mudado junto com o resto do item (UpdateItem).
+    if (SlotUtilityIndex[Record.Slot] != INDEX_NONE)
+    {
+        WriteUtilityFeatures(SlotUtilityIndex[Record.Slot], Slots[Record.Slot].Item);
+    }
+}
+
+void UIQT_PriorityQueueInternal::RebuildWorstHeapLocked()
+{
+    for (const FIQT_HotRecord& Record : WorstHeap)
+    {
+        SlotWorstIndex[Record.Slot] = INDEX_NONE;
+    }
+    WorstHeap.Reset();
+    if (IsTrackingWorst())
+    {
+        WorstHeap = Heap;
+        IndexedHeapify(WorstHeap, SlotWorstIndex, &WorstLess);
+    }
+}
+
+void UIQT_PriorityQueueInternal::UtilityInsert(uint32 Slot)
+{
+    const int32 UtilityIndex = UtilitySlots.Add(Slot);
+    for (int32 Feature = 0; Feature < NumUtilityWeights; ++Feature)
+    {
+        UtilityColumns[Feature].AddUninitialized();
+    }
+    WriteUtilityFeatures(UtilityIndex, Slots[Slot].Item);
+    SlotUtilityIndex[Slot] = UtilityIndex;
+}
+
+void UIQT_PriorityQueueInternal::UtilityRemove(uint32 Slot)
+{
+    // Troca com o último: as colunas continuam densas, sem buracos para o kernel pular.
+    const int32 UtilityIndex = SlotUtilityIndex[Slot];
+    const int32 LastIndex = UtilitySlots.Num() - 1;
+    if (UtilityIndex != LastIndex)
+    {
+        const uint32 MovedSlot = UtilitySlots[LastIndex];
+        UtilitySlots[UtilityIndex] = MovedSlot;
+        SlotUtilityIndex[MovedSlot] = UtilityIndex;
+        for (int32 Feature = 0; Feature < NumUtilityWeights; ++Feature)
+        {
+            UtilityColumns[Feature][UtilityIndex] = UtilityColumns[Feature][LastIndex];
+        }
+    }
+    UtilitySlots.Pop(EAllowShrinking::No);
+    for (int32 Feature = 0; Feature < NumUtilityWeights; ++Feature)
+    {
+        UtilityColumns[Feature].Pop(EAllowShrinking::No);
+    }
+    SlotUtilityIndex[Slot] = INDEX_NONE;
+}
+
+void UIQT_PriorityQueueInternal::WriteUtilityFeatures(int32 UtilityIndex, const FIQT_QueueItem& Item)
+{
+    // Características ausentes valem 0.
+    for (int32 Feature = 0; Feature < NumUtilityWeights; ++Feature)
+    {
+        UtilityColumns[Feature][UtilityIndex] = Item.UtilityFeatures.IsValidIndex(Feature) ? Item.UtilityFeatures[Feature] : 0.0f;
+    }
+}
+
+void UIQT_PriorityQueueInternal::RebuildUtilityColumnsLocked()
+{
+    for (const uint32 Slot : UtilitySlots)
+    {
+        SlotUtilityIndex[Slot] = INDEX_NONE;
+    }
+    UtilitySlots.Reset();
+    for (int32 Feature = 0; Feature < FIQT_QueueItem::MaxUtilityFeatures; ++Feature)
+    {
+        UtilityColumns[Feature].Reset(Feature < NumUtilityWeights ? Heap.Num() : 0);
+    }
+    if (IsTrackingUtility())
+    {
+        for (const FIQT_HotRecord& Record : Heap)
+        {
+            UtilityInsert(Record.Slot);
+        }
+    }
+}
+
+void UIQT_PriorityQueueInternal::FixHeapAt(int32 HeapIndex)
+{
+    const uint32 Slot = Heap[HeapIndex].Slot;
+    SiftDown(HeapIndex);
+    SiftUp(SlotHeapIndex[Slot]);
+}
+
+void UIQT_PriorityQueueInternal::RemoveAtHeapIndex(int32 HeapIndex, FIQT_QueueItem* OutData)
+{
+    const uint32 Slot = Heap[HeapIndex].Slot;
+    RemoveFromHeapsAt(HeapIndex);
+    ReleaseSlotLocked(Slot, OutData);
+}
+
+void UIQT_PriorityQueueInternal::RemoveFromHeapsAt(int32 HeapIndex)
+{
+    NumOpen -= (Heap[HeapIndex].Flags & HotFlag_Open) ? 1 : 0;
+    SecondaryRemove(Heap[HeapIndex]);
+
+    // O último registro ocupa o lugar do removido e é reposicionado para cima ou para baixo.
+    const FIQT_HotRecord Last = Heap.Pop(EAllowShrinking::No);
+    if (HeapIndex < Heap.Num())
+    {
+        PlaceRecord(HeapIndex, Last);
+        FixHeapAt(HeapIndex);
+    }
+}
+
+void UIQT_PriorityQueueInternal::ReleaseSlotLocked(uint32 Slot, FIQT_QueueItem* OutData)
+{
+    FIQT_QueueItem& Item = Slots[Slot].Item;
+    KeyIndex.RemoveSingle(FItemKey(Item), Slot);
+    if (Item.TaskID.IsValid())
+    {
+        TaskIDIndex.RemoveSingle(Item.TaskID, Slot);
+    }
+    if (Item.Handle.GetSlot() != Slot)
+    {
+        RelocatedHandles.Remove(Item.Handle);
+    }
+
+    // O slot livre mantém o item movido até ser reutilizado (sem reconstruir um FIQT_QueueItem aqui).
+    if (OutData)
+    {
+        *OutData = MoveTemp(Item);
+    }
+    SlotHeapIndex[Slot] = INDEX_NONE;
+    FreeSlots.Add(Slot);
+}
+
+FIQT_HotRecord UIQT_PriorityQueueInternal::GetSpilledOrder(const FSpilledRecord& Record)
+{
+    FIQT_HotRecord Order = {};
+    Order.SortKey = Record.Run->ShiftSortKey(Record.Header.SortKey);
+    Order.Sequence = Record.Header.Sequence;
+    return Order;
+}
+
+FIQT_SpillRun* UIQT_PriorityQueueInternal::FindSpillRun(uint32 RunId) const
+{
+    for (const TUniquePtr<FIQT_SpillRun>& Run : SpillRuns)
+    {
+        if (Run->GetId() == RunId)
+        {
+            return Run.Get();
+        }
+    }
+    return nullptr;
+}
+
+bool UIQT_PriorityQueueInternal::FindFirstSpilledLocked(TFunctionRef<bool(const FIQT_SpillRun&)> RunFilter, TFunctionRef<bool(const FIQT_SpillRecordHeader&)> HeaderFilter,
+    TFunctionRef<bool(const FIQT_QueueItem&)> ItemFilter, FSpilledRecord& OutRecord, FIQT_QueueItem& OutItem) const
+{
+    bool bFound = false;
+    for (const TUniquePtr<FIQT_SpillRun>& Run : SpillRuns)
+    {
+        if (!RunFilter(*Run))
+        {
+            continue;
+        }
+        // A run está em ordem de saída: o primeiro registro aceito é o melhor dela.
+        Run->ForEachRecord(0, HeaderFilter, [&Run, &ItemFilter, &bFound, &OutRecord, &OutItem](int64 RecordOffset, const FIQT_SpillRecordHeader& Header, FIQT_QueueItem& Item)
+        {
+            if (!ItemFilter(Item))
+            {
+                return true;
+            }
+            const FSpilledRecord Candidate{ Run.Get(), RecordOffset, Header };
+            if (!bFound || HotLess(GetSpilledOrder(Candidate), GetSpilledOrder(OutRecord)))
+            {
+                bFound = true;
+                OutRecord = Candidate;
+                OutItem = MoveTemp(Item);
+            }
+            return false;
+        });
+    }
+    return bFound;
+}
+
+bool UIQT_PriorityQueueInternal::FindSpilledHandleLocked(FIQT_ItemHandle Handle, FSpilledRecord& OutRecord, FIQT_QueueItem& OutItem) const
+{
+    if (!Handle.IsValid() || NumSpilled == 0)
+    {
+        return false;
+    }
+    return FindFirstSpilledLocked(
+        [Handle](const FIQT_SpillRun& Run) { return Run.MayContainHandle(Handle); },
+        [Handle](const FIQT_SpillRecordHeader& Header) { return Header.Slot == Handle.GetSlot() && Header.Generation == Handle.GetGeneration(); },
+        [](const FIQT_QueueItem&) { return true; },
+        OutRecord, OutItem);
+}
+
+bool UIQT_PriorityQueueInternal::FindFirstSpilledKeyLocked(const FItemKey& Key, FSpilledRecord& OutRecord, FIQT_QueueItem& OutItem) const
+{
+    if (NumSpilled == 0)
+    {
+        return false;
+    }
+    const uint32 KeyHash = GetTypeHash(Key);
+    return FindFirstSpilledLocked(
+        [KeyHash](const FIQT_SpillRun& Run) { return Run.MayContainKey(KeyHash); },
+        [KeyHash](const FIQT_SpillRecordHeader& Header) { return Header.KeyHash == KeyHash; },
+        [&Key](const FIQT_QueueItem& Item) { return FItemKey(Item) == Key; },
+        OutRecord, OutItem);
+}
+
+void UIQT_PriorityQueueInternal::RemoveSpilledLocked(const FSpilledRecord& Record, const FIQT_QueueItem& Item)
+{
+    // Pela diferença, como em RefillFromSpillLocked: um erro ao avançar a cabeça também perde os itens seguintes.
+    FIQT_SpillRun& Run = *Record.Run;
+    const int32 NumBefore = Run.GetNumRemaining();
+    const int32 NumOpenBefore = Run.GetNumOpenRemaining();
+    Run.Remove(Record.RecordOffset, Item);
+    NumSpilled -= NumBefore - Run.GetNumRemaining();
+    NumSpilledOpen -= NumOpenBefore - Run.GetNumOpenRemaining();
+}
+
+uint32 UIQT_PriorityQueueInternal::LoadSpilledLocked(const FSpilledRecord& Record, FIQT_QueueItem&& Item)
+{
+    RemoveSpilledLocked(Record, Item);
+    return RestoreLocked(MoveTemp(Item), Record.Header.Sequence);
+}
+
+int32 UIQT_PriorityQueueInternal::ResolveOrLoadHandleLocked(FIQT_ItemHandle Handle)
+{
+    const int32 Slot = ResolveHandle(Handle);
+    if (Slot != INDEX_NONE)
+    {
+        return Slot;
+    }
+    FSpilledRecord Record;
+    FIQT_QueueItem Item;
+    if (!FindSpilledHandleLocked(Handle, Record, Item))
+    {
+        return INDEX_NONE;
+    }
+    return static_cast<int32>(LoadSpilledLocked(Record, MoveTemp(Item)));
+}
+
+void UIQT_PriorityQueueInternal::ForEachSpilledItemLocked(TFunctionRef<void(const FSpilledRecord& Record, FIQT_QueueItem& Item)> Visitor) const
+{
+    for (const TUniquePtr<FIQT_SpillRun>& Run : SpillRuns)
+    {
+        Run->ForEachRecord(0, [](const FIQT_SpillRecordHeader&) { return true; },
+            [&Run, &Visitor](int64 RecordOffset, const FIQT_SpillRecordHeader& Header, FIQT_QueueItem& Item)
+            {
+                Visitor(FSpilledRecord{ Run.Get(), RecordOffset, Header }, Item);
+                return true;
+            });
+    }
+}
+
+template <typename KeyType>
+int32 UIQT_PriorityQueueInternal::FindFirstSlot(const TMultiMap<KeyType, uint32>& Index, const KeyType& Key) const
+{
+    int32 BestSlot = INDEX_NONE;
+    for (typename TMultiMap<KeyType, uint32>::TConstKeyIterator It(Index, Key); It; ++It)
+    {
+        const uint32 Slot = It.Value();
+        if (BestSlot == INDEX_NONE || HotLess(Heap[SlotHeapIndex[Slot]], Heap[SlotHeapIndex[BestSlot]]))
+        {
+            BestSlot = static_cast<int32>(Slot);
+        }
+    }
+    return BestSlot;
+}
+
+bool UIQT_PriorityQueueInternal::Contains(const FIQT_QueueItem& InData) const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    const FItemKey Key(InData);
+    if (KeyIndex.Contains(Key))
+    {
+        return true;
+    }
+    FSpilledRecord Record;
+    FIQT_QueueItem Item;
+    return FindFirstSpilledKeyLocked(Key, Record, Item);
+}
+
+bool UIQT_PriorityQueueInternal::RemoveItem(const FIQT_QueueItem& ItemToRemove)
+{
+    FPublishingWriteScope WriteScope(*this);
+    const FItemKey Key(ItemToRemove);
+    const int32 Slot = FindFirstSlot(KeyIndex, Key);
+    FSpilledRecord Record;
+    FIQT_QueueItem Item;
+    if (FindFirstSpilledKeyLocked(Key, Record, Item) && (Slot == INDEX_NONE || HotLess(GetSpilledOrder(Record), Heap[SlotHeapIndex[Slot]])))
+    {
+        RemoveSpilledLocked(Record, Item);
+        return true;
+    }
+    if (Slot == INDEX_NONE)
+    {
+        return false;
+    }
+    RemoveAtHeapIndex(SlotHeapIndex[Slot], nullptr);
+    return true;
+}
+
+bool UIQT_PriorityQueueInternal::ValidateData(const FIQT_QueueItem& InData)
+{
+    if (InData.Name.IsNone()) return false;
+    if (!InData.AbilityTriggerTag.IsValid()) return false;
+
+    return true;
+}
+
+bool UIQT_PriorityQueueInternal::FindByTaskID(const FGuid& TaskID, FIQT_QueueItem& OutData) const
+{
+    if (!TaskID.IsValid())
+    {
+        return false;
+    }
+    FReadScopeLock ReadLock(QueueLock);
+    const int32 Slot = FindFirstSlot(TaskIDIndex, TaskID);
+    FSpilledRecord Record;
+    FIQT_QueueItem Item;
+    const uint32 TaskIDHash = FIQT_SpillRun::HashTaskID(TaskID);
+    if (NumSpilled > 0 && FindFirstSpilledLocked(
+            [TaskIDHash](const FIQT_SpillRun& Run) { return Run.MayContainTaskID(TaskIDHash); },
+            [TaskIDHash](const FIQT_SpillRecordHeader& Header) { return Header.TaskIDHash == TaskIDHash; },
+            [&TaskID](const FIQT_QueueItem& Candidate) { return Candidate.TaskID == TaskID; },
+            Record, Item)
+        && (Slot == INDEX_NONE || HotLess(GetSpilledOrder(Record), Heap[SlotHeapIndex[Slot]])))
+    {
+        OutData = MoveTemp(Item);
+        return true;
+    }
+    if (Slot == INDEX_NONE)
+    {
+        return false;
+    }
+    OutData = Slots[Slot].Item;
+    return true;
+}
+
+bool UIQT_PriorityQueueInternal::FindByHashKey(FName InName, FGameplayTag InTag, bool bInIsOpen, FIQT_QueueItem& OutData) const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    const FItemKey Key(InName, InTag, bInIsOpen);
+    const int32 Slot = FindFirstSlot(KeyIndex, Key);
+    FSpilledRecord Record;
+    FIQT_QueueItem Item;
+    if (FindFirstSpilledKeyLocked(Key, Record, Item) && (Slot == INDEX_NONE || HotLess(GetSpilledOrder(Record), Heap[SlotHeapIndex[Slot]])))
+    {
+        OutData = MoveTemp(Item);
+        return true;
+    }
+    if (Slot == INDEX_NONE)
+    {
+        return false;
+    }
+    OutData = Slots[Slot].Item;
+    return true;
+}
+
+int32 UIQT_PriorityQueueInternal::ResolveHandle(FIQT_ItemHandle Handle) const
+{
+    const uint32 Slot = Handle.GetSlot();
+    if (!Handle.IsValid())
+    {
+        return INDEX_NONE;
+    }
+    if (Slots.IsValidIndex(Slot) && SlotHeapIndex[Slot] != INDEX_NONE && Slots[Slot].Item.Handle == Handle)
+    {
+        return static_cast<int32>(Slot);
+    }
+    const uint32* RelocatedSlot = RelocatedHandles.Find(Handle);
+    return RelocatedSlot ? static_cast<int32>(*RelocatedSlot) : INDEX_NONE;
+}
+
+bool UIQT_PriorityQueueInternal::IsHandleValid(FIQT_ItemHandle Handle) const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    FSpilledRecord Record;
+    FIQT_QueueItem Item;
+    return ResolveHandle(Handle) != INDEX_NONE || FindSpilledHandleLocked(Handle, Record, Item);
+}
+
+bool UIQT_PriorityQueueInternal::FindByHandle(FIQT_ItemHandle Handle, FIQT_QueueItem& OutData) const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    const int32 Slot = ResolveHandle(Handle);
+    if (Slot != INDEX_NONE)
+    {
+        OutData = Slots[Slot].Item;
+        return true;
+    }
+    FSpilledRecord Record;
+    return FindSpilledHandleLocked(Handle, Record, OutData);
+}
+
+bool UIQT_PriorityQueueInternal::RemoveByHandle(FIQT_ItemHandle Handle, FIQT_QueueItem* OutData)
+{
+    FPublishingWriteScope WriteScope(*this);
+    const int32 Slot = ResolveHandle(Handle);
+    if (Slot != INDEX_NONE)
+    {
+        RemoveAtHeapIndex(SlotHeapIndex[Slot], OutData);
+        return true;
+    }
+    FSpilledRecord Record;
+    FIQT_QueueItem Item;
+    if (!FindSpilledHandleLocked(Handle, Record, Item))
+    {
+        return false;
+    }
+    RemoveSpilledLocked(Record, Item);
+    if (OutData)
+    {
+        *OutData = MoveTemp(Item);
+    }
+    return true;
+}
+
+bool UIQT_PriorityQueueInternal::UpdatePriority(FIQT_ItemHandle Handle, int32 NewPriority)
+{
+    FPublishingWriteScope WriteScope(*this);
+    const int32 Slot = ResolveOrLoadHandleLocked(Handle);
+    if (Slot == INDEX_NONE)
+    {
+        return false;
+    }
+    const int32 HeapIndex = SlotHeapIndex[Slot];
+    Slots[Slot].Item.Priority = NewPriority;
+    Heap[HeapIndex].SortKey = MakeSortKey(Slots[Slot].Item);
+    SecondaryUpdate(Heap[HeapIndex]);
+    FixHeapAt(HeapIndex);
+    return true;
+}
+
+bool UIQT_PriorityQueueInternal::Update(FIQT_ItemHandle Handle, const FIQT_QueueItem& NewData, bool bKeepPriority, bool bRejectDuplicateKey)
+{
+    if (!ValidateData(NewData))
+    {
+        return false;
+    }
+
+    FPublishingWriteScope WriteScope(*this);
+    const int32 Slot = ResolveOrLoadHandleLocked(Handle);
+    if (Slot == INDEX_NONE)
+    {
+        return false;
+    }
+
+    FIQT_QueueItem& Item = Slots[Slot].Item;
+    const FItemKey OldKey(Item);
+    const FItemKey NewKey(NewData);
+    const bool bKeyChanged = !(OldKey == NewKey);
+    if (bKeyChanged && bRejectDuplicateKey)
+    {
+        FSpilledRecord DuplicateRecord;
+        FIQT_QueueItem Duplicate;
+        if (KeyIndex.Contains(NewKey) || FindFirstSpilledKeyLocked(NewKey, DuplicateRecord, Duplicate))
+        {
+            return false;
+        }
+    }
+
+    const FGuid OldTaskID = Item.TaskID;
+    const int32 OldPriority = Item.Priority;
+    const double EnqueueTimeSeconds = Item.EnqueueTimeSeconds;
+
+    NumOpen += (NewData.bIsOpen ? 1 : 0) - (Item.bIsOpen ? 1 : 0);
+    Item = NewData;
+    Item.Handle = Handle;
+    Item.bIsEnqueued = true;
+    Item.EnqueueTimeSeconds = EnqueueTimeSeconds;
+    if (!Item.TaskID.IsValid())
+    {
+        Item.TaskID = OldTaskID;
+    }
+    if (bKeepPriority)
+    {
+        Item.Priority = OldPriority;
+    }
+
+    if (bKeyChanged)
+    {
+        KeyIndex.RemoveSingle(OldKey, static_cast<uint32>(Slot));
+        KeyIndex.Add(NewKey, static_cast<uint32>(Slot));
+    }
+    if (Item.TaskID != OldTaskID)
+    {
+        if (OldTaskID.IsValid())
+        {
+            TaskIDIndex.RemoveSingle(OldTaskID, static_cast<uint32>(Slot));
+        }
+        TaskIDIndex.Add(Item.TaskID, static_cast<uint32>(Slot));
+    }
+
+    const int32 HeapIndex = SlotHeapIndex[Slot];
+    FIQT_HotRecord& Record = Heap[HeapIndex];
+    const uint16 NewTagIndex = GetOrAddTagIndex(Item.AbilityTriggerTag);
+    if (NewTagIndex != Record.TagIndex)
+    {
+        // A tag mudou: o item troca de bucket.
+        SecondaryRemove(Record);
+        Record.TagIndex = NewTagIndex;
+        Record.SortKey = MakeSortKey(Item);
+        Record.Flags = MakeHotFlags(Item);
+        SecondaryInsert(Record);
+    }
+    else
+    {
+        Record.SortKey = MakeSortKey(Item);
+        Record.Flags = MakeHotFlags(Item);
+        SecondaryUpdate(Record);
+    }
+    FixHeapAt(HeapIndex);
+    return true;
+}
+
+bool UIQT_PriorityQueueInternal::EnsureTaskID(FIQT_ItemHandle Handle, FGuid& OutTaskID)
+{
+    FPublishingWriteScope WriteScope(*this);
+    int32 Slot = ResolveHandle(Handle);
+    if (Slot == INDEX_NONE)
+    {
+        // Em disco: um TaskID já gerado é lido da run; gerar um novo exige o item de volta (a run tem a cópia antiga).
+        FSpilledRecord Record;
+        FIQT_QueueItem Spilled;
+        if (!FindSpilledHandleLocked(Handle, Record, Spilled))
+        {
+            return false;
+        }
+        if (Spilled.TaskID.IsValid())
+        {
+            OutTaskID = Spilled.TaskID;
+            return true;
+        }
+        Slot = static_cast<int32>(LoadSpilledLocked(Record, MoveTemp(Spilled)));
+    }
+    FIQT_QueueItem& Item = Slots[Slot].Item;
+    if (!Item.TaskID.IsValid())
+    {
+        TaskIDIndex.Add(Item.GetTaskID(), static_cast<uint32>(Slot));
+    }
+    OutTaskID = Item.TaskID;
+    return true;
+}
+
+void UIQT_PriorityQueueInternal::SetMaxSize(int32 NewSize)
+{
+    // Publica ao sair: aumentar o limite libera produtores bloqueados.
+    FPublishingWriteScope WriteScope(*this);
+    iQueueMaxSize = NewSize > 0 ? NewSize : MAX_int32;
+}
+
+int32 UIQT_PriorityQueueInternal::GetMaxSize() const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    return iQueueMaxSize;
+}
+
+void UIQT_PriorityQueueInternal::SetOverflowPolicy(EIQT_OverflowPolicy NewPolicy, float NewBlockTimeoutSeconds)
+{
+    FWriteScopeLock WriteLock(QueueLock);
+    BlockTimeoutSeconds = FMath::Max(0.0f, NewBlockTimeoutSeconds);
+    if (NewPolicy != OverflowPolicy)
+    {
+        OverflowPolicy = NewPolicy;
+        RebuildWorstHeapLocked();
+    }
+}
+
+EIQT_OverflowPolicy UIQT_PriorityQueueInternal::GetOverflowPolicy() const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    return OverflowPolicy;
+}
+
+int32 UIQT_PriorityQueueInternal::GetNumEvicted() const
+{
+    return NumEvicted.load(std::memory_order_relaxed);
+}
+
+void UIQT_PriorityQueueInternal::SetSpill(int32 InMemoryThreshold, const FString& Directory)
+{
+    FWriteScopeLock WriteLock(QueueLock);
+    SpillThreshold = FMath::Max(0, InMemoryThreshold);
+    SpillDirectory = Directory.IsEmpty() ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("IQT"), TEXT("Spill")) : Directory;
+    bSpillFailed = false;
+}
+
+int32 UIQT_PriorityQueueInternal::GetNumSpilled() const
+{
+    return PublishedNumSpilled.load(std::memory_order_relaxed);
+}
+
+int32 UIQT_PriorityQueueInternal::StealTransferable(int32 MaxItems, TArray<FIQT_QueueItem>& OutItems)
+{
+    FPublishingWriteScope WriteScope(*this);
+    int32 NumStolen = 0;
+    while (NumStolen < MaxItems && TransferHeap.Num() > 0)
+    {
+        FIQT_QueueItem& Stolen = OutItems.AddDefaulted_GetRef();
+        RemoveAtHeapIndex(SlotHeapIndex[TransferHeap[0].Slot], &Stolen);
+        NumStolen++;
+    }
+    return NumStolen;
+}
+
+int32 UIQT_PriorityQueueInternal::GetNumTransferable() const
+{
+    return PublishedNumTransferable.load(std::memory_order_relaxed);
+}
+
+void UIQT_PriorityQueueInternal::SetUtilityWeights(TConstArrayView<float> Weights)
+{
+    FPublishingWriteScope WriteScope(*this);
+    const int32 NewNumWeights = FMath::Min(Weights.Num(), FIQT_QueueItem::MaxUtilityFeatures);
+    FMemory::Memzero(UtilityWeights);
+    FMemory::Memcpy(UtilityWeights, Weights.GetData(), NewNumWeights * sizeof(float));
+    if (NewNumWeights != NumUtilityWeights)
+    {
+        NumUtilityWeights = NewNumWeights;
+        RebuildUtilityColumnsLocked();
+    }
+}
+
+int32 UIQT_PriorityQueueInternal::FindBestScoredSlotLocked(int32 CandidateWindow) const
+{
+    const float* Columns[FIQT_QueueItem::MaxUtilityFeatures];
+    float BestScore = TNumericLimits<float>::Lowest();
+
+    if (CandidateWindow > 0 && CandidateWindow < Heap.Num())
+    {
+        // Janela: reúne as características dos K primeiros em colunas temporárias e roda o mesmo kernel.
+        TArray<uint32, TInlineAllocator<64>> CandidateSlots;
+        ForEachTopKIndexLocked(CandidateWindow, [this, &CandidateSlots](int32 HeapIndex) { CandidateSlots.Add(Heap[HeapIndex].Slot); });
+        const int32 NumCandidates = CandidateSlots.Num();
+        TArray<float, TInlineAllocator<256>> Gathered;
+        Gathered.SetNumUninitialized(NumUtilityWeights * NumCandidates);
+        for (int32 Feature = 0; Feature < NumUtilityWeights; ++Feature)
+        {
+            float* Column = Gathered.GetData() + Feature * NumCandidates;
+            for (int32 Candidate = 0; Candidate < NumCandidates; ++Candidate)
+            {
+                Column[Candidate] = UtilityColumns[Feature][SlotUtilityIndex[CandidateSlots[Candidate]]];
+            }
+            Columns[Feature] = Column;
+        }
+        const int32 Best = IQTUtilityKernel::ArgMaxWeightedSum(Columns, UtilityWeights, NumUtilityWeights, 0, NumCandidates, BestScore);
+        // Nenhum valor acima de Lowest (ex.: pontuações NaN): fica com o primeiro na ordem de prioridade.
+        return CandidateSlots[Best != INDEX_NONE ? Best : 0];
+    }
+
+    for (int32 Feature = 0; Feature < NumUtilityWeights; ++Feature)
+    {
+        Columns[Feature] = UtilityColumns[Feature].GetData();
+    }
+    int32 Best = INDEX_NONE;
+    for (int32 Begin = 0; Begin < UtilitySlots.Num(); Begin += IQTUtilityKernel::MaxBlockItems)
+    {
+        const int32 End = FMath::Min(UtilitySlots.Num(), Begin + IQTUtilityKernel::MaxBlockItems);
+        const int32 BlockBest = IQTUtilityKernel::ArgMaxWeightedSum(Columns, UtilityWeights, NumUtilityWeights, Begin, End, BestScore);
+        if (BlockBest != INDEX_NONE)
+        {
+            Best = BlockBest;
+        }
+    }
+    return Best != INDEX_NONE ? static_cast<int32>(UtilitySlots[Best]) : static_cast<int32>(Heap[0].Slot);
+}
+
+bool UIQT_PriorityQueueInternal::DequeueBestScored(int32 CandidateWindow, FIQT_QueueItem& OutData)
+{
+    FPublishingWriteScope WriteScope(*this);
+    if (Heap.Num() == 0)
+    {
+        return false;
+    }
+    const int32 HeapIndex = IsTrackingUtility() ? SlotHeapIndex[FindBestScoredSlotLocked(CandidateWindow)] : 0;
+    RemoveAtHeapIndex(HeapIndex, &OutData);
+    return true;
+}
+
+bool UIQT_PriorityQueueInternal::UpdateUtilityFeatures(FIQT_ItemHandle Handle, TConstArrayView<float> Features)
+{
+    FPublishingWriteScope WriteScope(*this);
+    const int32 Slot = ResolveOrLoadHandleLocked(Handle);
+    if (Slot == INDEX_NONE)
+    {
+        return false;
+    }
+    FIQT_QueueItem& Item = Slots[Slot].Item;
+    Item.UtilityFeatures.Reset(Features.Num());
+    Item.UtilityFeatures.Append(Features.GetData(), Features.Num());
+    if (SlotUtilityIndex[Slot] != INDEX_NONE)
+    {
+        WriteUtilityFeatures(SlotUtilityIndex[Slot], Item);
+    }
+    return true;
+}
+
+void UIQT_PriorityQueueInternal::SetAgingRate(float PriorityPerSecond)
+{
+    FPublishingWriteScope WriteScope(*this);
+    const float NewRate = FMath::Max(0.0f, PriorityPerSecond);
+    if (NewRate == AgingRate)
+    {
+        return;
+    }
+    AgingRate = NewRate;
+    AgingEpochSeconds = FPlatformTime::Seconds();
+    RebuildSortKeysLocked();
+}
+
+float UIQT_PriorityQueueInternal::GetAgingRate() const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    return AgingRate;
+}
+
+int32 UIQT_PriorityQueueInternal::MakeSortKey(const FIQT_QueueItem& Item) const
+{
+    if (AgingRate <= 0.0f)
+    {
+        return Item.Priority;
+    }
+    // Itens sem hora de chegada (enfileirados antes de ativar o envelhecimento) contam a partir da época atual.
+    const double ArrivalSeconds = Item.EnqueueTimeSeconds > 0.0 ? Item.EnqueueTimeSeconds : AgingEpochSeconds;
+    const double Key = double(Item.Priority) + double(AgingRate) * (ArrivalSeconds - AgingEpochSeconds);
+    return static_cast<int32>(FMath::Clamp(FMath::RoundToDouble(Key), double(MIN_int32), double(MAX_int32)));
+}
+
+void UIQT_PriorityQueueInternal::RebaseAgingEpochLocked(double ArrivalSeconds)
+{
+    // Um deslocamento inteiro mantém as chaves recalculadas e as das runs exatamente alinhadas.
+    const int64 KeyDelta = FMath::FloorToInt64(double(AgingRate) * (ArrivalSeconds - AgingEpochSeconds));
+    AgingEpochSeconds += double(KeyDelta) / double(AgingRate);
+    for (const TUniquePtr<FIQT_SpillRun>& Run : SpillRuns)
+    {
+        Run->ShiftKeys(KeyDelta);
+    }
+    RebuildSortKeysLocked();
+    UE_LOG(LogIQTInternal, Verbose, TEXT("UIQT_PriorityQueueInternal: Época de envelhecimento avançada em %lld unidades de chave."), KeyDelta);
+}
+
+void UIQT_PriorityQueueInternal::RebuildSortKeysLocked()
+{
+    for (FIQT_HotRecord& Record : Heap)
+    {
+        Record.SortKey = MakeSortKey(Slots[Record.Slot].Item);
+    }
+    RebuildHeapsLocked();
+}
+
+void UIQT_PriorityQueueInternal::RebuildHeapsLocked()
+{
+    for (int32 HeapIndex = 0; HeapIndex < Heap.Num(); ++HeapIndex)
+    {
+        SlotHeapIndex[Heap[HeapIndex].Slot] = HeapIndex;
+    }
+    // Heapify de baixo para cima: O(n), contra O(n log n) de reinserir tudo.
+    for (int32 HeapIndex = Heap.Num() / 2 - 1; HeapIndex >= 0; --HeapIndex)
+    {
+        SiftDown(HeapIndex);
+    }
+
+    // Os heaps secundários são refeitos com cópias dos registros atuais (as colunas de utilidade não dependem da ordem). Limpar os índices reversos pelos registros
+    // antigos cobre também os slots que acabaram de ser liberados.
+    for (FTagBucket& Bucket : TagBuckets)
+    {
+        for (const FIQT_HotRecord& Record : Bucket.Heap)
+        {
+            SlotBucketIndex[Record.Slot] = INDEX_NONE;
+        }
+        Bucket.Heap.Reset();
+    }
+    for (const FIQT_HotRecord& Record : TransferHeap)
+    {
+        SlotTransferIndex[Record.Slot] = INDEX_NONE;
+    }
+    TransferHeap.Reset();
+
+    for (const FIQT_HotRecord& Record : Heap)
+    {
+        TagBuckets[Record.TagIndex].Heap.Add(Record);
+        if (Record.Flags & HotFlag_Transferable)
+        {
+            TransferHeap.Add(Record);
+        }
+    }
+    for (FTagBucket& Bucket : TagBuckets)
+    {
+        IndexedHeapify(Bucket.Heap, SlotBucketIndex, &HotLess);
+    }
+    IndexedHeapify(TransferHeap, SlotTransferIndex, &WorstLess);
+    RebuildWorstHeapLocked();
+}
+
+int32 UIQT_PriorityQueueInternal::MatchRecordsLocked(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate, TArray<uint8>& OutMatches) const
+{
+    OutMatches.SetNumUninitialized(Heap.Num());
+    // Cada tarefa lê itens distintos e escreve apenas a sua posição de OutMatches.
+    ParallelFor(TEXT("IQT.MatchRecords"), Heap.Num(), BulkMinBatchSize, [this, &Predicate, &OutMatches](int32 HeapIndex)
+    {
+        OutMatches[HeapIndex] = Predicate(Slots[Heap[HeapIndex].Slot].Item) ? 1 : 0;
+    });
+
+    int32 NumMatches = 0;
+    for (const uint8 Match : OutMatches)
+    {
+        NumMatches += Match;
+    }
+    return NumMatches;
+}
+
+int32 UIQT_PriorityQueueInternal::RemoveAllMatching(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate, TArray<FIQT_QueueItem>* OutRemoved)
+{
+    FPublishingWriteScope WriteScope(*this);
+
+    // Itens em disco primeiro: só são marcados como removidos nas runs, sem mexer nos heaps.
+    TArray<TPair<FSpilledRecord, FIQT_QueueItem>> SpilledMatches;
+    ForEachSpilledItemLocked([&Predicate, &SpilledMatches](const FSpilledRecord& Record, FIQT_QueueItem& Item)
+    {
+        if (Predicate(Item))
+        {
+            SpilledMatches.Emplace(Record, MoveTemp(Item));
+        }
+    });
+    for (TPair<FSpilledRecord, FIQT_QueueItem>& Match : SpilledMatches)
+    {
+        RemoveSpilledLocked(Match.Key, Match.Value);
+        if (OutRemoved)
+        {
+            OutRemoved->Add(MoveTemp(Match.Value));
+        }
+    }
+    const int32 NumSpilledMatches = SpilledMatches.Num();
+
+    TArray<uint8> Matches;
+    const int32 NumMatches = MatchRecordsLocked(Predicate, Matches);
+    if (NumMatches == 0)
+    {
+        return NumSpilledMatches;
+    }
+    if (OutRemoved)
+    {
+        OutRemoved->Reserve(OutRemoved->Num() + NumMatches);
+    }
+
+    // Poucos itens: remoções individuais, O(k log n), custam menos que reconstruir todos os heaps.
+    if (NumMatches <= Heap.Num() / BulkIncrementalDivisor)
+    {
+        TArray<uint32, TInlineAllocator<64>> MatchedSlots;
+        for (int32 HeapIndex = 0; HeapIndex < Heap.Num(); ++HeapIndex)
+        {
+            if (Matches[HeapIndex])
+            {
+                MatchedSlots.Add(Heap[HeapIndex].Slot);
+            }
+        }
+        for (const uint32 Slot : MatchedSlots)
+        {
+            RemoveAtHeapIndex(SlotHeapIndex[Slot], OutRemoved ? &OutRemoved->AddDefaulted_GetRef() : nullptr);
+        }
+        return NumMatches + NumSpilledMatches;
+    }
+
+    // Compacta o heap com os registros restantes; a ordem é refeita de uma vez, em O(n).
+    int32 NumKept = 0;
+    for (int32 HeapIndex = 0; HeapIndex < Heap.Num(); ++HeapIndex)
+    {
+        const FIQT_HotRecord Record = Heap[HeapIndex];
+        if (Matches[HeapIndex])
+        {
+            // As colunas de utilidade não dependem da ordem: saem aqui mesmo, em O(1), e não são reconstruídas.
+            if (SlotUtilityIndex[Record.Slot] != INDEX_NONE)
+            {
+                UtilityRemove(Record.Slot);
+            }
+            NumOpen -= (Record.Flags & HotFlag_Open) ? 1 : 0;
+            ReleaseSlotLocked(Record.Slot, OutRemoved ? &OutRemoved->AddDefaulted_GetRef() : nullptr);
+        }
+        else
+        {
+            Heap[NumKept++] = Record;
+        }
+    }
+    Heap.SetNum(NumKept, EAllowShrinking::No);
+    RebuildHeapsLocked();
+    return NumMatches + NumSpilledMatches;
+}
+
+int32 UIQT_PriorityQueueInternal::RescoreAll(TFunctionRef<int32(const FIQT_QueueItem&)> Scorer)
+{
+    // O pontuador roda na thread do chamador e sem trava, sobre uma cópia: pode ler UObjects do jogo e, se for
+    // lento, não segura os produtores. Só as prioridades novas são aplicadas depois, sob a trava de escrita.
+    TArray<FIQT_QueueItem> Snapshot;
+    TArray<int64> SnapshotOffsets;
+    TArray<uint32> RunIds;
+    {
+        FReadScopeLock ReadLock(QueueLock);
+        Snapshot.Reserve(Heap.Num());
+        for (const FIQT_HotRecord& Record : Heap)
+        {
+            Snapshot.Add(Slots[Record.Slot].Item);
+        }
+        for (const TUniquePtr<FIQT_SpillRun>& Run : SpillRuns)
+        {
+            RunIds.Add(Run->GetId());
+        }
+    }
+
+    TArray<FPriorityChange> NewPriorities;
+    auto ScoreSnapshot = [&Scorer, &Snapshot, &SnapshotOffsets, &NewPriorities](uint32 RunId)
+    {
+        NewPriorities.Reset();
+        for (int32 Index = 0; Index < Snapshot.Num(); ++Index)
+        {
+            const FIQT_QueueItem& Item = Snapshot[Index];
+            const int32 NewPriority = Scorer(Item);
+            if (NewPriority != Item.Priority)
+            {
+                NewPriorities.Add({ Item.Handle, NewPriority, RunId, RunId != 0 ? SnapshotOffsets[Index] : 0 });
+            }
+        }
+    };
+    ScoreSnapshot(0);
+    int32 NumChanged = ApplyPriorities(NewPriorities);
+
+    // Itens em disco: lidos em lotes de cada run, para não trazer a fila inteira para a memória. Só as runs que
+    // existiam no início: as criadas depois guardam itens já repontuados.
+    for (const uint32 RunId : RunIds)
+    {
+        int64 Offset = 0;
+        bool bMore = true;
+        while (bMore)
+        {
+            Snapshot.Reset();
+            SnapshotOffsets.Reset();
+            {
+                FReadScopeLock ReadLock(QueueLock);
+                FIQT_SpillRun* Run = FindSpillRun(RunId);
+                if (!Run)
+                {
+                    break;
+                }
+                int64 NextOffset = 0;
+                bMore = Run->ForEachRecord(Offset, [](const FIQT_SpillRecordHeader&) { return true; },
+                    [&Snapshot, &SnapshotOffsets](int64 RecordOffset, const FIQT_SpillRecordHeader&, FIQT_QueueItem& Item)
+                    {
+                        SnapshotOffsets.Add(RecordOffset);
+                        Snapshot.Add(MoveTemp(Item));
+                        return Snapshot.Num() < SpillRefillBatch;
+                    }, &NextOffset);
+                bMore = bMore && NextOffset < Run->GetFileSize();
+                Offset = NextOffset;
+            }
+            ScoreSnapshot(RunId);
+            NumChanged += ApplyPriorities(NewPriorities);
+        }
+    }
+    return NumChanged;
+}
+
+int32 UIQT_PriorityQueueInternal::ApplyPriorities(TConstArrayView<FPriorityChange> NewPriorities)
+{
+    if (NewPriorities.Num() == 0)
+    {
+        return 0;
+    }
+
+    FPublishingWriteScope WriteScope(*this);
+    // Itens retirados desde a cópia não resolvem mais o handle e ficam de fora. Os que estão em disco voltam à
+    // memória antes de mudar; o excedente volta ao disco ao liberar a trava, já com a chave nova.
+    for (const FPriorityChange& Change : NewPriorities)
+    {
+        if (ResolveHandle(Change.Handle) != INDEX_NONE)
+        {
+            continue;
+        }
+        FSpilledRecord Record;
+        FIQT_QueueItem Item;
+        bool bFound = false;
+        FIQT_SpillRun* Run = Change.RunId != 0 ? FindSpillRun(Change.RunId) : nullptr;
+        if (Run && Run->IsLive(Change.RecordOffset))
+        {
+            // Posição conhecida pela cópia: lê só aquele registro, sem consultar o filtro nem varrer a run.
+            Run->ForEachRecord(Change.RecordOffset, [](const FIQT_SpillRecordHeader&) { return true; },
+                [&Change, Run, &Record, &Item, &bFound](int64 RecordOffset, const FIQT_SpillRecordHeader& Header, FIQT_QueueItem& Read)
+                {
+                    if (RecordOffset == Change.RecordOffset && Read.Handle == Change.Handle)
+                    {
+                        Record = FSpilledRecord{ Run, RecordOffset, Header };
+                        Item = MoveTemp(Read);
+                        bFound = true;
+                    }
+                    return false;
+                });
+        }
+        else
+        {
+            bFound = FindSpilledHandleLocked(Change.Handle, Record, Item);
+        }
+        if (bFound && Item.Priority != Change.Priority)
+        {
+            LoadSpilledLocked(Record, MoveTemp(Item));
+        }
+    }
+
+    // As mudanças são coletadas antes de escrever qualquer chave, para escolher entre reposicionar uma a uma e
+    // reconstruir tudo de uma vez.
+    TArray<TPair<uint32, int32>, TInlineAllocator<64>> Changes;
+    for (const FPriorityChange& Change : NewPriorities)
+    {
+        const int32 Slot = ResolveHandle(Change.Handle);
+        if (Slot != INDEX_NONE && Slots[Slot].Item.Priority != Change.Priority)
+        {
+            Changes.Emplace(static_cast<uint32>(Slot), Change.Priority);
+        }
+    }
+    const int32 NumChanged = Changes.Num();
+    if (NumChanged == 0)
+    {
+        return 0;
+    }
+
+    if (NumChanged <= Heap.Num() / BulkIncrementalDivisor)
+    {
+        // Cada chave é escrita e reposicionada antes da próxima: o sift assume o resto do heap válido, o que não
+        // vale com dois nós alterados ao mesmo tempo (por exemplo, um nó e um descendente).
+        for (const TPair<uint32, int32>& Change : Changes)
+        {
+            FIQT_QueueItem& Item = Slots[Change.Key].Item;
+            Item.Priority = Change.Value;
+            Heap[SlotHeapIndex[Change.Key]].SortKey = MakeSortKey(Item);
+            FixHeapAt(SlotHeapIndex[Change.Key]);
+            SecondaryUpdate(Heap[SlotHeapIndex[Change.Key]]);
+        }
+    }
+    else
+    {
+        for (const TPair<uint32, int32>& Change : Changes)
+        {
+            FIQT_QueueItem& Item = Slots[Change.Key].Item;
+            Item.Priority = Change.Value;
+            Heap[SlotHeapIndex[Change.Key]].SortKey = MakeSortKey(Item);
+        }
+        RebuildHeapsLocked();
+    }
+    return NumChanged;
+}
+
+int32 UIQT_PriorityQueueInternal::CountMatching(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate) const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    TArray<uint8> Matches;
+    int32 NumMatches = MatchRecordsLocked(Predicate, Matches);
+    ForEachSpilledItemLocked([&Predicate, &NumMatches](const FSpilledRecord&, FIQT_QueueItem& Item)
+    {
+        NumMatches += Predicate(Item) ? 1 : 0;
+    });
+    return NumMatches;
+}
+
+int32 UIQT_PriorityQueueInternal::CountMatching(const FGameplayTagQuery& Query) const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    if (Heap.Num() + NumSpilled == 0 || Query.IsEmpty())
+    {
+        return 0;
+    }
+
+    FQueryBucketList MatchingBuckets;
+    ResolveQueryBuckets(Query, MatchingBuckets);
+
+    int32 NumMatches = 0;
+    for (const uint16 BucketIndex : MatchingBuckets)
+    {
+        const FTagBucket& Bucket = TagBuckets[BucketIndex];
+        if (!Bucket.bSharedTags)
+        {
+            NumMatches += Bucket.Heap.Num();
+            continue;
+        }
+        for (const FIQT_HotRecord& Record : Bucket.Heap)
+        {
+            NumMatches += Query.Matches(FGameplayTagContainer(Slots[Record.Slot].Item.AbilityTriggerTag)) ? 1 : 0;
+        }
+    }
+
+    // Itens em disco: cada run conta os restantes por tag, sem ler o arquivo. A consulta é avaliada uma vez por tag distinta.
+    TMap<FGameplayTag, bool, TInlineSetAllocator<16>> SpilledTagMatches;
+    for (const TUniquePtr<FIQT_SpillRun>& Run : SpillRuns)
+    {
+        for (const TPair<FGameplayTag, int32>& Pair : Run->GetTagCounts())
+        {
+            const bool* bMatches = SpilledTagMatches.Find(Pair.Key);
+            if (!bMatches)
+            {
+                bMatches = &SpilledTagMatches.Add(Pair.Key, Query.Matches(FGameplayTagContainer(Pair.Key)));
+            }
+            NumMatches += *bMatches ? Pair.Value : 0;
+        }
+    }
+    return NumMatches;
+}
+
+int32 UIQT_PriorityQueueInternal::GetCount() const
+{
+    return PublishedCount.load(std::memory_order_relaxed);
+}
+
+int32 UIQT_PriorityQueueInternal::GetNumOpen() const
+{
+    return PublishedNumOpen.load(std::memory_order_relaxed);
+}
+
+int32 UIQT_PriorityQueueInternal::GetNumClose() const
+{
+    return FMath::Max(0, GetCount() - GetNumOpen());
+}
+
+bool UIQT_PriorityQueueInternal::IsEmpty() const
+{
+    return GetCount() == 0;
+}
+
+bool UIQT_PriorityQueueInternal::GetHeadPriority(int32& OutPriority) const
+{
+    const int64 HeadPriority = PublishedHeadPriority.load(std::memory_order_relaxed);
+    if (HeadPriority == NoHeadPriority)
+    {
+        return false;
+    }
+    OutPriority = static_cast<int32>(HeadPriority);
+    return true;
+}
+
+// Despeja o conteúdo da fila na ordem de saída.
+void UIQT_PriorityQueueInternal::DumpQueueContents() const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    UE_LOG(LogIQTInternal, Warning, TEXT("UIQT_PriorityQueueInternal - Conteúdo Atual da Fila"));
+    UE_LOG(LogIQTInternal, Warning, TEXT("UIQT_PriorityQueueInternal - ============================================================="));
+
+    TArray<FIQT_HotRecord> Ordered = Heap;
+    Ordered.Sort(&UIQT_PriorityQueueInternal::HotLess);
+    for (int32 Index = 0; Index < Ordered.Num(); ++Index)
+    {
+        const FIQT_QueueItem& Item = Slots[Ordered[Index].Slot].Item;
+        UE_LOG(LogIQTInternal, Warning, TEXT("UIQT_PriorityQueueInternal - Item %d: Name=%s | Tag=%s | IsOpen=%s | Priority=%d | Handle=%s | TaskID=%s"),
+            Index, *Item.Name.ToString(), *Item.AbilityTriggerTag.ToString(),
+            Item.bIsOpen ? TEXT("true") : TEXT("false"), Item.Priority, *Item.Handle.ToString(), *Item.TaskID.ToString());
+    }
+    if (NumSpilled > 0)
+    {
+        UE_LOG(LogIQTInternal, Warning, TEXT("UIQT_PriorityQueueInternal - Mais %d itens em %d runs de spill (não listados)."), NumSpilled, SpillRuns.Num());
+    }
+    UE_LOG(LogIQTInternal, Warning, TEXT("UIQT_PriorityQueueInternal - ============================================================="));
+}
+
+bool UIQT_PriorityQueueInternal::ValidateInvariants() const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    for (int32 Index = 0; Index < Heap.Num(); ++Index)
+    {
+        const FIQT_HotRecord& Record = Heap[Index];
+        if (Index > 0 && HotLess(Record, Heap[(Index - 1) / 2]))
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Propriedade de heap violada no índice %d."), Index);
+            return false;
+        }
+        if (!Slots.IsValidIndex(Record.Slot) || SlotHeapIndex[Record.Slot] != Index)
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Slot %u não aponta de volta para o índice %d do heap."), Record.Slot, Index);
+            return false;
+        }
+        const FIQT_QueueItem& Item = Slots[Record.Slot].Item;
+        const uint32* RelocatedSlot = RelocatedHandles.Find(Item.Handle);
+        if (Item.Handle != FIQT_ItemHandle(Record.Slot, Slots[Record.Slot].Generation) && !(RelocatedSlot && *RelocatedSlot == Record.Slot))
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Handle do item no slot %u não corresponde à geração do slot."), Record.Slot);
+            return false;
+        }
+        if (Record.SortKey != MakeSortKey(Item) || Record.Flags != MakeHotFlags(Item))
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Registro quente do slot %u diverge do item."), Record.Slot);
+            return false;
+        }
+    }
+    if (Heap.Num() + FreeSlots.Num() != Slots.Num())
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Slots usados (%d) + livres (%d) != total (%d)."), Heap.Num(), FreeSlots.Num(), Slots.Num());
+        return false;
+    }
+    // Handles redirecionados: cada um aponta para um slot no heap cujo item ainda o carrega.
+    for (const TPair<FIQT_ItemHandle, uint32>& Pair : RelocatedHandles)
+    {
+        if (!Slots.IsValidIndex(Pair.Value) || SlotHeapIndex[Pair.Value] == INDEX_NONE || Slots[Pair.Value].Item.Handle != Pair.Key)
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Handle redirecionado para o slot %u não corresponde ao item."), Pair.Value);
+            return false;
+        }
+    }
+    for (const uint32 FreeSlot : FreeSlots)
+    {
+        if (SlotHeapIndex[FreeSlot] != INDEX_NONE)
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Slot livre %u ainda está no heap."), FreeSlot);
+            return false;
+        }
+    }
+    int32 NumOpenRecords = 0;
+    for (const FIQT_HotRecord& Record : Heap)
+    {
+        NumOpenRecords += (Record.Flags & HotFlag_Open) ? 1 : 0;
+    }
+    if (NumOpenRecords != NumOpen || GetCount() != GetTotalCountLocked() || GetNumOpen() != NumOpen + NumSpilledOpen)
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Contagem de abertos (%d) ou valores publicados (%d itens, %d abertos) divergem do heap (%d itens, %d abertos)."),
+            NumOpen, GetCount(), GetNumOpen(), Heap.Num(), NumOpenRecords);
+        return false;
+    }
+
+    // Runs: as contagens somam os itens em disco e nenhuma cabeça fica à frente do topo em memória.
+    int32 NumInRuns = 0;
+    int32 NumOpenInRuns = 0;
+    for (const TUniquePtr<FIQT_SpillRun>& Run : SpillRuns)
+    {
+        NumInRuns += Run->GetNumRemaining();
+        NumOpenInRuns += Run->GetNumOpenRemaining();
+        if (Run->IsExhausted() || Heap.Num() == 0 || HotLess(FIQT_HotRecord{ Run->GetHeadSortKey(), Run->GetHead().Sequence }, Heap[0]))
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Run '%s' esgotada ou com cabeça à frente do topo em memória."), *Run->GetPath());
+            return false;
+        }
+    }
+    if (NumInRuns != NumSpilled || NumOpenInRuns != NumSpilledOpen)
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Runs com %d registros (%d abertos), esperado %d (%d abertos)."),
+            NumInRuns, NumOpenInRuns, NumSpilled, NumSpilledOpen);
+        return false;
+    }
+    // Os índices cobrem só os itens em memória; os em disco são achados pelos filtros das runs.
+    if (KeyIndex.Num() != Heap.Num() || TaskIDIndex.Num() > Heap.Num())
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Índices (%d chaves, %d TaskIDs) diferem do tamanho do heap (%d)."), KeyIndex.Num(), TaskIDIndex.Num(), Heap.Num());
+        return false;
+    }
+
+    // Buckets por tag: propriedade de heap, índice reverso e cópias idênticas aos registros do heap principal.
+    int32 NumBucketed = 0;
+    for (int32 BucketIndex = 0; BucketIndex < TagBuckets.Num(); ++BucketIndex)
+    {
+        const FTagBucket& Bucket = TagBuckets[BucketIndex];
+        NumBucketed += Bucket.Heap.Num();
+        for (int32 Index = 0; Index < Bucket.Heap.Num(); ++Index)
+        {
+            const FIQT_HotRecord& Record = Bucket.Heap[Index];
+            if (Index > 0 && HotLess(Record, Bucket.Heap[(Index - 1) / 2]))
+            {
+                UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Propriedade de heap violada no bucket %d, índice %d."), BucketIndex, Index);
+                return false;
+            }
+            if (!Slots.IsValidIndex(Record.Slot) || SlotBucketIndex[Record.Slot] != Index || SlotHeapIndex[Record.Slot] == INDEX_NONE)
+            {
+                UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Slot %u não aponta de volta para o índice %d do bucket %d."), Record.Slot, Index, BucketIndex);
+                return false;
+            }
+            const FIQT_HotRecord& MainRecord = Heap[SlotHeapIndex[Record.Slot]];
+            if (MainRecord.SortKey != Record.SortKey || MainRecord.Sequence != Record.Sequence || MainRecord.TagIndex != BucketIndex
+                || (!Bucket.bSharedTags && Slots[Record.Slot].Item.AbilityTriggerTag != Bucket.Tag))
+            {
+                UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Registro do slot %u no bucket %d diverge do heap principal."), Record.Slot, BucketIndex);
+                return false;
+            }
+        }
+    }
+    if (NumBucketed != Heap.Num())
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Buckets contêm %d itens, fila contém %d."), NumBucketed, Heap.Num());
+        return false;
+    }
+
+    // Heap invertido: presente apenas com EvictLowest, com o pior item no topo.
+    if (WorstHeap.Num() != (IsTrackingWorst() ? Heap.Num() : 0))
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Heap invertido contém %d itens, fila contém %d."), WorstHeap.Num(), Heap.Num());
+        return false;
+    }
+    for (int32 Index = 0; Index < WorstHeap.Num(); ++Index)
+    {
+        const FIQT_HotRecord& Record = WorstHeap[Index];
+        if ((Index > 0 && WorstLess(Record, WorstHeap[(Index - 1) / 2]))
+            || !Slots.IsValidIndex(Record.Slot) || SlotWorstIndex[Record.Slot] != Index || SlotHeapIndex[Record.Slot] == INDEX_NONE
+            || Heap[SlotHeapIndex[Record.Slot]].SortKey != Record.SortKey || Heap[SlotHeapIndex[Record.Slot]].Sequence != Record.Sequence)
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Heap invertido inconsistente no índice %d (slot %u)."), Index, Record.Slot);
+            return false;
+        }
+    }
+
+    // Heap de transferíveis: exatamente os registros com HotFlag_Transferable, com o pior item no topo.
+    int32 NumTransferableRecords = 0;
+    for (const FIQT_HotRecord& Record : Heap)
+    {
+        NumTransferableRecords += (Record.Flags & HotFlag_Transferable) ? 1 : 0;
+    }
+    if (TransferHeap.Num() != NumTransferableRecords || GetNumTransferable() != NumTransferableRecords)
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Heap de transferíveis contém %d itens (publicado %d), fila contém %d transferíveis."),
+            TransferHeap.Num(), GetNumTransferable(), NumTransferableRecords);
+        return false;
+    }
+    for (int32 Index = 0; Index < TransferHeap.Num(); ++Index)
+    {
+        const FIQT_HotRecord& Record = TransferHeap[Index];
+        if ((Index > 0 && WorstLess(Record, TransferHeap[(Index - 1) / 2]))
+            || !Slots.IsValidIndex(Record.Slot) || SlotTransferIndex[Record.Slot] != Index || SlotHeapIndex[Record.Slot] == INDEX_NONE
+            || Heap[SlotHeapIndex[Record.Slot]].SortKey != Record.SortKey || Heap[SlotHeapIndex[Record.Slot]].Sequence != Record.Sequence)
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Heap de transferíveis inconsistente no índice %d (slot %u)."), Index, Record.Slot);
+            return false;
+        }
+    }
+
+    // Colunas de utilidade: uma posição por item enquanto houver pesos, com as características do próprio item.
+    if (UtilitySlots.Num() != (IsTrackingUtility() ? Heap.Num() : 0))
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Colunas de utilidade contêm %d itens, fila contém %d."), UtilitySlots.Num(), Heap.Num());
+        return false;
+    }
+    for (int32 Feature = 0; Feature < FIQT_QueueItem::MaxUtilityFeatures; ++Feature)
+    {
+        if (UtilityColumns[Feature].Num() != (Feature < NumUtilityWeights ? UtilitySlots.Num() : 0))
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Coluna de utilidade %d com %d posições (esperado %d)."),
+                Feature, UtilityColumns[Feature].Num(), Feature < NumUtilityWeights ? UtilitySlots.Num() : 0);
+            return false;
+        }
+    }
+    for (int32 Index = 0; Index < UtilitySlots.Num(); ++Index)
+    {
+        const uint32 Slot = UtilitySlots[Index];
+        if (!Slots.IsValidIndex(Slot) || SlotUtilityIndex[Slot] != Index || SlotHeapIndex[Slot] == INDEX_NONE)
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Slot %u não aponta de volta para a posição %d das colunas de utilidade."), Slot, Index);
+            return false;
+        }
+        const TArray<float>& Features = Slots[Slot].Item.UtilityFeatures;
+        for (int32 Feature = 0; Feature < NumUtilityWeights; ++Feature)
+        {
+            if (UtilityColumns[Feature][Index] != (Features.IsValidIndex(Feature) ? Features[Feature] : 0.0f))
+            {
+                UE_LOG(LogIQTInternal, Error, TEXT("UIQT_PriorityQueueInternal: Erro de validação: Característica %d do slot %u diverge da coluna de utilidade."), Feature, Slot);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void UIQT_PriorityQueueInternal::AddReferencedObjects(FReferenceCollector& Collector)
+{
+    FWriteScopeLock WriteLock(QueueLock);
+    // Slots livres guardam itens já movidos para fora: apenas os itens presentes no heap são visitados.
+    for (const FIQT_HotRecord& Record : Heap)
+    {
+        FIQT_QueueItem& Item = Slots[Record.Slot].Item;
+        Collector.AddReferencedObject(Item.UserPayload);
+        Item.DispatchData.AddStructReferencedObjects(Collector);
+    }
+    for (const TUniquePtr<FIQT_SpillRun>& Run : SpillRuns)
+    {
+        Run->AddReferencedObjects(Collector);
+    }
+}
+
+SIZE_T UIQT_PriorityQueueInternal::GetAllocatedSize() const
+{
+    FReadScopeLock ReadLock(QueueLock);
+    FScopeLock CacheLock(&QueryCacheMutex);
+    // Runs contam só os metadados (contagens, filtro, remoções): o conteúdo está em disco.
+    SIZE_T BucketBytes = TagBuckets.GetAllocatedSize() + SlotBucketIndex.GetAllocatedSize() + QueryCache.GetAllocatedSize()
+        + WorstHeap.GetAllocatedSize() + SlotWorstIndex.GetAllocatedSize() + SpillRuns.GetAllocatedSize() + RelocatedHandles.GetAllocatedSize()
+        + TransferHeap.GetAllocatedSize() + SlotTransferIndex.GetAllocatedSize() + UtilitySlots.GetAllocatedSize() + SlotUtilityIndex.GetAllocatedSize();
+    for (const FTagBucket& Bucket : TagBuckets)
+    {
+        BucketBytes += Bucket.Heap.GetAllocatedSize();
+    }
+    for (const TArray<float>& Column : UtilityColumns)
+    {
+        BucketBytes += Column.GetAllocatedSize();
+    }
+    for (const TUniquePtr<FIQT_SpillRun>& Run : SpillRuns)
+    {
+        BucketBytes += Run->GetAllocatedSize();
+    }
+    return Heap.GetAllocatedSize() + Slots.GetAllocatedSize() + SlotHeapIndex.GetAllocatedSize() + FreeSlots.GetAllocatedSize()
+        + KeyIndex.GetAllocatedSize() + TaskIDIndex.GetAllocatedSize() + TagToIndex.GetAllocatedSize() + BucketBytes;
+}
@@ -7,13 +7,64 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "IQT_DynAINode.h" 
-#include "HAL/CriticalSection.h" 
-#include "IQT_DataTypes.h"       
+#include "HAL/CriticalSection.h"
+#include "Misc/ScopeRWLock.h"
+#include "HAL/Event.h"
+#include <atomic>
+#include "GameplayTagContainer.h"
+#include "IQT_DataTypes.h"
+#include "IQT_SpillRun.h"
 
 /**
- * UIQT_PriorityQueueInternal: Implementa uma fila de prioridade usando uma lista duplamente encadeada.
- * Esta fila é thread-safe e gerencia seus próprios nós internos.
+ * FIQT_HotRecord: Registro compacto (16 bytes) mantido no heap de ordenação.
+ * Contém apenas o necessário para comparar e filtrar itens; o FIQT_QueueItem completo fica na tabela fria (slots).
+ */
+struct FIQT_HotRecord
+{
+    int32 SortKey;     // Menor valor sai primeiro. Priority mais o deslocamento de envelhecimento (ver MakeSortKey).
+    uint32 Sequence;   // Ordem de chegada; desempata prioridades iguais.
+    uint32 Slot;       // Índice do item na tabela fria.
+    uint16 TagIndex;   // Índice da AbilityTriggerTag na tabela de tags da fila.
+    uint8 Flags;       // EIQT_HotFlags.
+    uint8 Pad;
+};
+static_assert(sizeof(FIQT_HotRecord) == 16, "FIQT_HotRecord deve caber em 16 bytes (4 registros por linha de cache).");
+
+/**
+ * UIQT_PriorityQueueInternal: Implementa uma fila de prioridade com um heap binário de registros quentes (FIQT_HotRecord)
+ * e uma tabela fria de slots com os itens completos.
+ * - Enqueue/Dequeue/RemoveItem: O(log n). Comparações tocam apenas o heap contíguo, sem seguir ponteiros.
+ * - Contains/FindByTaskID/FindByHashKey: O(1) esperado, por índices de hash.
+ * - Operações por FIQT_ItemHandle resolvem o slot diretamente: O(1) para buscar, O(log n) para remover/atualizar.
+ * - Prioridades iguais saem do item mais novo para o mais antigo (mesma ordem da antiga lista encadeada).
+ * - Envelhecimento (SetAgingRate): a prioridade efetiva é Priority - Rate * espera. Como todos os itens envelhecem
+ *   no mesmo ritmo, comparar prioridades efetivas equivale a comparar Priority + Rate * (chegada - época): a chave
+ *   é fixada na entrada e o heap nunca precisa ser reordenado com o passar do tempo. A cada 2^30 unidades de
+ *   deslocamento a época avança (heapify O(n)), para que as chaves de chegadas novas não saturem em int32.
+ * - Fila cheia (SetMaxSize/SetOverflowPolicy): recusa, espera por espaço ou remove o item que sairia por último.
+ *   Para a remoção, um heap invertido (pior item no topo) é mantido apenas enquanto a política é EvictLowest: O(log n).
+ * - Itens com bTransferable ficam também em um heap invertido próprio, para que StealTransferable retire os menos
+ *   prioritários (a "cauda" da fila) em O(k log n) quando outra fila do grupo de compartilhamento está ociosa.
+ * - Modo spill (SetSpill): acima de um limite de itens em memória, a metade menos prioritária é gravada em um arquivo
+ *   de run ordenado (FIQT_SpillRun) e sai da memória por completo (slot, índices e heaps); de cada run fica só um
+ *   resumo pequeno (contagens, cabeça e um filtro de Bloom). As runs voltam em lotes, sempre que a cabeça de uma delas
+ *   passaria à frente do topo em memória, então Dequeue/PeekTop continuam exatos. O item volta com o mesmo handle:
+ *   se o slot original estiver ocupado, o handle é redirecionado (RelocatedHandles) enquanto o item está em memória.
+ *   Contains, buscas e operações por handle e em lote enxergam também os itens em disco, percorrendo os arquivos das
+ *   runs cujo filtro aceita o handle, a chave ou o TaskID; mutações por handle trazem o item de volta à memória.
+ *   DequeueMatching, DequeueBestScored, StealTransferable, EvictLowest e os visitantes enxergam apenas a parte em
+ *   memória. Mudar a taxa de envelhecimento não reordena as runs já gravadas.
+ * - Cada AbilityTriggerTag tem também um sub-heap próprio (bucket): DequeueMatching/PeekMatching comparam apenas
+ *   o topo dos buckets cuja tag satisfaz a consulta, em vez de percorrer a fila.
+ * - Pontuação de utilidade (SetUtilityWeights/DequeueBestScored): as UtilityFeatures de cada item são copiadas para
+ *   colunas SoA densas (uma por característica), e o item de maior produto escalar com os pesos é escolhido por um
+ *   kernel vetorizado (4 itens por instrução). Mantidas apenas enquanto houver pesos, como o heap invertido.
+ * - Operações em lote (RemoveAllMatching/RescoreAll/CountMatching) reconstroem a ordem com um único heapify O(n), em
+ *   vez de n remoções ou reinserções O(log n). RemoveAllMatching/CountMatching avaliam o predicado com ParallelFor
+ *   sobre o heap contíguo; RescoreAll pontua uma cópia na thread do chamador, fora da trava.
+ * Esta fila é thread-safe: consultas const rodam em paralelo sob trava de leitura (FRWLock) e apenas as mutações
+ * são exclusivas. Tamanho, itens abertos e prioridade do topo são publicados em atômicos a cada mutação,
+ * então GetCount/GetNumOpen/GetNumClose/IsEmpty/GetHeadPriority não travam.
  */
 class UIQT_PriorityQueueInternal
 {
@@ -24,42 +75,471 @@ public:
     void Init();
     void Empty();
 
-    bool Enqueue(TSharedPtr<FIQT_QueueItem>& InData);
+    // Pré-aloca heap, slots e índices para NumItems itens em memória (limitado pelo modo spill), de modo que inserções
+    // até esse total não realocam. Heaps mantidos sob demanda (EvictLowest, utilidade) seguem a configuração vigente.
+    void Reserve(int32 NumItems);
+
+    // Recebe os itens de uma FIQT_SmallQueue promovida, na ordem de chegada, mantendo o handle de cada um (mesmo slot e
+    // geração); NextGeneration continua de onde a fila pequena parou. Exige uma fila vazia e sem slots (recém-criada).
+    void Adopt(TArray<FIQT_QueueItem>&& Items, uint32 InNextGeneration);
+
+    // O handle atribuído é gravado no item guardado e, se informado, em OutHandle.
+    // Com a fila cheia segue a política de estouro: um item removido por EvictLowest é movido para OutEvicted;
+    // com Block a chamada pode esperar até o tempo limite (nunca com a fila travada).
+    bool Enqueue(const FIQT_QueueItem& InData, FIQT_ItemHandle* OutHandle = nullptr, TOptional<FIQT_QueueItem>* OutEvicted = nullptr);
+    bool Enqueue(FIQT_QueueItem&& InData, FIQT_ItemHandle* OutHandle = nullptr, TOptional<FIQT_QueueItem>* OutEvicted = nullptr);
+
+    // Move o item de maior prioridade para OutData. Retorna false se a fila estiver vazia.
+    bool Dequeue(FIQT_QueueItem& OutData);
+
+    // Como Dequeue/Peek, mas considerando apenas itens cuja AbilityTriggerTag satisfaz Query (tags pai inclusas).
+    // O(B + log n), onde B é o número de buckets que satisfazem a consulta. Uma consulta vazia não satisfaz nenhum item.
+    bool DequeueMatching(const FGameplayTagQuery& Query, FIQT_QueueItem& OutData);
+    bool PeekMatching(const FGameplayTagQuery& Query, FIQT_QueueItem& OutData) const;
+
+    // Acesso sem cópia. Os visitantes recebem referências válidas apenas durante a chamada e rodam sob a trava
+    // de leitura: podem chamar as consultas sem trava (GetCount, GetHeadPriority...), mas nenhuma outra operação
+    // da fila (a trava não é recursiva).
+
+    // Visita o item que Dequeue retornaria. Retorna false se a fila estiver vazia.
+    bool PeekTop(TFunctionRef<void(const FIQT_QueueItem&)> Visitor) const;
+
+    // Visita até K itens na ordem de saída, sem removê-los. Seleção parcial sobre o heap: O(K log K).
+    // Retorna o número de itens visitados.
+    int32 ForEachTopK(int32 K, TFunctionRef<void(const FIQT_QueueItem&)> Visitor) const;
 
-    TSharedPtr<FIQT_QueueItem> Dequeue();
+    // Visita todos os itens em ordem arbitrária (ordem do heap). O visitante retorna false para interromper.
+    void ForEachItem(TFunctionRef<bool(const FIQT_QueueItem&)> Visitor) const;
 
-    // Renomeado e atualizado para iterar a lista encadeada.
-    bool Contains(TSharedPtr<FIQT_QueueItem>& InData); 
+    // Operações em lote. O predicado roda em paralelo em threads de trabalho, sob a trava da fila: deve ser
+    // thread-safe, não pode chamar a fila e não deve criar nem destruir UObjects. Itens gravados em runs de spill são
+    // lidos dos arquivos, um de cada vez e em sequência, e avaliados na thread chamadora.
 
-    bool RemoveItem(TSharedPtr<FIQT_QueueItem>& ItemToRemove);
+    // Remove todos os itens que satisfazem o predicado, movendo-os para OutRemoved (se informado, em ordem arbitrária).
+    // Retorna quantos.
+    int32 RemoveAllMatching(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate, TArray<FIQT_QueueItem>* OutRemoved = nullptr);
 
-    bool ValidateData(const FIQT_QueueItem& InData) const;
+    // Atribui a cada item a prioridade retornada por Scorer e reordena a fila. Retorna quantos itens mudaram.
+    // Scorer roda na thread do chamador, sem trava, sobre uma cópia dos itens (pode chamar a fila). Itens que
+    // saírem da fila enquanto isso são ignorados; itens que entrarem não são pontuados. Itens em disco são lidos
+    // em lotes de SpillRefillBatch; os que mudam de prioridade voltam à memória (e o excedente, a uma run nova).
+    int32 RescoreAll(TFunctionRef<int32(const FIQT_QueueItem&)> Scorer);
 
-    TSharedPtr<FIQT_QueueItem> FindByTaskID(const FGuid& TaskID);
-    TSharedPtr<FIQT_QueueItem> FindByHashKey(FName InName, FGameplayTag InTag, bool bInIsOpen);
+    // Número de itens que satisfazem o predicado (trava de leitura).
+    int32 CountMatching(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate) const;
 
+    // Número de itens cuja AbilityTriggerTag satisfaz a consulta: soma o tamanho dos buckets, O(B), mais as contagens
+    // por tag de cada run (sem ler os arquivos).
+    int32 CountMatching(const FGameplayTagQuery& Query) const;
+
+    // Pesos da pontuação de utilidade: Score = Soma(Weights[i] * UtilityFeatures[i]), até
+    // FIQT_QueueItem::MaxUtilityFeatures pesos (os demais são ignorados). Vazio desativa. Mudar o número de pesos
+    // reconstrói as colunas (O(n)); mudar apenas os valores é O(F).
+    void SetUtilityWeights(TConstArrayView<float> Weights);
+
+    // Retira o item de maior pontuação (empates: qualquer um dos empatados). CandidateWindow > 0 limita a escolha aos
+    // CandidateWindow primeiros itens na ordem de prioridade: O(K log K) em vez de O(n). Sem pesos, equivale a Dequeue.
+    // Itens gravados em runs de spill só concorrem depois de voltarem à memória.
+    bool DequeueBestScored(int32 CandidateWindow, FIQT_QueueItem& OutData);
+
+    // Substitui as UtilityFeatures do item (contexto ao vivo: distância, vida, recarga...) sem mexer na ordem de prioridade.
+    bool UpdateUtilityFeatures(FIQT_ItemHandle Handle, TConstArrayView<float> Features);
+
+    // Igualdade de FIQT_QueueItem: Nome, AbilityTriggerTag e bIsOpen.
+    bool Contains(const FIQT_QueueItem& InData) const;
+
+    // Remove o primeiro item (na ordem de saída) igual a ItemToRemove.
+    bool RemoveItem(const FIQT_QueueItem& ItemToRemove);
+
+    static bool ValidateData(const FIQT_QueueItem& InData);
+
+    bool FindByTaskID(const FGuid& TaskID, FIQT_QueueItem& OutData) const;
+    bool FindByHashKey(FName InName, FGameplayTag InTag, bool bInIsOpen, FIQT_QueueItem& OutData) const;
+
+    // Operações por handle. Falham se o item já saiu da fila (handle obsoleto). Valem também para itens em disco
+    // (procurados nas runs cujo filtro aceita o handle).
+    bool IsHandleValid(FIQT_ItemHandle Handle) const;
+    bool FindByHandle(FIQT_ItemHandle Handle, FIQT_QueueItem& OutData) const;
+    bool RemoveByHandle(FIQT_ItemHandle Handle, FIQT_QueueItem* OutData = nullptr);
+    bool UpdatePriority(FIQT_ItemHandle Handle, int32 NewPriority);
+
+    // Substitui os dados do item, mantendo Handle, ordem de chegada, bIsEnqueued e EnqueueTimeSeconds
+    // (e o TaskID, se NewData não tiver um). Com bKeepPriority a prioridade guardada é preservada.
+    // Com bRejectDuplicateKey falha se a nova chave (Nome, Tag, bIsOpen) pertencer a outro item da fila.
+    bool Update(FIQT_ItemHandle Handle, const FIQT_QueueItem& NewData, bool bKeepPriority, bool bRejectDuplicateKey);
+
+    // Retorna o TaskID do item, gerando-o (e indexando-o) se ainda não existir.
+    bool EnsureTaskID(FIQT_ItemHandle Handle, FGuid& OutTaskID);
+
+    // NewSize <= 0 remove o limite (padrão).
     void SetMaxSize(int32 NewSize);
     int32 GetMaxSize() const;
 
+    // BlockTimeoutSeconds só se aplica a Block. Ativar EvictLowest constrói o heap invertido (O(n)).
+    void SetOverflowPolicy(EIQT_OverflowPolicy NewPolicy, float BlockTimeoutSeconds);
+    EIQT_OverflowPolicy GetOverflowPolicy() const;
+
+    // Total de itens removidos por EvictLowest desde a criação da fila (sem trava).
+    int32 GetNumEvicted() const;
+
+    // Ativa o modo spill acima de InMemoryThreshold itens em memória (<= 0 desativa; runs existentes continuam sendo
+    // consumidas). Directory vazio usa Saved/IQT/Spill.
+    void SetSpill(int32 InMemoryThreshold, const FString& Directory);
+
+    // Itens atualmente em arquivos de run (sem trava).
+    int32 GetNumSpilled() const;
+
+    // Retira até MaxItems itens com bTransferable, do menos prioritário para o mais prioritário. Retorna quantos.
+    int32 StealTransferable(int32 MaxItems, TArray<FIQT_QueueItem>& OutItems);
+
+    // Itens em memória com bTransferable (sem trava).
+    int32 GetNumTransferable() const;
+
+    // Pontos de prioridade ganhos por segundo de espera (0 desativa). Mudar a taxa recalcula as chaves: O(n).
+    void SetAgingRate(float PriorityPerSecond);
+    float GetAgingRate() const;
+
+    // Sem trava: leem os valores publicados pela última mutação concluída.
     int32 GetCount() const;
     int32 GetNumOpen() const;
     int32 GetNumClose() const;
 
     bool IsEmpty() const;
 
+    // Prioridade do item que Dequeue retornaria. Retorna false se a fila estiver vazia.
+    bool GetHeadPriority(int32& OutPriority) const;
+
     // Renomeado para clareza, pois agora ele despeja o conteúdo real da fila.
-    void DumpQueueContents() const; 
+    void DumpQueueContents() const;
+
+    // Verifica os invariantes (propriedade de heap, slots, índices e contagens). Usado pelo iqt.Stress.Run.
+    bool ValidateInvariants() const;
+
+    // Memória alocada pelas estruturas da fila (heap, slots e índices), em bytes.
+    SIZE_T GetAllocatedSize() const;
+
+    // Reporta ao GC os UObjects referenciados pelos itens na fila (UserPayload e DispatchData).
+    void AddReferencedObjects(FReferenceCollector& Collector);
 
 private:
-    mutable FCriticalSection Mutex;         // Adicionado 'mutable' para permitir o uso em funções const
-    int32 iQueueSize;               
-    int32 iQueueMaxSize;            
-    UIQT_DynAINode* pHead;         
-    UIQT_DynAINode* pTail;         
+    enum EIQT_HotFlags : uint8
+    {
+        HotFlag_Open = 1 << 0,
+        HotFlag_Transferable = 1 << 1,
+    };
+
+    static uint8 MakeHotFlags(const FIQT_QueueItem& Item)
+    {
+        return (Item.bIsOpen ? HotFlag_Open : 0) | (Item.bTransferable ? HotFlag_Transferable : 0);
+    }
+
+    // Chave de igualdade de FIQT_QueueItem (ver FIQT_QueueItem::operator==).
+    struct FItemKey
+    {
+        FName Name;
+        FGameplayTag Tag;
+        bool bIsOpen;
+
+        explicit FItemKey(const FIQT_QueueItem& Item)
+            : Name(Item.Name), Tag(Item.AbilityTriggerTag), bIsOpen(Item.bIsOpen) {}
+        FItemKey(FName InName, FGameplayTag InTag, bool bInIsOpen)
+            : Name(InName), Tag(InTag), bIsOpen(bInIsOpen) {}
+
+        bool operator==(const FItemKey& Other) const
+        {
+            return Name == Other.Name && Tag == Other.Tag && bIsOpen == Other.bIsOpen;
+        }
+        friend uint32 GetTypeHash(const FItemKey& Key)
+        {
+            return HashCombineFast(HashCombineFast(GetTypeHash(Key.Name), GetTypeHash(Key.Tag)), Key.bIsOpen ? 1u : 0u);
+        }
+    };
+
+    // Entrada da tabela fria. Generation muda a cada reutilização do slot.
+    struct FColdSlot
+    {
+        FIQT_QueueItem Item;
+        uint32 Generation;
+    };
+
+    // Sub-heap dos itens de uma AbilityTriggerTag, com cópias dos registros quentes do heap principal.
+    struct FTagBucket
+    {
+        FGameplayTag Tag;
+        // Bucket de estouro (índice MAX_uint16) compartilhado por várias tags: a consulta é avaliada item a item.
+        bool bSharedTags = false;
+        TArray<FIQT_HotRecord> Heap;
+    };
+
+    // Buckets que satisfazem uma consulta, recalculados apenas quando surge uma tag nova.
+    struct FQueryBuckets
+    {
+        FGameplayTagQuery Query;
+        TArray<uint16> Buckets;
+        uint32 BucketsVersion = 0;
+    };
+    static constexpr int32 MaxCachedQueries = 16;
+    using FQueryBucketList = TArray<uint16, TInlineAllocator<16>>;
+
+    // Registro de um item em disco, ainda na run.
+    struct FSpilledRecord
+    {
+        FIQT_SpillRun* Run = nullptr;
+        int64 RecordOffset = 0;
+        FIQT_SpillRecordHeader Header = {};
+    };
+
+    // Prioridade nova de RescoreAll. Um item lido de uma run leva a posição do registro (RunId != 0).
+    struct FPriorityChange
+    {
+        FIQT_ItemHandle Handle;
+        int32 Priority;
+        uint32 RunId;
+        int64 RecordOffset;
+    };
+
+    // Trava de escrita que, ao sair e ainda com a trava tomada, devolve ao disco o excedente de memória, traz de volta
+    // o que passou à frente do topo e republica os contadores.
+    struct FPublishingWriteScope
+    {
+        explicit FPublishingWriteScope(UIQT_PriorityQueueInternal& InQueue)
+            : Queue(InQueue), WriteLock(InQueue.QueueLock) {}
+        ~FPublishingWriteScope()
+        {
+            Queue.SpillIfOverBudgetLocked();
+            Queue.RefillFromSpillLocked();
+            Queue.PublishLocked();
+        }
+
+        UIQT_PriorityQueueInternal& Queue;
+        FWriteScopeLock WriteLock;
+    };
+
+    // Valor de PublishedHeadPriority com a fila vazia (fora do intervalo de int32).
+    static constexpr int64 NoHeadPriority = MIN_int64;
+
+    // Operações em lote: registros por tarefa do ParallelFor (abaixo disso roda na thread chamadora) e fração
+    // máxima de itens afetados (1/N) para a qual remoções/reposicionamentos individuais saem mais baratos que o heapify.
+    static constexpr int32 BulkMinBatchSize = 1024;
+    static constexpr int32 BulkIncrementalDivisor = 32;
+
+    mutable FRWLock QueueLock;
+    int32 iQueueMaxSize;            // MAX_int32 = sem limite.
+    EIQT_OverflowPolicy OverflowPolicy;
+    float BlockTimeoutSeconds;
+    float AgingRate;
+    double AgingEpochSeconds;       // Origem dos deslocamentos de envelhecimento; mantém as chaves longe do limite de int32.
+
+    // Deslocamento de envelhecimento (em unidades de chave) a partir do qual a época avança até a chegada atual.
+    // Metade da faixa de int32: itens antigos ficam com deslocamentos negativos ainda representáveis.
+    static constexpr double AgingRebaseKeyThreshold = double(1 << 30);
+    uint32 NextSequence;
+    uint32 NextGeneration;          // Nunca é reiniciado: handles anteriores a um Empty/Init não resolvem para itens novos.
+    int32 NumOpen;                  // Itens com bIsOpen, mantido incrementalmente.
+
+    // Publicados por PublishLocked ao fim de cada mutação; lidos sem trava.
+    std::atomic<int32> PublishedCount;
+    std::atomic<int32> PublishedNumOpen;
+    std::atomic<int64> PublishedHeadPriority;
+    std::atomic<int32> NumEvicted;
+    std::atomic<int32> PublishedNumSpilled;
+    std::atomic<int32> PublishedNumTransferable;
+
+    // Produtores esperando espaço (Block). PublishLocked sinaliza o evento quando há espaço e alguém esperando.
+    std::atomic<int32> NumBlockedProducers;
+    FEventRef SpaceAvailableEvent;
+
+    TArray<FIQT_HotRecord> Heap;
+    TArray<FColdSlot> Slots;
+    TArray<int32> SlotHeapIndex;    // Posição de cada slot no heap (INDEX_NONE se livre).
+    TArray<uint32> FreeSlots;
+    // Handle -> slot dos itens que voltaram de uma run para um slot diferente do original (ver RestoreLocked).
+    TMap<FIQT_ItemHandle, uint32> RelocatedHandles;
+
+    TMultiMap<FItemKey, uint32> KeyIndex;
+    TMultiMap<FGuid, uint32> TaskIDIndex;  // Apenas itens com TaskID já gerado.
+    TMap<FGameplayTag, uint16> TagToIndex;
+
+    TArray<FTagBucket> TagBuckets;  // Indexado por FIQT_HotRecord::TagIndex. Como TagToIndex, não encolhe.
+    TArray<int32> SlotBucketIndex;  // Posição de cada slot no heap do seu bucket (INDEX_NONE se livre).
+    uint32 BucketsVersion;          // Muda quando um bucket é criado ou passa a ser compartilhado.
+
+    // Heap invertido (o item que sairia por último no topo), mantido só com OverflowPolicy == EvictLowest.
+    TArray<FIQT_HotRecord> WorstHeap;
+    TArray<int32> SlotWorstIndex;   // Posição de cada slot no WorstHeap (INDEX_NONE se livre ou sem rastreamento).
+
+    // Heap invertido apenas dos itens transferíveis (pior no topo), sempre mantido.
+    TArray<FIQT_HotRecord> TransferHeap;
+    TArray<int32> SlotTransferIndex;
+
+    // Pontuação de utilidade. As colunas são densas (remoção por troca com o último) e só as NumUtilityWeights
+    // primeiras existem; UtilitySlots[i] é o slot do item na posição i de todas as colunas.
+    float UtilityWeights[FIQT_QueueItem::MaxUtilityFeatures];
+    int32 NumUtilityWeights;        // 0 = desativado.
+    TArray<float> UtilityColumns[FIQT_QueueItem::MaxUtilityFeatures];
+    TArray<uint32> UtilitySlots;
+    TArray<int32> SlotUtilityIndex; // Posição de cada slot nas colunas (INDEX_NONE se livre ou sem rastreamento).
+
+    // Modo spill. Invariante após cada mutação: o topo do heap é melhor que a cabeça de toda run.
+    static constexpr int32 SpillRefillBatch = 256;
+    int32 SpillThreshold;           // 0 = desativado.
+    bool bSpillFailed;              // Uma gravação falhou: o spill fica suspenso até o próximo SetSpill.
+    FString SpillDirectory;
+    TArray<TUniquePtr<FIQT_SpillRun>> SpillRuns;
+    int32 NumSpilled;               // Soma de GetNumRemaining das runs.
+    int32 NumSpilledOpen;
+
+    // Cache das consultas recentes (substituição circular). Mutável: preenchido também por PeekMatching, que roda
+    // sob a trava de leitura; por isso tem a sua própria trava.
+    mutable FCriticalSection QueryCacheMutex;
+    mutable TArray<FQueryBuckets> QueryCache;
+    mutable int32 NextQueryCacheEntry;
+
+    static bool HotLess(const FIQT_HotRecord& A, const FIQT_HotRecord& B);
+    static bool WorstLess(const FIQT_HotRecord& A, const FIQT_HotRecord& B) { return HotLess(B, A); }
+    bool IsTrackingWorst() const { return OverflowPolicy == EIQT_OverflowPolicy::EvictLowest; }
+    bool IsTrackingUtility() const { return NumUtilityWeights > 0; }
+
+    bool EnqueueLocked(FIQT_QueueItem&& InData, FIQT_ItemHandle* OutHandle, TOptional<FIQT_QueueItem>* OutEvicted);
+
+    // Coloca o item (já validado) em um slot novo, no heap e nos índices. Retorna o slot.
+    uint32 InsertLocked(FIQT_QueueItem&& InData, uint32 Sequence);
+    // Acrescenta um slot ao fim da tabela fria e dos índices por slot. Retorna o slot.
+    uint32 AddSlotLocked(FIQT_QueueItem&& InData, uint32 Generation);
+    // Grava o handle do item do slot e o coloca no heap e nos índices.
+    void IndexSlotLocked(uint32 Slot, uint32 Sequence);
+    // Coloca o item do slot no heap principal e nos secundários.
+    void PlaceSlotLocked(uint32 Slot, uint32 Sequence);
+    // Devolve à memória um item lido de uma run, com o handle e a ordem de chegada originais. Retorna o slot.
+    uint32 RestoreLocked(FIQT_QueueItem&& Item, uint32 Sequence);
+
+    // Itens em memória mais os gravados em runs: é a contagem usada pelo limite da fila.
+    int32 GetTotalCountLocked() const { return Heap.Num() + NumSpilled; }
+
+    // Grava a metade menos prioritária da memória em uma run nova, se o heap passou do limite do spill.
+    void SpillIfOverBudgetLocked();
+    void SpillLocked();
+
+    // Descarta as runs esgotadas e traz de volta lotes das runs cuja cabeça passaria à frente do topo em memória.
+    void RefillFromSpillLocked();
+
+    // Ordem de saída de um registro em disco, comparável com os registros do heap por HotLess.
+    static FIQT_HotRecord GetSpilledOrder(const FSpilledRecord& Record);
+
+    FIQT_SpillRun* FindSpillRun(uint32 RunId) const;
+
+    // Entre os registros em disco aceitos por RunFilter (filtro de Bloom), HeaderFilter e, lido o item, ItemFilter,
+    // o primeiro na ordem de saída. Lê só as runs aceitas e, em cada uma, para no primeiro registro aceito.
+    bool FindFirstSpilledLocked(TFunctionRef<bool(const FIQT_SpillRun&)> RunFilter, TFunctionRef<bool(const FIQT_SpillRecordHeader&)> HeaderFilter,
+        TFunctionRef<bool(const FIQT_QueueItem&)> ItemFilter, FSpilledRecord& OutRecord, FIQT_QueueItem& OutItem) const;
+    bool FindSpilledHandleLocked(FIQT_ItemHandle Handle, FSpilledRecord& OutRecord, FIQT_QueueItem& OutItem) const;
+    bool FindFirstSpilledKeyLocked(const FItemKey& Key, FSpilledRecord& OutRecord, FIQT_QueueItem& OutItem) const;
+
+    // Tira o item da run (o registro passa a ser ignorado). A run esgotada é descartada no fim da mutação.
+    void RemoveSpilledLocked(const FSpilledRecord& Record, const FIQT_QueueItem& Item);
+
+    // Tira o item da run e o devolve à memória. Retorna o slot.
+    uint32 LoadSpilledLocked(const FSpilledRecord& Record, FIQT_QueueItem&& Item);
+
+    // Slot do item do handle, trazendo-o de volta à memória se estiver em disco. INDEX_NONE se obsoleto.
+    int32 ResolveOrLoadHandleLocked(FIQT_ItemHandle Handle);
+
+    // Visita os itens em disco, lidos das runs um de cada vez e em sequência. O item pode ser movido pelo visitante.
+    void ForEachSpilledItemLocked(TFunctionRef<void(const FSpilledRecord& Record, FIQT_QueueItem& Item)> Visitor) const;
+
+    // Aplica as prioridades novas (itens que saíram da fila são ignorados; os em disco voltam à memória). Retorna quantas mudaram.
+    int32 ApplyPriorities(TConstArrayView<FPriorityChange> NewPriorities);
+
+    // Com a fila cheia e EvictLowest: remove o pior item se NewSortKey for estritamente melhor. Retorna false se não houver espaço.
+    bool EvictForLocked(int32 NewSortKey, TOptional<FIQT_QueueItem>* OutEvicted);
+
+    // Publica tamanho, abertos e prioridade do topo. Chamado com a trava de escrita tomada.
+    void PublishLocked();
+
+    // Slot do item em memória apontado pelo handle, ou INDEX_NONE (handle obsoleto ou item em disco).
+    int32 ResolveHandle(FIQT_ItemHandle Handle) const;
+
+    // Chave de ordenação do item: Priority + AgingRate * (EnqueueTimeSeconds - AgingEpochSeconds), saturada em int32.
+    int32 MakeSortKey(const FIQT_QueueItem& Item) const;
+
+    // Avança AgingEpochSeconds até perto de ArrivalSeconds (por um número inteiro de unidades de chave), recalcula as
+    // chaves em memória e desloca as das runs. Sem isso, chegadas após 2^31/AgingRate segundos empatariam no limite.
+    void RebaseAgingEpochLocked(double ArrivalSeconds);
+
+    // Recalcula as chaves de todos os registros e reconstrói o heap principal e os buckets (O(n)).
+    void RebuildSortKeysLocked();
+
+    // Reconstrói o heap principal e todos os heaps secundários a partir dos registros de Heap, em O(n).
+    // Os registros podem estar em qualquer ordem e com chaves novas.
+    void RebuildHeapsLocked();
+
+    // Avalia o predicado em paralelo para cada registro de Heap. OutMatches[i] != 0 se Heap[i] satisfaz.
+    // Retorna quantos satisfazem.
+    int32 MatchRecordsLocked(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate, TArray<uint8>& OutMatches) const;
+
+    // Reposiciona o registro após uma mudança de prioridade.
+    void FixHeapAt(int32 HeapIndex);
+    void EmptyLocked();
+    uint16 GetOrAddTagIndex(FGameplayTag Tag);
+    void PlaceRecord(int32 HeapIndex, const FIQT_HotRecord& Record);
+    void SiftUp(int32 HeapIndex);
+    void SiftDown(int32 HeapIndex);
+
+    // Sift genérico, compartilhado pelo heap principal, pelos buckets e pelo heap invertido.
+    // Less define a ordem do heap; Place grava o registro e o índice reverso.
+    template <typename LessType, typename PlaceType>
+    static void HeapSiftUp(TArray<FIQT_HotRecord>& InHeap, int32 HeapIndex, LessType&& Less, PlaceType&& Place);
+    template <typename LessType, typename PlaceType>
+    static void HeapSiftDown(TArray<FIQT_HotRecord>& InHeap, int32 HeapIndex, LessType&& Less, PlaceType&& Place);
+
+    // Heaps secundários com cópias dos registros e índice reverso por slot (buckets e heap invertido).
+    template <typename LessType>
+    void IndexedHeapInsert(TArray<FIQT_HotRecord>& InHeap, TArray<int32>& SlotIndex, const FIQT_HotRecord& Record, LessType&& Less);
+    template <typename LessType>
+    void IndexedHeapRemove(TArray<FIQT_HotRecord>& InHeap, TArray<int32>& SlotIndex, uint32 Slot, LessType&& Less);
+    template <typename LessType>
+    void IndexedHeapUpdate(TArray<FIQT_HotRecord>& InHeap, TArray<int32>& SlotIndex, const FIQT_HotRecord& Record, LessType&& Less);
+    template <typename LessType>
+    void IndexedHeapify(TArray<FIQT_HotRecord>& InHeap, TArray<int32>& SlotIndex, LessType&& Less);
+
+    // Manutenção dos heaps secundários do registro: o bucket da sua tag (TagIndex) e, se ativo, o heap invertido.
+    void SecondaryInsert(const FIQT_HotRecord& Record);
+    void SecondaryRemove(const FIQT_HotRecord& Record);
+    void SecondaryUpdate(const FIQT_HotRecord& Record);
+
+    // Reconstrói o heap invertido a partir do heap principal (O(n)), ou o descarta se a política não o usa.
+    void RebuildWorstHeapLocked();
+
+    // Colunas de utilidade: inclusão, remoção (troca com o último), regravação das características de uma posição
+    // e reconstrução completa a partir do heap principal (ou descarte, sem pesos).
+    void UtilityInsert(uint32 Slot);
+    void UtilityRemove(uint32 Slot);
+    void WriteUtilityFeatures(int32 UtilityIndex, const FIQT_QueueItem& Item);
+    void RebuildUtilityColumnsLocked();
+
+    // Slot do item de maior pontuação entre todos os itens ou entre os CandidateWindow primeiros (CandidateWindow > 0).
+    // Requer pesos e a fila não vazia.
+    int32 FindBestScoredSlotLocked(int32 CandidateWindow) const;
+
+    // Visita os índices de heap dos Count primeiros itens na ordem de saída (seleção parcial, O(Count log Count)).
+    void ForEachTopKIndexLocked(int32 Count, TFunctionRef<void(int32)> Visitor) const;
+
+    // Copia para OutBuckets os buckets que satisfazem a consulta (a entrada do cache pode ser substituída por outro leitor).
+    void ResolveQueryBuckets(const FGameplayTagQuery& Query, FQueryBucketList& OutBuckets) const;
+
+    // Slot do primeiro item (na ordem de saída) que satisfaz a consulta, ou INDEX_NONE.
+    int32 FindFirstMatchingSlot(const FGameplayTagQuery& Query) const;
+
+    // Retira o registro do heap e libera o slot; o item é movido para OutData, se informado.
+    void RemoveAtHeapIndex(int32 HeapIndex, FIQT_QueueItem* OutData);
+
+    // Retira o registro do heap principal e dos secundários, sem liberar o slot.
+    void RemoveFromHeapsAt(int32 HeapIndex);
 
-    // TArray<FIQT_QueueItem> VerificationList; // REMOVIDO: Não é mais necessário para esta implementação.
+    // Tira o item dos índices e devolve o slot à lista livre. O registro já deve ter saído de todos os heaps.
+    void ReleaseSlotLocked(uint32 Slot, FIQT_QueueItem* OutData);
 
-    void InsertNode(UIQT_DynAINode* InNode);
-    void RemoveNode(UIQT_DynAINode* InNode);
-    bool ValidateList() const;
+    // Entre os slots candidatos em memória, o que sai primeiro da fila (INDEX_NONE se nenhum).
+    template <typename KeyType>
+    int32 FindFirstSlot(const TMultiMap<KeyType, uint32>& Index, const KeyType& Key) const;
 };
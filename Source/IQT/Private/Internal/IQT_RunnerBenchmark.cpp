@@ -0,0 +1,300 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_RunnerBenchmark.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+//
+// Benchmark de criação de UObjects do UIQT_RunQueuedActions (comando de console "iqt.Bench.RunnerObjects").
+//
+// Cria no mundo de jogo atual um ator temporário com ASC, uma UIQT_Queue com Items itens e uma habilidade base
+// que executa a fila. Um respondedor devolve a tag de fim de forma síncrona a cada evento de trigger, então o
+// executor processa aproximadamente um item por frame. Um listener do GUObjectArray conta os UObjects criados
+// durante a execução: com a espera reutilizável, UIQT_WaitForAction criadas deve ficar em 1 e o total de
+// objetos não deve crescer com o número de itens.
+//
+// Uso típico (precisa de um mundo de jogo, ex.: -game ou PIE):
+//   UnrealEditor-Cmd <Projeto>.uproject <Mapa> -game -nullrhi -unattended -nosplash -log
+//       -ExecCmds="iqt.Bench.RunnerObjects Items=10000 Exit=1"
+//
+// Argumentos (todos opcionais):
+//   Items=10000          Itens executados.
+//   Sample=1000          Intervalo (em itens) entre as amostras de contagem registradas no log.
+//   MaxSeconds=600       Tempo máximo antes de abortar a execução.
+//   Exit=1               Encerra o processo ao final (código 1 se mais de uma UIQT_WaitForAction for criada).
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "IQT_Queue.h"
+#include "IQT_RunQueuedActions.h"
+#include "IQT_WaitForAction.h"
+#include "IQT_Log.h"
+#include "AbilitySystemComponent.h"
+#include "Abilities/GameplayAbility.h"
+#include "Containers/Ticker.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformTime.h"
+#include "NativeGameplayTags.h"
+#include "UObject/UObjectArray.h"
+#include <atomic>
+
+namespace IQTRunnerBenchmark
+{
+    // Tags próprias do benchmark, para não colidir com habilidades reais do projeto.
+    UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_BenchTrigger, "IQT.Bench.Trigger");
+    UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_BenchEnd, "IQT.Bench.End");
+    UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_BenchFail, "IQT.Bench.Fail");
+
+    struct FRunnerBenchConfig
+    {
+        int32 Items = 10000;
+        int32 SampleEvery = 1000;
+        double MaxSeconds = 600.0;
+        bool bExitWhenDone = false;
+    };
+
+    // Conta UObjects criados enquanto registrado. Pode ser chamado de outras threads (carregamento assíncrono).
+    class FObjectCreationCounter : public FUObjectArray::FUObjectCreateListener
+    {
+    public:
+        FObjectCreationCounter()
+        {
+            GUObjectArray.AddUObjectCreateListener(this);
+        }
+
+        virtual ~FObjectCreationCounter()
+        {
+            Unregister();
+        }
+
+        virtual void NotifyUObjectCreated(const UObjectBase* Object, int32 Index) override
+        {
+            TotalCreated.fetch_add(1, std::memory_order_relaxed);
+            const UClass* ObjectClass = Object ? Object->GetClass() : nullptr;
+            if (ObjectClass && ObjectClass->IsChildOf(UIQT_WaitForAction::StaticClass()))
+            {
+                WaitTasksCreated.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        virtual void OnUObjectArrayShutdown() override
+        {
+            Unregister();
+        }
+
+        void Unregister()
+        {
+            if (bRegistered)
+            {
+                GUObjectArray.RemoveUObjectCreateListener(this);
+                bRegistered = false;
+            }
+        }
+
+        std::atomic<int64> TotalCreated{ 0 };
+        std::atomic<int64> WaitTasksCreated{ 0 };
+
+    private:
+        bool bRegistered = true;
+    };
+
+    struct FRunnerSample
+    {
+        int32 ItemsDispatched = 0;
+        int64 TotalCreated = 0;
+        int64 WaitTasksCreated = 0;
+    };
+
+    // Estado de uma execução, mantido vivo pelo ticker até o fim.
+    struct FRunnerBenchState
+    {
+        FRunnerBenchConfig Config;
+        TWeakObjectPtr<AActor> Actor;
+        TWeakObjectPtr<UAbilitySystemComponent> ASC;
+        TWeakObjectPtr<UIQT_RunQueuedActions> Runner;
+        FGameplayAbilitySpecHandle AbilityHandle;
+        FDelegateHandle ResponderHandle;
+        TUniquePtr<FObjectCreationCounter> Counter;
+        TArray<FRunnerSample> Samples;
+        int32 ItemsDispatched = 0;
+        double StartSeconds = 0.0;
+    };
+
+    static FRunnerBenchConfig ParseConfig(const TArray<FString>& Args)
+    {
+        FRunnerBenchConfig Config;
+        const FString Line = FString::Join(Args, TEXT(" "));
+        FParse::Value(*Line, TEXT("Items="), Config.Items);
+        FParse::Value(*Line, TEXT("Sample="), Config.SampleEvery);
+        FParse::Value(*Line, TEXT("MaxSeconds="), Config.MaxSeconds);
+        int32 ExitFlag = 0;
+        FParse::Value(*Line, TEXT("Exit="), ExitFlag);
+        Config.bExitWhenDone = ExitFlag != 0;
+
+        Config.Items = FMath::Max(1, Config.Items);
+        Config.SampleEvery = FMath::Clamp(Config.SampleEvery, 1, Config.Items);
+        return Config;
+    }
+
+    static void TakeSample(FRunnerBenchState& State)
+    {
+        FRunnerSample& Sample = State.Samples.AddDefaulted_GetRef();
+        Sample.ItemsDispatched = State.ItemsDispatched;
+        Sample.TotalCreated = State.Counter->TotalCreated.load(std::memory_order_relaxed);
+        Sample.WaitTasksCreated = State.Counter->WaitTasksCreated.load(std::memory_order_relaxed);
+    }
+
+    static void Finish(FRunnerBenchState& State, bool bCompleted)
+    {
+        TakeSample(State);
+        State.Counter->Unregister();
+        const double Elapsed = FPlatformTime::Seconds() - State.StartSeconds;
+
+        if (UAbilitySystemComponent* ASC = State.ASC.Get())
+        {
+            if (FGameplayEventMulticastDelegate* Delegate = ASC->GenericGameplayEventCallbacks.Find(TAG_BenchTrigger))
+            {
+                Delegate->Remove(State.ResponderHandle);
+            }
+            ASC->ClearAbility(State.AbilityHandle);
+        }
+        if (AActor* Actor = State.Actor.Get())
+        {
+            Actor->Destroy();
+        }
+
+        for (const FRunnerSample& Sample : State.Samples)
+        {
+            UE_LOG(LogIQT, Display, TEXT("IQT.Bench.RunnerObjects: %6d itens | UObjects criados: %lld | UIQT_WaitForAction criadas: %lld"),
+                Sample.ItemsDispatched, Sample.TotalCreated, Sample.WaitTasksCreated);
+        }
+
+        // Objetos por item em regime: descarta a primeira amostra, que inclui a criação da espera e o aquecimento.
+        const FRunnerSample& First = State.Samples[0];
+        const FRunnerSample& Last = State.Samples.Last();
+        const int32 SteadyItems = Last.ItemsDispatched - First.ItemsDispatched;
+        const double ObjectsPerItem = SteadyItems > 0 ? static_cast<double>(Last.TotalCreated - First.TotalCreated) / SteadyItems : 0.0;
+
+        const bool bPass = bCompleted && Last.WaitTasksCreated <= 1;
+        UE_LOG(LogIQT, Display, TEXT("IQT.Bench.RunnerObjects: %s. %d/%d itens em %.2fs, %lld UObjects criados (%.3f por item em regime), %lld UIQT_WaitForAction."),
+            bPass ? TEXT("PASS") : TEXT("FAIL"), State.ItemsDispatched, State.Config.Items, Elapsed, Last.TotalCreated, ObjectsPerItem, Last.WaitTasksCreated);
+
+        if (State.Config.bExitWhenDone)
+        {
+            FPlatformMisc::RequestExitWithStatus(false, bPass ? 0 : 1);
+        }
+    }
+
+    static void Run(const TArray<FString>& Args, UWorld* World)
+    {
+        if (!World || !World->IsGameWorld())
+        {
+            UE_LOG(LogIQT, Error, TEXT("IQT.Bench.RunnerObjects: requer um mundo de jogo (-game ou PIE)."));
+            return;
+        }
+
+        TSharedRef<FRunnerBenchState> State = MakeShared<FRunnerBenchState>();
+        State->Config = ParseConfig(Args);
+
+        FActorSpawnParameters SpawnParams;
+        SpawnParams.ObjectFlags |= RF_Transient;
+        AActor* Actor = World->SpawnActor<AActor>(SpawnParams);
+        if (!Actor)
+        {
+            UE_LOG(LogIQT, Error, TEXT("IQT.Bench.RunnerObjects: falha ao criar o ator do benchmark."));
+            return;
+        }
+        State->Actor = Actor;
+
+        UAbilitySystemComponent* ASC = NewObject<UAbilitySystemComponent>(Actor, TEXT("IQTBenchASC"));
+        ASC->RegisterComponent();
+        ASC->InitAbilityActorInfo(Actor, Actor);
+        State->ASC = ASC;
+
+        UIQT_Queue* Queue = NewObject<UIQT_Queue>(Actor, TEXT("IQTBenchQueue"));
+        Queue->QueueName = TEXT("IQTBenchRunner");
+        Queue->EnqueueMode = EIQT_QueueMode::FIFO;
+        Queue->MaxQueueSize = State->Config.Items;
+        Queue->InitializeQueue();
+        for (int32 Index = 0; Index < State->Config.Items; ++Index)
+        {
+            FIQT_QueueItem Item;
+            Item.Name = FName(TEXT("IQTBenchRunnerItem"), Index + 1);
+            Item.AbilityTriggerTag = TAG_BenchTrigger;
+            Item.AbilityEndTag = TAG_BenchEnd;
+            Item.AbilityFailTag = TAG_BenchFail;
+            Item.bIsOpen = true;
+            Queue->EnqueueItem(Item);
+        }
+
+        // A habilidade base não termina sozinha: serve apenas de dona para o executor.
+        State->AbilityHandle = ASC->GiveAbility(FGameplayAbilitySpec(UGameplayAbility::StaticClass()));
+        ASC->TryActivateAbility(State->AbilityHandle);
+        const FGameplayAbilitySpec* Spec = ASC->FindAbilitySpecFromHandle(State->AbilityHandle);
+        UGameplayAbility* Ability = Spec ? Spec->GetPrimaryInstance() : nullptr;
+        if (!Ability || !Ability->IsActive())
+        {
+            UE_LOG(LogIQT, Error, TEXT("IQT.Bench.RunnerObjects: não foi possível ativar a habilidade do benchmark."));
+            Actor->Destroy();
+            return;
+        }
+
+        // Respondedor síncrono: cada trigger é concluído imediatamente com a tag de fim.
+        TWeakPtr<FRunnerBenchState> WeakState = State;
+        State->ResponderHandle = ASC->GenericGameplayEventCallbacks.FindOrAdd(TAG_BenchTrigger).AddLambda(
+            [WeakState](const FGameplayEventData* Payload)
+            {
+                TSharedPtr<FRunnerBenchState> PinnedState = WeakState.Pin();
+                UAbilitySystemComponent* ResponderASC = PinnedState ? PinnedState->ASC.Get() : nullptr;
+                if (!ResponderASC)
+                {
+                    return;
+                }
+                if (++PinnedState->ItemsDispatched % PinnedState->Config.SampleEvery == 0)
+                {
+                    TakeSample(*PinnedState);
+                }
+                FGameplayEventData Reply;
+                Reply.EventTag = TAG_BenchEnd;
+                Reply.OptionalObject = Payload ? Payload->OptionalObject : nullptr;
+                ResponderASC->HandleGameplayEvent(TAG_BenchEnd, &Reply);
+            });
+
+        UE_LOG(LogIQT, Display, TEXT("IQT.Bench.RunnerObjects: executando %d itens (aprox. um por frame)..."), State->Config.Items);
+
+        // A contagem começa imediatamente antes do executor, para medir só o custo por item.
+        State->Counter = MakeUnique<FObjectCreationCounter>();
+        State->StartSeconds = FPlatformTime::Seconds();
+        UIQT_RunQueuedActions* Runner = UIQT_RunQueuedActions::IQT_RunQueuedActions(Ability, Queue);
+        State->Runner = Runner;
+        Runner->ReadyForActivation();
+
+        FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([State](float DeltaTime)
+        {
+            const UIQT_RunQueuedActions* ActiveRunner = State->Runner.Get();
+            if (!ActiveRunner || ActiveRunner->IsFinished())
+            {
+                Finish(*State, State->ItemsDispatched >= State->Config.Items);
+                return false;
+            }
+            if (FPlatformTime::Seconds() - State->StartSeconds > State->Config.MaxSeconds)
+            {
+                UE_LOG(LogIQT, Error, TEXT("IQT.Bench.RunnerObjects: tempo máximo de %.0fs excedido."), State->Config.MaxSeconds);
+                Finish(*State, false);
+                return false;
+            }
+            return true;
+        }));
+    }
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdIQTBenchRunnerObjects(
+    TEXT("iqt.Bench.RunnerObjects"),
+    TEXT("Executa Items ações pelo UIQT_RunQueuedActions e reporta quantos UObjects foram criados. Ver IQT_RunnerBenchmark.cpp para os argumentos."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&IQTRunnerBenchmark::Run));
+
+#endif // !UE_BUILD_SHIPPING
@@ -0,0 +1,463 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_SpillRun.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_SpillRun.h"
+#include "IQT_Log.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "UObject/UObjectGlobals.h"
+#include <atomic>
+
+namespace IQTSpillRun
+{
+    static constexpr uint32 Magic = 0x52545149; // "IQTR"
+    static constexpr uint32 Version = 3;
+
+    // Bits do filtro de Bloom por registro (três chaves por registro, duas sondas por chave).
+    static constexpr int32 FilterBitsPerRecord = 16;
+
+    // Sementes que separam handles, chaves e TaskIDs no mesmo filtro.
+    static constexpr uint32 HandleSeed = 0x68A3D1F5u;
+    static constexpr uint32 KeySeed = 0x2C1B3C6Du;
+    static constexpr uint32 TaskIDSeed = 0x297A2D39u;
+
+    static std::atomic<uint32> NextRunId{ 1 };
+
+    static uint32 HashHandle(uint32 Slot, uint32 Generation)
+    {
+        return HashCombineFast(HashCombineFast(Slot, Generation), HandleSeed);
+    }
+
+    struct FFileHeader
+    {
+        uint32 Magic;
+        uint32 Version;
+        int32 NumRecords;
+        int32 NumOpen;
+    };
+
+    // Junta os UObjects de um item pelo mesmo caminho usado pelo GC (UIQT_PriorityQueueInternal::AddReferencedObjects).
+    class FObjectGatherer : public FReferenceCollector
+    {
+    public:
+        explicit FObjectGatherer(TSet<UObject*>& InObjects) : Objects(InObjects) {}
+
+        virtual bool IsIgnoringArchetypeRef() const override { return false; }
+        virtual bool IsIgnoringTransient() const override { return false; }
+        virtual void HandleObjectReference(UObject*& InObject, const UObject* InReferencingObject, const FProperty* InReferencingProperty) override
+        {
+            if (InObject)
+            {
+                Objects.Add(InObject);
+            }
+        }
+
+    private:
+        TSet<UObject*>& Objects;
+    };
+
+    // Serializa as propriedades do item sem tags: compacto e suficiente para ler de volta no mesmo processo.
+    static void SerializeItem(FArchive& InnerAr, FIQT_QueueItem& Item)
+    {
+        FObjectAndNameAsStringProxyArchive Ar(InnerAr, /*bInLoadIfFindFails*/ false);
+        Ar.SetUseUnversionedPropertySerialization(true);
+        FIQT_QueueItem::StaticStruct()->SerializeItem(Ar, &Item, nullptr);
+    }
+}
+
+FIQT_SpillRun::~FIQT_SpillRun()
+{
+    // O mapeamento precisa ser desfeito antes de apagar o arquivo (obrigatório no Windows).
+    MappedRegion.Reset();
+    MappedFile.Reset();
+    FileReader.Reset();
+    if (!Path.IsEmpty())
+    {
+        IFileManager::Get().Delete(*Path, /*RequireExists*/ false, /*EvenReadOnly*/ true, /*Quiet*/ true);
+    }
+}
+
+TUniquePtr<FIQT_SpillRun> FIQT_SpillRun::Write(const FString& Directory, TConstArrayView<FEntry> Entries)
+{
+    if (Entries.Num() == 0)
+    {
+        return nullptr;
+    }
+
+    TUniquePtr<FIQT_SpillRun> Run(new FIQT_SpillRun());
+    Run->Id = IQTSpillRun::NextRunId.fetch_add(1, std::memory_order_relaxed);
+    const int32 NumFilterBits = FMath::RoundUpToPowerOfTwo(FMath::Max(64, Entries.Num() * IQTSpillRun::FilterBitsPerRecord));
+    Run->FilterBits.SetNumZeroed(NumFilterBits / 64);
+    Run->Path = FPaths::Combine(Directory, FString::Printf(TEXT("IQT-%s.run"), *FGuid::NewGuid().ToString(EGuidFormats::Digits)));
+
+    IFileManager::Get().MakeDirectory(*Directory, /*Tree*/ true);
+    TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Run->Path));
+    if (!Writer)
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SpillRun: Não foi possível criar o arquivo de run '%s'."), *Run->Path);
+        Run->Path.Reset();
+        return nullptr;
+    }
+
+    // O cabeçalho do arquivo é regravado ao final, quando a contagem de abertos é conhecida.
+    IQTSpillRun::FFileHeader FileHeader = { IQTSpillRun::Magic, IQTSpillRun::Version, Entries.Num(), 0 };
+    Writer->Serialize(&FileHeader, sizeof(FileHeader));
+
+    TSet<UObject*> Objects;
+    IQTSpillRun::FObjectGatherer Gatherer(Objects);
+    TArray<uint8> Payload;
+    for (int32 Index = 0; Index < Entries.Num(); ++Index)
+    {
+        const FEntry& Entry = Entries[Index];
+        FIQT_QueueItem& Item = const_cast<FIQT_QueueItem&>(*Entry.Item);
+
+        Payload.Reset();
+        FMemoryWriter PayloadWriter(Payload);
+        IQTSpillRun::SerializeItem(PayloadWriter, Item);
+
+        Gatherer.AddReferencedObject(Item.UserPayload);
+        Item.DispatchData.AddStructReferencedObjects(Gatherer);
+
+        FIQT_SpillRecordHeader Header = {};
+        Header.SortKey = Entry.SortKey;
+        Header.Sequence = Entry.Sequence;
+        Header.Priority = Item.Priority;
+        Header.Slot = Item.Handle.GetSlot();
+        Header.Generation = Item.Handle.GetGeneration();
+        Header.KeyHash = Entry.KeyHash;
+        Header.TaskIDHash = HashTaskID(Item.TaskID);
+        Header.bIsOpen = Item.bIsOpen ? 1 : 0;
+        Header.PayloadBytes = static_cast<uint32>(Payload.Num());
+        Writer->Serialize(&Header, sizeof(Header));
+        Writer->Serialize(Payload.GetData(), Payload.Num());
+
+        FileHeader.NumOpen += Header.bIsOpen;
+        Run->TagCounts.FindOrAdd(Item.AbilityTriggerTag)++;
+        Run->AddToFilter(IQTSpillRun::HashHandle(Header.Slot, Header.Generation));
+        Run->AddToFilter(HashCombineFast(Header.KeyHash, IQTSpillRun::KeySeed));
+        if (Header.TaskIDHash != 0)
+        {
+            Run->AddToFilter(HashCombineFast(Header.TaskIDHash, IQTSpillRun::TaskIDSeed));
+        }
+        if (Index == 0)
+        {
+            Run->Head = Header;
+        }
+    }
+
+    Writer->Seek(0);
+    Writer->Serialize(&FileHeader, sizeof(FileHeader));
+    const bool bWriteOk = !Writer->IsError() && Writer->Close();
+    if (!bWriteOk)
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SpillRun: Erro ao gravar o arquivo de run '%s' (disco cheio?)."), *Run->Path);
+        Writer.Reset();
+        return nullptr; // O destrutor apaga o arquivo parcial.
+    }
+    Writer.Reset();
+
+    Run->FileSize = IFileManager::Get().FileSize(*Run->Path);
+    Run->HeadOffset = sizeof(IQTSpillRun::FFileHeader); // O cabeçalho da cabeça já está em memória.
+    Run->NumRemaining = FileHeader.NumRecords;
+    Run->NumOpenRemaining = FileHeader.NumOpen;
+    Run->ReferencedObjects.Reserve(Objects.Num());
+    for (UObject* Object : Objects)
+    {
+        Run->ReferencedObjects.Add(Object);
+    }
+    return Run;
+}
+
+bool FIQT_SpillRun::OpenForRead()
+{
+    if (MappedRegion || FileReader)
+    {
+        return true;
+    }
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    FOpenMappedResult MappedResult = PlatformFile.OpenMappedEx(*Path);
+    if (MappedResult.HasValue())
+    {
+        MappedFile = MappedResult.StealValue();
+        MappedRegion.Reset(MappedFile->MapRegion(0, FileSize));
+        if (MappedRegion && MappedRegion->GetMappedSize() == FileSize)
+        {
+            return true;
+        }
+        MappedRegion.Reset();
+        MappedFile.Reset();
+    }
+
+    // Plataformas sem mapeamento de arquivos: leitura sequencial com buffer.
+    FileReader.Reset(IFileManager::Get().CreateFileReader(*Path));
+    if (!FileReader)
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SpillRun: Não foi possível abrir o arquivo de run '%s'."), *Path);
+        return false;
+    }
+    return true;
+}
+
+void FIQT_SpillRun::AddToFilter(uint32 Hash)
+{
+    // Duas sondas derivadas do mesmo hash (Kirsch-Mitzenmacher).
+    const uint32 Mask = static_cast<uint32>(FilterBits.Num() * 64 - 1);
+    const uint32 Second = (Hash >> 17 | Hash << 15) | 1u;
+    for (uint32 Probe = 0; Probe < 2; ++Probe)
+    {
+        const uint32 Bit = (Hash + Probe * Second) & Mask;
+        FilterBits[Bit >> 6] |= uint64(1) << (Bit & 63);
+    }
+}
+
+bool FIQT_SpillRun::FilterContains(uint32 Hash) const
+{
+    const uint32 Mask = static_cast<uint32>(FilterBits.Num() * 64 - 1);
+    const uint32 Second = (Hash >> 17 | Hash << 15) | 1u;
+    for (uint32 Probe = 0; Probe < 2; ++Probe)
+    {
+        const uint32 Bit = (Hash + Probe * Second) & Mask;
+        if ((FilterBits[Bit >> 6] & (uint64(1) << (Bit & 63))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FIQT_SpillRun::MayContainHandle(FIQT_ItemHandle Handle) const
+{
+    return !IsExhausted() && FilterContains(IQTSpillRun::HashHandle(Handle.GetSlot(), Handle.GetGeneration()));
+}
+
+bool FIQT_SpillRun::MayContainKey(uint32 KeyHash) const
+{
+    return !IsExhausted() && FilterContains(HashCombineFast(KeyHash, IQTSpillRun::KeySeed));
+}
+
+bool FIQT_SpillRun::MayContainTaskID(uint32 TaskIDHash) const
+{
+    return !IsExhausted() && TaskIDHash != 0 && FilterContains(HashCombineFast(TaskIDHash, IQTSpillRun::TaskIDSeed));
+}
+
+bool FIQT_SpillRun::ReadHeader(int64& Offset, FIQT_SpillRecordHeader& OutHeader)
+{
+    if (Offset < 0 || Offset + int64(sizeof(OutHeader)) > FileSize)
+    {
+        return false;
+    }
+    if (MappedRegion)
+    {
+        FMemory::Memcpy(&OutHeader, MappedRegion->GetMappedPtr() + Offset, sizeof(OutHeader));
+    }
+    else
+    {
+        if (FileReader->Tell() != Offset)
+        {
+            FileReader->Seek(Offset);
+        }
+        FileReader->Serialize(&OutHeader, sizeof(OutHeader));
+        if (FileReader->IsError())
+        {
+            return false;
+        }
+    }
+    Offset += sizeof(OutHeader);
+    return true;
+}
+
+bool FIQT_SpillRun::ReadPayload(int64& Offset, uint32 PayloadBytes, FIQT_QueueItem& OutItem)
+{
+    if (Offset + int64(PayloadBytes) > FileSize)
+    {
+        return false;
+    }
+    TConstArrayView<uint8> Bytes;
+    if (MappedRegion)
+    {
+        Bytes = MakeArrayView(MappedRegion->GetMappedPtr() + Offset, static_cast<int32>(PayloadBytes));
+    }
+    else
+    {
+        if (FileReader->Tell() != Offset)
+        {
+            FileReader->Seek(Offset);
+        }
+        Scratch.SetNumUninitialized(static_cast<int32>(PayloadBytes), EAllowShrinking::No);
+        FileReader->Serialize(Scratch.GetData(), PayloadBytes);
+        if (FileReader->IsError())
+        {
+            return false;
+        }
+        Bytes = Scratch;
+    }
+    Offset += PayloadBytes;
+
+    FMemoryReaderView Reader(Bytes);
+    OutItem = FIQT_QueueItem();
+    IQTSpillRun::SerializeItem(Reader, OutItem);
+    return !Reader.IsError();
+}
+
+bool FIQT_SpillRun::ReadNext(FIQT_QueueItem& OutItem, FIQT_SpillRecordHeader& OutHeader)
+{
+    if (IsExhausted())
+    {
+        return false;
+    }
+    int64 Offset = HeadOffset + sizeof(FIQT_SpillRecordHeader);
+    if (!OpenForRead() || !ReadPayload(Offset, Head.PayloadBytes, OutItem))
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SpillRun: Erro de leitura em '%s'; %d itens perdidos."), *Path, NumRemaining);
+        MarkExhausted(/*bError*/ true);
+        return false;
+    }
+
+    OutHeader = Head;
+    OutItem.Handle = FIQT_ItemHandle(Head.Slot, Head.Generation);
+    Forget(OutItem);
+    if (NumRemaining > 0 && !SeekHead(Offset))
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SpillRun: Cabeçalho inválido em '%s'; %d itens perdidos."), *Path, NumRemaining);
+        MarkExhausted(/*bError*/ true);
+    }
+    if (IsExhausted())
+    {
+        // Nada mais será lido: libera o mapeamento e as referências antes da destruição da run.
+        MarkExhausted(/*bError*/ false);
+    }
+    return true;
+}
+
+bool FIQT_SpillRun::SeekHead(int64 Offset)
+{
+    while (true)
+    {
+        const int64 RecordOffset = Offset;
+        if (!ReadHeader(Offset, Head))
+        {
+            return false;
+        }
+        if (RemovedOffsets.Remove(RecordOffset) == 0)
+        {
+            HeadOffset = RecordOffset;
+            return true;
+        }
+        Offset += Head.PayloadBytes;
+    }
+}
+
+bool FIQT_SpillRun::ForEachRecord(int64 StartOffset, TFunctionRef<bool(const FIQT_SpillRecordHeader&)> HeaderFilter,
+    TFunctionRef<bool(int64 RecordOffset, const FIQT_SpillRecordHeader& Header, FIQT_QueueItem& Item)> Visitor, int64* OutNextOffset)
+{
+    FScopeLock ScopeLock(&RandomReadMutex);
+    if (OutNextOffset)
+    {
+        *OutNextOffset = FileSize;
+    }
+    if (IsExhausted())
+    {
+        return true;
+    }
+    if (!OpenForRead())
+    {
+        return false;
+    }
+
+    FIQT_QueueItem Item;
+    int64 Offset = FMath::Max(StartOffset, HeadOffset);
+    while (Offset < FileSize)
+    {
+        const int64 RecordOffset = Offset;
+        FIQT_SpillRecordHeader Header;
+        if (!ReadHeader(Offset, Header))
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SpillRun: Cabeçalho inválido em %lld de '%s'."), RecordOffset, *Path);
+            return false;
+        }
+        if (RemovedOffsets.Contains(RecordOffset) || !HeaderFilter(Header))
+        {
+            Offset += Header.PayloadBytes;
+            continue;
+        }
+        if (!ReadPayload(Offset, Header.PayloadBytes, Item))
+        {
+            UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SpillRun: Erro ao ler o registro em %lld de '%s'."), RecordOffset, *Path);
+            return false;
+        }
+        Item.Handle = FIQT_ItemHandle(Header.Slot, Header.Generation);
+        if (!Visitor(RecordOffset, Header, Item))
+        {
+            if (OutNextOffset)
+            {
+                *OutNextOffset = Offset;
+            }
+            return true;
+        }
+    }
+    return true;
+}
+
+bool FIQT_SpillRun::IsLive(int64 RecordOffset) const
+{
+    return !IsExhausted() && RecordOffset >= HeadOffset && RecordOffset < FileSize && !RemovedOffsets.Contains(RecordOffset);
+}
+
+void FIQT_SpillRun::Remove(int64 RecordOffset, const FIQT_QueueItem& Item)
+{
+    check(IsLive(RecordOffset));
+    Forget(Item);
+    if (RecordOffset != HeadOffset)
+    {
+        RemovedOffsets.Add(RecordOffset);
+    }
+    else if (NumRemaining > 0 && !(OpenForRead() && SeekHead(HeadOffset + sizeof(FIQT_SpillRecordHeader) + Head.PayloadBytes)))
+    {
+        UE_LOG(LogIQTInternal, Error, TEXT("FIQT_SpillRun: Cabeçalho inválido em '%s'; %d itens perdidos."), *Path, NumRemaining);
+        MarkExhausted(/*bError*/ true);
+    }
+    if (IsExhausted())
+    {
+        MarkExhausted(/*bError*/ false);
+    }
+}
+
+void FIQT_SpillRun::Forget(const FIQT_QueueItem& Item)
+{
+    NumRemaining--;
+    NumOpenRemaining -= Item.bIsOpen ? 1 : 0;
+    int32* TagCount = TagCounts.Find(Item.AbilityTriggerTag);
+    if (TagCount && --*TagCount == 0)
+    {
+        TagCounts.Remove(Item.AbilityTriggerTag);
+    }
+}
+
+void FIQT_SpillRun::MarkExhausted(bool bError)
+{
+    bReadError |= bError;
+    NumRemaining = 0;
+    NumOpenRemaining = 0;
+    TagCounts.Empty();
+    RemovedOffsets.Empty();
+    FilterBits.Empty();
+    MappedRegion.Reset();
+    MappedFile.Reset();
+    FileReader.Reset();
+    ReferencedObjects.Empty();
+}
+
+void FIQT_SpillRun::AddReferencedObjects(FReferenceCollector& Collector)
+{
+    Collector.AddReferencedObjects(ReferencedObjects);
+}
@@ -0,0 +1,161 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_SpillRun.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "GameplayTagContainer.h"
+#include "IQT_DataTypes.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+class FReferenceCollector;
+
+// Cabeçalho de um registro no arquivo de run. Também é a "cabeça" da run mantida em memória para o merge.
+struct FIQT_SpillRecordHeader
+{
+    int32 SortKey;
+    uint32 Sequence;
+    int32 Priority;
+    uint32 Slot;            // Slot e geração do handle do item: a fila o resolve pela run enquanto ele está em disco.
+    uint32 Generation;
+    uint32 KeyHash;         // Hashes da chave de igualdade e do TaskID (0 sem TaskID): as buscas comparam o
+    uint32 TaskIDHash;      // cabeçalho antes de ler o item.
+    uint8 bIsOpen;
+    uint8 Pad[3];
+    uint32 PayloadBytes;    // Tamanho do FIQT_QueueItem serializado que segue o cabeçalho.
+};
+static_assert(sizeof(FIQT_SpillRecordHeader) == 36, "FIQT_SpillRecordHeader é gravado byte a byte no arquivo de run.");
+
+/**
+ * FIQT_SpillRun: Arquivo de run da fila (modo spill), com itens já em ordem de saída.
+ * - Escrito uma única vez, sequencialmente (Write). Lido sequencialmente por um mapeamento de memória aberto apenas
+ *   na primeira leitura; se o mapeamento não estiver disponível, usa um leitor de arquivo com buffer.
+ * - Em memória fica só o resumo da run: contagens (por tag inclusive), a cabeça, a posição de leitura, os registros
+ *   removidos fora de ordem e um filtro de Bloom (2 bytes por registro) de handles, chaves e TaskIDs. Buscas e
+ *   operações em lote da fila percorrem o arquivo (ForEachRecord) sem mover a cabeça; um item pode sair da run fora
+ *   de ordem (Remove) e o seu registro passa a ser ignorado.
+ * - Os itens são serializados pelas propriedades de FIQT_QueueItem (sem tags de versão: o arquivo só vive enquanto
+ *   o processo vive). UObjects são gravados pelo caminho e mantidos vivos pela run (AddReferencedObjects) até ela
+ *   ser consumida, para que o caminho continue resolvendo.
+ * - O arquivo é apagado quando a run é destruída.
+ */
+class FIQT_SpillRun
+{
+public:
+    struct FEntry
+    {
+        int32 SortKey;
+        uint32 Sequence;
+        uint32 KeyHash;
+        const FIQT_QueueItem* Item;
+    };
+
+    ~FIQT_SpillRun();
+
+    // Grava Entries (em ordem de saída) em um arquivo novo em Directory. Retorna nullptr em caso de erro.
+    static TUniquePtr<FIQT_SpillRun> Write(const FString& Directory, TConstArrayView<FEntry> Entries);
+
+    // Hash gravado em FIQT_SpillRecordHeader::TaskIDHash (0 para TaskID inválido).
+    static uint32 HashTaskID(const FGuid& TaskID) { return TaskID.IsValid() ? (GetTypeHash(TaskID) | 1u) : 0u; }
+
+    // Filtro de Bloom da run: false garante que nenhum registro gravado tem o handle, a chave ou o TaskID.
+    bool MayContainHandle(FIQT_ItemHandle Handle) const;
+    bool MayContainKey(uint32 KeyHash) const;
+    bool MayContainTaskID(uint32 TaskIDHash) const;
+
+    // Identificador único no processo (posições de registros só valem junto com a run).
+    uint32 GetId() const { return Id; }
+
+    // Registros ainda na run: nem lidos por ReadNext nem removidos.
+    bool IsExhausted() const { return NumRemaining == 0; }
+    int32 GetNumRemaining() const { return NumRemaining; }
+    int32 GetNumOpenRemaining() const { return NumOpenRemaining; }
+    const TMap<FGameplayTag, int32>& GetTagCounts() const { return TagCounts; }
+
+    // Cabeçalho do próximo item (válido enquanto !IsExhausted()).
+    const FIQT_SpillRecordHeader& GetHead() const { return Head; }
+
+    // Chave da cabeça na época de envelhecimento atual da fila: as chaves gravadas são da época em que a run foi
+    // escrita, e cada avanço posterior da época (ShiftKeys) as desloca sem reescrever o arquivo.
+    int32 GetHeadSortKey() const { return ShiftSortKey(Head.SortKey); }
+    int32 ShiftSortKey(int32 WrittenKey) const { return static_cast<int32>(FMath::Clamp(int64(WrittenKey) - KeyShift, int64(MIN_int32), int64(MAX_int32))); }
+    void ShiftKeys(int64 Delta) { KeyShift += Delta; }
+
+    // Lê o próximo item (com o handle do cabeçalho) e avança a cabeça, pulando registros removidos. Retorna false em
+    // erro de leitura (a run é dada como esgotada). Exige acesso exclusivo à run (a fila chama com a trava de escrita).
+    bool ReadNext(FIQT_QueueItem& OutItem, FIQT_SpillRecordHeader& OutHeader);
+
+    // Percorre os registros ainda na run a partir de StartOffset (0 = da cabeça), na ordem do arquivo, sem mover a
+    // cabeça. Só os registros aceitos por HeaderFilter têm o item lido e entregue ao Visitor, que retorna false para
+    // parar; OutNextOffset recebe onde continuar (GetFileSize() ao fim). Pode rodar em várias threads ao mesmo tempo,
+    // mas não junto com ReadNext/Remove. Retorna false em erro de leitura.
+    bool ForEachRecord(int64 StartOffset, TFunctionRef<bool(const FIQT_SpillRecordHeader&)> HeaderFilter,
+        TFunctionRef<bool(int64 RecordOffset, const FIQT_SpillRecordHeader& Header, FIQT_QueueItem& Item)> Visitor, int64* OutNextOffset = nullptr);
+
+    // O registro em RecordOffset ainda está na run (nem lido por ReadNext nem removido).
+    bool IsLive(int64 RecordOffset) const;
+
+    // Tira da run o registro em RecordOffset (vivo; Item é o item dele). Exige acesso exclusivo à run.
+    void Remove(int64 RecordOffset, const FIQT_QueueItem& Item);
+
+    // Uma leitura falhou e os itens ainda não lidos se perderam.
+    bool HasReadError() const { return bReadError; }
+
+    int64 GetFileSize() const { return FileSize; }
+
+    // Memória do resumo mantido para a run (filtro, contagens, registros removidos), em bytes.
+    SIZE_T GetAllocatedSize() const
+    {
+        return sizeof(*this) + FilterBits.GetAllocatedSize() + TagCounts.GetAllocatedSize() + RemovedOffsets.GetAllocatedSize()
+            + ReferencedObjects.GetAllocatedSize() + Scratch.GetAllocatedSize();
+    }
+    const FString& GetPath() const { return Path; }
+
+    void AddReferencedObjects(FReferenceCollector& Collector);
+
+private:
+    FIQT_SpillRun() = default;
+
+    bool OpenForRead();
+    // Leem a partir de Offset e o avançam. Sem mapeamento, reposicionam o leitor se ele estiver em outro ponto.
+    bool ReadHeader(int64& Offset, FIQT_SpillRecordHeader& OutHeader);
+    bool ReadPayload(int64& Offset, uint32 PayloadBytes, FIQT_QueueItem& OutItem);
+    // Posiciona a cabeça no primeiro registro não removido a partir de Offset.
+    bool SeekHead(int64 Offset);
+    // Desconta das contagens um item que saiu da run.
+    void Forget(const FIQT_QueueItem& Item);
+    void MarkExhausted(bool bError);
+
+    void AddToFilter(uint32 Hash);
+    bool FilterContains(uint32 Hash) const;
+
+    FString Path;
+    uint32 Id = 0;
+    int64 FileSize = 0;
+    int64 HeadOffset = 0;           // Início do registro da cabeça (o cabeçalho já está em Head).
+    int32 NumRemaining = 0;
+    int32 NumOpenRemaining = 0;
+    FIQT_SpillRecordHeader Head = {};
+    int64 KeyShift = 0;
+    bool bReadError = false;
+
+    TMap<FGameplayTag, int32> TagCounts;
+    TSet<int64> RemovedOffsets;     // Registros à frente da cabeça já tirados da run (Remove).
+    TArray<uint64> FilterBits;      // Potência de 2 de bits.
+
+    // Serializa as leituras fora da cabeça entre si (abertura do arquivo, leitor e Scratch são compartilhados).
+    FCriticalSection RandomReadMutex;
+
+    TUniquePtr<IMappedFileHandle> MappedFile;
+    TUniquePtr<IMappedFileRegion> MappedRegion;
+    TUniquePtr<FArchive> FileReader;    // Alternativa ao mapeamento.
+    TArray<uint8> Scratch;
+
+    // UObjects referenciados pelos itens gravados (UserPayload e DispatchData), sem repetição.
+    TArray<TObjectPtr<UObject>> ReferencedObjects;
+};
@@ -0,0 +1,125 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_Stats.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_Stats.h"
+#include "HAL/PlatformTime.h"
+
+DEFINE_STAT(STAT_IQT_Enqueue);
+DEFINE_STAT(STAT_IQT_Dequeue);
+DEFINE_STAT(STAT_IQT_Lookup);
+DEFINE_STAT(STAT_IQT_Remove);
+DEFINE_STAT(STAT_IQT_Bulk);
+DEFINE_STAT(STAT_IQT_RunnerStep);
+DEFINE_STAT(STAT_IQT_RunnerCallback);
+DEFINE_STAT(STAT_IQT_QueuedItems);
+DEFINE_STAT(STAT_IQT_InFlightActions);
+DEFINE_STAT(STAT_IQT_Operations);
+
+UE_TRACE_CHANNEL_DEFINE(IQTChannel);
+
+TSharedRef<FIQT_QueueCounters> FIQT_QueueCounters::FindOrAdd(FName QueueName)
+{
+    static FCriticalSection RegistryMutex;
+    static TMap<FName, TSharedRef<FIQT_QueueCounters>> Registry;
+
+    FScopeLock ScopeLock(&RegistryMutex);
+    if (const TSharedRef<FIQT_QueueCounters>* Found = Registry.Find(QueueName))
+    {
+        return *Found;
+    }
+    return Registry.Add(QueueName, MakeShared<FIQT_QueueCounters>(QueueName.ToString()));
+}
+
+FIQT_QueueCounters::FIQT_QueueCounters(const FString& InQueueName)
+    : DepthName(FString::Printf(TEXT("IQT/%s/Depth"), *InQueueName))
+    , OpsName(FString::Printf(TEXT("IQT/%s/OpsPerSecond"), *InQueueName))
+    , InFlightName(FString::Printf(TEXT("IQT/%s/InFlight"), *InQueueName))
+    , OpsInWindow(0)
+    , Depth(0)
+    , InFlight(0)
+    , WindowStartSeconds(FPlatformTime::Seconds())
+    , LastOpsPerSecond(0.0f)
+{
+    // Sem nome (fila sem QueueName): só as contagens locais, sem stats nem contadores de trace.
+    if (InQueueName.IsEmpty())
+    {
+        return;
+    }
+#if COUNTERSTRACE_ENABLED
+    // Os nomes ficam vivos nos membros FString: o contador guarda apenas o ponteiro.
+    DepthCounter = MakeUnique<FCountersTrace::FCounterAtomicInt>(*DepthName, TraceCounterDisplayHint_None);
+    OpsCounter = MakeUnique<FCountersTrace::FCounterAtomicInt>(*OpsName, TraceCounterDisplayHint_None);
+    InFlightCounter = MakeUnique<FCountersTrace::FCounterAtomicInt>(*InFlightName, TraceCounterDisplayHint_None);
+#endif
+
+#if STATS
+    DepthStatName = FDynamicStats::CreateStatIdInt64<FStatGroup_STATGROUP_IQT>(DepthName).GetName();
+    OpsStatName = FDynamicStats::CreateStatIdInt64<FStatGroup_STATGROUP_IQT>(OpsName).GetName();
+    InFlightStatName = FDynamicStats::CreateStatIdInt64<FStatGroup_STATGROUP_IQT>(InFlightName).GetName();
+#endif
+}
+
+void FIQT_QueueCounters::AddDepth(int32 Delta)
+{
+    const int32 NewDepth = FMath::Max(0, Depth.fetch_add(Delta, std::memory_order_relaxed) + Delta);
+#if COUNTERSTRACE_ENABLED
+    if (DepthCounter)
+    {
+        DepthCounter->Set(NewDepth);
+    }
+#endif
+#if STATS
+    if (!DepthStatName.IsNone())
+    {
+        SET_DWORD_STAT_FName(DepthStatName, NewDepth);
+    }
+#endif
+}
+
+void FIQT_QueueCounters::AddOperations(int32 NumOperations)
+{
+    OpsInWindow.fetch_add(NumOperations, std::memory_order_relaxed);
+
+    // A cada segundo, uma única thread publica a taxa da janela e abre a próxima.
+    const double Now = FPlatformTime::Seconds();
+    double WindowStart = WindowStartSeconds.load(std::memory_order_relaxed);
+    const double Elapsed = Now - WindowStart;
+    if (Elapsed >= 1.0 && WindowStartSeconds.compare_exchange_strong(WindowStart, Now, std::memory_order_relaxed))
+    {
+        const int32 WindowOps = OpsInWindow.exchange(0, std::memory_order_relaxed);
+        const float OpsPerSecond = static_cast<float>(WindowOps / Elapsed);
+        LastOpsPerSecond.store(OpsPerSecond, std::memory_order_relaxed);
+#if COUNTERSTRACE_ENABLED
+        if (OpsCounter)
+        {
+            OpsCounter->Set(static_cast<int64>(OpsPerSecond));
+        }
+#endif
+#if STATS
+        if (!OpsStatName.IsNone())
+        {
+            SET_DWORD_STAT_FName(OpsStatName, static_cast<uint32>(OpsPerSecond));
+        }
+#endif
+    }
+}
+
+void FIQT_QueueCounters::AddInFlight(int32 Delta)
+{
+    const int32 NewInFlight = FMath::Max(0, InFlight.fetch_add(Delta, std::memory_order_relaxed) + Delta);
+#if COUNTERSTRACE_ENABLED
+    if (InFlightCounter)
+    {
+        InFlightCounter->Set(NewInFlight);
+    }
+#endif
+#if STATS
+    if (!InFlightStatName.IsNone())
+    {
+        SET_DWORD_STAT_FName(InFlightStatName, NewInFlight);
+    }
+#endif
+}
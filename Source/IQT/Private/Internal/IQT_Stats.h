@@ -0,0 +1,89 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_Stats.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include <atomic>
+
+// Grupo de estatísticas da IQT: "stat IQT" no console.
+DECLARE_STATS_GROUP(TEXT("IQT"), STATGROUP_IQT, STATCAT_Advanced);
+
+// Escopos de tempo das operações da fila e do executor.
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enqueue"), STAT_IQT_Enqueue, STATGROUP_IQT, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Dequeue"), STAT_IQT_Dequeue, STATGROUP_IQT, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Lookup"), STAT_IQT_Lookup, STATGROUP_IQT, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Remove"), STAT_IQT_Remove, STATGROUP_IQT, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Bulk"), STAT_IQT_Bulk, STATGROUP_IQT, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Runner Step"), STAT_IQT_RunnerStep, STATGROUP_IQT, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Runner Callback"), STAT_IQT_RunnerCallback, STATGROUP_IQT, );
+
+// Contadores agregados de todas as filas.
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Queued Items (all queues)"), STAT_IQT_QueuedItems, STATGROUP_IQT, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("In-Flight Actions (all queues)"), STAT_IQT_InFlightActions, STATGROUP_IQT, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Operations (per frame)"), STAT_IQT_Operations, STATGROUP_IQT, );
+
+// Canal de trace da IQT no Unreal Insights (habilitar com -trace=cpu,counters,IQT ou "Trace.Enable IQT").
+UE_TRACE_CHANNEL_EXTERN(IQTChannel);
+
+// Escopo combinado: evento de CPU no canal IQT (Insights) + cycle stat no STATGROUP_IQT (stat IQT).
+#define IQT_SCOPE_CYCLE_COUNTER(StatName) \
+    TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(IQT_##StatName, IQTChannel); \
+    SCOPE_CYCLE_COUNTER(STAT_IQT_##StatName)
+
+/**
+ * FIQT_QueueCounters: Contadores de um QueueName, publicados no Insights (counters trace) e no "stat IQT".
+ * - Depth: itens na fila.
+ * - Ops/s: operações por segundo, publicadas uma vez por janela de 1 segundo.
+ * - In-Flight: ações disparadas pelo executor e ainda sem resultado.
+ * Os totais agregados (STAT_IQT_*) são mantidos pela UIQT_Queue; estes contadores são apenas por nome.
+ * Os stats dinâmicos e os contadores de trace não podem ser liberados, então há uma instância por QueueName,
+ * compartilhada pelas filas com esse nome (os valores são somas) e nunca destruída: o total cresce com os nomes
+ * distintos, não com as filas. Filas sem QueueName usam uma instância própria, sem nome, que não publica nada.
+ * Todos os métodos são thread-safe.
+ */
+class FIQT_QueueCounters
+{
+public:
+    // Instância compartilhada do nome (criada na primeira chamada).
+    static TSharedRef<FIQT_QueueCounters> FindOrAdd(FName QueueName);
+
+    explicit FIQT_QueueCounters(const FString& InQueueName);
+
+    void AddDepth(int32 Delta);
+    void AddOperations(int32 NumOperations = 1);
+    void AddInFlight(int32 Delta);
+
+    int32 GetInFlight() const { return InFlight.load(std::memory_order_relaxed); }
+    float GetOperationsPerSecond() const { return LastOpsPerSecond.load(std::memory_order_relaxed); }
+
+private:
+    const FString DepthName;
+    const FString OpsName;
+    const FString InFlightName;
+
+#if COUNTERSTRACE_ENABLED
+    TUniquePtr<FCountersTrace::FCounterAtomicInt> DepthCounter;
+    TUniquePtr<FCountersTrace::FCounterAtomicInt> OpsCounter;
+    TUniquePtr<FCountersTrace::FCounterAtomicInt> InFlightCounter;
+#endif
+
+#if STATS
+    FName DepthStatName;
+    FName OpsStatName;
+    FName InFlightStatName;
+#endif
+
+    std::atomic<int32> OpsInWindow;
+    std::atomic<int32> Depth;
+    std::atomic<int32> InFlight;
+    std::atomic<double> WindowStartSeconds;
+    std::atomic<float> LastOpsPerSecond;
+};
@@ -0,0 +1,803 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_StressTest.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+//
+// Teste de estresse concorrente da UIQT_PriorityQueueInternal (comando de console "iqt.Stress.Run").
+//
+// Alterna três fases até esgotar o orçamento de tempo:
+//  - Sequencial: um histórico aleatório de operações é aplicado à fila e a um modelo de referência
+//    (TArray ordenado); todo resultado deve ser idêntico. Inclui DequeueMatching com consultas por tag pai e filha
+//    e as operações em lote (RemoveAllMatching/RescoreAll/CountMatching), nos caminhos incremental e de heapify
+//    (incluindo um RescoreAll que muda só o topo e um descendente dele).
+//    Nas fases ímpares as colunas de utilidade ficam ativas durante todo o histórico e, ao final,
+//    DequeueBestScored deve retirar um item de pontuação máxima (com e sem janela de candidatos).
+//  - Concorrente: N threads executam operações aleatórias com registro de invocação/resposta.
+//    Ao final, verifica que nenhum item foi criado do nada (retirado antes de ser enfileirado), nenhum foi
+//    retirado duas vezes e nenhum foi perdido (enfileirados = retirados + restantes).
+//    É uma checagem de conservação dos itens, não de linearizabilidade: a ordem de saída sob concorrência não é
+//    comparada com um modelo (a ordem só é verificada nas fases sequenciais).
+//  - Fila pequena: o mesmo modelo contra a FIQT_SmallQueue (armazenamento inline da UIQT_Queue), incluindo
+//    UpdatePriority e operações por handle. Ao encher ela é promovida para uma fila interna, que deve resolver
+//    os mesmos handles e retirar os itens na mesma ordem.
+// Os invariantes da fila (ValidateInvariants) são verificados ao fim de cada fase.
+//
+// Argumentos (todos opcionais):
+//   Seconds=10        Orçamento total de tempo.
+//   Threads=4         Threads da fase concorrente.
+//   PhaseSeconds=0.5  Duração de cada fase concorrente.
+//   SeqOps=20000      Operações de cada fase sequencial.
+//   Seed=1            Semente do gerador aleatório.
+//   Exit=1            Encerra o processo ao final (código 1 se houver violação).
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "IQT_PriorityQueueInternal.h"
+#include "IQT_SmallQueue.h"
+#include "IQT_GameplayTags.h"
+#include "IQT_Log.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/Sort.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "NativeGameplayTags.h"
+#include <atomic>
+
+namespace IQTStressTest
+{
+    // Tags dos itens de teste: uma hierarquia pai/filha para exercitar os buckets por tag em DequeueMatching.
+    UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_StressWork, "IQT.Stress.Work");
+    UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_StressWorkChild, "IQT.Stress.Work.Child");
+
+    struct FStressConfig
+    {
+        double BudgetSeconds = 10.0;
+        int32 NumThreads = 4;
+        double PhaseSeconds = 0.5;
+        int32 SequentialOps = 20000;
+        int32 Seed = 1;
+        bool bExitWhenDone = false;
+    };
+
+    enum class EOpType : uint8
+    {
+        Enqueue,
+        Dequeue,
+        Remove,
+        Contains,
+        FindByTaskID,
+    };
+
+    // Registro de uma operação concorrente. ItemId = -1 quando a operação não tocou item algum (ex.: Dequeue vazio).
+    struct FOpRecord
+    {
+        uint64 InvokeCycles;
+        uint64 ResponseCycles;
+        int32 ItemId;
+        EOpType Type;
+        bool bResult;
+    };
+
+    struct FStressReport
+    {
+        int64 TotalOps = 0;
+        int32 SequentialPhases = 0;
+        int32 ConcurrentPhases = 0;
+        int32 SmallQueuePhases = 0;
+        TArray<FString> Violations;
+
+        void AddViolation(const FString& Violation)
+        {
+            // Um bug costuma gerar milhares de violações iguais: guarda apenas as primeiras.
+            if (Violations.Num() < 32)
+            {
+                Violations.Add(Violation);
+            }
+        }
+    };
+
+    static FStressConfig ParseConfig(const TArray<FString>& Args)
+    {
+        FStressConfig Config;
+        const FString Line = FString::Join(Args, TEXT(" "));
+        FParse::Value(*Line, TEXT("Seconds="), Config.BudgetSeconds);
+        FParse::Value(*Line, TEXT("Threads="), Config.NumThreads);
+        FParse::Value(*Line, TEXT("PhaseSeconds="), Config.PhaseSeconds);
+        FParse::Value(*Line, TEXT("SeqOps="), Config.SequentialOps);
+        FParse::Value(*Line, TEXT("Seed="), Config.Seed);
+        int32 ExitFlag = 0;
+        FParse::Value(*Line, TEXT("Exit="), ExitFlag);
+        Config.bExitWhenDone = ExitFlag != 0;
+        // Os Ids de item são intercalados em passos de 64 por thread.
+        Config.NumThreads = FMath::Clamp(Config.NumThreads, 1, 64);
+        return Config;
+    }
+
+    // O nome do item carrega o seu Id (FName Number), o que permite identificá-lo sem estado extra.
+    static FIQT_QueueItem MakeItem(int32 ItemId, int32 Priority)
+    {
+        // A tag deriva do Id, para que sondas de Contains/RemoveItem reconstruam a mesma chave.
+        static const FGameplayTag ItemTags[] = { IQTGameplayTags::Action_Timeout, TAG_StressWork, TAG_StressWorkChild };
+        FIQT_QueueItem Item;
+        Item.Name = FName(TEXT("IQTStressItem"), ItemId + 1);
+        Item.AbilityTriggerTag = ItemTags[ItemId % UE_ARRAY_COUNT(ItemTags)];
+        Item.bIsOpen = true;
+        Item.Priority = Priority;
+        // Inteiros pequenos e pesos múltiplos de 0.25: as pontuações de utilidade são exatas em float.
+        Item.UtilityFeatures = { float(ItemId % 7), float(ItemId % 11), float(ItemId % 13) - 6.0f };
+        Item.GetTaskID();
+        return Item;
+    }
+
+    static int32 GetItemId(const FIQT_QueueItem& Item)
+    {
+        return Item.Name.GetNumber() - 1;
+    }
+
+    /**
+     * Modelo sequencial de referência: mesma semântica da fila interna.
+     * Um novo item entra antes do primeiro item de prioridade maior ou igual (empates saem do mais novo para o mais antigo).
+     */
+    struct FReferenceModel
+    {
+        TArray<FIQT_QueueItem> Items;
+
+        void Enqueue(const FIQT_QueueItem& Item)
+        {
+            const int32 Index = Algo::LowerBoundBy(Items, Item.Priority, [](const FIQT_QueueItem& Existing) { return Existing.Priority; });
+            Items.Insert(Item, Index);
+        }
+
+        // Id do item retirado, ou -1 se vazio.
+        int32 Dequeue()
+        {
+            if (Items.Num() == 0)
+            {
+                return -1;
+            }
+            const int32 FrontId = GetItemId(Items[0]);
+            Items.RemoveAt(0, EAllowShrinking::No);
+            return FrontId;
+        }
+
+        // Id do primeiro item cuja tag satisfaz a consulta (retirado), ou -1.
+        int32 DequeueMatching(const FGameplayTagQuery& Query)
+        {
+            const int32 Index = Items.IndexOfByPredicate([&Query](const FIQT_QueueItem& Existing) { return Query.Matches(FGameplayTagContainer(Existing.AbilityTriggerTag)); });
+            if (Index == INDEX_NONE)
+            {
+                return -1;
+            }
+            const int32 FoundId = GetItemId(Items[Index]);
+            Items.RemoveAt(Index, EAllowShrinking::No);
+            return FoundId;
+        }
+
+        int32 IndexOf(const FIQT_QueueItem& Item) const
+        {
+            return Items.IndexOfByPredicate([&Item](const FIQT_QueueItem& Existing) { return Existing == Item; });
+        }
+
+        int32 RemoveAllMatching(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate)
+        {
+            return Items.RemoveAll([&Predicate](const FIQT_QueueItem& Existing) { return Predicate(Existing); });
+        }
+
+        // Os Ids crescem com a ordem de chegada da fase sequencial: empates voltam a sair do mais novo para o mais antigo.
+        void RescoreAll(TFunctionRef<int32(const FIQT_QueueItem&)> Scorer)
+        {
+            for (FIQT_QueueItem& Existing : Items)
+            {
+                Existing.Priority = Scorer(Existing);
+            }
+            Algo::Sort(Items, [](const FIQT_QueueItem& A, const FIQT_QueueItem& B)
+            {
+                return A.Priority != B.Priority ? A.Priority < B.Priority : GetItemId(A) > GetItemId(B);
+            });
+        }
+
+        // Mesma ordem de RescoreAll: a fila mantém a ordem de chegada original do item atualizado.
+        void UpdatePriority(int32 Index, int32 NewPriority)
+        {
+            Items[Index].Priority = NewPriority;
+            Algo::Sort(Items, [](const FIQT_QueueItem& A, const FIQT_QueueItem& B)
+            {
+                return A.Priority != B.Priority ? A.Priority < B.Priority : GetItemId(A) > GetItemId(B);
+            });
+        }
+
+        // Id do primeiro item com o TaskID, ou -1.
+        int32 FindByTaskID(const FGuid& TaskID) const
+        {
+            const FIQT_QueueItem* Found = Items.FindByPredicate([&TaskID](const FIQT_QueueItem& Existing) { return Existing.TaskID == TaskID; });
+            return Found ? GetItemId(*Found) : -1;
+        }
+    };
+
+    static void CheckInvariants(const UIQT_PriorityQueueInternal& Queue, const TCHAR* PhaseName, int32 PhaseIndex, FStressReport& Report)
+    {
+        if (!Queue.ValidateInvariants())
+        {
+            Report.AddViolation(FString::Printf(TEXT("%s %d: invariantes da fila violados (ver LogIQTInternal)."), PhaseName, PhaseIndex));
+        }
+    }
+
+    static void RunSequentialPhase(UIQT_PriorityQueueInternal& Queue, FRandomStream& Random, int32& NextItemId, const FStressConfig& Config, FStressReport& Report)
+    {
+        const int32 PhaseIndex = Report.SequentialPhases++;
+        Queue.Init();
+        const float UtilityWeights[] = { 0.25f * Random.RandRange(-4, 4), 0.25f * Random.RandRange(-4, 4), 0.25f * Random.RandRange(-4, 4) };
+        const bool bUtilityPhase = (PhaseIndex & 1) != 0;
+        Queue.SetUtilityWeights(bUtilityPhase ? TConstArrayView<float>(UtilityWeights) : TConstArrayView<float>());
+        // Capacidade reservada (às vezes menor que a fila, às vezes maior) não pode mudar o comportamento.
+        Queue.Reserve(Random.RandRange(0, 512));
+        FReferenceModel Model;
+        FIQT_ItemHandle LastDequeuedHandle;
+
+        // Consulta pela tag pai (pai + filha), pela filha e por uma tag sem relação com as demais.
+        const FGameplayTagQuery MatchQueries[] =
+        {
+            FGameplayTagQuery::MakeQuery_MatchAnyTags(FGameplayTagContainer(TAG_StressWork)),
+            FGameplayTagQuery::MakeQuery_MatchAnyTags(FGameplayTagContainer(TAG_StressWorkChild)),
+            FGameplayTagQuery::MakeQuery_MatchAnyTags(FGameplayTagContainer(IQTGameplayTags::Action_Timeout)),
+        };
+
+        for (int32 OpIndex = 0; OpIndex < Config.SequentialOps; ++OpIndex)
+        {
+            const int32 Roll = Random.RandRange(0, 99);
+            // Faixa de prioridades pequena para exercitar empates.
+            if (Roll < 40)
+            {
+                FIQT_QueueItem Item = MakeItem(NextItemId++, Random.RandRange(0, 15));
+                const bool bResult = Queue.Enqueue(Item, &Item.Handle);
+                if (bResult)
+                {
+                    Model.Enqueue(Item);
+                }
+                else
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Sequencial %d op %d: Enqueue falhou com a fila abaixo do limite."), PhaseIndex, OpIndex));
+                }
+            }
+            else if (Roll < 60)
+            {
+                const FGameplayTagQuery& Query = MatchQueries[Random.RandRange(0, UE_ARRAY_COUNT(MatchQueries) - 1)];
+                FIQT_QueueItem Dequeued;
+                const int32 ActualId = Queue.DequeueMatching(Query, Dequeued) ? GetItemId(Dequeued) : -1;
+                const int32 ExpectedId = Model.DequeueMatching(Query);
+                if (ActualId != ExpectedId)
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Sequencial %d op %d: DequeueMatching(%s) retornou %d, modelo esperava %d."), PhaseIndex, OpIndex, *Query.GetDescription(), ActualId, ExpectedId));
+                }
+            }
+            else if (Roll < 70)
+            {
+                FIQT_QueueItem Dequeued;
+                const int32 ActualId = Queue.Dequeue(Dequeued) ? GetItemId(Dequeued) : -1;
+                if (ActualId != -1)
+                {
+                    LastDequeuedHandle = Dequeued.Handle;
+                }
+                const int32 ExpectedId = Model.Dequeue();
+                if (ActualId != ExpectedId)
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Sequencial %d op %d: Dequeue retornou %d, modelo esperava %d."), PhaseIndex, OpIndex, ActualId, ExpectedId));
+                }
+            }
+            else if (Roll < 80)
+            {
+                // Remove um item existente (ou um Id já retirado, quando a fila está vazia).
+                const FIQT_QueueItem Probe = Model.Items.Num() > 0 ? Model.Items[Random.RandRange(0, Model.Items.Num() - 1)] : MakeItem(Random.RandRange(0, FMath::Max(0, NextItemId - 1)), 0);
+                const int32 ModelIndex = Model.IndexOf(Probe);
+                const bool bResult = Queue.RemoveItem(Probe);
+                if (bResult != (ModelIndex != INDEX_NONE))
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Sequencial %d op %d: RemoveItem(%d) retornou %d."), PhaseIndex, OpIndex, GetItemId(Probe), bResult));
+                }
+                if (ModelIndex != INDEX_NONE)
+                {
+                    Model.Items.RemoveAt(ModelIndex, EAllowShrinking::No);
+                }
+            }
+            else if (Roll < 90)
+            {
+                const FIQT_QueueItem Probe = MakeItem(Random.RandRange(0, FMath::Max(0, NextItemId - 1)), 0);
+                const bool bResult = Queue.Contains(Probe);
+                if (bResult != (Model.IndexOf(Probe) != INDEX_NONE))
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Sequencial %d op %d: Contains(%d) retornou %d."), PhaseIndex, OpIndex, GetItemId(Probe), bResult));
+                }
+            }
+            else if (Roll < 92)
+            {
+                // Ora afeta uma faixa de prioridade inteira (heapify), ora poucos itens (remoções/reposicionamentos individuais).
+                const bool bFewItems = Random.RandRange(0, 1) == 0;
+                const int32 Selector = Random.RandRange(0, 15);
+                const int32 BulkKind = Random.RandRange(0, 2);
+                if (BulkKind == 0)
+                {
+                    auto Predicate = [bFewItems, Selector](const FIQT_QueueItem& Item)
+                    {
+                        return bFewItems ? GetItemId(Item) % 53 == Selector : Item.Priority == Selector;
+                    };
+                    const int32 ActualCount = Queue.RemoveAllMatching(Predicate);
+                    const int32 ExpectedCount = Model.RemoveAllMatching(Predicate);
+                    if (ActualCount != ExpectedCount)
+                    {
+                        Report.AddViolation(FString::Printf(TEXT("Sequencial %d op %d: RemoveAllMatching removeu %d, modelo esperava %d."), PhaseIndex, OpIndex, ActualCount, ExpectedCount));
+                    }
+                }
+                else if (BulkKind == 1 || Model.Items.Num() < 2)
+                {
+                    auto Scorer = [bFewItems, Selector](const FIQT_QueueItem& Item)
+                    {
+                        return bFewItems ? (GetItemId(Item) % 53 == Selector ? (Item.Priority + 7) % 16 : Item.Priority) : (Item.Priority * 5 + Selector) % 16;
+                    };
+                    Queue.RescoreAll(Scorer);
+                    Model.RescoreAll(Scorer);
+                }
+                else
+                {
+                    // Só o topo e um descendente dele mudam (caminho incremental): cada reposicionamento tem que ver o
+                    // heap já válido, senão o outro nó alterado fica fora de ordem.
+                    const int32 TopId = GetItemId(Model.Items[0]);
+                    const int32 DescendantId = GetItemId(Model.Items[Random.RandRange(0, 1) == 0 ? 1 : Random.RandRange(1, Model.Items.Num() - 1)]);
+                    const int32 TopPriority = Random.RandRange(0, 15);
+                    const int32 DescendantPriority = Random.RandRange(0, 15);
+                    auto Scorer = [TopId, DescendantId, TopPriority, DescendantPriority](const FIQT_QueueItem& Item)
+                    {
+                        const int32 ItemId = GetItemId(Item);
+                        return ItemId == TopId ? TopPriority : (ItemId == DescendantId ? DescendantPriority : Item.Priority);
+                    };
+                    Queue.RescoreAll(Scorer);
+                    Model.RescoreAll(Scorer);
+
+                    int32 ActualTopId = -1;
+                    Queue.PeekTop([&ActualTopId](const FIQT_QueueItem& Top) { ActualTopId = GetItemId(Top); });
+                    if (ActualTopId != GetItemId(Model.Items[0]))
+                    {
+                        Report.AddViolation(FString::Printf(TEXT("Sequencial %d op %d: RescoreAll do topo e de um descendente deixou %d no topo, modelo esperava %d."),
+                            PhaseIndex, OpIndex, ActualTopId, GetItemId(Model.Items[0])));
+                    }
+                    CheckInvariants(Queue, TEXT("Sequencial"), PhaseIndex, Report);
+                }
+
+                const FGameplayTagQuery& Query = MatchQueries[Random.RandRange(0, UE_ARRAY_COUNT(MatchQueries) - 1)];
+                const int32 ExpectedMatching = Model.Items.FilterByPredicate([&Query](const FIQT_QueueItem& Existing) { return Query.Matches(FGameplayTagContainer(Existing.AbilityTriggerTag)); }).Num();
+                if (Queue.CountMatching(Query) != ExpectedMatching)
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Sequencial %d op %d: CountMatching(%s) divergiu do modelo (%d)."), PhaseIndex, OpIndex, *Query.GetDescription(), ExpectedMatching));
+                }
+            }
+            else if (Roll < 96)
+            {
+                // Handle de um item presente deve resolver para ele; o de um item já retirado deve estar obsoleto.
+                const bool bProbePresent = Model.Items.Num() > 0 && Random.RandRange(0, 1) == 0;
+                const FIQT_ItemHandle Handle = bProbePresent ? Model.Items[Random.RandRange(0, Model.Items.Num() - 1)].Handle : LastDequeuedHandle;
+                FIQT_QueueItem Found;
+                const bool bResult = Queue.FindByHandle(Handle, Found);
+                if (bResult != bProbePresent || (bResult && Found.Handle != Handle))
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Sequencial %d op %d: FindByHandle(%s) retornou %d."), PhaseIndex, OpIndex, *Handle.ToString(), bResult));
+                }
+            }
+            else
+            {
+                const FGuid TaskID = Model.Items.Num() > 0 && Random.RandRange(0, 1) == 0 ? Model.Items[Random.RandRange(0, Model.Items.Num() - 1)].TaskID : FGuid::NewGuid();
+                FIQT_QueueItem Found;
+                if ((Queue.FindByTaskID(TaskID, Found) ? GetItemId(Found) : -1) != Model.FindByTaskID(TaskID))
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Sequencial %d op %d: FindByTaskID divergiu do modelo."), PhaseIndex, OpIndex));
+                }
+            }
+
+            if (Queue.GetCount() != Model.Items.Num())
+            {
+                Report.AddViolation(FString::Printf(TEXT("Sequencial %d op %d: GetCount %d, modelo %d."), PhaseIndex, OpIndex, Queue.GetCount(), Model.Items.Num()));
+                break;
+            }
+        }
+
+        if (bUtilityPhase)
+        {
+            const auto Score = [&UtilityWeights](const FIQT_QueueItem& Item)
+            {
+                float Sum = 0.0f;
+                for (int32 Feature = 0; Feature < UE_ARRAY_COUNT(UtilityWeights); ++Feature)
+                {
+                    Sum += UtilityWeights[Feature] * Item.UtilityFeatures[Feature];
+                }
+                return Sum;
+            };
+            // Janela 8: apenas os 8 primeiros na ordem de prioridade (os 8 primeiros do modelo) concorrem.
+            for (const int32 Window : { 0, 8, 0, 8 })
+            {
+                if (Model.Items.Num() == 0)
+                {
+                    break;
+                }
+                const int32 NumCandidates = Window > 0 ? FMath::Min(Window, Model.Items.Num()) : Model.Items.Num();
+                float BestScore = TNumericLimits<float>::Lowest();
+                for (int32 Index = 0; Index < NumCandidates; ++Index)
+                {
+                    BestScore = FMath::Max(BestScore, Score(Model.Items[Index]));
+                }
+                FIQT_QueueItem Dequeued;
+                const bool bResult = Queue.DequeueBestScored(Window, Dequeued);
+                const int32 ModelIndex = bResult ? Model.IndexOf(Dequeued) : INDEX_NONE;
+                if (ModelIndex == INDEX_NONE || ModelIndex >= NumCandidates || Score(Dequeued) != BestScore)
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Sequencial %d: DequeueBestScored(janela %d) retornou %d (pontuação %.2f), máximo esperado %.2f."),
+                        PhaseIndex, Window, bResult ? GetItemId(Dequeued) : -1, bResult ? Score(Dequeued) : 0.0f, BestScore));
+                    break;
+                }
+                Model.Items.RemoveAt(ModelIndex, EAllowShrinking::No);
+            }
+        }
+
+        Report.TotalOps += Config.SequentialOps;
+        CheckInvariants(Queue, TEXT("Sequencial"), PhaseIndex, Report);
+    }
+
+    static void RunConcurrentPhase(UIQT_PriorityQueueInternal& Queue, FRandomStream& Random, int32& NextItemId, const FStressConfig& Config, FStressReport& Report)
+    {
+        const int32 PhaseIndex = Report.ConcurrentPhases++;
+        Queue.Init();
+
+        // Cada thread usa uma faixa própria de Ids; o registro de operações é local à thread.
+        constexpr int32 MaxOpsPerThread = 1 << 20;
+        const int32 FirstItemId = NextItemId;
+        std::atomic<bool> bStop(false);
+        TArray<TArray<FOpRecord>> Logs;
+        Logs.SetNum(Config.NumThreads);
+        TArray<TFuture<void>> Workers;
+        const int32 PhaseSeed = Random.RandRange(0, MAX_int32 - 1);
+
+        for (int32 ThreadIndex = 0; ThreadIndex < Config.NumThreads; ++ThreadIndex)
+        {
+            Workers.Add(Async(EAsyncExecution::Thread, [&Queue, &bStop, &Logs, ThreadIndex, FirstItemId, PhaseSeed]()
+            {
+                FRandomStream ThreadRandom(PhaseSeed + ThreadIndex * 7919);
+                TArray<FOpRecord>& Log = Logs[ThreadIndex];
+                Log.Reserve(64 * 1024);
+                TArray<FIQT_QueueItem> Mine;
+                int32 LocalCounter = 0;
+
+                while (!bStop.load(std::memory_order_relaxed) && Log.Num() < MaxOpsPerThread)
+                {
+                    const int32 Roll = ThreadRandom.RandRange(0, 99);
+                    FOpRecord Record;
+                    Record.ItemId = -1;
+                    Record.InvokeCycles = FPlatformTime::Cycles64();
+                    if (Roll < 45)
+                    {
+                        // Ids intercalados por thread: FirstItemId + LocalCounter * N + ThreadIndex.
+                        const int32 ItemId = FirstItemId + LocalCounter++ * 64 + ThreadIndex;
+                        const FIQT_QueueItem Item = MakeItem(ItemId, ThreadRandom.RandRange(0, 15));
+                        Record.Type = EOpType::Enqueue;
+                        Record.ItemId = ItemId;
+                        Record.bResult = Queue.Enqueue(Item);
+                        if (Record.bResult)
+                        {
+                            Mine.Add(Item);
+                        }
+                    }
+                    else if (Roll < 80)
+                    {
+                        FIQT_QueueItem Item;
+                        Record.Type = EOpType::Dequeue;
+                        Record.bResult = Queue.Dequeue(Item);
+                        Record.ItemId = Record.bResult ? GetItemId(Item) : -1;
+                    }
+                    else if (Roll < 90 && Mine.Num() > 0)
+                    {
+                        const FIQT_QueueItem& Item = Mine[ThreadRandom.RandRange(0, Mine.Num() - 1)];
+                        Record.Type = EOpType::Remove;
+                        Record.ItemId = GetItemId(Item);
+                        Record.bResult = Queue.RemoveItem(Item);
+                    }
+                    else if (Roll < 95 && Mine.Num() > 0)
+                    {
+                        const FIQT_QueueItem& Item = Mine[ThreadRandom.RandRange(0, Mine.Num() - 1)];
+                        Record.Type = EOpType::Contains;
+                        Record.ItemId = GetItemId(Item);
+                        Record.bResult = Queue.Contains(Item);
+                    }
+                    else
+                    {
+                        const FIQT_QueueItem* Item = Mine.Num() > 0 ? &Mine[ThreadRandom.RandRange(0, Mine.Num() - 1)] : nullptr;
+                        FIQT_QueueItem Found;
+                        Record.Type = EOpType::FindByTaskID;
+                        Record.ItemId = Item ? GetItemId(*Item) : -1;
+                        Record.bResult = Queue.FindByTaskID(Item ? Item->TaskID : FGuid::NewGuid(), Found);
+                    }
+                    Record.ResponseCycles = FPlatformTime::Cycles64();
+                    Log.Add(Record);
+                }
+            }));
+        }
+
+        FPlatformProcess::Sleep(static_cast<float>(Config.PhaseSeconds));
+        bStop.store(true);
+        for (TFuture<void>& Worker : Workers)
+        {
+            Worker.Wait();
+        }
+
+        // Consolida: momento do Enqueue bem-sucedido e quem retirou cada item.
+        TMap<int32, uint64> EnqueueInvoke;
+        TMap<int32, int32> TakenCount;
+        int32 MaxLocalId = FirstItemId;
+        for (const TArray<FOpRecord>& Log : Logs)
+        {
+            Report.TotalOps += Log.Num();
+            for (const FOpRecord& Record : Log)
+            {
+                if (Record.Type == EOpType::Enqueue && Record.bResult)
+                {
+                    EnqueueInvoke.Add(Record.ItemId, Record.InvokeCycles);
+                    MaxLocalId = FMath::Max(MaxLocalId, Record.ItemId + 1);
+                }
+            }
+        }
+
+        for (int32 ThreadIndex = 0; ThreadIndex < Logs.Num(); ++ThreadIndex)
+        {
+            for (const FOpRecord& Record : Logs[ThreadIndex])
+            {
+                const bool bTakes = (Record.Type == EOpType::Dequeue || Record.Type == EOpType::Remove) && Record.bResult;
+                if (!bTakes)
+                {
+                    continue;
+                }
+                const uint64* Enqueued = EnqueueInvoke.Find(Record.ItemId);
+                if (!Enqueued)
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Concorrente %d: thread %d retirou o item %d, que nunca foi enfileirado."), PhaseIndex, ThreadIndex, Record.ItemId));
+                }
+                else if (*Enqueued > Record.ResponseCycles)
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Concorrente %d: item %d retirado antes de o Enqueue começar."), PhaseIndex, Record.ItemId));
+                }
+                int32& Count = TakenCount.FindOrAdd(Record.ItemId);
+                if (++Count == 2)
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Concorrente %d: item %d retirado mais de uma vez."), PhaseIndex, Record.ItemId));
+                }
+            }
+        }
+
+        CheckInvariants(Queue, TEXT("Concorrente"), PhaseIndex, Report);
+
+        // Conservação: o que sobrou na fila é exatamente o que foi enfileirado e não retirado.
+        int32 Remaining = 0;
+        FIQT_QueueItem Item;
+        while (Queue.Dequeue(Item))
+        {
+            const int32 ItemId = GetItemId(Item);
+            if (!EnqueueInvoke.Contains(ItemId))
+            {
+                Report.AddViolation(FString::Printf(TEXT("Concorrente %d: item %d restante nunca foi enfileirado."), PhaseIndex, ItemId));
+            }
+            if (++TakenCount.FindOrAdd(ItemId) == 2)
+            {
+                Report.AddViolation(FString::Printf(TEXT("Concorrente %d: item %d restante já tinha sido retirado."), PhaseIndex, ItemId));
+            }
+            ++Remaining;
+        }
+        for (const TPair<int32, uint64>& Pair : EnqueueInvoke)
+        {
+            if (!TakenCount.Contains(Pair.Key))
+            {
+                Report.AddViolation(FString::Printf(TEXT("Concorrente %d: item %d perdido (enfileirado, nunca retirado nem restante)."), PhaseIndex, Pair.Key));
+            }
+        }
+
+        UE_LOG(LogIQT, Verbose, TEXT("IQT.Stress: fase concorrente %d: %d enfileirados, %d restantes."), PhaseIndex, EnqueueInvoke.Num(), Remaining);
+        NextItemId = MaxLocalId + 64;
+    }
+
+    static void RunSmallQueuePhase(FRandomStream& Random, int32& NextItemId, const FStressConfig& Config, FStressReport& Report)
+    {
+        if (FIQT_SmallQueue::Capacity <= 0)
+        {
+            return;
+        }
+        const int32 PhaseIndex = Report.SmallQueuePhases++;
+        FIQT_SmallQueue Small;
+        UIQT_PriorityQueueInternal Promoted;
+        Promoted.SetMaxSize(MAX_int32);
+        FReferenceModel Model;
+        const FGameplayTagQuery ParentQuery = FGameplayTagQuery::MakeQuery_MatchAnyTags(FGameplayTagContainer(TAG_StressWork));
+
+        // Termina após NumOps operações ou na primeira promoção (a fila pequena cheia recusa um item por falta de slot).
+        const int32 NumOps = FMath::Max(1, Config.SequentialOps / 4);
+        int32 OpIndex = 0;
+        for (; OpIndex < NumOps && Small.IsActive(); ++OpIndex)
+        {
+            const int32 Roll = Random.RandRange(0, 99);
+            if (Roll < 45)
+            {
+                FIQT_QueueItem Item = MakeItem(NextItemId++, Random.RandRange(0, 7));
+                FIQT_QueueItem Stored = Item;
+                const TOptional<bool> bResult = Small.Enqueue(Stored, 0, Item.Handle);
+                if (!bResult.IsSet())
+                {
+                    if (Model.Items.Num() != FIQT_SmallQueue::Capacity)
+                    {
+                        Report.AddViolation(FString::Printf(TEXT("Fila pequena %d op %d: sem slot livre com %d itens."), PhaseIndex, OpIndex, Model.Items.Num()));
+                    }
+                    Small.Promote([&Promoted](TArray<FIQT_QueueItem>&& Items, uint32 NextGeneration) { Promoted.Adopt(MoveTemp(Items), NextGeneration); });
+                    if (!Promoted.Enqueue(Item, &Item.Handle))
+                    {
+                        Report.AddViolation(FString::Printf(TEXT("Fila pequena %d op %d: Enqueue na fila promovida falhou."), PhaseIndex, OpIndex));
+                        continue;
+                    }
+                }
+                else if (!bResult.GetValue())
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Fila pequena %d op %d: Enqueue recusado sem limite."), PhaseIndex, OpIndex));
+                    continue;
+                }
+                Model.Enqueue(Item);
+            }
+            else if (Roll < 65)
+            {
+                FIQT_QueueItem Dequeued;
+                const int32 ActualId = Small.Dequeue(Dequeued).Get(false) ? GetItemId(Dequeued) : -1;
+                const int32 ExpectedId = Model.Dequeue();
+                if (ActualId != ExpectedId)
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Fila pequena %d op %d: Dequeue retornou %d, modelo esperava %d."), PhaseIndex, OpIndex, ActualId, ExpectedId));
+                }
+            }
+            else if (Roll < 75)
+            {
+                FIQT_QueueItem Dequeued;
+                const int32 ActualId = Small.DequeueMatching(ParentQuery, Dequeued).Get(false) ? GetItemId(Dequeued) : -1;
+                const int32 ExpectedId = Model.DequeueMatching(ParentQuery);
+                if (ActualId != ExpectedId)
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Fila pequena %d op %d: DequeueMatching retornou %d, modelo esperava %d."), PhaseIndex, OpIndex, ActualId, ExpectedId));
+                }
+            }
+            else if (Roll < 85 && Model.Items.Num() > 0)
+            {
+                const int32 Index = Random.RandRange(0, Model.Items.Num() - 1);
+                const int32 NewPriority = Random.RandRange(0, 7);
+                if (!Small.UpdatePriority(Model.Items[Index].Handle, NewPriority).Get(false))
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Fila pequena %d op %d: UpdatePriority(%s) falhou."), PhaseIndex, OpIndex, *Model.Items[Index].Handle.ToString()));
+                }
+                Model.UpdatePriority(Index, NewPriority);
+            }
+            else if (Roll < 92 && Model.Items.Num() > 0)
+            {
+                const int32 Index = Random.RandRange(0, Model.Items.Num() - 1);
+                const FIQT_ItemHandle Handle = Model.Items[Index].Handle;
+                FIQT_QueueItem Removed;
+                if (!Small.RemoveByHandle(Handle, &Removed).Get(false) || GetItemId(Removed) != GetItemId(Model.Items[Index]))
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Fila pequena %d op %d: RemoveByHandle(%s) divergiu do modelo."), PhaseIndex, OpIndex, *Handle.ToString()));
+                }
+                Model.Items.RemoveAt(Index, EAllowShrinking::No);
+                // Um handle removido não pode voltar a resolver, mesmo depois de o slot ser reutilizado.
+                if (Small.IsHandleValid(Handle).Get(false))
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Fila pequena %d op %d: handle removido %s ainda válido."), PhaseIndex, OpIndex, *Handle.ToString()));
+                }
+            }
+            else if (Model.Items.Num() > 0)
+            {
+                const FIQT_QueueItem& Probe = Model.Items[Random.RandRange(0, Model.Items.Num() - 1)];
+                FIQT_QueueItem Found;
+                if (!Small.Contains(Probe).Get(false) || !Small.FindByTaskID(Probe.TaskID, Found).Get(false) || GetItemId(Found) != GetItemId(Probe))
+                {
+                    Report.AddViolation(FString::Printf(TEXT("Fila pequena %d op %d: item %d não encontrado."), PhaseIndex, OpIndex, GetItemId(Probe)));
+                }
+            }
+
+            int32 HeadPriority = 0;
+            const bool bHasHead = Small.GetHeadPriority(HeadPriority).Get(false);
+            if (Small.IsActive() && (Small.GetCount().Get(-1) != Model.Items.Num() || bHasHead != (Model.Items.Num() > 0) || (bHasHead && HeadPriority != Model.Items[0].Priority)))
+            {
+                Report.AddViolation(FString::Printf(TEXT("Fila pequena %d op %d: contagem ou prioridade do topo divergem do modelo (%d itens)."), PhaseIndex, OpIndex, Model.Items.Num()));
+            }
+        }
+        if (Small.IsActive() && !Small.ValidateInvariants().Get(false))
+        {
+            Report.AddViolation(FString::Printf(TEXT("Fila pequena %d: invariantes violados (ver LogIQTInternal)."), PhaseIndex));
+        }
+
+        // Promove (se ainda não foi) e confere que a fila interna herdou handles e ordem.
+        Small.Promote([&Promoted](TArray<FIQT_QueueItem>&& Items, uint32 NextGeneration) { Promoted.Adopt(MoveTemp(Items), NextGeneration); });
+        CheckInvariants(Promoted, TEXT("Fila pequena"), PhaseIndex, Report);
+        for (const FIQT_QueueItem& Expected : Model.Items)
+        {
+            FIQT_QueueItem Found;
+            if (!Promoted.FindByHandle(Expected.Handle, Found) || GetItemId(Found) != GetItemId(Expected))
+            {
+                Report.AddViolation(FString::Printf(TEXT("Fila pequena %d: handle %s do item %d não resolve após a promoção."), PhaseIndex, *Expected.Handle.ToString(), GetItemId(Expected)));
+            }
+        }
+        // Um item novo não pode receber o handle de um item adotado.
+        FIQT_QueueItem Extra = MakeItem(NextItemId++, Random.RandRange(0, 7));
+        if (Promoted.Enqueue(Extra, &Extra.Handle))
+        {
+            if (Model.Items.ContainsByPredicate([&Extra](const FIQT_QueueItem& Existing) { return Existing.Handle == Extra.Handle; }))
+            {
+                Report.AddViolation(FString::Printf(TEXT("Fila pequena %d: handle %s reutilizado após a promoção."), PhaseIndex, *Extra.Handle.ToString()));
+            }
+            Model.Enqueue(Extra);
+        }
+        for (int32 ExpectedId = Model.Dequeue(); ExpectedId != -1; ExpectedId = Model.Dequeue())
+        {
+            FIQT_QueueItem Dequeued;
+            const int32 ActualId = Promoted.Dequeue(Dequeued) ? GetItemId(Dequeued) : -1;
+            if (ActualId != ExpectedId)
+            {
+                Report.AddViolation(FString::Printf(TEXT("Fila pequena %d: após a promoção Dequeue retornou %d, modelo esperava %d."), PhaseIndex, ActualId, ExpectedId));
+                break;
+            }
+        }
+        Report.TotalOps += OpIndex;
+    }
+
+    static void Run(const TArray<FString>& Args)
+    {
+        const FStressConfig Config = ParseConfig(Args);
+        UE_LOG(LogIQT, Display, TEXT("IQT.Stress: Iniciando (%.1fs, %d threads, semente %d)."), Config.BudgetSeconds, Config.NumThreads, Config.Seed);
+
+        const ELogVerbosity::Type PrevInternalVerbosity = LogIQTInternal.GetVerbosity();
+        LogIQTInternal.SetVerbosity(ELogVerbosity::Error);
+
+        UIQT_PriorityQueueInternal Queue;
+        Queue.SetMaxSize(MAX_int32);
+        FRandomStream Random(Config.Seed);
+        FStressReport Report;
+        int32 NextItemId = 0;
+
+        const double Start = FPlatformTime::Seconds();
+        while (FPlatformTime::Seconds() - Start < Config.BudgetSeconds && Report.Violations.Num() == 0)
+        {
+            RunSequentialPhase(Queue, Random, NextItemId, Config, Report);
+            RunConcurrentPhase(Queue, Random, NextItemId, Config, Report);
+            RunSmallQueuePhase(Random, NextItemId, Config, Report);
+            // Ids vão no Number do FName (int32): recomeça antes de estourar.
+            if (NextItemId > (1 << 30))
+            {
+                NextItemId = 0;
+            }
+        }
+        const double Elapsed = FPlatformTime::Seconds() - Start;
+
+        LogIQTInternal.SetVerbosity(PrevInternalVerbosity);
+
+        for (const FString& Violation : Report.Violations)
+        {
+            UE_LOG(LogIQT, Error, TEXT("IQT.Stress: VIOLAÇÃO %s"), *Violation);
+        }
+        UE_LOG(LogIQT, Display, TEXT("IQT.Stress: %s. %lld operações em %.2fs (%.0f ops/s), %d fases sequenciais (ordem), %d concorrentes (conservação), %d de fila pequena, %d violações."),
+            Report.Violations.Num() > 0 ? TEXT("FAIL") : TEXT("PASS"), Report.TotalOps, Elapsed, Elapsed > 0.0 ? Report.TotalOps / Elapsed : 0.0,
+            Report.SequentialPhases, Report.ConcurrentPhases, Report.SmallQueuePhases, Report.Violations.Num());
+
+        if (Config.bExitWhenDone)
+        {
+            FPlatformMisc::RequestExitWithStatus(false, Report.Violations.Num() > 0 ? 1 : 0);
+        }
+    }
+}
+
+static FAutoConsoleCommand CmdIQTStressRun(
+    TEXT("iqt.Stress.Run"),
+    TEXT("Executa o teste de estresse da fila interna da IQT: ordem contra um modelo sequencial e conservação dos itens sob concorrência. Ver IQT_StressTest.cpp para os argumentos."),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&IQTStressTest::Run));
+
+#endif // !UE_BUILD_SHIPPING
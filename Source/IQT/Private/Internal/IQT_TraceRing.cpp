@@ -0,0 +1,181 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_TraceRing.cpp
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#include "IQT_TraceRing.h"
+#include "IQT_Log.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+static bool GIQTTraceRingEnabled = false;
+static FAutoConsoleVariableRef CVarIQTTraceRingEnabled(
+    TEXT("iqt.Trace.Enable"),
+    GIQTTraceRingEnabled,
+    TEXT("Grava as operações da IQT (enqueue, dequeue, ações) no buffer circular binário. Use iqt.Trace.Dump para despejar."));
+
+#if IQT_WITH_TRACE_RING
+static FAutoConsoleCommand CmdIQTTraceDump(
+    TEXT("iqt.Trace.Dump"),
+    TEXT("Despeja o buffer circular de eventos da IQT em Saved/Profiling. Argumento opcional 'csv' para saída em texto."),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        const bool bAsCsv = Args.Num() > 0 && Args[0].Equals(TEXT("csv"), ESearchCase::IgnoreCase);
+        const FString Path = FIQT_TraceRing::Get().DumpToFile(bAsCsv);
+        if (Path.IsEmpty())
+        {
+            UE_LOG(LogIQT, Warning, TEXT("FIQT_TraceRing: Falha ao gravar o despejo de eventos."));
+        }
+        else
+        {
+            UE_LOG(LogIQT, Display, TEXT("FIQT_TraceRing: Eventos gravados em '%s'."), *Path);
+        }
+    }));
+
+static FAutoConsoleCommand CmdIQTTraceReset(
+    TEXT("iqt.Trace.Reset"),
+    TEXT("Descarta os eventos do buffer circular da IQT."),
+    FConsoleCommandDelegate::CreateLambda([]() { FIQT_TraceRing::Get().Reset(); }));
+#endif
+
+static_assert((FIQT_TraceRing::Capacity & (FIQT_TraceRing::Capacity - 1)) == 0, "FIQT_TraceRing::Capacity deve ser potência de dois.");
+
+FIQT_TraceRing& FIQT_TraceRing::Get()
+{
+    static FIQT_TraceRing Instance;
+    return Instance;
+}
+
+bool FIQT_TraceRing::IsEnabled()
+{
+    return GIQTTraceRingEnabled;
+}
+
+FIQT_TraceRing::FIQT_TraceRing()
+    : Slots(MakeUnique<FSlot[]>(Capacity))
+    , WriteIndex(0)
+{
+}
+
+void FIQT_TraceRing::Record(EIQT_TraceOp Op, uint32 QueueId, uint64 ItemHandle, int32 Priority)
+{
+    const uint64 Index = WriteIndex.fetch_add(1, std::memory_order_relaxed);
+    FSlot& Slot = Slots[Index & (Capacity - 1)];
+
+    // Marca o slot como "em escrita" (ímpar) antes de tocar no registro.
+    Slot.Sequence.store(2 * Index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Slot.Record.Cycles = FPlatformTime::Cycles64();
+    Slot.Record.ItemHandle = ItemHandle;
+    Slot.Record.Priority = Priority;
+    Slot.Record.QueueId = QueueId;
+    Slot.Record.Op = Op;
+
+    Slot.Sequence.store(2 * (Index + 1), std::memory_order_release);
+}
+
+void FIQT_TraceRing::Snapshot(TArray<FIQT_TraceRecord>& OutRecords) const
+{
+    OutRecords.Reset();
+
+    const uint64 End = WriteIndex.load(std::memory_order_acquire);
+    const uint64 Begin = End > Capacity ? End - Capacity : 0;
+    OutRecords.Reserve(static_cast<int32>(End - Begin));
+
+    for (uint64 Index = Begin; Index < End; ++Index)
+    {
+        const FSlot& Slot = Slots[Index & (Capacity - 1)];
+        const uint64 Expected = 2 * (Index + 1);
+        if (Slot.Sequence.load(std::memory_order_acquire) != Expected)
+        {
+            continue; // Ainda em escrita ou já sobrescrito por uma volta mais nova.
+        }
+
+        const FIQT_TraceRecord Copy = Slot.Record;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (Slot.Sequence.load(std::memory_order_relaxed) == Expected)
+        {
+            OutRecords.Add(Copy);
+        }
+    }
+}
+
+FString FIQT_TraceRing::DumpToFile(bool bAsCsv) const
+{
+    TArray<FIQT_TraceRecord> Records;
+    Snapshot(Records);
+
+    const FString BaseName = FString::Printf(TEXT("IQTTrace-%s"), *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S")));
+    const FString Directory = FPaths::ProfilingDir();
+
+    if (bAsCsv)
+    {
+        const double MillisecondsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1000.0;
+        const uint64 FirstCycles = Records.Num() > 0 ? Records[0].Cycles : 0;
+
+        FString Csv = TEXT("TimeMs,Op,QueueId,ItemHandle,Priority\n");
+        for (const FIQT_TraceRecord& Record : Records)
+        {
+            Csv += FString::Printf(TEXT("%.4f,%s,%u,%llu,%d\n"),
+                static_cast<double>(Record.Cycles - FirstCycles) * MillisecondsPerCycle,
+                GetOpName(Record.Op), Record.QueueId, Record.ItemHandle, Record.Priority);
+        }
+
+        const FString Path = Directory / (BaseName + TEXT(".csv"));
+        return FFileHelper::SaveStringToFile(Csv, *Path) ? Path : FString();
+    }
+
+    // Formato binário: cabeçalho (magic, versão, tamanho do registro, segundos por ciclo, quantidade) + registros crus.
+    TArray<uint8> Bytes;
+    const uint32 Magic = 0x54515149; // "IQQT"
+    const uint32 Version = 2; // 2: TaskID (FGuid) substituído por ItemHandle (uint64)
+    const uint32 RecordSize = sizeof(FIQT_TraceRecord);
+    const double SecondsPerCycle = FPlatformTime::GetSecondsPerCycle64();
+    const uint32 NumRecords = static_cast<uint32>(Records.Num());
+
+    Bytes.Append(reinterpret_cast<const uint8*>(&Magic), sizeof(Magic));
+    Bytes.Append(reinterpret_cast<const uint8*>(&Version), sizeof(Version));
+    Bytes.Append(reinterpret_cast<const uint8*>(&RecordSize), sizeof(RecordSize));
+    Bytes.Append(reinterpret_cast<const uint8*>(&SecondsPerCycle), sizeof(SecondsPerCycle));
+    Bytes.Append(reinterpret_cast<const uint8*>(&NumRecords), sizeof(NumRecords));
+    Bytes.Append(reinterpret_cast<const uint8*>(Records.GetData()), Records.Num() * RecordSize);
+
+    const FString Path = Directory / (BaseName + TEXT(".iqttrace"));
+    return FFileHelper::SaveArrayToFile(Bytes, *Path) ? Path : FString();
+}
+
+void FIQT_TraceRing::Reset()
+{
+    // Invalida todos os slots; escritores concorrentes apenas publicam em índices novos.
+    for (uint32 Index = 0; Index < Capacity; ++Index)
+    {
+        Slots[Index].Sequence.store(0, std::memory_order_relaxed);
+    }
+    WriteIndex.store(0, std::memory_order_release);
+}
+
+const TCHAR* FIQT_TraceRing::GetOpName(EIQT_TraceOp Op)
+{
+    switch (Op)
+    {
+        case EIQT_TraceOp::Enqueue:         return TEXT("Enqueue");
+        case EIQT_TraceOp::EnqueueRejected: return TEXT("EnqueueRejected");
+        case EIQT_TraceOp::Dequeue:         return TEXT("Dequeue");
+        case EIQT_TraceOp::DequeueEmpty:    return TEXT("DequeueEmpty");
+        case EIQT_TraceOp::Remove:          return TEXT("Remove");
+        case EIQT_TraceOp::RequeueDelayed:  return TEXT("RequeueDelayed");
+        case EIQT_TraceOp::DeadLetter:      return TEXT("DeadLetter");
+        case EIQT_TraceOp::ActionStart:     return TEXT("ActionStart");
+        case EIQT_TraceOp::ActionSuccess:   return TEXT("ActionSuccess");
+        case EIQT_TraceOp::ActionFail:      return TEXT("ActionFail");
+        case EIQT_TraceOp::ActionTimeout:   return TEXT("ActionTimeout");
+        case EIQT_TraceOp::Evict:           return TEXT("Evict");
+        case EIQT_TraceOp::Steal:           return TEXT("Steal");
+        default:                            return TEXT("Unknown");
+    }
+}
@@ -0,0 +1,93 @@
+﻿// IQT/Source/IQT/Private/Internal/IQT_TraceRing.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+// Habilita a compilação do buffer circular de eventos. Desligado em Shipping por padrão.
+#ifndef IQT_WITH_TRACE_RING
+    #define IQT_WITH_TRACE_RING !UE_BUILD_SHIPPING
+#endif
+
+// Operações registradas no buffer de eventos.
+enum class EIQT_TraceOp : uint8
+{
+    Enqueue,
+    EnqueueRejected,
+    Dequeue,
+    DequeueEmpty,
+    Remove,
+    RequeueDelayed,
+    DeadLetter,
+    ActionStart,
+    ActionSuccess,
+    ActionFail,
+    ActionTimeout,
+    Evict,
+    Steal,
+
+    Count
+};
+
+// Registro binário de um evento: sem strings, copiado como bloco de memória.
+struct FIQT_TraceRecord
+{
+    uint64 Cycles;      // FPlatformTime::Cycles64() no momento do evento
+    uint64 ItemHandle;  // FIQT_ItemHandle::Value do item (0 quando não se aplica)
+    int32 Priority;
+    uint32 QueueId;     // GetUniqueID() da UIQT_Queue de origem (0 quando não se aplica)
+    EIQT_TraceOp Op;
+};
+
+/**
+ * FIQT_TraceRing: Buffer circular global, sem locks, de eventos da IQT.
+ * Os produtores reservam um slot com um fetch_add e publicam o registro com uma sequência por slot (seqlock),
+ * então gravar um evento custa algumas instruções e nenhuma formatação de texto.
+ * O conteúdo é despejado sob demanda pelo comando de console "iqt.Trace.Dump [csv]".
+ * Eventos são gravados somente quando a CVar iqt.Trace.Enable = 1.
+ */
+class FIQT_TraceRing
+{
+public:
+    static constexpr uint32 Capacity = 1u << 14; // Deve ser potência de dois.
+
+    static FIQT_TraceRing& Get();
+
+    static bool IsEnabled();
+
+    void Record(EIQT_TraceOp Op, uint32 QueueId, uint64 ItemHandle, int32 Priority);
+
+    // Copia os eventos publicados, do mais antigo para o mais recente. Slots em escrita são ignorados.
+    void Snapshot(TArray<FIQT_TraceRecord>& OutRecords) const;
+
+    // Grava o snapshot em arquivo (binário ou CSV). Retorna o caminho gravado, ou string vazia em caso de falha.
+    FString DumpToFile(bool bAsCsv) const;
+
+    void Reset();
+
+    static const TCHAR* GetOpName(EIQT_TraceOp Op);
+
+private:
+    FIQT_TraceRing();
+
+    struct FSlot
+    {
+        std::atomic<uint64> Sequence { 0 }; // Ímpar = em escrita; 2 * (Índice + 1) = publicado
+        FIQT_TraceRecord Record;
+    };
+
+    TUniquePtr<FSlot[]> Slots;
+    std::atomic<uint64> WriteIndex;
+};
+
+#if IQT_WITH_TRACE_RING
+    #define IQT_TRACE_EVENT(Op, QueueId, ItemHandle, Priority) \
+        do { if (FIQT_TraceRing::IsEnabled()) { FIQT_TraceRing::Get().Record((Op), (QueueId), (ItemHandle), (Priority)); } } while (0)
+#else
+    #define IQT_TRACE_EVENT(Op, QueueId, ItemHandle, Priority) do { } while (0)
+#endif
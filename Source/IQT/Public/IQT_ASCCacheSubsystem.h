@@ -0,0 +1,68 @@
+﻿// IQT/Source/IQT/Public/IQT_ASCCacheSubsystem.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+
+#include "IQT_ASCCacheSubsystem.generated.h"
+
+class AActor;
+class UAbilitySystemComponent;
+
+/**
+ * UIQT_ASCCacheSubsystem: Cache compartilhado Ator -> AbilitySystemComponent usado pelas tasks da IQT.
+ * Evita repetir a busca por interface/componente (UAbilitySystemGlobals::GetAbilitySystemComponentFromActor)
+ * para cada item processado. As entradas usam ponteiros fracos e são invalidadas quando o ator é destruído;
+ * se o ASC de um ator mudar (ex.: troca de avatar), a entrada é revalidada na próxima consulta.
+ *
+ * Deve ser usado apenas na Game Thread.
+ */
+UCLASS()
+class IQT_API UIQT_ASCCacheSubsystem : public UWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // Retorna o subsistema do mundo do objeto de contexto (ou nullptr se não houver mundo).
+    static UIQT_ASCCacheSubsystem* Get(const UObject* WorldContextObject);
+
+    /**
+     * Resolve o ASC de um ator usando o cache do mundo do ator.
+     * Se o ator não estiver em um mundo com o subsistema, faz a busca direta em UAbilitySystemGlobals.
+     */
+    static UAbilitySystemComponent* ResolveASC(AActor* Actor);
+
+    // Resolve o ASC de um ator consultando (e preenchendo) este cache.
+    UAbilitySystemComponent* FindOrResolveASC(AActor* Actor);
+
+    // Remove a entrada do ator. Use após trocar manualmente o ASC de um ator.
+    UFUNCTION(BlueprintCallable, Category = "IQT|Ability System")
+    void InvalidateActor(AActor* Actor);
+
+    // Limpa todo o cache.
+    UFUNCTION(BlueprintCallable, Category = "IQT|Ability System")
+    void InvalidateAll();
+
+    UFUNCTION(BlueprintPure, Category = "IQT|Ability System")
+    int32 GetNumCachedActors() const { return CachedASCs.Num(); }
+
+    // USubsystem
+    virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+    virtual void Deinitialize() override;
+
+private:
+    void HandleActorDestroyed(AActor* Actor);
+
+    // Verifica se o ASC em cache ainda pertence ao ator (como dono ou como avatar).
+    static bool IsCachedASCValidFor(const UAbilitySystemComponent* ASC, const AActor* Actor);
+
+    TMap<TObjectKey<AActor>, TWeakObjectPtr<UAbilitySystemComponent>> CachedASCs;
+
+    FDelegateHandle ActorDestroyedHandle;
+};
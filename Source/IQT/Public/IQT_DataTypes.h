@@ -10,6 +10,8 @@
 #include "GameplayTags.h" 
 #include "Abilities/GameplayAbilityTypes.h" // Inclui FGameplayEventData
 #include "GameFramework/Actor.h" // Inclui AActor
+#include "IQT_TaskPayload.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
 
 #include "IQT_DataTypes.generated.h" 
 
@@ -19,7 +21,197 @@ enum class EIQT_QueueMode : uint8
 {
     PriorityOrder   UMETA(DisplayName = "Order By Priority"), // Ordenação baseada na propriedade Priority
     FIFO            UMETA(DisplayName = "First In, First Out"), // Primeiro a entrar, primeiro a sair
-    FILO            UMETA(DisplayName = "First In, Last Out")   // Primeiro a entrar, último a sair
+    FILO            UMETA(DisplayName = "First In, Last Out"),  // Primeiro a entrar, último a sair
+    UtilityScore    UMETA(DisplayName = "Order By Utility Score") // Maior Soma(UtilityWeights * UtilityFeatures) no momento da retirada
+};
+
+// O que acontece ao enfileirar em uma fila cheia (UIQT_Queue::MaxQueueSize).
+UENUM(BlueprintType)
+enum class EIQT_OverflowPolicy : uint8
+{
+    Reject          UMETA(DisplayName = "Reject New Item"),       // O item novo é recusado
+    EvictLowest     UMETA(DisplayName = "Evict Lowest Priority"), // O item que sairia por último é removido, se o novo for mais prioritário
+    Block           UMETA(DisplayName = "Block Producer")         // O produtor espera por espaço até o tempo limite e então recusa
+};
+
+// Grupos de campos copiados por UIQT_Queue::GetQueueSnapshot. Campos fora da máscara ficam com o valor padrão.
+UENUM(BlueprintType, meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class EIQT_SnapshotFields : uint8
+{
+    None        = 0         UMETA(Hidden),
+    Identity    = 1 << 0    UMETA(DisplayName = "Identity (Name, Handle, TaskID)"),
+    Tags        = 1 << 1    UMETA(DisplayName = "Tags (Trigger, End, Fail)"),
+    Priority    = 1 << 2    UMETA(DisplayName = "Priority (Priority, Utility Features)"),
+    State       = 1 << 3    UMETA(DisplayName = "State (Open, Enqueued, Stacked, Transferable, Attempts)"),
+    Payload     = 1 << 4    UMETA(DisplayName = "Payload (UserPayload, TaskPayload)"),
+    Policy      = 1 << 5    UMETA(DisplayName = "Policy (Timeout, Retry)"),
+    Timing      = 1 << 6    UMETA(DisplayName = "Timing"),
+};
+ENUM_CLASS_FLAGS(EIQT_SnapshotFields);
+
+/**
+ * Política de novas tentativas para um item cuja ação falhou.
+ * O atraso entre tentativas cresce exponencialmente: BackoffBaseSeconds * 2^(tentativa - 1), limitado por BackoffMaxSeconds,
+ * com uma variação aleatória de +/- JitterFraction para evitar que vários agentes repitam a ação no mesmo frame.
+ */
+USTRUCT(BlueprintType)
+struct FIQT_RetryPolicy
+{
+    GENERATED_BODY()
+
+    // Número máximo de tentativas, incluindo a primeira. 1 = sem novas tentativas.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Retry", meta = (ClampMin = "1"))
+    int32 MaxAttempts;
+
+    // Atraso base (segundos) antes da segunda tentativa.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Retry", meta = (ClampMin = "0", Units = "s"))
+    float BackoffBaseSeconds;
+
+    // Atraso máximo (segundos) entre tentativas.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Retry", meta = (ClampMin = "0", Units = "s"))
+    float BackoffMaxSeconds;
+
+    // Fração de variação aleatória aplicada ao atraso (0.2 = +/-20%).
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Retry", meta = (ClampMin = "0", ClampMax = "1"))
+    float JitterFraction;
+
+    // Tags de falha que permitem nova tentativa. Vazio = qualquer falha (inclusive timeout) é repetida.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Retry")
+    FGameplayTagContainer RetryableFailTags;
+
+    FIQT_RetryPolicy()
+        : MaxAttempts(1)
+        , BackoffBaseSeconds(0.5f)
+        , BackoffMaxSeconds(30.0f)
+        , JitterFraction(0.2f)
+    {}
+
+    // Verifica se um item que já executou AttemptsSoFar tentativas e falhou com FailTag pode ser repetido.
+    bool CanRetry(int32 AttemptsSoFar, const FGameplayTag& FailTag) const
+    {
+        if (AttemptsSoFar >= MaxAttempts)
+        {
+            return false;
+        }
+        return RetryableFailTags.IsEmpty() || FailTag.MatchesAny(RetryableFailTags);
+    }
+
+    // Calcula o atraso (segundos) antes da próxima tentativa, com backoff exponencial e jitter.
+    float ComputeBackoffDelay(int32 AttemptsSoFar) const
+    {
+        const int32 Exponent = FMath::Clamp(AttemptsSoFar - 1, 0, 30);
+        const float Delay = FMath::Min(BackoffBaseSeconds * static_cast<float>(1 << Exponent), BackoffMaxSeconds);
+        const float Jitter = FMath::Clamp(JitterFraction, 0.0f, 1.0f);
+        return FMath::Max(0.0f, Delay * FMath::FRandRange(1.0f - Jitter, 1.0f + Jitter));
+    }
+};
+
+/**
+ * Dados de um item lidos apenas no disparo da ação (e nas novas tentativas), fora do caminho quente da fila.
+ * Ficam em FIQT_QueueItem::DispatchData; use FIQT_QueueItem::GetDispatchData/GetMutableDispatchData em C++
+ * e UIQT_QueueItemLibrary em Blueprint.
+ */
+USTRUCT(BlueprintType)
+struct FIQT_QueueItemDispatchData
+{
+    GENERATED_BODY()
+
+    // Dados tipados da tarefa (qualquer USTRUCT), guardados por valor. Chegam à habilidade disparada
+    // no TargetData do evento de trigger (ver FIQT_PayloadTargetData).
+    UPROPERTY(BlueprintReadWrite, Category = "IQT|Queue Item")
+    FIQT_TaskPayload TaskPayload;
+
+    // Tempo limite (em segundos) para a ação emitir AbilityEndTag ou AbilityFailTag.
+    // 0 usa o timeout padrão do executor (UIQT_RunQueuedActions); se ambos forem 0, a espera não expira.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Queue Item", meta = (ClampMin = "0", Units = "s"))
+    float TimeoutSeconds;
+
+    // Política de novas tentativas usada pelo UIQT_RunQueuedActions quando a ação deste item falha.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Queue Item")
+    FIQT_RetryPolicy RetryPolicy;
+
+    FIQT_QueueItemDispatchData()
+        : TimeoutSeconds(0.0f)
+    {}
+};
+
+/**
+ * Bloco compartilhado de FIQT_QueueItemDispatchData (cópia na escrita).
+ * Copiar o item só incrementa a contagem de referências; o bloco é duplicado na primeira escrita de uma cópia
+ * compartilhada. Vazio enquanto o item usa os valores padrão, sem alocar nada.
+ * Serialização e GC passam pelas operações de struct abaixo, então spill, broker e coleta continuam vendo os dados.
+ */
+USTRUCT()
+struct IQT_API FIQT_SharedDispatchData
+{
+    GENERATED_BODY()
+
+    bool HasData() const { return Data.IsValid(); }
+
+    // Os valores padrão quando vazio.
+    const FIQT_QueueItemDispatchData& Get() const;
+
+    // Aloca o bloco, ou o duplica se estiver compartilhado com outra cópia do item.
+    FIQT_QueueItemDispatchData& GetMutable();
+
+    // Operações de struct (ver TStructOpsTypeTraits abaixo).
+    bool Serialize(FArchive& Ar);
+    bool Identical(const FIQT_SharedDispatchData* Other, uint32 PortFlags) const;
+    void AddStructReferencedObjects(FReferenceCollector& Collector);
+
+private:
+    TSharedPtr<FIQT_QueueItemDispatchData, ESPMode::ThreadSafe> Data;
+};
+
+template<>
+struct TStructOpsTypeTraits<FIQT_SharedDispatchData> : public TStructOpsTypeTraitsBase2<FIQT_SharedDispatchData>
+{
+    enum
+    {
+        WithCopy = true,
+        WithSerializer = true,
+        WithIdentical = true,
+        WithAddStructReferencedObjects = true,
+    };
+};
+
+/**
+ * Handle geracional de um item enfileirado em uma UIQT_Queue.
+ * Codifica o slot do item na tabela interna (32 bits baixos) e a geração do slot (32 bits altos):
+ * depois que o item sai da fila, o handle deixa de resolver, mesmo que o slot seja reutilizado.
+ * Atribuído pela fila em EnqueueItem; um handle zerado é inválido.
+ */
+USTRUCT(BlueprintType)
+struct FIQT_ItemHandle
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    uint64 Value;
+
+    FIQT_ItemHandle()
+        : Value(0)
+    {}
+
+    FIQT_ItemHandle(uint32 InSlot, uint32 InGeneration)
+        : Value((static_cast<uint64>(InGeneration) << 32) | InSlot)
+    {}
+
+    bool IsValid() const { return Value != 0; }
+    void Invalidate() { Value = 0; }
+
+    uint32 GetSlot() const { return static_cast<uint32>(Value); }
+    uint32 GetGeneration() const { return static_cast<uint32>(Value >> 32); }
+
+    FString ToString() const { return FString::Printf(TEXT("%u:%u"), GetSlot(), GetGeneration()); }
+
+    bool operator==(const FIQT_ItemHandle& Other) const { return Value == Other.Value; }
+    bool operator!=(const FIQT_ItemHandle& Other) const { return Value != Other.Value; }
+
+    friend uint32 GetTypeHash(const FIQT_ItemHandle& Handle)
+    {
+        return GetTypeHash(Handle.Value);
+    }
 };
 
 /**
@@ -31,6 +223,9 @@ struct FIQT_QueueItem
 {
     GENERATED_BODY()
 
+    // Número máximo de características usadas pela pontuação de utilidade (UtilityFeatures).
+    static constexpr int32 MaxUtilityFeatures = 8;
+
     // Nome descritivo ou identificador do item.
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Queue Item")
     FName Name;
@@ -55,10 +250,26 @@ struct FIQT_QueueItem
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Queue Item")
     int32 Priority;
 
+    // Características do item para o modo UtilityScore (ex.: proximidade, vida do alvo, recarga pronta), combinadas
+    // com UIQT_Queue::UtilityWeights na hora da retirada. Só as MaxUtilityFeatures primeiras contam; ausentes valem 0.
+    // Para atualizar um item já na fila use UIQT_Queue::UpdateItemUtilityFeatures.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Queue Item")
+    TArray<float> UtilityFeatures;
+
     // ID de tarefa único, útil para identificação e busca.
+    // Gerado sob demanda (GetTaskID) para que construir um item não custe uma chamada ao gerador de GUIDs da plataforma.
+    // Para identificar um item dentro da fila, prefira o Handle.
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Queue Item")
     FGuid TaskID;
 
+    // Handle atribuído pela UIQT_Queue ao enfileirar o item. Permite buscar, cancelar e atualizar o item em O(1).
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IQT|Queue Item")
+    FIQT_ItemHandle Handle;
+
+    // Empréstimo no broker de um item desenfileirado por um proxy (0 fora desse caso), confirmado por
+    // UIQT_Queue::AcknowledgeItem. Não é UPROPERTY: só vale na conexão deste processo e não viaja com o item.
+    uint64 BrokerLeaseId;
+
     // Flags de estado interno do item, conforme sua lógica.
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Queue Item")
     bool bIsEnqueued;
@@ -66,10 +277,42 @@ struct FIQT_QueueItem
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Queue Item")
     bool bIsStacked;
 
+    // Pode ser roubado por outra fila do mesmo grupo de compartilhamento (UIQT_Queue::SharingGroup).
+    // Marque apenas itens que qualquer agente do grupo consegue executar.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Queue Item")
+    bool bTransferable;
+
     // Payload genérico para o usuário armazenar qualquer UObject que desejar associar a este item da fila.
+    // Para dados simples prefira o TaskPayload (GetDispatchData), que não exige alocar um UObject.
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Queue Item")
     UObject* UserPayload;
 
+    // TaskPayload, TimeoutSeconds e RetryPolicy: lidos só no disparo, ficam fora do item para que as cópias
+    // feitas pela fila e pelo executor não os dupliquem. Acesse por GetDispatchData/GetMutableDispatchData.
+    UPROPERTY()
+    FIQT_SharedDispatchData DispatchData;
+
+    // Quantas vezes a ação deste item já foi disparada. Incrementado pelo executor a cada tentativa.
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IQT|Queue Item")
+    int32 AttemptCount;
+
+    // Carimbos do ciclo de vida do item, usados nos histogramas de latência (IQT_LatencyStats.h).
+    // Só a chegada é absoluta (FPlatformTime::Seconds, também usada pelo envelhecimento); as demais etapas
+    // são deslocamentos em segundos a partir dela, em float para não pesar no item. 0 = etapa ainda não ocorreu.
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IQT|Queue Item|Timing")
+    double EnqueueTimeSeconds;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IQT|Queue Item|Timing")
+    float DequeueOffsetSeconds;
+
+    // Envio do evento de trigger pelo executor.
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IQT|Queue Item|Timing")
+    float DispatchOffsetSeconds;
+
+    // Recebimento da tag de fim/falha (ou timeout).
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IQT|Queue Item|Timing")
+    float CompletionOffsetSeconds;
+
     // Construtor padrão
     FIQT_QueueItem()
         : Name(NAME_None)
@@ -78,12 +321,42 @@ struct FIQT_QueueItem
         , AbilityFailTag(FGameplayTag())
         , bIsOpen(false)
         , Priority(0)
-        , TaskID(FGuid::NewGuid()) 
+        , TaskID() 
+        , BrokerLeaseId(0)
         , bIsEnqueued(false)
         , bIsStacked(false)
+        , bTransferable(false)
         , UserPayload(nullptr)
+        , AttemptCount(0)
+        , EnqueueTimeSeconds(0.0)
+        , DequeueOffsetSeconds(0.0f)
+        , DispatchOffsetSeconds(0.0f)
+        , CompletionOffsetSeconds(0.0f)
     {}
 
+    const FIQT_QueueItemDispatchData& GetDispatchData() const { return DispatchData.Get(); }
+
+    // Antes de enfileirar, ou na cópia local de um item já retirado; a cópia guardada na fila não é alterada.
+    FIQT_QueueItemDispatchData& GetMutableDispatchData() { return DispatchData.GetMutable(); }
+
+    // Deslocamento de NowSeconds em relação à chegada; nunca 0, que marca etapa não ocorrida.
+    float MakeStageOffset(double NowSeconds) const
+    {
+        return FMath::Max(static_cast<float>(NowSeconds - EnqueueTimeSeconds), UE_SMALL_NUMBER);
+    }
+
+    // Retorna o TaskID, gerando-o na primeira chamada.
+    // Chame antes de enfileirar para que a cópia guardada na fila possa ser encontrada por FindItemByTaskID;
+    // para um item já enfileirado use UIQT_Queue::GetItemTaskID.
+    const FGuid& GetTaskID()
+    {
+        if (!TaskID.IsValid())
+        {
+            TaskID = FGuid::NewGuid();
+        }
+        return TaskID;
+    }
+
     // Sobrecarga do operador de igualdade para comparação de itens
     // NOTA: 'AbilityEndTag' e 'AbilityFailTag' não estão incluídas na comparação de igualdade,
     // pois geralmente são tags de "resultado" ou "estado final" e não definem a unicidade fundamental do item na fila.
@@ -119,7 +392,7 @@ struct FIQT_TriggerData
     FGameplayTag TriggerTag;
 
     // O payload completo (FGameplayEventData) pré-preenchido para o disparo do evento.
-    // Inclui Instigator, Target, EventTag (que é a TriggerTag) e OptionalObject.
+    // Inclui Instigator, Target, EventTag (que é a TriggerTag), OptionalObject (UserPayload) e TargetData (TaskPayload).
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Trigger Data")
     FGameplayEventData Payload;
 
@@ -128,6 +401,10 @@ struct FIQT_TriggerData
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Trigger Data")
     AActor* EventTargetActor;
 
+    // Cópia do TaskPayload do item. Também é anexado ao Payload.TargetData, de onde a habilidade o lê.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT|Trigger Data")
+    FIQT_TaskPayload TaskPayload;
+
     FIQT_TriggerData()
         : TriggerTag(FGameplayTag())
         , Payload(FGameplayEventData())
@@ -140,3 +417,21 @@ struct FIQT_TriggerData
     //     return TriggerTag == Other.TriggerTag && Payload == Other.Payload && EventTargetActor == Other.EventTargetActor;
     // }
 };
+
+/**
+ * Funções de Blueprint para ler e alterar FIQT_QueueItem::DispatchData (TaskPayload, TimeoutSeconds e RetryPolicy).
+ */
+UCLASS()
+class IQT_API UIQT_QueueItemLibrary : public UBlueprintFunctionLibrary
+{
+    GENERATED_BODY()
+
+public:
+    // Retorna uma cópia dos dados de disparo do item (valores padrão se nunca foram definidos).
+    UFUNCTION(BlueprintPure, Category = "IQT|Queue Item")
+    static FIQT_QueueItemDispatchData GetQueueItemDispatchData(const FIQT_QueueItem& Item);
+
+    // Substitui os dados de disparo do item. Use antes de enfileirar.
+    UFUNCTION(BlueprintCallable, Category = "IQT|Queue Item")
+    static void SetQueueItemDispatchData(UPARAM(ref) FIQT_QueueItem& Item, const FIQT_QueueItemDispatchData& DispatchData);
+};
@@ -0,0 +1,30 @@
+﻿// IQT/Source/IQT/Public/IQT_GameplayTags.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NativeGameplayTags.h"
+
+/**
+ * Tags nativas usadas internamente pela IQT.
+ * São registradas automaticamente quando o módulo é carregado, não é necessário declará-las no DefaultGameplayTags.ini.
+ */
+namespace IQTGameplayTags
+{
+    // Tag enviada no FailedAction quando uma ação não emite AbilityEndTag/AbilityFailTag dentro do tempo limite.
+    IQT_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Action_Timeout);
+
+    // Tag usada quando um item retirado da fila não chega a ser disparado (TriggerData inválida, alvo sem ASC ou
+    // espera sem tags de fim/falha). Passa pela RetryPolicy como qualquer outra falha.
+    IQT_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Action_DispatchFailed);
+
+    // Tag usada na dead-letter quando a fila recusa como duplicado um item já aceito antes (ao sair do atraso/roubo).
+    IQT_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Item_Duplicate);
+
+    // Tag usada na dead-letter quando a fila recusa um item já aceito antes por outro motivo (inválido ao sair do atraso/roubo).
+    IQT_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Item_Rejected);
+}
@@ -0,0 +1,180 @@
+﻿// IQT/Source/IQT/Public/IQT_LatencyStats.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "Misc/ScopeRWLock.h"
+#include <atomic>
+
+#include "IQT_LatencyStats.generated.h"
+
+class UIQT_Queue;
+
+/**
+ * FIQT_LatencyPercentiles: Resumo de um histograma de latência, em milissegundos.
+ */
+USTRUCT(BlueprintType)
+struct IQT_API FIQT_LatencyPercentiles
+{
+    GENERATED_BODY()
+
+    // Quantidade de amostras registradas.
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IQT|Latency")
+    int64 SampleCount;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IQT|Latency", meta = (Units = "ms"))
+    float P50Ms;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IQT|Latency", meta = (Units = "ms"))
+    float P95Ms;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IQT|Latency", meta = (Units = "ms"))
+    float P99Ms;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IQT|Latency", meta = (Units = "ms"))
+    float MeanMs;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IQT|Latency", meta = (Units = "ms"))
+    float MaxMs;
+
+    FIQT_LatencyPercentiles()
+        : SampleCount(0)
+        , P50Ms(0.0f)
+        , P95Ms(0.0f)
+        , P99Ms(0.0f)
+        , MeanMs(0.0f)
+        , MaxMs(0.0f)
+    {}
+};
+
+/**
+ * FIQT_LatencyHistogram: Histograma log-linear de memória fixa (estilo HDR) para latências em microssegundos.
+ * - 32 faixas em potência de dois, cada uma dividida em 16 sub-faixas lineares: erro relativo máximo de ~6%.
+ * - Cobre de 1 us até ~9,5 horas; valores acima caem na última sub-faixa.
+ * - Record é lock-free (contadores atômicos relaxados) e pode ser chamado de qualquer thread.
+ */
+class IQT_API FIQT_LatencyHistogram
+{
+public:
+    static constexpr int32 SubBucketBits = 4;
+    static constexpr int32 SubBucketCount = 1 << SubBucketBits;
+    static constexpr int32 MajorBucketCount = 32;
+    static constexpr int32 NumBuckets = MajorBucketCount * SubBucketCount;
+
+    FIQT_LatencyHistogram();
+
+    FIQT_LatencyHistogram(const FIQT_LatencyHistogram&) = delete;
+    FIQT_LatencyHistogram& operator=(const FIQT_LatencyHistogram&) = delete;
+
+    void RecordSeconds(double Seconds);
+    void RecordMicroseconds(uint64 Microseconds);
+    void Reset();
+
+    uint64 GetCount() const { return Count.load(std::memory_order_relaxed); }
+
+    // Valor (em microssegundos) abaixo do qual estão Quantile (0..1) das amostras.
+    uint64 GetValueAtQuantile(double Quantile) const;
+
+    FIQT_LatencyPercentiles GetPercentiles() const;
+
+    static int32 GetBucketIndex(uint64 Microseconds);
+    static uint64 GetBucketLowerBound(int32 BucketIndex);
+    static uint64 GetBucketWidth(int32 BucketIndex);
+
+private:
+    std::atomic<uint32> Buckets[NumBuckets];
+    std::atomic<uint64> Count;
+    std::atomic<uint64> SumMicroseconds;
+    std::atomic<uint64> MaxMicroseconds;
+};
+
+/**
+ * FIQT_LatencySeries: Par de histogramas de uma série (uma fila ou uma AbilityTriggerTag).
+ * - QueueWait: do enfileiramento até o desenfileiramento.
+ * - Execution: do envio do evento de trigger até a tag de fim/falha (ou timeout).
+ */
+struct IQT_API FIQT_LatencySeries
+{
+    explicit FIQT_LatencySeries(const FString& InSeriesName);
+
+    const FString SeriesName;
+    FIQT_LatencyHistogram QueueWait;
+    FIQT_LatencyHistogram Execution;
+
+    // Nomes pré-calculados das colunas no CSV profiler (Wait/Exec x P50/P95/P99).
+    FName CsvStatNames[6];
+};
+
+/**
+ * FIQT_LatencyRegistry: Registro global das séries de latência por fila e por tag.
+ * - Séries por fila: chaveadas pelo QueueName (filas de mesmo nome compartilham a série) e contadas por referência;
+ *   a série é liberada quando a última fila que a obteve a devolve.
+ * - Séries por tag: nunca são liberadas (Reset apenas zera os contadores), então ponteiros obtidos continuam válidos.
+ */
+class IQT_API FIQT_LatencyRegistry
+{
+public:
+    static FIQT_LatencyRegistry& Get();
+
+    // Obtém (criando se preciso) a série da fila e soma uma referência. nullptr com QueueName vazio.
+    FIQT_LatencySeries* AcquireQueueSeries(FName QueueName);
+    // Devolve uma referência obtida em AcquireQueueSeries; a última libera a série.
+    void ReleaseQueueSeries(FIQT_LatencySeries* Series);
+
+    FIQT_LatencySeries& FindOrAddTagSeries(FGameplayTag Tag);
+    const FIQT_LatencySeries* FindQueueSeries(FName QueueName) const;
+    const FIQT_LatencySeries* FindTagSeries(FGameplayTag Tag) const;
+
+    // Registra a espera na fila/execução de um item na série da fila (lock-free) e, com iqt.Latency.PerTag
+    // ligado, também na série da sua AbilityTriggerTag (busca no mapa sob leitura do Lock).
+    void RecordQueueWait(FIQT_LatencySeries* QueueSeries, FGameplayTag Tag, double Seconds);
+    void RecordExecution(FIQT_LatencySeries* QueueSeries, FGameplayTag Tag, double Seconds);
+
+    void ResetAll();
+
+    // Publica os percentis de todas as séries no CSV profiler (chamado a cada fim de frame pelo módulo).
+    void ExportToCsvProfiler() const;
+
+private:
+    FIQT_LatencyRegistry() = default;
+
+    struct FQueueSeriesEntry
+    {
+        TUniquePtr<FIQT_LatencySeries> Series;
+        int32 NumRefs = 0;
+    };
+
+    mutable FRWLock Lock;
+    TMap<FName, FQueueSeriesEntry> QueueSeries;
+    TMap<FGameplayTag, TUniquePtr<FIQT_LatencySeries>> TagSeries;
+};
+
+/**
+ * UIQT_LatencyStatsLibrary: Consulta dos histogramas de latência da IQT em Blueprint.
+ */
+UCLASS()
+class IQT_API UIQT_LatencyStatsLibrary : public UBlueprintFunctionLibrary
+{
+    GENERATED_BODY()
+
+public:
+    // Percentis de espera na fila e de execução de uma fila. Retorna false se a fila não tem QueueName ou se
+    // nenhuma fila com esse nome registrou amostras desde que entrou em registro.
+    UFUNCTION(BlueprintPure, Category = "IQT|Latency")
+    static bool GetQueueLatency(const UIQT_Queue* Queue, FIQT_LatencyPercentiles& OutQueueWait, FIQT_LatencyPercentiles& OutExecution);
+
+    // Percentis de espera na fila e de execução dos itens com esta AbilityTriggerTag (todas as filas).
+    // Só há amostras com a variável de console iqt.Latency.PerTag ligada.
+    UFUNCTION(BlueprintPure, Category = "IQT|Latency")
+    static bool GetTagLatency(FGameplayTag AbilityTriggerTag, FIQT_LatencyPercentiles& OutQueueWait, FIQT_LatencyPercentiles& OutExecution);
+
+    // Zera todos os histogramas (útil no início de um soak test).
+    UFUNCTION(BlueprintCallable, Category = "IQT|Latency")
+    static void ResetLatencyStats();
+};
@@ -0,0 +1,38 @@
+﻿// IQT/Source/IQT/Public/IQT_Log.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Logging/LogMacros.h"
+
+/**
+ * Verbosidade máxima COMPILADA das categorias de log da IQT.
+ * Mensagens acima deste nível são removidas pelo compilador (nem a checagem em tempo de execução sobra),
+ * então as mensagens por operação (Verbose/VeryVerbose) não custam nada em builds Shipping/Test.
+ * Nos demais builds tudo é compilado e a verbosidade padrão (Log) filtra em tempo de execução: as mensagens por
+ * operação podem ser ligadas com "log LogIOTQueue Verbose" ou -LogCmds="LogIOTQueue Verbose".
+ * Pode ser sobrescrita pelo projeto, ex.: PublicDefinitions.Add("IQT_LOG_COMPILE_VERBOSITY=VeryVerbose").
+ */
+#ifndef IQT_LOG_COMPILE_VERBOSITY
+    #if UE_BUILD_SHIPPING || UE_BUILD_TEST
+        #define IQT_LOG_COMPILE_VERBOSITY Warning
+    #else
+        #define IQT_LOG_COMPILE_VERBOSITY All
+    #endif
+#endif
+
+// Módulo e subsistemas da IQT.
+IQT_API DECLARE_LOG_CATEGORY_EXTERN(LogIQT, Log, IQT_LOG_COMPILE_VERBOSITY);
+
+// Componente UIQT_Queue (mantém o nome histórico da categoria para não quebrar filtros existentes).
+IQT_API DECLARE_LOG_CATEGORY_EXTERN(LogIOTQueue, Log, IQT_LOG_COMPILE_VERBOSITY);
+
+// Estrutura interna da fila (UIQT_PriorityQueueInternal).
+IQT_API DECLARE_LOG_CATEGORY_EXTERN(LogIQTInternal, Log, IQT_LOG_COMPILE_VERBOSITY);
+
+// Ability Tasks (UIQT_RunQueuedActions e UIQT_WaitForAction).
+IQT_API DECLARE_LOG_CATEGORY_EXTERN(LogIQTTasks, Log, IQT_LOG_COMPILE_VERBOSITY);
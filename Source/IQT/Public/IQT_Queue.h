@@ -8,14 +8,25 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h" 
+#include "Containers/Ticker.h"
 #include "IQT_DataTypes.h" 
+#include "IQT_Log.h"
+#include "IQT_SmallQueue.h"
 
 class UIQT_PriorityQueueInternal; 
+class FIQT_QueueCounters;
+class FIQT_Broker;
+class FIQT_BrokerClient;
+struct FIQT_LatencySeries;
 
 #include "IQT_Queue.generated.h" 
 
 
-DECLARE_LOG_CATEGORY_EXTERN(LogIOTQueue, Log, All);
+// Disparado quando um item esgota suas tentativas e é movido para a fila de mensagens mortas (dead-letter).
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FIQT_OnItemDeadLetteredDelegate, const FIQT_QueueItem&, Item, FGameplayTag, LastFailTag);
+
+// Disparado quando a fila cheia (OverflowPolicy = EvictLowest) remove um item para dar lugar a outro mais prioritário.
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FIQT_OnItemEvictedDelegate, const FIQT_QueueItem&, EvictedItem);
 /**
  * UIQT_Queue: Componente Gerenciador de Fila de Prioridade para Unreal Engine.
  * Este componente encapsula a lógica de fila C++ e a expõe para Blueprints.
@@ -32,11 +43,21 @@ class IQT_API UIQT_Queue : public UActorComponent
 public:
     UIQT_Queue();
     
+    virtual void OnRegister() override;   // Cria os contadores de profiling da fila
+    virtual void OnUnregister() override; // Sai do grupo de compartilhamento e devolve a série de latência
     virtual void BeginDestroy() override; // Limpeza do objeto interno da fila
 
+    // Os itens da fila interna e da lista de atrasados não são UPROPERTYs: seus payloads são reportados ao GC aqui.
+    static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+
     // --- Propriedades Configuráveis da Fila (Expostas no Blueprint) ---
 
-    // Define o modo de enfileiramento (Prioridade, FIFO, FILO).
+    // Nome da fila em estatísticas ("stat IQT") e no Unreal Insights. Se vazio, usa "<Dono>.<Componente>".
+    // Os histogramas de latência por fila exigem um QueueName (filas de mesmo nome compartilham os histogramas).
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "IQT Queue Configuration")
+    FName QueueName;
+
+    // Define o modo de enfileiramento (Prioridade, FIFO, FILO ou pontuação de utilidade).
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration")
     EIQT_QueueMode EnqueueMode; 
 
@@ -46,35 +67,170 @@ public:
     bool bIgnoreDuplicatesOnEnqueue;
 
     // Tamanho máximo que a fila pode atingir. Se for 0, não há limite de tamanho.
+    // O que acontece ao enfileirar com a fila cheia é definido por OverflowPolicy.
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration",
               meta = (ClampMin = "0", ToolTip = "Maximum number of items the queue can hold. 0 means no limit."))
     int32 MaxQueueSize;
+
+    // Itens para os quais InitializeQueue pré-aloca o armazenamento interno (heap, slots e índices), para que a fila
+    // não realoque durante o jogo. Se for 0 (ou caber inline, ver FIQT_SmallQueue), o armazenamento só é criado quando
+    // a fila passa de FIQT_SmallQueue::Capacity itens e cresce sob demanda.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration",
+              meta = (ClampMin = "0", ToolTip = "Items to preallocate storage for in InitializeQueue. 0 creates storage on first enqueue."))
+    int32 ReserveCapacity;
+
+    // Comportamento com a fila cheia: recusar o item novo, remover o item que sairia por último (se o novo for mais
+    // prioritário; dispara OnItemEvicted) ou bloquear o produtor até haver espaço ou esgotar OverflowBlockTimeoutSeconds.
+    // Block é pensado para produtores em outras threads: no game thread a espera trava o frame.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration")
+    EIQT_OverflowPolicy OverflowPolicy;
+
+    // Tempo máximo (segundos) que EnqueueItem espera por espaço com OverflowPolicy = Block.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration",
+              meta = (ClampMin = "0", EditCondition = "OverflowPolicy == EIQT_OverflowPolicy::Block"))
+    float OverflowBlockTimeoutSeconds;
+
+    UPROPERTY(BlueprintAssignable, Category = "IQT Queue")
+    FIQT_OnItemEvictedDelegate OnItemEvicted;
+
+    // Envelhecimento (apenas no modo PriorityOrder): pontos de prioridade que um item ganha por segundo de espera,
+    // para que itens de baixa prioridade não esperem para sempre atrás de um fluxo contínuo de itens urgentes.
+    // Prioridade efetiva = Priority - AgingRatePerSecond * espera (menor sai primeiro). 0 desativa.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration",
+              meta = (ClampMin = "0", ToolTip = "Priority points an item gains per second of waiting (PriorityOrder only). 0 disables aging."))
+    float AgingRatePerSecond;
+
+    // Pesos do modo UtilityScore: DequeueItem retira o item de maior Soma(UtilityWeights[i] * UtilityFeatures[i]),
+    // calculada no momento da retirada (até FIQT_QueueItem::MaxUtilityFeatures pesos). Os demais modos ignoram os pesos.
+    // Para trocar em tempo de execução (o contexto mudou) use SetUtilityWeights.
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "IQT Queue Configuration|Utility")
+    TArray<float> UtilityWeights;
+
+    // Modo UtilityScore: 0 pontua todos os itens; N > 0 pontua apenas os N primeiros na ordem de Priority,
+    // limitando o custo da retirada em filas grandes.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration|Utility", meta = (ClampMin = "0"))
+    int32 UtilityCandidateWindow;
+
+    // Modo spill: acima deste número de itens em memória, a metade menos prioritária é gravada em arquivos de run
+    // ordenados (em SpillDirectory) e volta à memória conforme os itens à frente saem. A ordem de saída é mantida.
+    // Em memória fica só um resumo por run (contagens e um filtro de ~2 bytes por item); buscas, handles, a checagem
+    // de duplicidade e as operações em lote leem os arquivos, então enxergam os itens em disco. DequeueMatching e
+    // StealWork, não. 0 desativa.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration|Spill",
+              meta = (ClampMin = "0", ToolTip = "Items kept in memory before lower-priority items are spilled to disk. 0 disables spilling."))
+    int32 SpillInMemoryBudget;
+
+    // Diretório dos arquivos de run. Vazio usa Saved/IQT/Spill.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration|Spill")
+    FString SpillDirectory;
+
+    // Grupo de compartilhamento (ex.: um esquadrão). Filas do mesmo grupo roubam umas das outras os itens marcados
+    // com bTransferable, sempre da cauda (menos prioritários) da fila com mais itens transferíveis. Vazio = fora de grupo.
+    // Para trocar em tempo de execução use SetSharingGroup.
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "IQT Queue Configuration|Sharing")
+    FGameplayTag SharingGroup;
+
+    // Se verdadeiro, DequeueItem em uma fila vazia tenta roubar até StealBatchSize itens do grupo antes de falhar.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration|Sharing")
+    bool bStealWhenIdle;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration|Sharing", meta = (ClampMin = "1"))
+    int32 StealBatchSize;
+
+    // Se verdadeiro, itens que esgotaram as tentativas são guardados na fila de mensagens mortas para inspeção.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration|Retry")
+    bool bEnableDeadLetterQueue;
+
+    // Quantidade máxima de itens guardados na fila de mensagens mortas (os mais antigos são descartados). 0 = sem limite.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration|Retry", meta = (ClampMin = "0"))
+    int32 MaxDeadLetterItems;
+
+    UPROPERTY(BlueprintAssignable, Category = "IQT Queue|Retry")
+    FIQT_OnItemDeadLetteredDelegate OnItemDeadLettered;
     
     // --- Funções Expostas para Blueprint ---
 
     /**
-     * Inicializa a fila. Deve ser chamada antes de qualquer operação de enfileiramento/desenfileiramento.
-     * Limpa qualquer estado anterior da fila.
+     * Inicializa a fila: limpa qualquer estado anterior e, com ReserveCapacity acima da capacidade inline
+     * (FIQT_SmallQueue::Capacity), pré-aloca o armazenamento interno.
+     * Sem reserva a chamada é opcional: os primeiros itens ficam inline e a fila interna é criada quando eles não cabem.
      */
     UFUNCTION(BlueprintCallable, Category = "IQT Queue")
     void InitializeQueue();
 
     /**
      * Adiciona um item à fila. O comportamento (prioridade, FIFO, FILO) depende do 'EnqueueMode'.
-     * @param ItemToEnqueue O item (FIQT_QueueItem) a ser adicionado.
+     * @param ItemToEnqueue O item (FIQT_QueueItem) a ser adicionado. Em caso de sucesso, ItemToEnqueue.Handle recebe o handle do item na fila.
      * @return True se o item foi adicionado com sucesso, false caso contrário (ex: fila cheia, duplicado).
      */
     UFUNCTION(BlueprintCallable, Category = "IQT Queue", meta=(DisplayName="Enqueue Item", Keywords="add queue push"))
     bool EnqueueItem(UPARAM(ref) FIQT_QueueItem& ItemToEnqueue); 
 
     /**
-     * Remove e retorna o item de maior prioridade (ou o próximo em ordem FIFO/FILO) da fila.
+     * Remove e retorna o item de maior prioridade (ou o próximo em ordem FIFO/FILO, ou o de maior pontuação no modo UtilityScore) da fila.
      * @param OutItem O item removido da fila. Será inválido se a fila estiver vazia.
      * @return True se um item foi removido com sucesso, false se a fila estiver vazia.
      */
     UFUNCTION(BlueprintCallable, Category = "IQT Queue", meta=(DisplayName="Dequeue Item", Keywords="remove queue pop"))
     bool DequeueItem(FIQT_QueueItem& OutItem); 
 
+    /**
+     * Remove e retorna o próximo item (na ordem da fila) cuja AbilityTriggerTag satisfaz a consulta.
+     * A tag do item conta com suas tags pai: uma consulta por "IQT.Task" aceita "IQT.Task.ImageProcess".
+     * Cada tag tem um sub-heap próprio, então o custo não depende do número de itens de outras tags.
+     * @param Query A consulta de gameplay tags. Uma consulta vazia não satisfaz nenhum item.
+     * @param OutItem O item removido. Será um item padrão se nenhum item satisfizer a consulta.
+     * @return True se um item foi removido.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue", meta=(DisplayName="Dequeue Matching Item", Keywords="remove queue pop tag query filter"))
+    bool DequeueMatching(const FGameplayTagQuery& Query, FIQT_QueueItem& OutItem);
+
+    /**
+     * Retorna uma cópia do próximo item que DequeueMatching removeria, sem removê-lo.
+     * @return True se algum item satisfaz a consulta.
+     */
+    UFUNCTION(BlueprintPure, Category = "IQT Queue", meta=(DisplayName="Peek Matching Item", Keywords="queue peek tag query filter"))
+    bool PeekMatching(const FGameplayTagQuery& Query, FIQT_QueueItem& OutItem) const;
+
+    // --- Inspeção ---
+    // Nenhuma destas funções remove itens. Itens atrasados (EnqueueDelayedItem) não fazem parte da fila até serem promovidos.
+
+    /**
+     * Retorna uma cópia do item que DequeueItem retornaria, sem removê-lo.
+     * @return True se a fila não estiver vazia.
+     */
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Inspection", meta=(DisplayName="Peek Top Item", Keywords="queue peek top head front"))
+    bool PeekTopItem(FIQT_QueueItem& OutItem) const;
+
+    /**
+     * Copia até K itens na ordem de saída, sem removê-los. Usa seleção parcial: O(K log K), independente do tamanho da fila.
+     * @return Número de itens copiados.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Inspection", meta=(DisplayName="Get Top K Items", Keywords="queue peek top list"))
+    int32 GetTopK(int32 K, TArray<FIQT_QueueItem>& OutItems) const;
+
+    /**
+     * Copia até MaxItems itens (todos se MaxItems <= 0) na ordem de saída, preenchendo apenas os grupos de campos
+     * pedidos em Fields (EIQT_SnapshotFields); os demais campos ficam com o valor padrão.
+     * Pensado para UI e ferramentas de depuração, que costumam precisar só de nome, tags e prioridade.
+     * @return Número de itens copiados.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Inspection", meta=(DisplayName="Get Queue Snapshot", Keywords="queue list inspect debug ui"))
+    int32 GetQueueSnapshot(UPARAM(meta=(Bitmask, BitmaskEnum="/Script/IQT.EIQT_SnapshotFields")) int32 Fields, int32 MaxItems, TArray<FIQT_QueueItem>& OutItems) const;
+
+    // Versões C++ sem cópia: os visitantes recebem referências válidas apenas durante a chamada e rodam sob a trava
+    // de leitura da fila (outros leitores seguem em paralelo). Dentro do visitante, chame apenas as consultas sem
+    // trava (GetQueueCount, IsQueueEmpty, GetNumOpenItems, GetNumClosedItems, GetHeadPriority).
+
+    // Visita o item que DequeueItem retornaria. Retorna false se a fila estiver vazia.
+    bool PeekTop(TFunctionRef<void(const FIQT_QueueItem&)> Visitor) const;
+
+    // Visita até K itens na ordem de saída. Retorna o número de itens visitados.
+    int32 ForEachTopK(int32 K, TFunctionRef<void(const FIQT_QueueItem&)> Visitor) const;
+
+    // Visita todos os itens em ordem arbitrária. O visitante retorna false para interromper.
+    void ForEachItem(TFunctionRef<bool(const FIQT_QueueItem&)> Visitor) const;
+
     /**
      * Remove um item específico da fila.
      * @param ItemToRemove O item a ser removido (comparado por Nome, Tag, bIsOpen).
@@ -83,6 +239,35 @@ public:
     UFUNCTION(BlueprintCallable, Category = "IQT Queue", meta=(DisplayName="Remove Specific Item", Keywords="remove queue delete"))
     bool RemoveSpecificItem(UPARAM(ref) FIQT_QueueItem& ItemToRemove); 
 
+    /**
+     * Remove todos os itens cujo UserPayload é o objeto informado (ex.: um alvo que morreu), em uma única passada.
+     * @return O número de itens removidos.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Bulk", meta=(DisplayName="Remove Items With Payload", Keywords="queue remove purge payload target bulk"))
+    int32 RemoveItemsWithPayload(const UObject* Payload);
+
+    /**
+     * Número de itens cuja AbilityTriggerTag satisfaz a consulta. Soma o tamanho dos buckets de tag, sem percorrer a fila.
+     */
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Bulk", meta=(DisplayName="Count Items Matching Query", Keywords="queue count filter tag query"))
+    int32 CountItemsMatchingQuery(const FGameplayTagQuery& Query) const;
+
+    // Versões C++ em lote: a fila é reordenada uma única vez (heapify O(n)), em vez de uma remoção ou reinserção
+    // O(log n) por item. Itens gravados em disco pelo modo spill são lidos das runs na thread chamadora.
+    // O predicado de RemoveAllMatching/CountMatching é avaliado em paralelo (ParallelFor), em threads de trabalho e
+    // sob a trava da fila: deve ser thread-safe, não pode chamar a fila e não deve criar nem destruir UObjects.
+
+    // Remove os itens que satisfazem o predicado, movendo-os para OutRemoved (se informado). Retorna quantos.
+    int32 RemoveAllMatching(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate, TArray<FIQT_QueueItem>* OutRemoved = nullptr);
+
+    // Atribui a cada item a prioridade retornada por Scorer. Disponível apenas nos modos PriorityOrder e UtilityScore.
+    // Scorer roda na thread do chamador, fora da trava, sobre uma cópia dos itens (pode ler UObjects do jogo).
+    // Retorna quantos itens mudaram de prioridade.
+    int32 RescoreAll(TFunctionRef<int32(const FIQT_QueueItem&)> Scorer);
+
+    // Número de itens que satisfazem o predicado.
+    int32 CountMatching(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate) const;
+
     /**
      * Verifica se a fila contém um item específico (comparado por Nome, Tag, bIsOpen).
      * @param ItemToCheck O item a ser verificado.
@@ -92,7 +277,7 @@ public:
     bool ContainsItem(UPARAM(ref) FIQT_QueueItem& ItemToCheck) const; 
 
     /**
-     * Retorna o número atual de itens na fila.
+     * Retorna o número atual de itens na fila. Não trava a fila: lê o valor publicado pela última operação concluída.
      * @return A contagem de itens na fila.
      */
     UFUNCTION(BlueprintPure, Category = "IQT Queue", meta=(DisplayName="Get Queue Count", Keywords="queue size count length"))
@@ -106,7 +291,15 @@ public:
     bool IsQueueEmpty() const;
 
     /**
-     * Esvazia completamente a fila, removendo todos os itens.
+     * Prioridade do item que DequeueItem retornaria, sem travar a fila nem copiar o item.
+     * Útil para decidir se vale a pena desenfileirar (ex.: agentes que só atendem prioridades abaixo de um limite).
+     * @return True se a fila não estiver vazia.
+     */
+    UFUNCTION(BlueprintPure, Category = "IQT Queue", meta=(DisplayName="Get Head Priority", Keywords="queue peek top priority"))
+    bool GetHeadPriority(int32& OutPriority) const;
+
+    /**
+     * Esvazia completamente a fila, removendo todos os itens (inclusive os atrasados).
      */
     UFUNCTION(BlueprintCallable, Category = "IQT Queue", meta=(DisplayName="Empty Queue", Keywords="clear queue reset"))
     void EmptyQueue();
@@ -133,6 +326,11 @@ public:
     UFUNCTION(BlueprintPure, Category = "IQT Queue", meta=(DisplayName="Validate Queue Item Data", ToolTip="Checks if the provided item data is valid for enqueueing (e.g., Name is not None)."))
     bool ValidateQueueItemData(UPARAM(ref) const FIQT_QueueItem& ItemToValidate) const; 
 
+    // Verifica os invariantes internos da fila (propriedade de heap, tabela de slots e gerações, índices por chave,
+    // runs de spill e contagens publicadas). Apenas para depuração.
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Debug")
+    bool ValidateQueueIntegrity() const;
+
     /**
      * Busca um item na fila pelo seu TaskID.
      * @param TaskID O GUID da tarefa a ser buscada.
@@ -153,10 +351,325 @@ public:
     UFUNCTION(BlueprintPure, Category = "IQT Queue|Search", meta=(DisplayName="Find Item by Hash Key", Keywords="queue search find hash key"))
     bool FindItemByHashKey(FName InName, FGameplayTag InTag, bool bInIsOpen, FIQT_QueueItem& OutItem) const; 
 
+    // --- Handles ---
+    // Um handle resolve apenas enquanto o item está na fila: após Dequeue, Cancel ou EmptyQueue ele fica obsoleto.
+
+    /**
+     * Busca um item na fila pelo handle recebido em EnqueueItem. O(1).
+     * @param OutItem O item encontrado, se houver. Será um item padrão se não encontrado.
+     * @return True se o handle ainda aponta para um item da fila.
+     */
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Search", meta=(DisplayName="Find Item by Handle", Keywords="queue search find handle"))
+    bool FindItemByHandle(FIQT_ItemHandle Handle, FIQT_QueueItem& OutItem) const;
+
+    // Verifica se o handle ainda aponta para um item da fila.
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Search", meta=(DisplayName="Is Item Handle Valid?"))
+    bool IsItemHandleValid(FIQT_ItemHandle Handle) const;
+
+    /**
+     * Cancela (remove da fila) o item apontado pelo handle.
+     * @return True se o item estava na fila e foi removido.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue", meta=(DisplayName="Cancel Item", Keywords="queue remove cancel handle"))
+    bool CancelItem(FIQT_ItemHandle Handle);
+
+    /**
+     * Substitui os dados do item apontado pelo handle e o reposiciona na fila.
+     * Handle, ordem de chegada e EnqueueTimeSeconds são mantidos. Em FIFO/FILO a prioridade guardada também é mantida.
+     * Com bIgnoreDuplicatesOnEnqueue, falha se a nova chave (Nome, Tag, bIsOpen) já pertencer a outro item.
+     * @return True se o item foi atualizado.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue", meta=(DisplayName="Update Item", Keywords="queue update modify handle"))
+    bool UpdateItem(FIQT_ItemHandle Handle, const FIQT_QueueItem& NewData);
+
+    /**
+     * Altera a prioridade do item apontado pelo handle. Disponível apenas nos modos PriorityOrder e UtilityScore.
+     * @return True se a prioridade foi alterada.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue", meta=(DisplayName="Update Item Priority", Keywords="queue priority handle"))
+    bool UpdateItemPriority(FIQT_ItemHandle Handle, int32 NewPriority);
+
+    /**
+     * Retorna o TaskID do item apontado pelo handle, gerando-o na primeira consulta.
+     * A partir daí o item também pode ser encontrado por FindItemByTaskID.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Search", meta=(DisplayName="Get Item Task ID", Keywords="queue TaskID guid handle"))
+    bool GetItemTaskID(FIQT_ItemHandle Handle, FGuid& OutTaskID);
+
+    // Retorna o TaskID de um item fora da fila, gerando-o na primeira consulta (FIQT_QueueItem::GetTaskID).
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Search", meta=(DisplayName="Get Queue Item Task ID", Keywords="TaskID guid"))
+    static FGuid GetQueueItemTaskID(UPARAM(ref) FIQT_QueueItem& Item);
+
+    // --- Itens Atrasados e Novas Tentativas ---
+
+    /**
+     * Agenda um item para entrar na fila somente após DelaySeconds segundos (tempo de jogo).
+     * Até lá o item não conta em GetQueueCount e não é retornado por DequeueItem.
+     * @return True se o item foi aceito na lista de atrasados.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Retry", meta=(DisplayName="Enqueue Delayed Item", Keywords="queue delay retry later"))
+    bool EnqueueDelayedItem(UPARAM(ref) FIQT_QueueItem& ItemToEnqueue, float DelaySeconds);
+
+    /**
+     * Versão C++ de EnqueueDelayedItem que move o item para a lista de atrasados, sem copiá-lo.
+     * Usada pelo executor para reenfileirar tentativas.
+     */
+    bool RequeueDelayedItem(FIQT_QueueItem&& ItemToRequeue, float DelaySeconds);
+
+    // Retorna o número de itens aguardando o fim do atraso.
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Retry", meta=(DisplayName="Get Number of Delayed Items"))
+    int32 GetNumDelayedItems() const;
+
+    // Verifica se há itens aguardando o fim do atraso.
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Retry", meta=(DisplayName="Has Delayed Items?"))
+    bool HasDelayedItems() const;
+
+    // Segundos até o próximo item atrasado ficar pronto (0 se já houver um pronto, -1 se não houver itens atrasados).
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Retry", meta=(DisplayName="Get Seconds Until Next Delayed Item"))
+    float GetSecondsUntilNextDelayedItem() const;
+
+    /**
+     * Move para a fila os itens atrasados cujo tempo já expirou. Chamado automaticamente por DequeueItem.
+     * @return Número de itens promovidos.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Retry", meta=(DisplayName="Promote Ready Delayed Items"))
+    int32 PromoteReadyDelayedItems();
+
+    // --- Fila de Mensagens Mortas (Dead-Letter) ---
+
+    /**
+     * Guarda um item que falhou definitivamente (tentativas esgotadas ou recusado ao voltar para a fila). Dispara OnItemDeadLettered.
+     * @param Item O item que falhou definitivamente.
+     * @param LastFailTag A tag da última falha (por exemplo IQT.Action.Timeout, IQT.Action.DispatchFailed,
+     *                    IQT.Item.Duplicate ou IQT.Item.Rejected).
+     */
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Retry", meta=(DisplayName="Add Dead Letter Item"))
+    void AddDeadLetterItem(const FIQT_QueueItem& Item, FGameplayTag LastFailTag);
+
+    // Retorna uma cópia dos itens na fila de mensagens mortas, do mais antigo para o mais recente.
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Retry", meta=(DisplayName="Get Dead Letter Items"))
+    void GetDeadLetterItems(TArray<FIQT_QueueItem>& OutItems) const;
+
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Retry", meta=(DisplayName="Get Number of Dead Letter Items"))
+    int32 GetNumDeadLetterItems() const;
+
+    // Total de itens removidos pela política EvictLowest desde a criação da fila.
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Stats", meta=(DisplayName="Get Number of Evicted Items"))
+    int32 GetNumEvictedItems() const;
+
+    // Itens atualmente gravados em disco pelo modo spill (já incluídos em GetCount).
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Stats", meta=(DisplayName="Get Number of Spilled Items"))
+    int32 GetNumSpilledItems() const;
+
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Retry", meta=(DisplayName="Clear Dead Letter Queue"))
+    void ClearDeadLetterQueue();
+
+    // --- Broker (fila compartilhada entre processos do mesmo host) ---
+    // Um processo hospeda a fila (HostBroker); os demais se conectam como proxy (ConnectToBroker). No proxy,
+    // EnqueueItem, DequeueItem, GetQueueCount e IsQueueEmpty vão para o broker; as demais operações continuam locais.
+    // Itens desenfileirados pelo proxy ficam emprestados até AcknowledgeItem (feito automaticamente por
+    // NotifyActionCompleted) e voltam para a fila se o processo cair antes. UObjects dos itens viajam pelo caminho.
+    // No game thread o DequeueItem do proxy não bloqueia: sem item já buscado, ele pede um ao broker e retorna
+    // false; a resposta chega no flush do frame e é entregue na próxima chamada (IsBrokerDequeuePending indica
+    // esse caso, em que IsQueueEmpty ainda é false).
+
+    // Itens por lote de Enqueue/Ack enviado ao broker. 1 = sem lotes (menor latência).
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration|Broker", meta = (ClampMin = "1"))
+    int32 BrokerBatchSize;
+
+    // Itens emprestados por pedido de Dequeue no proxy. Acima de 1 há menos viagens ao broker, mas os itens buscados
+    // ficam presos a este processo e a ordem de prioridade entre consumidores deixa de ser global.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IQT Queue Configuration|Broker", meta = (ClampMin = "1"))
+    int32 BrokerPrefetchCount;
+
+    // Passa a aceitar proxies em 127.0.0.1:Port, compartilhando a fila deste componente.
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Broker")
+    bool HostBroker(int32 Port);
+
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Broker")
+    void StopBroker();
+
+    // Transforma este componente em proxy da fila hospedada em Host:Port.
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Broker")
+    bool ConnectToBroker(int32 Port, const FString& Host = TEXT("127.0.0.1"));
+
+    // Envia o que estiver pendente e encerra a conexão. Itens buscados e ainda não entregues voltam para a fila.
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Broker")
+    void DisconnectFromBroker();
+
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Broker")
+    bool IsBrokerProxy() const;
+
+    // No proxy, true se um DequeueItem pediu um item ao broker e a resposta ainda não chegou: tente no próximo frame.
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Broker")
+    bool IsBrokerDequeuePending() const;
+
+    // Confirma ao broker que um item desenfileirado pelo proxy terminou. Sem efeito fora do modo proxy.
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Broker")
+    bool AcknowledgeItem(const FIQT_QueueItem& Item);
+
+    // Envia imediatamente os lotes pendentes (também ocorre a cada frame e ao completar BrokerBatchSize).
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Broker")
+    bool FlushBrokerRequests();
+
+    // --- Pontuação de utilidade ---
+
+    // Troca os pesos da pontuação (ex.: a situação de combate mudou). Os itens não são reordenados: a pontuação é
+    // calculada na próxima retirada.
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Utility")
+    void SetUtilityWeights(const TArray<float>& NewWeights);
+
+    // Substitui as UtilityFeatures do item apontado pelo handle (contexto ao vivo). O(número de características).
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Utility")
+    bool UpdateItemUtilityFeatures(FIQT_ItemHandle Handle, const TArray<float>& Features);
+
+    // --- Grupo de compartilhamento (roubo de trabalho) ---
+
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Sharing")
+    void SetSharingGroup(FGameplayTag NewGroup);
+
+    // Rouba até MaxItems itens transferíveis da fila mais carregada do grupo, limitado à metade da diferença de
+    // profundidade (roubos repetidos convergem sem devolver itens de um lado para o outro). Retorna quantos vieram.
+    // Os itens passam pelo mesmo caminho de EnqueueItem (duplicidade, despejo com OnItemEvicted, prioridade refeita em
+    // FIFO/FILO) mas mantêm a hora de chegada. Um item recusado volta para a vítima.
+    UFUNCTION(BlueprintCallable, Category = "IQT Queue|Sharing")
+    int32 StealWork(int32 MaxItems);
+
+    // Itens com bTransferable na fila (sem trava).
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Sharing")
+    int32 GetNumTransferableItems() const;
+
+    // --- Profiling ---
+
+    // Memória alocada pela estrutura interna da fila (heap, slots e índices), em bytes.
+    SIZE_T GetInternalAllocatedSize() const;
+
+    // Inclui a estrutura interna da fila nos relatórios de memória (obj list, memreport).
+    virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+    // Nome efetivo da fila nos logs (QueueName ou "<Dono>.<Componente>"). Contadores por fila usam só o QueueName.
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Stats")
+    FString GetStatsName() const;
+
+    // Informa que o executor disparou/concluiu a ação de um item desta fila.
+    // Atualiza o contador In-Flight, carimba DispatchOffsetSeconds/CompletionOffsetSeconds e,
+    // se bRecordLatency, registra a latência de execução nos histogramas da fila e da AbilityTriggerTag.
+    void NotifyActionDispatched(FIQT_QueueItem& Item);
+    void NotifyActionCompleted(FIQT_QueueItem& Item, bool bRecordLatency = true);
+
+    // Ações desta fila disparadas e ainda sem resultado.
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Stats")
+    int32 GetNumInFlightActions() const;
+
+    // Operações por segundo medidas na última janela de 1 segundo (somadas entre as filas de mesmo QueueName).
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Stats")
+    float GetOperationsPerSecond() const;
+
 
 private:
 
-    TSharedPtr<UIQT_PriorityQueueInternal> InternalQueue; 
+    // Item aguardando o fim do seu atraso (ex.: nova tentativa com backoff).
+    struct FDelayedItem
+    {
+        double ReadyTime;
+        FIQT_QueueItem Item;
+    };
+
+    // Tempo de referência para atrasos: tempo de jogo do mundo, ou tempo da plataforma fora de um mundo.
+    double GetQueueTimeSeconds() const;
+
+    // Corpo de EnqueueItem; ArrivalTimeSeconds vira EnqueueTimeSeconds (StealWork preserva a chegada original).
+    bool EnqueueItemInternal(FIQT_QueueItem& ItemToEnqueue, double ArrivalTimeSeconds);
+
+    // Log, trace e OnItemEvicted de um item removido pela política EvictLowest para dar lugar a Incoming.
+    void ReportEvictedItem(FIQT_QueueItem& Evicted, const FIQT_QueueItem& Incoming);
+
+    // Contabiliza um item recém-desenfileirado (bIsEnqueued, tempo de espera, trace e contadores).
+    void FinishDequeue(FIQT_QueueItem& OutItem);
+
+    // Repassa à fila interna a configuração vigente: MaxQueueSize, OverflowPolicy, o modo spill, a taxa de
+    // envelhecimento (AgingRatePerSecond no modo PriorityOrder, 0 nos demais) e os pesos de utilidade (apenas no modo
+    // UtilityScore). Pode rodar em qualquer thread; só trava a fila interna quando algum valor muda.
+    void SyncQueueSettings();
+
+    // Corpo de SyncQueueSettings para uma fila interna já existente ou ainda não publicada (promoção).
+    void ApplyQueueSettings(UIQT_PriorityQueueInternal& Internal);
+
+    // Retira o próximo item da fila interna: o de maior pontuação no modo UtilityScore, o topo nos demais.
+    bool DequeueFromInternal(FIQT_QueueItem& OutItem);
+
+    // Modos em que Priority vem do chamador (nos demais é um contador de chegada).
+    bool UsesItemPriority() const { return EnqueueMode == EIQT_QueueMode::PriorityOrder || EnqueueMode == EIQT_QueueMode::UtilityScore; }
+
+    // Primeiros itens da fila, guardados no próprio componente. Enquanto ativa, toda operação a consulta antes da
+    // fila interna; ao encher (ou quando a configuração pede recursos da fila interna) é promovida uma única vez.
+    FIQT_SmallQueue SmallQueue;
+
+    // Criada na promoção da SmallQueue (EnsureInternalQueue) e liberada em BeginDestroy. Sem ela nem a SmallQueue
+    // ativa, a fila está vazia. InternalQueueOwner é o dono (compartilhado com o broker); as demais threads leem o
+    // ponteiro publicado em InternalQueue, que depois de publicado só volta a nulo em BeginDestroy.
+    TSharedPtr<UIQT_PriorityQueueInternal> InternalQueueOwner;
+    std::atomic<UIQT_PriorityQueueInternal*> InternalQueue;
+
+    UIQT_PriorityQueueInternal* GetInternalQueue() const { return InternalQueue.load(std::memory_order_acquire); }
+
+    // Configurações atendidas pela SmallQueue: sem envelhecimento, utilidade, spill, grupo de compartilhamento e com
+    // OverflowPolicy = Reject.
+    bool CanUseInlineStorage() const;
+
+    // Promove a SmallQueue, criando a fila interna com os seus itens e handles (produtores podem estar em outras
+    // threads). Retorna false em destruição.
+    bool EnsureInternalQueue();
+
+    // Contadores de Insights/stat IQT, compartilhados pelas filas de mesmo QueueName (ver FIQT_QueueCounters::FindOrAdd).
+    // Obtidos em OnRegister (filas criadas fora de um ator não publicam contadores).
+    TSharedPtr<FIQT_QueueCounters> Counters;
+
+    // Publica profundidade e contagem de operações após uma operação bem-sucedida.
+    void PublishCounters(int32 NumOperations);
+
+    // Série de latência desta fila no FIQT_LatencyRegistry, obtida na primeira amostra (qualquer thread) e devolvida
+    // em OnUnregister. Sem QueueName, fica nula: só as séries por tag recebem as amostras.
+    std::atomic<FIQT_LatencySeries*> LatencySeries;
+    FIQT_LatencySeries* GetLatencySeries();
+    void ReleaseLatencySeries();
+
+    // Profundidade já somada ao STAT_IQT_QueuedItems agregado e aos Counters (para publicar apenas a diferença).
+    // Trocada com exchange: com publicações simultâneas cada diferença é contada uma única vez e o agregado não deriva.
+    std::atomic<int32> PublishedDepth;
+
+    // Ações desta fila em andamento: os Counters podem somar as de outras filas com o mesmo QueueName.
+    std::atomic<int32> NumInFlight;
+
+    // Configuração já aplicada à fila interna (ver SyncQueueSettings). Protegida por AppliedSettingsMutex:
+    // SyncQueueSettings roda em qualquer thread produtora ou consumidora.
+    mutable FCriticalSection AppliedSettingsMutex;
+    float AppliedAgingRate;
+    int32 AppliedMaxQueueSize;
+    EIQT_OverflowPolicy AppliedOverflowPolicy;
+    float AppliedBlockTimeoutSeconds;
+    int32 AppliedSpillBudget;
+    FString AppliedSpillDirectory;
+    TArray<float> AppliedUtilityWeights;
+
+    // Broker hospedado por este componente e conexão do modo proxy (mutuamente exclusivos).
+    TSharedPtr<FIQT_Broker> Broker;
+    TSharedPtr<FIQT_BrokerClient> BrokerClient;
+    FTSTicker::FDelegateHandle BrokerFlushTicker;
+
+    bool EnqueueToBroker(FIQT_QueueItem& ItemToEnqueue);
+
+    // Grupo em que a fila está registrada no UIQT_QueueGroupSubsystem (pode diferir de SharingGroup antes de OnRegister).
+    FGameplayTag RegisteredSharingGroup;
+
+    // Heap mínimo por ReadyTime. A capacidade é mantida entre usos para não realocar a cada nova tentativa.
+    TArray<FDelayedItem> DelayedItems;
+    mutable FCriticalSection DelayedItemsMutex;
+
+    // Protegida por DeadLetterMutex: é alimentada por Dequeue (promoção de atrasados) e StealWork em qualquer thread.
+    UPROPERTY(Transient)
+    TArray<FIQT_QueueItem> DeadLetterItems;
+    mutable FCriticalSection DeadLetterMutex;
 
     mutable int32 NextFIFOPriorityCounter;
     mutable int32 NextFILOPriorityCounter; 
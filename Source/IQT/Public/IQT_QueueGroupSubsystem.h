@@ -0,0 +1,92 @@
+﻿// IQT/Source/IQT/Public/IQT_QueueGroupSubsystem.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Subsystems/WorldSubsystem.h"
+
+#include "IQT_QueueGroupSubsystem.generated.h"
+
+class UIQT_Queue;
+
+// Métricas de equilíbrio de um grupo de compartilhamento.
+USTRUCT(BlueprintType)
+struct FIQT_QueueGroupStats
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category = "IQT|Queue Group")
+    int32 NumQueues = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "IQT|Queue Group")
+    int32 TotalItems = 0;
+
+    // Itens que ainda podem ser roubados (bTransferable).
+    UPROPERTY(BlueprintReadOnly, Category = "IQT|Queue Group")
+    int32 TotalTransferable = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "IQT|Queue Group")
+    int32 MinDepth = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "IQT|Queue Group")
+    int32 MaxDepth = 0;
+
+    // MaxDepth / profundidade média. 1 = perfeitamente equilibrado; 0 = grupo vazio.
+    UPROPERTY(BlueprintReadOnly, Category = "IQT|Queue Group")
+    float Imbalance = 0.0f;
+
+    // Roubos bem-sucedidos e itens movidos desde a criação do grupo.
+    UPROPERTY(BlueprintReadOnly, Category = "IQT|Queue Group")
+    int64 NumSteals = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "IQT|Queue Group")
+    int64 NumItemsStolen = 0;
+};
+
+/**
+ * UIQT_QueueGroupSubsystem: Registro dos grupos de compartilhamento de filas (UIQT_Queue::SharingGroup).
+ * Filas de um mesmo grupo podem roubar itens transferíveis umas das outras (UIQT_Queue::StealWork).
+ * A escolha da vítima lê apenas contadores publicados sem trava; somente a fila roubada é travada, e só durante
+ * a retirada dos itens.
+ */
+UCLASS()
+class IQT_API UIQT_QueueGroupSubsystem : public UWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    // Retorna o subsistema do mundo do objeto de contexto (ou nullptr se não houver mundo de jogo).
+    static UIQT_QueueGroupSubsystem* Get(const UObject* WorldContextObject);
+
+    void RegisterQueue(FGameplayTag Group, UIQT_Queue* Queue);
+    void UnregisterQueue(FGameplayTag Group, UIQT_Queue* Queue);
+
+    // Fila do grupo (exceto Thief) com mais itens transferíveis, ou nullptr se nenhuma tiver.
+    UIQT_Queue* FindBusiestPeer(FGameplayTag Group, const UIQT_Queue* Thief) const;
+
+    void RecordSteal(FGameplayTag Group, int32 NumItems);
+
+    UFUNCTION(BlueprintPure, Category = "IQT Queue|Group")
+    FIQT_QueueGroupStats GetGroupStats(FGameplayTag Group) const;
+
+    // USubsystem
+    virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+    virtual void Deinitialize() override;
+
+private:
+    struct FGroup
+    {
+        TArray<TWeakObjectPtr<UIQT_Queue>> Members;
+        int64 NumSteals = 0;
+        int64 NumItemsStolen = 0;
+    };
+
+    // Filas de threads diferentes podem roubar ao mesmo tempo: o registro é lido sob trava compartilhada.
+    mutable FRWLock GroupsLock;
+    TMap<FGameplayTag, FGroup> Groups;
+};
@@ -18,6 +18,9 @@
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FRunQueuedActionsFinishedDelegate, bool, bSuccess);
 
+// Versão nativa (somente C++) do FRunQueuedActionsFinishedDelegate.
+DECLARE_MULTICAST_DELEGATE_OneParam(FIQT_RunQueuedActionsFinishedNativeDelegate, bool /*bSuccess*/);
+
 /**
  * UIQT_RunQueuedActions: Uma AbilityTask para executar todas as a��es em uma fila de forma sequencial.
  * Desenfileira cada item, dispara seu evento de trigger e espera pela conclus�o usando UIQT_WaitForAction.
@@ -33,14 +36,18 @@ public:
     UPROPERTY(BlueprintAssignable)
     FRunQueuedActionsFinishedDelegate OnFinished; 
 
+    // Equivalente nativo de OnFinished, disparado logo após ele (que só é disparado quando há ligações).
+    FIQT_RunQueuedActionsFinishedNativeDelegate OnFinishedNative;
+
     /**
      * Inicia a execu��o sequencial das a��es em uma fila.
      * @param OwningAbility A habilidade que est� iniciando esta tarefa.
      * @param InQueue O componente UIQT_Queue a ser processado.
+     * @param DefaultActionTimeout Timeout (segundos) aplicado aos itens que não definem TimeoutSeconds. 0 = sem timeout.
      * @return Uma inst�ncia da tarefa UIQT_RunQueuedActions.
      */
     UFUNCTION(BlueprintCallable, Category = "IQT|Ability|Tasks", meta = (HidePin = "OwningAbility", DefaultToSelf = "OwningAbility", BlueprintInternalUseOnly = "TRUE"))
-    static UIQT_RunQueuedActions* IQT_RunQueuedActions(UGameplayAbility* OwningAbility, UIQT_Queue* InQueue);
+    static UIQT_RunQueuedActions* IQT_RunQueuedActions(UGameplayAbility* OwningAbility, UIQT_Queue* InQueue, float DefaultActionTimeout = 0.0f);
 
     virtual void Activate() override;
     virtual void OnDestroy(bool AbilityEnding) override;
@@ -49,11 +56,42 @@ protected:
     UPROPERTY()
     TObjectPtr<UIQT_Queue> Queue; 
 
+    // Espera reutilizada por todos os itens (re-armada a cada item em vez de recriada).
+    // Um executor processa um item por vez, então um único objeto basta.
     UPROPERTY()
-    TObjectPtr<UIQT_WaitForAction> CurrentWaitTask; 
+    TObjectPtr<UIQT_WaitForAction> WaitTask; 
+
+    // Retorna a espera reutilizável, criando-a (e vinculando seus delegates) apenas quando necessário.
+    UIQT_WaitForAction* GetOrCreateWaitTask();
 
     bool bOverallSuccess; 
 
+    // Timeout padrão repassado para cada UIQT_WaitForAction criada por este executor.
+    float DefaultActionTimeoutSeconds;
+
+    // Item em execução. Mantido no executor para que uma nova tentativa o mova de volta para a fila sem cópia.
+    // UPROPERTY: entre a retirada e o fim da ação este é o único dono do payload, que precisa ser visto pelo GC.
+    UPROPERTY()
+    FIQT_QueueItem InFlightItem;
+
+    // Verdadeiro entre o envio do evento e o resultado da ação (contador In-Flight da fila).
+    bool bActionInFlight;
+
+    // Decide o destino de InFlightItem depois de uma falha: nova tentativa (volta à fila como atrasado, conforme a
+    // RetryPolicy e FailTag) ou fila de mensagens mortas.
+    void RetryOrDeadLetterInFlightItem(FGameplayTag FailTag);
+
+    // InFlightItem foi retirado mas não chegou a ser disparado (TriggerData inválida, alvo sem ASC, espera sem tags
+    // de fim/falha): encerra o empréstimo do broker, decide como uma falha IQT.Action.DispatchFailed e segue.
+    void FailUndispatchedItem();
+
+    // Marca a ação atual como concluída na fila (In-Flight e latência de execução). Idempotente.
+    // bRecordLatency = false para ações canceladas, que não devem entrar nos histogramas.
+    void ReleaseInFlightAction(bool bRecordLatency = true);
+
+    // Dispara OnFinished (apenas se ligado) e OnFinishedNative com bOverallSuccess.
+    void BroadcastFinished();
+
     // Handle para agendar a pr�xima chamada de ProcessNextQueueItem
     FTimerHandle NextItemTimerHandle;
 
@@ -64,13 +102,12 @@ protected:
 
     /**
      * Callback quando UIQT_WaitForAction para um item individual � bem-sucedida.
+     * Ligado ao delegate nativo da espera: o payload chega por refer�ncia, sem ProcessEvent.
      */
-    UFUNCTION()
-    void OnActionSucceeded(FGameplayEventData Payload, const FIQT_QueueItem& QueueItemData, FGameplayTag EventTag, AActor* EventTargetActor, FGameplayTag TriggerTag);
+    void OnActionSucceeded(const FGameplayEventData& Payload, const FIQT_QueueItem& QueueItemData, FGameplayTag EventTag, AActor* EventTargetActor, FGameplayTag TriggerTag);
 
     /**
      * Callback quando UIQT_WaitForAction para um item individual falha.
      */
-    UFUNCTION()
-    void OnActionFailed(FGameplayEventData Payload, const FIQT_QueueItem& QueueItemData, FGameplayTag EventTag, AActor* EventTargetActor, FGameplayTag TriggerTag);
+    void OnActionFailed(const FGameplayEventData& Payload, const FIQT_QueueItem& QueueItemData, FGameplayTag EventTag, AActor* EventTargetActor, FGameplayTag TriggerTag);
 };
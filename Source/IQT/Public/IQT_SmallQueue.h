@@ -0,0 +1,130 @@
+﻿// IQT/Source/IQT/Public/IQT_SmallQueue.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "IQT_DataTypes.h"
+#include <atomic>
+
+// Itens guardados inline em cada UIQT_Queue antes de passar para a fila interna (0 desativa; no máximo 32).
+// Pode ser sobrescrito pelo projeto, ex.: PublicDefinitions.Add("IQT_SMALL_QUEUE_CAPACITY=4").
+#ifndef IQT_SMALL_QUEUE_CAPACITY
+    #define IQT_SMALL_QUEUE_CAPACITY 8
+#endif
+
+/**
+ * FIQT_SmallQueue: Armazenamento inline para filas com poucos itens, sem nenhuma alocação no heap.
+ * - Os itens ficam em slots fixos e não se movem; apenas as chaves (Priority) e a ordem dos slots são mantidas
+ *   ordenadas, da saída mais tardia para a mais próxima. A posição de inserção é contada com comparações vetoriais
+ *   de 4 chaves por instrução, e Dequeue retira do fim do arranjo em O(1).
+ * - A ordem de saída é a mesma da fila interna sem envelhecimento: menor Priority primeiro, empates do mais novo
+ *   para o mais antigo. Handles usam o mesmo formato (slot, geração).
+ * - Promote entrega os itens, na ordem de chegada e com os seus handles, para a fila interna e desativa o
+ *   armazenamento inline de vez. Depois disso toda operação retorna um TOptional vazio e o chamador segue para a
+ *   fila interna.
+ * Thread-safe: as operações rodam sob uma trava própria; contagens e prioridade do topo são publicadas em atômicos.
+ */
+class FIQT_SmallQueue
+{
+public:
+    static constexpr int32 Capacity = IQT_SMALL_QUEUE_CAPACITY;
+    static_assert(Capacity >= 0 && Capacity <= 32, "IQT_SMALL_QUEUE_CAPACITY deve estar entre 0 e 32.");
+
+    FIQT_SmallQueue();
+    ~FIQT_SmallQueue();
+
+    FIQT_SmallQueue(const FIQT_SmallQueue&) = delete;
+    FIQT_SmallQueue& operator=(const FIQT_SmallQueue&) = delete;
+
+    // False depois de Promote (ou sempre, com Capacity = 0).
+    bool IsActive() const { return bActive.load(std::memory_order_acquire); }
+
+    // Move InOutItem para um slot livre e grava o handle em OutHandle. Retorna false se o item for inválido ou
+    // a fila tiver MaxSize itens (MaxSize <= 0 = sem limite); vazio se não houver slot livre (InOutItem intacto).
+    TOptional<bool> Enqueue(FIQT_QueueItem& InOutItem, int32 MaxSize, FIQT_ItemHandle& OutHandle);
+
+    TOptional<bool> Dequeue(FIQT_QueueItem& OutItem);
+    TOptional<bool> DequeueMatching(const FGameplayTagQuery& Query, FIQT_QueueItem& OutItem);
+    TOptional<bool> PeekMatching(const FGameplayTagQuery& Query, FIQT_QueueItem& OutItem) const;
+
+    // Visitantes rodam sob a trava e não podem chamar a fila. ForEachItem visita na ordem de saída.
+    TOptional<int32> ForEachTopK(int32 K, TFunctionRef<void(const FIQT_QueueItem&)> Visitor) const;
+    bool ForEachItem(TFunctionRef<bool(const FIQT_QueueItem&)> Visitor) const;
+
+    TOptional<int32> CountMatching(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate) const;
+    TOptional<int32> CountMatching(const FGameplayTagQuery& Query) const;
+
+    TOptional<bool> Contains(const FIQT_QueueItem& InData) const;
+    TOptional<bool> RemoveItem(const FIQT_QueueItem& ItemToRemove);
+    TOptional<bool> FindByTaskID(const FGuid& TaskID, FIQT_QueueItem& OutItem) const;
+    TOptional<bool> FindByHashKey(FName InName, FGameplayTag InTag, bool bInIsOpen, FIQT_QueueItem& OutItem) const;
+
+    TOptional<bool> IsHandleValid(FIQT_ItemHandle Handle) const;
+    TOptional<bool> FindByHandle(FIQT_ItemHandle Handle, FIQT_QueueItem& OutItem) const;
+    TOptional<bool> RemoveByHandle(FIQT_ItemHandle Handle, FIQT_QueueItem* OutItem = nullptr);
+    TOptional<bool> UpdatePriority(FIQT_ItemHandle Handle, int32 NewPriority);
+    TOptional<bool> EnsureTaskID(FIQT_ItemHandle Handle, FGuid& OutTaskID);
+
+    // Sem trava: valores publicados pela última mutação.
+    TOptional<int32> GetCount() const;
+    TOptional<int32> GetNumOpen() const;
+    TOptional<bool> GetHeadPriority(int32& OutPriority) const;
+
+    bool Empty();
+
+    // Entrega os itens a Adopt (na ordem de chegada, com Handle preenchido, e a próxima geração de handle livre) e
+    // desativa o armazenamento inline. Adopt roda sob a trava: operações concorrentes esperam e seguem para a fila
+    // interna já preenchida. Retorna false se já tinha sido promovida.
+    bool Promote(TFunctionRef<void(TArray<FIQT_QueueItem>&& Items, uint32 NextGeneration)> Adopt);
+
+    void AddReferencedObjects(FReferenceCollector& Collector);
+
+    // Verifica a ordem das chaves, os slots e as contagens.
+    TOptional<bool> ValidateInvariants() const;
+
+private:
+    static constexpr int32 NumSlots = Capacity > 0 ? Capacity : 1;
+    static constexpr int32 NumKeyLanes = (NumSlots + 3) & ~3;
+    static constexpr int64 NoHeadPriority = MIN_int64;
+
+    // Keys[Position] é a Priority do item na posição; Keys[Num - 1] é o próximo a sair. Posições livres = MAX_int32,
+    // que nunca é contado como "sai antes" pela comparação vetorial.
+    alignas(16) int32 Keys[NumKeyLanes];
+    uint32 Sequences[NumSlots];    // Ordem de chegada por slot; desempata chaves iguais (como na fila interna).
+    uint32 Generations[NumSlots];  // Geração do handle de cada slot ocupado.
+    uint8 PositionSlots[NumSlots]; // Slot do item em cada posição.
+    uint32 UsedSlots;              // Bit por slot ocupado.
+    int32 Num;
+    int32 NumOpen;
+    uint32 NextSequence;
+    uint32 NextGeneration;
+    TTypeCompatibleBytes<FIQT_QueueItem> Storage[NumSlots];
+
+    std::atomic<bool> bActive;
+    std::atomic<int32> PublishedNum;
+    std::atomic<int32> PublishedNumOpen;
+    std::atomic<int64> PublishedHeadPriority;
+    mutable FCriticalSection Mutex;
+
+    FIQT_QueueItem& GetItem(int32 Slot) { return *Storage[Slot].GetTypedPtr(); }
+    const FIQT_QueueItem& GetItem(int32 Slot) const { return *Storage[Slot].GetTypedPtr(); }
+
+    // Posição em que um item com (Key, Sequence) entra: itens que saem antes dele ficam acima.
+    int32 FindInsertPositionLocked(int32 Key, uint32 Sequence) const;
+    void InsertAtLocked(int32 Position, int32 Slot);
+    // Tira a posição da ordem sem tocar o item; RemoveAtLocked também libera o slot.
+    void UnlinkAtLocked(int32 Position);
+    void RemoveAtLocked(int32 Position, FIQT_QueueItem* OutItem);
+
+    // Posição (da saída mais próxima para a mais tardia) do primeiro item que satisfaz o predicado, ou INDEX_NONE.
+    int32 FindFirstPositionLocked(TFunctionRef<bool(const FIQT_QueueItem&)> Predicate) const;
+    // Posição do item do handle, ou INDEX_NONE se o handle for obsoleto.
+    int32 ResolveHandleLocked(FIQT_ItemHandle Handle) const;
+    void EmptyLocked();
+    void PublishLocked();
+};
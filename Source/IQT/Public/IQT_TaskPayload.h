@@ -0,0 +1,181 @@
+﻿// IQT/Source/IQT/Public/IQT_TaskPayload.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StructUtils/InstancedStruct.h"
+#include "Abilities/GameplayAbilityTargetTypes.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+
+#include "IQT_TaskPayload.generated.h"
+
+struct FGameplayEventData;
+
+/**
+ * FIQT_TaskPayload: Dados tipados de uma tarefa, guardados por valor no FIQT_QueueItem.
+ * Alternativa ao UserPayload (UObject*): qualquer USTRUCT pode ser anexado sem alocar um UObject.
+ * - Structs de até InlineSize bytes (alinhamento até InlineAlignment) ficam no buffer interno, sem alocação no heap;
+ *   maiores são alocadas uma única vez por cópia, como em um FInstancedStruct.
+ * - Structs sem referências a UObjects não custam nada ao GC: AddStructReferencedObjects só percorre as
+ *   propriedades quando o tipo tem referências.
+ * Em Blueprint, converta de/para FInstancedStruct com UIQT_TaskPayloadLibrary.
+ */
+USTRUCT(BlueprintType)
+struct IQT_API FIQT_TaskPayload
+{
+    GENERATED_BODY()
+
+    static constexpr int32 InlineSize = 32;
+    static constexpr int32 InlineAlignment = 16;
+
+    FIQT_TaskPayload();
+    FIQT_TaskPayload(const FIQT_TaskPayload& Other);
+    FIQT_TaskPayload(FIQT_TaskPayload&& Other);
+    ~FIQT_TaskPayload();
+
+    FIQT_TaskPayload& operator=(const FIQT_TaskPayload& Other);
+    FIQT_TaskPayload& operator=(FIQT_TaskPayload&& Other);
+
+    template <typename T>
+    static FIQT_TaskPayload Make(const T& Value)
+    {
+        FIQT_TaskPayload Payload;
+        Payload.Set(Value);
+        return Payload;
+    }
+
+    template <typename T>
+    void Set(const T& Value)
+    {
+        InitializeAs(TBaseStructure<T>::Get(), reinterpret_cast<const uint8*>(&Value));
+    }
+
+    // Retorna os dados como T, ou nullptr se o payload estiver vazio ou for de outro tipo.
+    template <typename T>
+    const T* GetPtr() const
+    {
+        return ScriptStruct && ScriptStruct->IsChildOf(TBaseStructure<T>::Get()) ? reinterpret_cast<const T*>(GetMemory()) : nullptr;
+    }
+
+    template <typename T>
+    T* GetMutablePtr()
+    {
+        return ScriptStruct && ScriptStruct->IsChildOf(TBaseStructure<T>::Get()) ? reinterpret_cast<T*>(GetMutableMemory()) : nullptr;
+    }
+
+    // Inicializa com o tipo InStruct, copiando Source se informado. Reaproveita a memória quando o tipo não muda.
+    void InitializeAs(const UScriptStruct* InStruct, const uint8* Source = nullptr);
+    void Reset();
+
+    bool IsValid() const { return ScriptStruct != nullptr; }
+    bool IsInline() const { return ScriptStruct != nullptr && HeapMemory == nullptr; }
+    const UScriptStruct* GetScriptStruct() const { return ScriptStruct; }
+
+    const uint8* GetMemory() const { return HeapMemory ? HeapMemory : InlineBuffer.Pad; }
+    uint8* GetMutableMemory() { return HeapMemory ? HeapMemory : InlineBuffer.Pad; }
+
+    FInstancedStruct ToInstancedStruct() const;
+    void FromInstancedStruct(const FInstancedStruct& InStruct);
+
+    // Operações de struct (ver TStructOpsTypeTraits abaixo).
+    bool Serialize(FArchive& Ar);
+    bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+    bool Identical(const FIQT_TaskPayload* Other, uint32 PortFlags) const;
+    void AddStructReferencedObjects(FReferenceCollector& Collector);
+
+    bool operator==(const FIQT_TaskPayload& Other) const { return Identical(&Other, 0); }
+    bool operator!=(const FIQT_TaskPayload& Other) const { return !Identical(&Other, 0); }
+
+private:
+    static bool FitsInline(const UScriptStruct* InStruct);
+
+    // Toma os dados de Other, deixando-o vazio. Dados no heap mudam de dono sem cópia.
+    void MoveFrom(FIQT_TaskPayload& Other);
+
+    TObjectPtr<const UScriptStruct> ScriptStruct;
+    uint8* HeapMemory;                  // nullptr quando os dados estão no InlineBuffer.
+    bool bHasObjectReferences;          // O tipo tem propriedades que referenciam UObjects (precisa ser visitado pelo GC).
+    TAlignedBytes<InlineSize, InlineAlignment> InlineBuffer;
+};
+
+template<>
+struct TStructOpsTypeTraits<FIQT_TaskPayload> : public TStructOpsTypeTraitsBase2<FIQT_TaskPayload>
+{
+    enum
+    {
+        WithCopy = true,
+        WithSerializer = true,
+        WithNetSerializer = true,
+        WithIdentical = true,
+        WithAddStructReferencedObjects = true,
+    };
+};
+
+/**
+ * FIQT_PayloadTargetData: Leva o FIQT_TaskPayload de um item até a habilidade disparada,
+ * dentro do FGameplayEventData::TargetData do evento de trigger.
+ * Na habilidade, use FindInEventData (C++) ou UIQT_TaskPayloadLibrary::GetTaskPayloadFromEventData (Blueprint).
+ */
+USTRUCT(BlueprintType)
+struct IQT_API FIQT_PayloadTargetData : public FGameplayAbilityTargetData
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category = "IQT|Payload")
+    FIQT_TaskPayload TaskPayload;
+
+    FIQT_PayloadTargetData() {}
+
+    explicit FIQT_PayloadTargetData(const FIQT_TaskPayload& InTaskPayload)
+        : TaskPayload(InTaskPayload)
+    {}
+
+    virtual UScriptStruct* GetScriptStruct() const override { return FIQT_PayloadTargetData::StaticStruct(); }
+    virtual FString ToString() const override;
+
+    bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+    // Primeiro payload da IQT no TargetData do evento, ou nullptr.
+    static const FIQT_TaskPayload* FindInEventData(const FGameplayEventData& EventData);
+
+    // Anexa o payload ao TargetData do evento (não faz nada se o payload estiver vazio).
+    static void AddToEventData(FGameplayEventData& EventData, const FIQT_TaskPayload& InTaskPayload);
+};
+
+template<>
+struct TStructOpsTypeTraits<FIQT_PayloadTargetData> : public TStructOpsTypeTraitsBase2<FIQT_PayloadTargetData>
+{
+    enum
+    {
+        WithNetSerializer = true,
+    };
+};
+
+/**
+ * Funções de Blueprint para criar e ler FIQT_TaskPayload.
+ */
+UCLASS()
+class IQT_API UIQT_TaskPayloadLibrary : public UBlueprintFunctionLibrary
+{
+    GENERATED_BODY()
+
+public:
+    // Cria um payload com uma cópia da struct.
+    UFUNCTION(BlueprintPure, Category = "IQT|Payload")
+    static FIQT_TaskPayload MakeTaskPayload(const FInstancedStruct& Value);
+
+    // Retorna uma cópia do payload como FInstancedStruct (vazio se o payload estiver vazio).
+    UFUNCTION(BlueprintPure, Category = "IQT|Payload")
+    static FInstancedStruct GetTaskPayloadStruct(const FIQT_TaskPayload& TaskPayload);
+
+    UFUNCTION(BlueprintPure, Category = "IQT|Payload")
+    static bool IsTaskPayloadValid(const FIQT_TaskPayload& TaskPayload);
+
+    // Lê o payload do item que disparou a habilidade. Retorna false se o evento não trouxer um.
+    UFUNCTION(BlueprintPure, Category = "IQT|Payload")
+    static bool GetTaskPayloadFromEventData(const FGameplayEventData& EventData, FInstancedStruct& OutPayload);
+};
@@ -0,0 +1,78 @@
+﻿// IQT/Source/IQT/Public/IQT_TimeoutSubsystem.h
+// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of William Wolff and protected by copyright law.
+// -------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+
+#include "IQT_TimeoutSubsystem.generated.h"
+
+/**
+ * UIQT_TimeoutSubsystem: Controle centralizado dos tempos limite (timeouts) das ações da IQT.
+ * Em vez de um FTimerHandle por espera, todas as UIQT_WaitForAction de um mundo registram seus prazos
+ * em uma única "timing wheel" (roda de tempo com hash). Agendar e cancelar custam O(1) e o custo por frame
+ * é proporcional apenas aos slots que avançaram.
+ *
+ * A resolução é de SlotResolution segundos: um timeout nunca dispara antes do prazo, e pode disparar até um slot depois.
+ */
+UCLASS()
+class IQT_API UIQT_TimeoutSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    UIQT_TimeoutSubsystem();
+
+    // Retorna o subsistema do mundo do objeto de contexto (ou nullptr se não houver mundo de jogo).
+    static UIQT_TimeoutSubsystem* Get(const UObject* WorldContextObject);
+
+    /**
+     * Agenda um callback para daqui a DelaySeconds segundos (tempo de jogo).
+     * @return Identificador do timeout, usado para cancelá-lo. 0 indica falha no agendamento.
+     */
+    uint64 ScheduleTimeout(float DelaySeconds, FSimpleDelegate&& Callback);
+
+    // Cancela um timeout pendente e zera o identificador. Seguro para identificadores já disparados ou inválidos.
+    void CancelTimeout(uint64& InOutTimeoutId);
+
+    // Número de timeouts ainda pendentes neste mundo.
+    int32 GetNumPendingTimeouts() const { return ActiveTimeoutIds.Num(); }
+
+    // USubsystem / FTickableGameObject
+    virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+    virtual void Deinitialize() override;
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+
+    // Número de slots da roda e a duração de cada slot em segundos (uma volta completa = 12.8s).
+    static constexpr int32 NumSlots = 256;
+    static constexpr float SlotResolution = 0.05f;
+
+private:
+    struct FWheelEntry
+    {
+        uint64 TimeoutId;
+        int32 RemainingRounds;  // Voltas completas que ainda faltam antes de disparar
+        FSimpleDelegate Callback;
+    };
+
+    // Processa o slot atual: decrementa voltas e move para OutExpired as entradas vencidas.
+    void ProcessSlot(int32 SlotIndex, TArray<FSimpleDelegate>& OutExpired);
+
+    TArray<FWheelEntry> Slots[NumSlots];
+
+    // Cancelamento preguiçoso: entradas cujo Id não está mais aqui são descartadas quando o slot é visitado
+    // (ou todas de uma vez, quando a roda para sem nada pendente).
+    TSet<uint64> ActiveTimeoutIds;
+
+    // Entradas ainda na roda, canceladas ou não.
+    int32 NumWheelEntries;
+
+    int32 CurrentSlot;
+    float SlotAccumulator;
+    uint64 NextTimeoutId;
+};
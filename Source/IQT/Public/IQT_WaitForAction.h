@@ -22,6 +22,9 @@ class AActor; // Forward declaration para AActor
 // Delegates agora incluem FIQT_QueueItem, a Tag do evento (a que matched), o Ator Alvo e a TriggerTag original.
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_FiveParams(FWaitActionEventDelegate, FGameplayEventData, Payload, const FIQT_QueueItem&, QueueItemData, FGameplayTag, EventTag, AActor*, EventTargetActor, FGameplayTag, TriggerTag);
 
+// Versão nativa (somente C++) do FWaitActionEventDelegate: sem reflexão e com o payload por referência constante.
+DECLARE_MULTICAST_DELEGATE_FiveParams(FIQT_WaitActionNativeDelegate, const FGameplayEventData& /*Payload*/, const FIQT_QueueItem& /*QueueItemData*/, FGameplayTag /*EventTag*/, AActor* /*EventTargetActor*/, FGameplayTag /*TriggerTag*/);
+
 /**
  * UIQT_WaitForAction: Uma AbilityTask que espera por eventos de Gameplay Tag.
  * Permite que uma Gameplay Ability pause sua execução até que uma tag de sucesso ou falha seja emitida.
@@ -39,6 +42,11 @@ public:
     UPROPERTY(BlueprintAssignable)
     FWaitActionEventDelegate FailedAction;
 
+    // Equivalentes nativos de SucessesfullAction/FailedAction, disparados logo após eles. Preferíveis em C++:
+    // evitam o ProcessEvent e a cópia do FGameplayEventData. Os dinâmicos só são disparados quando há ligações.
+    FIQT_WaitActionNativeDelegate OnSucceededNative;
+    FIQT_WaitActionNativeDelegate OnFailedNative;
+
     /**
      * Espera até que o evento de gameplay tag especificado seja acionado.
      * Por padrão, verificará o dono desta habilidade. O OptionalExternalTarget pode ser usado para monitorar outro ator.
@@ -50,13 +58,42 @@ public:
      * @param InOptionalExternalTarget O ator cujo AbilitySystemComponent será monitorado, se diferente do OwningAbility.
      * @param InOnlyTriggerOnce Se verdadeiro, a task será encerrada após a primeira ocorrência de sucesso ou falha.
      * @param InOnlyMatchExact Se verdadeiro, a tag do evento deve corresponder exatamente. Se falso, tags aninhadas também acionarão.
+     * @param InDefaultTimeoutSeconds Timeout usado quando o item não define TimeoutSeconds. Ao expirar, FailedAction é disparado
+     *                                com a tag IQT.Action.Timeout. 0 = sem timeout.
      */
     UFUNCTION(BlueprintCallable, Category = "IQT|Ability|Tasks", meta = (HidePin = "OwningAbility", DefaultToSelf = "OwningAbility", BlueprintInternalUseOnly = "TRUE"))
     static UIQT_WaitForAction* IQT_WaitActionEvent(UGameplayAbility* OwningAbility, 
         const FIQT_QueueItem& InQueueItem,
         AActor* InOptionalExternalTarget = nullptr,
         bool InOnlyTriggerOnce = false,
-        bool InOnlyMatchExact = true);
+        bool InOnlyMatchExact = true,
+        float InDefaultTimeoutSeconds = 0.0f);
+
+    /**
+     * Cria uma espera reutilizável: em vez de terminar após cada item, ela é desarmada e re-armada com o próximo
+     * item (ReArm + StartWaiting), sem alocar um novo UObject nem refazer as ligações de delegates.
+     * Usada pelo UIQT_RunQueuedActions. Termina apenas com EndTask (ou com o fim da habilidade).
+     */
+    static UIQT_WaitForAction* CreateReusableWaitTask(UGameplayAbility* OwningAbility);
+
+    /**
+     * Reconfigura a espera para um novo item: tags, alvo, timeout e TriggerData. Desarma a espera anterior.
+     * Os parâmetros têm o mesmo significado dos de IQT_WaitActionEvent.
+     */
+    void ReArm(const FIQT_QueueItem& InQueueItem, AActor* InOptionalExternalTarget, bool InOnlyTriggerOnce, bool InOnlyMatchExact, float InDefaultTimeoutSeconds);
+
+    /**
+     * Passa a ouvir as tags de fim/falha do item atual e inicia o timeout.
+     * Retorna false se a espera nunca poderia disparar (sem ASC alvo ou sem tags de fim/falha).
+     */
+    bool StartWaiting();
+
+    // Para de aceitar eventos do item atual e cancela o timeout. As ligações com o ASC são mantidas
+    // para o próximo item com as mesmas tags; eventos recebidos enquanto desarmada são ignorados.
+    void Disarm();
+
+    bool IsArmed() const { return bArmed; }
+    bool IsReusable() const { return bReusable; }
 
     // Helpers
     TObjectPtr<UAbilitySystemComponent> GetTargetASC() const; 
@@ -73,10 +110,13 @@ public:
     virtual void OnDestroy(bool AbilityEnding) override;
 
 protected:
-    // O item da fila que esta tarefa está esperando
+    // O item da fila que esta tarefa está esperando.
+    // UPROPERTY para que o GC enxergue UserPayload e os objetos do TaskPayload enquanto a ação roda.
+    UPROPERTY()
     FIQT_QueueItem QueueItemData;
 
-    // Dados pré-preparados para o disparo do evento associado a este item.
+    // Dados pré-preparados para o disparo do evento associado a este item (também referenciam o payload).
+    UPROPERTY()
     FIQT_TriggerData TriggerDataToUse;
 
     // Tags que estamos esperando (inicializadas do QueueItemData)
@@ -90,14 +130,49 @@ protected:
     bool bOnlyTriggerOnce;
     bool bOnlyMatchExact;
 
+    // Espera reutilizável (CreateReusableWaitTask): após o resultado é desarmada em vez de encerrada.
+    bool bReusable;
+
+    // Verdadeiro entre StartWaiting e o resultado (ou Disarm). Eventos fora desse intervalo são ignorados.
+    bool bArmed;
+
+    // Timeout efetivo desta espera (do item ou o padrão informado) e o identificador na UIQT_TimeoutSubsystem.
+    float TimeoutSeconds;
+    uint64 TimeoutId;
+
     // Handles para as ligações de delegate
     FDelegateHandle SuccessHandle;
     FDelegateHandle FailHandle;
 
+    // Tags, modo e ASC das ligações atuais. Podem diferir de SuccessTag/FailTag depois de um ReArm.
+    FGameplayTag BoundSuccessTag;
+    FGameplayTag BoundFailTag;
+    bool bBoundMatchExact;
+    TWeakObjectPtr<UAbilitySystemComponent> BoundASC;
+
+    // Liga os callbacks ao ASC alvo, reaproveitando as ligações existentes quando tags, modo e ASC não mudaram.
+    void BindEventListeners(UAbilitySystemComponent* TargetASC);
+    void UnbindEventListeners();
+
+    // Chamado por todos os callbacks de resultado: desarma (ou encerra) a espera conforme bOnlyTriggerOnce.
+    // A espera é desarmada ANTES do broadcast, pois o ouvinte pode re-armá-la no mesmo callback.
+    void PrepareResultBroadcast();
+    void FinishResultBroadcast();
+
+    // Dispara o delegate dinâmico (apenas se houver ligações) e depois o nativo correspondente ao resultado.
+    void BroadcastResult(bool bSucceeded, const FGameplayEventData& Payload, const FGameplayTag& EventTag, AActor* EventTargetActor);
+
     // Callbacks para os eventos - Agora com a tag que combinou e o ator alvo
     void OnExactSuccessEvent(const FGameplayEventData* Payload);
     void OnExactFailEvent(const FGameplayEventData* Payload);
 
     void OnContainerSuccessEvent(FGameplayTag MatchedTag, const FGameplayEventData* Payload);
     void OnContainerFailEvent(FGameplayTag MatchedTag, const FGameplayEventData* Payload);
+
+    // Registra/cancela o prazo desta espera na roda de timeouts compartilhada do mundo.
+    void StartTimeout();
+    void ClearTimeout();
+
+    // Chamado pela UIQT_TimeoutSubsystem quando o prazo expira sem tag de fim ou falha.
+    void OnTimeoutExpired();
 };